@@ -31,6 +31,9 @@ AHT20 I2C Registers
 #define AHT20_TEMP_CONVERSION_FACTOR	0.00019073486
 #define AHT20_HUMID_CONVERSION_FACTOR	1048576.0f
 
+#define AHT20_MEASUREMENT_TIME_MS		80	// Time from trigger to data ready
+#define AHT20_TASK_DEFAULT_INTERVAL_MS	30000
+
 // Sensor Data Struct
 typedef struct AHT20_Data {
 	float temperature;		// In Degrees Celsius
@@ -38,6 +41,11 @@ typedef struct AHT20_Data {
 	SYS_RESULT validity;
 }AHT20_Data_t;
 
+// Scheduler task handles, SCHEDULER_NO_TASK if the AHT20 is switchboard
+// disabled
+extern Scheduler_Task_ID_t AHT20_Request_Measurement_Task_ID;
+extern Scheduler_Task_ID_t AHT20_Get_Data_Task_ID;
+
 // Function Declarations
 bool AHT20_Init(I2C_HandleTypeDef *hi2c, uint32_t timeout);
 SYS_RESULT AHT20_Request_Measurement(I2C_HandleTypeDef *hi2c);
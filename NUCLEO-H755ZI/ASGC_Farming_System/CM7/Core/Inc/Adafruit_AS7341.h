@@ -58,11 +58,18 @@
 #define _ADAFRUIT_AS7341_H
 
 #include "stm32h7xx_hal.h"
+#include "main.h" // For the scheduler task handle type
 #include <stdbool.h>
 
 #define AS7341_I2CADDR_DEFAULT 0x39 ///< AS7341 default i2c address
 #define AS7341_CHIP_ID 0x09         ///< AS7341 default device id from WHOAMI
 
+#define AS7341_TASK_DEFAULT_INTERVAL_MS 30000            ///< Spectral reading interval
+#define AS7341_TASK_BUDGET_MS 600   ///< Reading all channels takes two integrations
+#define AS7341_DLI_TASK_INTERVAL_MS 30000                ///< DLI integration from the data bus
+#define AS7341_DLI_MAX_SAMPLE_GAP_MS (2 * AS7341_TASK_DEFAULT_INTERVAL_MS) ///< Longer gaps are not integrated
+#define AS7341_PPFD_PER_BASIC_COUNT 1.0f ///< umol/m^2/s per F1-F8 basic count, uncalibrated until checked against a PAR meter
+
 #define AS7341_WHOAMI 0x92 ///< Chip ID register
 
 //#define AS7341_ASTATUS 0x60    ///< AS7341_ASTATUS (unused)
@@ -252,6 +259,13 @@
 		AS7341_WAITING_DONE,//
 	}as7341_waiting_t;
 
+		/**
+		 * @brief Scheduler task handles, SCHEDULER_NO_TASK if the AS7341 is
+		 * switchboard disabled
+		 */
+		extern Scheduler_Task_ID_t AS7341_Get_Data_Task_ID;
+		extern Scheduler_Task_ID_t AS7341_Integrate_DLI_Task_ID;
+
 		bool Adafruit_AS7341_begin(uint8_t i2c_addr, I2C_HandleTypeDef *i2c_handle,
 				int32_t sensor_id);
 
@@ -265,6 +279,10 @@
 
 		long Adafruit_AS7341_getTINT();
 		float Adafruit_AS7341_toBasicCounts(uint16_t raw);
+		float Adafruit_AS7341_updateDLI(void);
+		void Adafruit_AS7341_resetDLI(void);
+		float Adafruit_AS7341_getDLI(void);
+		void Adafruit_AS7341_restoreDLI(float dli_mol_m2);
 
 		bool Adafruit_AS7341_ReadAllChannels(void);
 		bool Adafruit_AS7341_readAllChannels(uint16_t *readings_buffer);
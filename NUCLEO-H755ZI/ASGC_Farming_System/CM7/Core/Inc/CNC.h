@@ -44,6 +44,36 @@
 						/* Y offset of the seed dispenser dispensing tube	 */
 						/* from the absolute CNC Position. Value TBD		 */
 
+#define CNC_DISPENSE_SEEDS_TASK_DEFAULT_INTERVAL_MS	100
+#define CNC_DISPENSE_SEEDS_TASK_BUDGET_MS	100
+						/* A G-code send or a position request, with retries */
+
+// Seed dispensing sequence, per hole
+#define CNC_DISPENSE_MOVE_TIMEOUT_MS		40000
+						/* Time allowed for the gantry to reach a hole. 	 */
+						/* Dispensing fails if it is not in position by then */
+#define CNC_DISPENSE_MOVE_ATTEMPTS			3
+						/* Sends of the move to a hole before giving up		 */
+#define CNC_DISPENSE_MOVE_RETRY_MS			500
+						/* Wait before sending a failed move again			 */
+#define CNC_DISPENSE_POSITION_POLL_MS		250
+						/* How often the Raspberry Pi is asked whether the	 */
+						/* gantry has reached the hole						 */
+#define CNC_POSITION_TOLERANCE_MM			0.5
+						/* Distance from the target still counted as there	 */
+#define CNC_DISPENSE_SHUTTER_OPEN_MS		500
+						/* Time the shutter is open for seeds to drop		 */
+#define CNC_DISPENSE_SHUTTER_CLOSE_MS		2000
+						/* Time for the shutter to close before moving on	 */
+#define CNC_HOMING_POLL_MS					500
+						/* How often the Raspberry Pi is asked whether the	 */
+						/* gantry has finished homing						 */
+#define CNC_HOMING_TASK_BUDGET_MS			100
+						/* A position request, with retries					 */
+#define CNC_DISPENSE_PARK_X_POS_MM			10.0
+#define CNC_DISPENSE_PARK_Y_POS_MM			10.0
+						/* Where the head is moved to once dispensing is done*/
+
 
 typedef struct {
 	float x_pos; 		/* Hole X position in mm 						 	 */
@@ -63,6 +93,14 @@ typedef enum {
 	CNC_TOOL_LIFTER_ARM,
 } CNC_Tool_Reference;
 
+/*-----------------------------------------------------------------------------
+TASK HANDLES
+-----------------------------------------------------------------------------*/
+extern Scheduler_Task_ID_t CNC_Dispense_Seeds_Task_ID;
+extern Scheduler_Task_ID_t CNC_Check_Homing_Task_ID;
+						/* SCHEDULER_NO_TASK if the Raspberry Pi interface	 */
+						/* is switchboard disabled							 */
+
 /*-----------------------------------------------------------------------------
 FUNCTION DECLARATIONS
 -----------------------------------------------------------------------------*/
@@ -71,9 +109,18 @@ uint8_t* CNC_Find_Hole_Closest_To_Position(float x_pos, float y_pos);
 
 
 SYS_RESULT CNC_Home_Command(void);
+SYS_RESULT CNC_Start_Homing(void);
+SYS_RESULT CNC_Check_Homing(void);
+void CNC_Stop_Homing(void);
+SYS_RESULT CNC_Emergency_Stop(void);
 SYS_RESULT CNC_Move_To_Pos(float x_pos, float y_pos);
 SYS_RESULT CNC_Move_To_Hole(uint8_t channel_index, uint8_t hole_index, CNC_Tool_Reference tool_to_use);
 SYS_RESULT CNC_Dispense_Seeds();
+void CNC_Start_Dispensing_Seeds();
+bool CNC_Is_Dispensing_Seeds();
+uint8_t CNC_Get_Holes_Dispensed();
+void CNC_Set_Holes_Dispensed(uint8_t holes);
+bool CNC_Is_In_Position();
 
 
 #endif /* __CNC_H */
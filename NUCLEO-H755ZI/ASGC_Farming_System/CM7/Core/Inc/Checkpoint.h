@@ -0,0 +1,72 @@
+/*-----------------------------------------------------------------------------
+ *
+ * 	Checkpoint.h
+ *
+ * 		Checkpoint of the FSM and seed dispensing progress, so the system
+ * 		picks up where it left off after a reset instead of starting over
+ * 		from FSM_STATE_INIT. The reservoir calibration is kept with it, so
+ * 		it is not learned again after every reset.
+ *
+ * 		The checkpoint is kept in the 4 KB backup SRAM, which is not cleared
+ * 		by a reset, brownout reset or watchdog reset, and is kept on VBAT
+ * 		through a power loss if a backup battery is fitted. It is written on
+ * 		every FSM transition, after every hole the dispenser is done with,
+ * 		and every CHECKPOINT_INTERVAL_MS by the checkpoint task for the DLI
+ * 		and the state times. Each write goes to the older of two slots, with
+ * 		a CRC, so a reset in the middle of a write leaves the other one.
+ *
+ * 		Timestamps restart at 0 with the board, so times are saved as how
+ * 		long things have been going, not as timestamps. The time the board
+ * 		was off is not counted.
+ *
+ *  Created on: Oct 16, 2026
+ *
+-----------------------------------------------------------------------------*/
+
+#ifndef INC_CHECKPOINT_H_
+#define INC_CHECKPOINT_H_
+
+/*-----------------------------------------------------------------------------
+INCLUDES
+-----------------------------------------------------------------------------*/
+#include "main.h"
+#include "FSM.h"
+
+/*-----------------------------------------------------------------------------
+DEFINES
+-----------------------------------------------------------------------------*/
+#define CHECKPOINT_INTERVAL_MS									5000
+						/* DLI and state times lost to a reset		 */
+#define CHECKPOINT_TASK_BUDGET_MS								SCHEDULER_DEFAULT_TASK_BUDGET_MS
+
+/*-----------------------------------------------------------------------------
+TYPEDEFS
+-----------------------------------------------------------------------------*/
+
+// What is resumed after a reset
+typedef struct Checkpoint_Data {
+	FSM_State state;
+	uint64_t uptime_ms;					/* FSM_GetSystemUptime()			 */
+	uint64_t state_residency_ms[NUM_FSM_STATES];
+										/* Including the stay in 'state'	 */
+	float dli_mol_m2;					/* Light integral of the day so far	 */
+	uint32_t dli_day;					/* Wall_Clock_Get_Local_Day() of it	 */
+	uint8_t holes_dispensed;			/* Holes the dispenser is done with	 */
+	float fill_rate_mm_s;				/* Reservoir_Get_Fill_Rate()		 */
+	uint16_t full_range_mm;				/* Reservoir_Get_Full_Range_mm()	 */
+}Checkpoint_Data_t;
+
+/*-----------------------------------------------------------------------------
+TASK HANDLES
+-----------------------------------------------------------------------------*/
+extern Scheduler_Task_ID_t Checkpoint_Save_Task_ID;
+
+/*-----------------------------------------------------------------------------
+FUNCTION DECLARATIONS
+-----------------------------------------------------------------------------*/
+void Checkpoint_Init();
+bool Checkpoint_Load(Checkpoint_Data_t *data);
+void Checkpoint_Save();
+
+
+#endif /* INC_CHECKPOINT_H_ */
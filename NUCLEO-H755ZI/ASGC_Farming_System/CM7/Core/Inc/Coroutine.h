@@ -0,0 +1,131 @@
+/*-----------------------------------------------------------------------------
+ *
+ * 	Coroutine.h
+ *
+ * 		Stackless coroutines (protothreads) for scheduler tasks. A long
+ * 		sequence can be written top to bottom in one task function, and each
+ * 		CO_AWAIT_... returns from the task function until the wait is over,
+ * 		instead of blocking the main loop. The next call resumes the function
+ * 		right after the wait.
+ *
+ * 		SYS_RESULT Example_TASK() {
+ * 			static Coroutine_t co;
+ *
+ * 			CO_BEGIN(&co);
+ * 			Open_Valve();
+ * 			CO_AWAIT_MS(&co, 2000);
+ * 			Close_Valve();
+ * 			CO_END(&co);
+ * 		}
+ *
+ * 		Rules that come with being stackless:
+ * 		- Local variables are lost at every wait. Keep anything that has to
+ * 		  live across a wait in static or file scope variables.
+ * 		- Only one CO_AWAIT_... per line, and no switch statement around a
+ * 		  wait, as the resume point is a case label made from __LINE__.
+ * 		- A wait returns SYS_SUCCESS from the task function.
+ *
+ * 		When the task runs under the scheduler, CO_AWAIT_MS and
+ * 		CO_AWAIT_EVENT tell the scheduler when to run it next, so the task
+ * 		is not run again before it can make progress. CO_AWAIT_CONDITION is
+ * 		polled at the task's interval. A task only counts as finished, and
+ * 		triggers its successors, when it returns without waiting.
+ *
+ *  Created on: Oct 16, 2026
+ *
+-----------------------------------------------------------------------------*/
+
+#ifndef INC_COROUTINE_H_
+#define INC_COROUTINE_H_
+
+/*-----------------------------------------------------------------------------
+INCLUDES
+-----------------------------------------------------------------------------*/
+#include "main.h"
+#include "Scheduler.h"
+#include "timer.h"
+
+/*-----------------------------------------------------------------------------
+TYPEDEFS
+-----------------------------------------------------------------------------*/
+typedef struct Coroutine {
+	uint16_t line;						/* Line to resume at, 0 to start	 */
+	uint64_t deadline;					/* End of the current timed wait	 */
+	Scheduler_Wait_Result_t wait_result;/* How the last event wait ended	 */
+}Coroutine_t;
+
+/*-----------------------------------------------------------------------------
+MACROS
+-----------------------------------------------------------------------------*/
+
+// Start of the coroutine body
+#define CO_BEGIN(co)														\
+	switch ((co)->line) {													\
+		case 0:
+
+// End of the coroutine body. The coroutine starts over on the next call.
+#define CO_END(co)															\
+	}																		\
+	(co)->line = 0;															\
+	return SYS_SUCCESS
+
+// Leave the coroutine with result, it starts over on the next call
+#define CO_EXIT(co, result)													\
+	do {																	\
+		(co)->line = 0;														\
+		return (result);													\
+	} while (0)
+
+// Return until cond is true. cond is evaluated again on every call.
+#define CO_WAIT_UNTIL(co, cond)												\
+	do {																	\
+		(co)->line = __LINE__;												\
+		case __LINE__:														\
+		if (!(cond)) {														\
+			return SYS_SUCCESS;												\
+		}																	\
+	} while (0)
+
+// Wait for ms milliseconds
+#define CO_AWAIT_MS(co, ms)													\
+	do {																	\
+		(co)->deadline = getTimestamp() + (ms);								\
+		CO_WAIT_UNTIL(co, Scheduler_Sleep_Until((co)->deadline));			\
+	} while (0)
+
+// Wait for a condition, checked each time the task runs
+#define CO_AWAIT_CONDITION(co, cond)										\
+	do {																	\
+		(co)->line = __LINE__;												\
+		case __LINE__:														\
+		if (!(cond)) {														\
+			Scheduler_Yield();												\
+			return SYS_SUCCESS;												\
+		}																	\
+	} while (0)
+
+// Wait for event to be posted with Scheduler_Post_Event()
+#define CO_AWAIT_EVENT(co, event)											\
+	do {																	\
+		(co)->deadline = SCHEDULER_NOT_SCHEDULED;							\
+		CO_WAIT_UNTIL(co, ((co)->wait_result = Scheduler_Wait_For_Event(	\
+			(event), (co)->deadline)) != SCHEDULER_WAIT_PENDING);			\
+	} while (0)
+
+// Wait for event to be posted, or for timeout_ms. Check CO_TIMED_OUT()
+// afterwards to tell the two apart.
+#define CO_AWAIT_EVENT_TIMEOUT(co, event, timeout_ms)						\
+	do {																	\
+		(co)->deadline = getTimestamp() + (timeout_ms);						\
+		CO_WAIT_UNTIL(co, ((co)->wait_result = Scheduler_Wait_For_Event(	\
+			(event), (co)->deadline)) != SCHEDULER_WAIT_PENDING);			\
+	} while (0)
+
+#define CO_TIMED_OUT(co)		((co)->wait_result == SCHEDULER_WAIT_TIMEOUT)
+
+// Coroutine state
+#define CO_RESET(co)			((co)->line = 0)
+#define CO_IS_RUNNING(co)		((co)->line != 0)
+
+
+#endif /* INC_COROUTINE_H_ */
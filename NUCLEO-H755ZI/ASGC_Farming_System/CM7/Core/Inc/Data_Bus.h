@@ -0,0 +1,99 @@
+/*-----------------------------------------------------------------------------
+ *
+ * 	Data_Bus.h
+ *
+ * 		Publish/subscribe bus for sensor readings. The acquisition tasks
+ * 		publish each reading to its topic and return; the consumers (the
+ * 		Raspberry Pi link, the display, the DLI integrator) pick the readings
+ * 		up on their own schedule, so a slow consumer no longer holds up the
+ * 		sensor it reads from.
+ *
+ * 		Two ways to consume a topic:
+ * 		- Data_Bus_Read_Latest() copies the newest reading of a topic. The
+ * 		  slot is a seqlock, so a reader never sees half of a reading that is
+ * 		  being published. For consumers that only care about the current
+ * 		  value, like the display.
+ * 		- Data_Bus_Subscribe() gives a consumer its own queue of every
+ * 		  reading on the topics it subscribed to, read with
+ * 		  Data_Bus_Receive(). When the queue is full the oldest reading is
+ * 		  dropped and counted.
+ *
+ * 		Each topic must only be published from one task.
+ *
+ *  Created on: Oct 16, 2026
+ *
+-----------------------------------------------------------------------------*/
+
+#ifndef INC_DATA_BUS_H_
+#define INC_DATA_BUS_H_
+
+/*-----------------------------------------------------------------------------
+INCLUDES
+-----------------------------------------------------------------------------*/
+#include "main.h"
+#include "AHT20.h"
+#include "SEN0169.h"
+#include "SEN0244.h"
+
+/*-----------------------------------------------------------------------------
+DEFINES
+-----------------------------------------------------------------------------*/
+#define DATA_BUS_MAX_SUBSCRIBERS								4
+#define DATA_BUS_QUEUE_LENGTH									8
+						/* Readings a subscriber can fall behind by	 */
+#define DATA_BUS_NO_SUBSCRIBER									0xFF
+#define DATA_BUS_SEQLOCK_MAX_RETRIES							4
+						/* A reader interrupting the publisher gives */
+						/* up instead of spinning forever			 */
+#define DATA_BUS_AS7341_NUM_CHANNELS							12
+
+#define DATA_BUS_TOPIC_MASK(topic)								(1UL << (topic))
+
+/*-----------------------------------------------------------------------------
+TYPEDEFS
+-----------------------------------------------------------------------------*/
+
+// Topics, one per kind of reading
+typedef uint8_t Data_Bus_Topic_t;
+enum {
+	DATA_BUS_TOPIC_AHT20,				// Air temperature and humidity
+	DATA_BUS_TOPIC_SEN0169,				// Water pH
+	DATA_BUS_TOPIC_SEN0244,				// Water TDS
+	DATA_BUS_TOPIC_AS7341,				// Spectral channel counts
+	DATA_BUS_TOPIC_VL53L1X,				// Range to the reservoir water surface
+	DATA_BUS_NUM_TOPICS,
+};
+
+typedef uint8_t Data_Bus_Subscriber_ID_t;
+
+// A reading of any topic
+typedef union Data_Bus_Value {
+	AHT20_Data_t aht20;
+	SEN0169_pH_Data pH;
+	SEN0244_TDS_Data tds;
+	uint16_t as7341[DATA_BUS_AS7341_NUM_CHANNELS];
+	uint16_t vl53l1x_range_mm;
+}Data_Bus_Value_t;
+
+typedef struct Data_Bus_Sample {
+	Data_Bus_Topic_t topic;
+	uint32_t sequence;					/* Readings published on the topic,	 */
+										/* including this one				 */
+	uint64_t timestamp;					/* When the reading was published	 */
+	Data_Bus_Value_t value;
+}Data_Bus_Sample_t;
+
+/*-----------------------------------------------------------------------------
+FUNCTION DECLARATIONS
+-----------------------------------------------------------------------------*/
+void Data_Bus_Init();
+void Data_Bus_Publish(Data_Bus_Topic_t topic, const Data_Bus_Value_t *value);
+bool Data_Bus_Read_Latest(Data_Bus_Topic_t topic, Data_Bus_Sample_t *sample);
+Data_Bus_Subscriber_ID_t Data_Bus_Subscribe(uint32_t topic_mask);
+bool Data_Bus_Peek(Data_Bus_Subscriber_ID_t subscriber_id, Data_Bus_Sample_t *sample);
+void Data_Bus_Consume(Data_Bus_Subscriber_ID_t subscriber_id);
+bool Data_Bus_Receive(Data_Bus_Subscriber_ID_t subscriber_id, Data_Bus_Sample_t *sample);
+uint32_t Data_Bus_Get_Dropped_Count(Data_Bus_Subscriber_ID_t subscriber_id);
+
+
+#endif /* INC_DATA_BUS_H_ */
@@ -21,23 +21,31 @@ INCLUDES
 DEFINES
 -----------------------------------------------------------------------------*/
 
-extern uint32_t unixTimeRefSec;
-#define FSM_STATE_FILL_RESERVOIR_DWELL_TIME         120000
+#define FSM_STATE_FILL_RESERVOIR_TIMEOUT            120000
+                        /* Longest fill. The whole fill without the      */
+                        /* VL53L1X, or before the full level is          */
+                        /* calibrated, see Reservoir.h. The VL53L1X ends */
+                        /* it on the level otherwise                     */
+#define FSM_STATE_CNC_HOMING_TIMEOUT                90000
+                        /* Homing, started with the fill, normally ends  */
+                        /* on FSM_EVENT_CNC_HOMED. Still not homed this  */
+                        /* long after the fill is a fault                */
+#define FSM_NO_PENDING_UPDATE_MS                    0xFFFFFFFF
+#define FSM_EVENT_QUEUE_LENGTH                      8
+#define FSM_EVENT_MASK(event)                       (1UL << (event))
+#define FSM_TRACE_LENGTH                            16
+                        /* Transitions kept by the trace, the oldest is  */
+                        /* overwritten                                   */
+#define FSM_ESTOP_RESET_POLL_MS                     500
+                        /* How often the Raspberry Pi is asked whether   */
+                        /* the E-stop has been reset                     */
+#define FSM_ESTOP_RESET_TASK_BUDGET_MS              100
+                        /* A request to the Raspberry Pi, with retries   */
 
 /*-----------------------------------------------------------------------------
 TYPEDEFS
 -----------------------------------------------------------------------------*/
 
-typedef struct FSM_State_Struct{
-    bool stateActivated;                        /* Has state activation function */
-                                                /* ran yet?                      */
-    uint64_t stateStartTimestamp;               /* Time that state was started   */
-    SYS_RESULT (*state_activation_funciton)();  /* Function to run when          */
-                                                /* transitioning to this state   */
-    SYS_RESULT (*transition_check_function)();  /* Periodic function to check for*/
-                                                /* transitions out of this state */
-}FSM_State_Struct_t;
-
 typedef uint16_t FSM_State;
 enum {
     FSM_STATE_INIT,
@@ -47,38 +55,105 @@ enum {
     FSM_STATE_SEED_DISPENSE,
     FSM_STATE_GROWTH_MONITORING,
     // ...
+    FSM_STATE_FAULT,
     FSM_STATE_ESTOP_PRESSED,
     NUM_FSM_STATES
 };
 
+// Everything that can move the FSM to another state. Posted with
+// FSM_Post_Event(), except FSM_EVENT_TIMEOUT.
+typedef uint8_t FSM_Event_t;
+enum {
+    FSM_EVENT_INITIALIZED,                      // FSM_Init() is done
+    FSM_EVENT_START_PRESSED,                    // Start button
+    FSM_EVENT_TIMEOUT,                          // State's timeout_ms elapsed
+    FSM_EVENT_SEEDS_DISPENSED,                  // Dispensing task finished
+    FSM_EVENT_RESERVOIR_FILLED,                 // Level reached, valve closed
+    FSM_EVENT_CNC_HOMED,                        // Pi reports X and Y homed
+    FSM_EVENT_CNC_HOMING_FAILED,                // Homing not sent, or Pi
+                                                // reports a Klipper error
+    FSM_EVENT_RESUMED,                          // FSM_Init() found a checkpoint
+                                                // of the growth phase, or the
+                                                // E-stop was reset in it
+    FSM_EVENT_ESTOP_PRESSED,                    // FSM_EStop(), not posted
+    FSM_EVENT_ESTOP_RESET,                      // Verified reset from the Pi
+    FSM_EVENT_SEED_DISPENSE_FAILED,             // Gantry not confirmed at a
+                                                // hole, nothing dropped there
+    NUM_FSM_EVENTS
+};
+
+// One row of a state's transition table
+typedef struct FSM_Transition {
+    FSM_Event_t event;
+    FSM_State nextState;
+}FSM_Transition_t;
+
+// One transition recorded by the trace
+typedef struct FSM_Trace_Entry {
+    uint64_t timestamp;                         /* getTimestamp() of the entry   */
+    FSM_State fromState;
+    FSM_State toState;
+    FSM_Event_t cause;                          /* Event that fired the          */
+                                                /* transition                    */
+}FSM_Trace_Entry_t;
+
+typedef struct FSM_State_Struct{
+    uint64_t stateStartTimestamp;               /* Time that state was started   */
+    SYS_RESULT (*state_activation_funciton)();  /* Function to run when          */
+                                                /* transitioning to this state   */
+    uint32_t timeout_ms;                        /* FSM_EVENT_TIMEOUT this long   */
+                                                /* after entry, 0 for none       */
+    const FSM_Transition_t *transitions;        /* Events handled in this state, */
+                                                /* others are ignored            */
+    uint8_t numTransitions;
+    uint32_t deferredEvents;                    /* FSM_EVENT_MASK()s of events   */
+                                                /* kept for the next state       */
+                                                /* instead of being ignored      */
+}FSM_State_Struct_t;
+
+/*-----------------------------------------------------------------------------
+TASK HANDLES
+-----------------------------------------------------------------------------*/
+extern Scheduler_Task_ID_t FSM_Check_EStop_Reset_Task_ID;
+                        /* SCHEDULER_NO_TASK if the Raspberry Pi         */
+                        /* interface is switchboard disabled             */
+
 /*-----------------------------------------------------------------------------
 FUNCTION DECLARATIONS
 -----------------------------------------------------------------------------*/
 SYS_RESULT FSM_Init();
 void FSM_Update();
-
-/* FSM_STATE_INIT */
-SYS_RESULT FSM_State_INIT_TCF();
+bool FSM_Post_Event(FSM_Event_t event);
+uint32_t FSM_Get_Ms_Until_Next_Update();
+FSM_State FSM_Get_State();
+SYS_RESULT FSM_Check_Transition_Table();
+uint8_t FSM_Get_Trace(FSM_Trace_Entry_t *entries, uint8_t maxEntries);
+uint32_t FSM_Get_Num_Transitions();
+uint64_t FSM_Get_State_Residency_ms(FSM_State state);
+const char *FSM_Get_State_Name(FSM_State state);
+void FSM_EStop();
+SYS_RESULT FSM_Check_EStop_Reset();
 
 /* FSM_STATE_WAITING_ON_START */
 SYS_RESULT FSM_State_WAITING_ON_START_SAF();
-SYS_RESULT FSM_State_WAITING_ON_START_TCF();
 
 /* FSM_STATE_FILL_RESERVOIR */
 SYS_RESULT FSM_State_FILL_RESERVOIR_SAF();
-SYS_RESULT FSM_State_FILL_RESERVOIR_TCF();
 
 /* FSM_STATE_CNC_HOMING */
 SYS_RESULT FSM_State_CNC_HOMING_SAF();
-SYS_RESULT FSM_State_CNC_HOMING_TCF();
 
 /* FSM_STATE_SEED_DISPENSE */
 SYS_RESULT FSM_State_SEED_DISPENSE_SAF();
-SYS_RESULT FSM_State_SEED_DISPENSE_TCF();
 
 /* FSM_STATE_GROWTH_MONITORING */
 SYS_RESULT FSM_State_GROWTH_MONITORING_SAF();
-SYS_RESULT FSM_State_GROWTH_MONITORING_TCF();
+
+/* FSM_STATE_FAULT */
+SYS_RESULT FSM_State_FAULT_SAF();
+
+/* FSM_STATE_ESTOP_PRESSED */
+SYS_RESULT FSM_State_ESTOP_PRESSED_SAF();
 
 uint64_t FSM_GetSystemUptime();
 
@@ -38,9 +38,12 @@ typedef enum {
 	VLIFTER_GO_UP,
 	VLIFTER_HOLD
 } vlifter_state;
-volatile static uint64_t pwm_counter = 0;
 volatile static vlifter_state VLifter_State = VLIFTER_RESET;
-volatile static _Bool VLifter_BobUp = 0;
+
+// Vertical Lifter motion timing
+#define PWM_VLIFTER_DOWN_MS         3000    // Time to lower the lifter
+#define PWM_VLIFTER_BOB_UP_MS       500     // Slight raise at the end of lowering
+#define PWM_VLIFTER_UP_MS           2500    // Time to raise the lifter
 
 // PWM Success/Failure Defines
 #define PWM_INIT_FAIL		        false
@@ -109,6 +112,7 @@ uint16_t PWMServo_GetDutyForConfig(PWM_Servo_Config config);
 SYS_RESULT PWM_VerticalServo_ResetDutyTask(void *arg);
 SYS_RESULT PWM_VerticalServo_DownTask(void *arg);
 SYS_RESULT PWM_VerticalServo_UpTask(void *arg);
+bool PWM_VerticalServo_Is_Moving();
 
 SYS_RESULT PWM_ShutterServo_OpenTask(void *arg);
 SYS_RESULT PWM_ShutterServo_CloseTask(void *arg);
@@ -16,15 +16,36 @@
 #include "AHT20.h"
 #include "SEN0169.h"
 #include "SEN0244.h"
+#include "Scheduler.h"
+#include "Data_Bus.h"
+#include "Watchdog.h"
+#include "FSM.h"
 #include <stdbool.h>
 #include <stdio.h>
 
+// Sensor readings are sent in batches, from the data bus queue
+#define RPI_UART_SENSOR_DATA_TASK_INTERVAL_MS		1000
+#define RPI_UART_SENSOR_DATA_TASK_BUDGET_MS		60
+
+extern Scheduler_Task_ID_t RPI_UART_Send_Sensor_Data_Task_ID;
+
+void RPI_UART_Init();
+SYS_RESULT RPI_UART_Send_Sensor_Data();
 SYS_RESULT RPI_UART_Send_Gcode_Pkt( const char *gcode, uint32_t timeout );
 SYS_RESULT RPI_UART_Send_AHT20_Pkt(AHT20_Data_t aht20_data, uint32_t timeout);
 SYS_RESULT RPI_UART_Send_SEN0169_Pkt(SEN0169_pH_Data SEN0169_data, uint32_t timeout);
 SYS_RESULT RPI_UART_Send_SEN0244_Pkt(SEN0244_TDS_Data SEN0244_data, uint32_t timeout);
 SYS_RESULT RPI_UART_Send_AS7341_Pkt(uint16_t *AS7341_data, uint32_t timeout);
 SYS_RESULT RPI_UART_Send_RPI_UNIX_TIME_REQUEST_Pkt(uint32_t timeout);
+struct RPI_UART_Axes_Pos_Packet;
+SYS_RESULT RPI_UART_Request_Axes_Pos_Pkt(struct RPI_UART_Axes_Pos_Packet *axes_pos, uint32_t timeout);
+SYS_RESULT RPI_UART_Send_Task_Stats_Pkt(uint32_t timeout);
+SYS_RESULT RPI_UART_Send_Device_Status_Pkt(Scheduler_Task_ID_t task_id, Scheduler_Breaker_State_t breaker_state, uint32_t degraded_task_mask, uint32_t timeout);
+SYS_RESULT RPI_UART_Send_Watchdog_Reset_Pkt(const Watchdog_Reset_Info_t *reset_info, uint32_t timeout);
+SYS_RESULT RPI_UART_Send_Dispense_Hole_Pkt(uint8_t channel, uint8_t hole, uint32_t move_ms, uint32_t cycle_ms, bool move_confirmed, uint32_t timeout);
+SYS_RESULT RPI_UART_Send_FSM_Trace_Pkt(uint32_t timeout);
+struct RPI_UART_EStop_Reset_Packet;
+SYS_RESULT RPI_UART_Request_EStop_Reset_Pkt(uint32_t token, uint8_t state_before, bool released, struct RPI_UART_EStop_Reset_Packet *reset, uint32_t timeout);
 
 /*-----------------------------------------------------------------------------
 Raspberry Pi Packets
@@ -46,6 +67,14 @@ enum {
 	RPI_ACK_PKT_ID,
 	RPI_UNIX_TIME_REQUEST_PKT_ID,
 	RPI_UNIX_TIME_PKT_ID,
+	RPI_TASK_STATS_PKT_ID,
+	RPI_DEVICE_STATUS_PKT_ID,
+	RPI_WATCHDOG_RESET_PKT_ID,
+	RPI_AXES_POS_PKT_ID,		// Reply to RPI_GET_AXES_POS_PKT_ID
+	RPI_DISPENSE_HOLE_PKT_ID,
+	RPI_FSM_TRACE_PKT_ID,
+	RPI_ESTOP_STATUS_PKT_ID,	// E-stop state, asks for a reset
+	RPI_ESTOP_RESET_PKT_ID,		// Reply to RPI_ESTOP_STATUS_PKT_ID
 
 	RPI_UART_NUM_PKT_IDS			// Number of packet IDs
 };
@@ -147,6 +176,169 @@ typedef struct RPI_UART_Unix_Time {
 
 #define RPI_UART_Unix_Time_SIZE	sizeof(RPI_UART_Unix_Time_t)
 
+/*-----------------------------------------------------------------------------
+Scheduler task statistics packet
+One entry per scheduler task, indexed by task ID. Times are in microseconds,
+jitter is how late the task started compared to its planned time.
+-----------------------------------------------------------------------------*/
+typedef struct RPI_UART_Task_Stats_Entry {
+	uint32_t run_count;
+	uint32_t last_us;
+	uint32_t min_us;
+	uint32_t max_us;
+	uint32_t mean_us;
+	uint32_t overrun_count;
+	uint32_t max_start_jitter_ms;
+	uint32_t missed_periods;
+
+} RPI_UART_Task_Stats_Entry_t;
+
+typedef struct RPI_UART_Task_Stats_Packet {
+	RPI_Packet_ID packet_id;
+	uint8_t num_tasks;
+	uint16_t planned_utilization;	// Permille, over 1000 is infeasible
+	uint32_t idle_time_s;			// Time the CM7 spent in tickless idle
+	uint32_t max_watchdog_feed_gap_ms;	// Resets at WATCHDOG_TIMEOUT_MS
+	RPI_UART_Task_Stats_Entry_t task_stats[SCHEDULER_MAX_TASKS];	// Indexed by task handle
+
+} RPI_UART_Task_Stats_Packet_t;
+
+#define RPI_UART_TASK_STATS_PACKET_SIZE	sizeof(RPI_UART_Task_Stats_Packet_t)
+
+/*-----------------------------------------------------------------------------
+Device status packet
+Sent when a scheduler task is parked after repeated failures, or put back
+into service. degraded_task_mask has bit n set for every parked task ID n.
+-----------------------------------------------------------------------------*/
+typedef struct RPI_UART_Device_Status_Packet {
+	RPI_Packet_ID packet_id;
+	uint8_t task_id;
+	uint8_t breaker_state;
+	uint32_t degraded_task_mask;
+
+} RPI_UART_Device_Status_Packet_t;
+
+#define RPI_UART_DEVICE_STATUS_PACKET_SIZE	sizeof(RPI_UART_Device_Status_Packet_t)
+
+/*-----------------------------------------------------------------------------
+Watchdog reset packet
+Sent after the watchdog reset the board, naming the task that hung or ran
+late. task_id is 0xFF if the board hung outside of a task.
+-----------------------------------------------------------------------------*/
+typedef struct RPI_UART_Watchdog_Reset_Packet {
+	RPI_Packet_ID packet_id;
+	uint8_t cause;					// Watchdog_Cause_t
+	uint8_t task_id;
+	uint32_t task_elapsed_ms;		// Running or late for this long at the reset
+	uint32_t task_budget_ms;
+
+} RPI_UART_Watchdog_Reset_Packet_t;
+
+#define RPI_UART_WATCHDOG_RESET_PACKET_SIZE	sizeof(RPI_UART_Watchdog_Reset_Packet_t)
+
+/*-----------------------------------------------------------------------------
+Axes position packet
+Reply to a RPI_GET_AXES_POS_PKT_ID request. idle is true once Klipper has run
+every queued move, i.e. an M400 would return. homed is true once Klipper's
+homed_axes holds both x and y. error is true if homing failed or Klipper shut
+down, the gantry will not move until it is restarted. Positions are in mm.
+-----------------------------------------------------------------------------*/
+typedef struct RPI_UART_Axes_Pos_Packet {
+	RPI_Packet_ID packet_id;
+	bool idle;
+	bool homed;
+	bool error;
+	float x_pos;
+	float y_pos;
+
+} RPI_UART_Axes_Pos_Packet_t;
+
+#define RPI_UART_AXES_POS_PACKET_SIZE	sizeof(RPI_UART_Axes_Pos_Packet_t)
+
+/*-----------------------------------------------------------------------------
+Dispense hole packet
+Sent after each net pot hole is seeded. move_ms is the time the gantry took
+to get there, cycle_ms the whole hole including the shutter. move_confirmed
+is false if the gantry never reported in position and the move timeout was
+waited out instead.
+-----------------------------------------------------------------------------*/
+typedef struct RPI_UART_Dispense_Hole_Packet {
+	RPI_Packet_ID packet_id;
+	uint8_t channel;
+	uint8_t hole;
+	bool move_confirmed;
+	uint32_t move_ms;
+	uint32_t cycle_ms;
+
+} RPI_UART_Dispense_Hole_Packet_t;
+
+#define RPI_UART_DISPENSE_HOLE_PACKET_SIZE	sizeof(RPI_UART_Dispense_Hole_Packet_t)
+
+/*-----------------------------------------------------------------------------
+FSM trace packet
+The latest FSM transitions, oldest first, and the total time spent in each
+state. num_transitions counts every transition since boot, so the Raspberry
+Pi can tell which entries it has already logged and how many were lost.
+Timestamps are ms since boot, residencies include the current state up to
+timestamp_ms.
+-----------------------------------------------------------------------------*/
+typedef struct RPI_UART_FSM_Trace_Entry {
+	uint64_t timestamp_ms;
+	uint8_t from_state;
+	uint8_t to_state;
+	uint8_t cause;					// FSM event that fired the transition
+
+} RPI_UART_FSM_Trace_Entry_t;
+
+typedef struct RPI_UART_FSM_Trace_Packet {
+	RPI_Packet_ID packet_id;
+	uint8_t current_state;
+	uint8_t num_entries;
+	uint32_t num_transitions;
+	uint64_t timestamp_ms;
+	uint32_t residency_s[NUM_FSM_STATES];	// Indexed by FSM state
+	RPI_UART_FSM_Trace_Entry_t entries[FSM_TRACE_LENGTH];
+
+} RPI_UART_FSM_Trace_Packet_t;
+
+#define RPI_UART_FSM_TRACE_PACKET_SIZE	sizeof(RPI_UART_FSM_Trace_Packet_t)
+
+/*-----------------------------------------------------------------------------
+E-stop status packet
+Sent every FSM_ESTOP_RESET_POLL_MS while the E-stop is pressed, asking the
+Raspberry Pi whether the operator reset it. token is new for every E-stop,
+state_before is the FSM state the E-stop was pressed in, released is true
+once the E-stop button has been released.
+-----------------------------------------------------------------------------*/
+typedef struct RPI_UART_EStop_Status_Packet {
+	RPI_Packet_ID packet_id;
+	uint8_t state_before;
+	bool released;
+	uint32_t token;
+
+} RPI_UART_EStop_Status_Packet_t;
+
+#define RPI_UART_ESTOP_STATUS_PACKET_SIZE	sizeof(RPI_UART_EStop_Status_Packet_t)
+
+/*-----------------------------------------------------------------------------
+E-stop reset packet
+Reply to a RPI_ESTOP_STATUS_PKT_ID packet. reset is true once the operator has
+reset the E-stop. The reset is only taken if token is the token of the status
+packet and token_check its bitwise inverse, so neither a reset meant for an
+earlier E-stop nor a corrupted reply restarts the machine. Klipper must be
+restarted (FIRMWARE_RESTART) before the reset is sent, as the E-stop shut it
+down with M112.
+-----------------------------------------------------------------------------*/
+typedef struct RPI_UART_EStop_Reset_Packet {
+	RPI_Packet_ID packet_id;
+	bool reset;
+	uint32_t token;
+	uint32_t token_check;
+
+} RPI_UART_EStop_Reset_Packet_t;
+
+#define RPI_UART_ESTOP_RESET_PACKET_SIZE	sizeof(RPI_UART_EStop_Reset_Packet_t)
+
 /*-----------------------------------------------------------------------------
 ACK Packet Definition
 -----------------------------------------------------------------------------*/
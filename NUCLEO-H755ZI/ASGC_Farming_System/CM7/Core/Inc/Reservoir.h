@@ -0,0 +1,73 @@
+/*-----------------------------------------------------------------------------
+ *
+ * 	Reservoir.h
+ *
+ * 		Level controlled fill of the reservoir. The VL53L1X looks down at the
+ * 		water surface, so the range it reads shrinks as the reservoir fills.
+ * 		Reservoir_Start_Fill() opens the fill valve, and the fill check task
+ * 		closes it as soon as the level reaches the full range.
+ *
+ * 		The full range depends on where the sensor is mounted, so it is
+ * 		calibrated on the reservoir rather than built in. Until it is known,
+ * 		a fill runs for the whole FSM timeout, the timed fill the system
+ * 		always had, and the level it ends at becomes the full range.
+ *
+ * 		The rate the level rises at is learned across fills. Between two
+ * 		ranges the level is extrapolated with it, so the valve closes on time
+ * 		instead of up to a ranging period late, and the fill still ends at
+ * 		the predicted time if the sensor stops giving valid ranges (splashes,
+ * 		foam). Without the VL53L1X the fill is timed by the FSM instead.
+ *
+ *  Created on: Oct 16, 2026
+ *
+-----------------------------------------------------------------------------*/
+
+#ifndef INC_RESERVOIR_H_
+#define INC_RESERVOIR_H_
+
+/*-----------------------------------------------------------------------------
+INCLUDES
+-----------------------------------------------------------------------------*/
+#include "main.h"
+#include "FSM.h"
+
+/*-----------------------------------------------------------------------------
+DEFINES
+-----------------------------------------------------------------------------*/
+#define RESERVOIR_CHECK_INTERVAL_MS								100
+#define RESERVOIR_LEVEL_MAX_AGE_MS								2000
+						/* Older ranges are not the current level	 */
+
+// Calibrating the full range
+#define RESERVOIR_FULL_RANGE_UNKNOWN							0
+#define RESERVOIR_CALIBRATION_FILL_MS							(FSM_STATE_FILL_RESERVOIR_TIMEOUT - RESERVOIR_LEVEL_MAX_AGE_MS)
+						/* A fill open this long ran to the FSM		 */
+						/* timeout, its last range is the full one	 */
+
+// Learning the fill rate
+#define RESERVOIR_FILL_RATE_UNKNOWN								0.0f
+#define RESERVOIR_FILL_RATE_WEIGHT								0.25f
+						/* Weight of the latest fill in the average	 */
+#define RESERVOIR_MIN_LEARN_RISE_MM								10
+						/* Shorter rises are mostly sensor noise	 */
+
+/*-----------------------------------------------------------------------------
+TASK HANDLES
+-----------------------------------------------------------------------------*/
+extern Scheduler_Task_ID_t Reservoir_Check_Fill_Task_ID;
+						/* SCHEDULER_NO_TASK if the VL53L1X is		 */
+						/* switchboard disabled						 */
+
+/*-----------------------------------------------------------------------------
+FUNCTION DECLARATIONS
+-----------------------------------------------------------------------------*/
+void Reservoir_Init();
+SYS_RESULT Reservoir_Start_Fill();
+SYS_RESULT Reservoir_Check_Fill();
+void Reservoir_Stop_Fill();
+float Reservoir_Get_Fill_Rate();
+uint16_t Reservoir_Get_Full_Range_mm();
+void Reservoir_Restore_Calibration(float fill_rate, uint16_t full_range_mm);
+
+
+#endif /* INC_RESERVOIR_H_ */
@@ -23,6 +23,8 @@
 
 #define SEN0169_NUM_MEASUREMENTS	40
 
+#define SEN0169_TASK_DEFAULT_INTERVAL_MS	30000
+
 /*-------------------------------------------------------------------------
 EXPERIMENTALLY DETERMINED VALUE
 THIS CONVERSION FACTOR IS DETERMINED BY:
@@ -35,6 +37,10 @@ THIS CONVERSION FACTOR IS DETERMINED BY:
 
 typedef double SEN0169_pH_Data;
 
+// Scheduler task handles, SCHEDULER_NO_TASK if the SEN0169 is switchboard
+// disabled
+extern Scheduler_Task_ID_t SEN0169_Get_Data_Task_ID;
+
 /*-------------------------------------------------------------------------
 FUNCTION DECLARATIONS
 -------------------------------------------------------------------------*/
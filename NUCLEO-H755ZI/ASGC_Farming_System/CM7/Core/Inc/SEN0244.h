@@ -26,6 +26,15 @@ Defines and includes
 
 #define SEN0244_NUM_MEASUREMENTS				40
 
+#define SEN0244_TASK_DEFAULT_INTERVAL_MS		30000
+
+// Water temperature assumed when no recent temperature reading is available
+#define SEN0244_DEFAULT_TEMPERATURE_C			25.0
+
+// A reading is only temperature compensated with an AHT20 reading at most
+// this old (two AHT20 measurement periods)
+#define SEN0244_TEMPERATURE_MAX_AGE_MS			60000
+
 // NOTE: THIS VALUE MUST BE CHANGED ANY TIME THE PROBE IS CHANGED OR THE LENGTH
 // OF THE WIRES BETWEEN THE PROBE AND THE ADC IS CHANGED
 #define SEN0244_PROBE_CALIBRATION_OFFSET		-41.417
@@ -35,6 +44,12 @@ typedefs
 -----------------------------------------------------------------------------*/
 typedef double SEN0244_TDS_Data;
 
+/*-----------------------------------------------------------------------------
+Scheduler task handles, SCHEDULER_NO_TASK if the SEN0244 is switchboard
+disabled
+-----------------------------------------------------------------------------*/
+extern Scheduler_Task_ID_t SEN0244_Get_Data_Task_ID;
+
 /*-----------------------------------------------------------------------------
 Function Declarations
 -----------------------------------------------------------------------------*/
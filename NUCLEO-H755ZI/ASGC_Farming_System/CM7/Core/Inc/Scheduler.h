@@ -33,55 +33,219 @@ INCLUDES
 /*-----------------------------------------------------------------------------
 DEFINES
 -----------------------------------------------------------------------------*/
-#define AHT20_TASK_DEFAULT_INTERVAL_MS							30000
-#define SEN0169_TASK_DEFAULT_INTERVAL_MS						30000
-#define SEN0244_TASK_DEFAULT_INTERVAL_MS						30000
-#define AS7341_TASK_DEFAULT_INTERVAL_MS							30000
-#define AS7341_MIDNIGHT_CHECK_DEFAULT_INTERVAL_MS				60000
-#define CNC_DISPENSE_SEEDS_TASK_DEFAULT_INTERVAL_MS				100
-#define ILI9341_TASK_DEFAULT_INTERVAL_MS						20000
-#define ILI9341_UPDATE_UPTIME_INTERVAL_MS						60000
+#ifndef SCHEDULER_MAX_TASKS
+#define SCHEDULER_MAX_TASKS										16
+						/* Capacity of the task pool, IDs below		 */
+						/* SCHEDULER_NO_TASK							 */
+#endif
+#define SCHEDULER_SEND_TASK_STATS_INTERVAL_MS					60000
+
+// Execution time budgets. A run longer than its budget counts as an overrun
+#define SCHEDULER_DEFAULT_TASK_BUDGET_MS						10
+#define SCHEDULER_SEND_TASK_STATS_BUDGET_MS						90
+						/* Task statistics, and the FSM trace after	 */
+						/* a transition								 */
+
+#define SCHEDULER_NO_TASK										0xFF
+						/* Not a task, also the ready list index of	 */
+						/* a task that is not in the list			 */
+#define SCHEDULER_NO_PENDING_TASK_MS							0xFFFFFFFF
+						/* Returned when no task is enabled			 */
+#define SCHEDULER_PLAN_FULL_UTILIZATION							1000
+						/* Planned utilization is in permille		 */
+#define SCHEDULER_MAX_BURST_RUNS								3
+						/* Missed periods a bursting task catches up */
+
+// Failure handling. Failed runs are retried after SCHEDULER_BACKOFF_BASE_MS,
+// doubling on each failure. After SCHEDULER_BREAKER_FAILURE_THRESHOLD
+// failures in a row the task is parked and only probed occasionally.
+#define SCHEDULER_BACKOFF_BASE_MS								100
+#define SCHEDULER_BACKOFF_MAX_MS								5000
+#define SCHEDULER_BREAKER_FAILURE_THRESHOLD						5
+#define SCHEDULER_BREAKER_PROBE_INTERVAL_MS						60000
+#define SCHEDULER_BREAKER_PROBE_MAX_INTERVAL_MS					900000
+
+#define SCHEDULER_MAX_SUCCESSORS								3
+
+// Bus batching. Tasks on the same bus due within
+// SCHEDULER_BUS_BATCH_WINDOW_MS of each other run back to back, and the bus
+// is closed (see Scheduler_Set_Bus_Hooks()) once none is due within it.
+#define SCHEDULER_BUS_BATCH_WINDOW_MS							100
+
+// Watchdog. A critical task that runs, or is late to run, by more than
+// SCHEDULER_WATCHDOG_GRACE_MS past its budget stops the watchdog feed.
+#define SCHEDULER_WATCHDOG_GRACE_MS								1000
+#define SCHEDULER_NOT_SCHEDULED									UINT64_MAX
+						/* next_run_timestamp of a triggered task	 */
+						/* that is waiting on its predecessor		 */
 
 /*-----------------------------------------------------------------------------
 TYPEDEFS
 -----------------------------------------------------------------------------*/
 
+// Scheduler_Task_ID_t, the handle of a registered task, is in main.h so that
+// the drivers can hold the handles of their tasks
+
+// How the next run of a task is timed after it runs
+typedef uint8_t Scheduler_Run_Mode_t;
+enum {
+	SCHEDULER_RUN_FIXED_DELAY,		// interval_ms after the task finishes
+	SCHEDULER_RUN_FIXED_RATE,		// interval_ms after the task was due
+	SCHEDULER_RUN_TRIGGERED,		// Only when a predecessor task triggers it
+};
+
+// Peripheral bus a task talks over. The scheduler runs the tasks of a bus in
+// one window and can clock gate the bus between windows.
+typedef uint8_t Scheduler_Bus_t;
+enum {
+	SCHEDULER_BUS_NONE,
+	SCHEDULER_BUS_I2C1,				// AHT20, AS7341, VL53L1X
+	SCHEDULER_BUS_SPI1,				// ILI9341 display
+	SCHEDULER_BUS_UART7,			// Raspberry Pi
+	SCHEDULER_NUM_BUSES,
+};
+
+// Task run each time its predecessor succeeds, see Scheduler_Add_Successor()
+typedef struct Scheduler_Successor {
+	Scheduler_Task_ID_t task_id;
+	uint32_t delay_ms;					/* Delay before a triggered run		 */
+}Scheduler_Successor_t;
+
+// Events a task can wait for, see Scheduler_Wait_For_Event(). One bit each.
+typedef uint32_t Scheduler_Event_t;
+enum {
+	SCHEDULER_EVENT_NONE				= 0,
+};
+
+// Result of Scheduler_Wait_For_Event()
+typedef uint8_t Scheduler_Wait_Result_t;
+enum {
+	SCHEDULER_WAIT_PENDING,			// Still waiting, return from the task
+	SCHEDULER_WAIT_EVENT,			// The event was posted
+	SCHEDULER_WAIT_TIMEOUT,			// The timeout passed first
+};
+
+// What a fixed rate task does when it has missed whole periods
+typedef uint8_t Scheduler_Catch_Up_t;
+enum {
+	SCHEDULER_CATCH_UP_SKIP,		// Drop missed periods, wait for the next one
+	SCHEDULER_CATCH_UP_RUN_ONCE,	// Run once now for all missed periods
+	SCHEDULER_CATCH_UP_BURST,		// Run once per missed period, up to
+									// SCHEDULER_MAX_BURST_RUNS
+};
+
+// Circuit breaker state of a task
+typedef uint8_t Scheduler_Breaker_State_t;
+enum {
+	SCHEDULER_BREAKER_CLOSED,		// Task is healthy and runs normally
+	SCHEDULER_BREAKER_OPEN,			// Task is parked after repeated failures
+	SCHEDULER_BREAKER_HALF_OPEN,	// Parked task is running a probe
+};
+
+// Task execution statistics, measured with the DWT cycle counter
+typedef struct Scheduler_Task_Stats {
+	uint32_t run_count;
+	uint32_t last_cycles;
+	uint32_t min_cycles;
+	uint32_t max_cycles;
+	uint64_t total_cycles;
+	uint32_t overrun_count;				/* Runs that exceeded budget_ms		 */
+	uint32_t last_start_jitter_ms;		/* Start time - planned start time	 */
+	uint32_t max_start_jitter_ms;
+	uint32_t missed_periods;			/* Fixed rate periods dropped		 */
+	uint32_t failure_count;
+	uint32_t breaker_trip_count;
+}Scheduler_Task_Stats_t;
+
+// Task placement request for Scheduler_Plan_Task_Offsets()
+typedef struct Scheduler_Plan_Entry {
+	Scheduler_Task_ID_t task_id;
+	Scheduler_Task_ID_t after_task;		/* If not SCHEDULER_NO_TASK, this	 */
+										/* task is pinned to after_delay_ms	 */
+	uint32_t after_delay_ms;			/* after after_task's offset		 */
+	uint32_t offset_ms;					/* Output: planned start offset		 */
+}Scheduler_Plan_Entry_t;
+
+// Task registration parameters for Scheduler_Register_Task()
+typedef struct Scheduler_Task_Config {
+	SYS_RESULT (*task_function)();
+	SYS_RESULT (*failure_handler)(struct Scheduler_Task*);	/* Can be NULL	 */
+	uint32_t interval_ms;				/* Unused by triggered tasks		 */
+	uint32_t budget_ms;					/* Expected worst case run time		 */
+	Scheduler_Run_Mode_t run_mode;
+	Scheduler_Catch_Up_t catch_up_policy;	/* Only used in fixed rate mode	 */
+	bool critical;						/* Watchdog is only fed while the	 */
+										/* task runs on time				 */
+	Scheduler_Bus_t bus;
+}Scheduler_Task_Config_t;
+
 // Task structure
 typedef struct Scheduler_Task{
 	bool enabled;
 	uint32_t interval_ms;
 	uint64_t last_run_timestamp;
+	uint64_t next_run_timestamp;		/* Time the task is next due to run	 */
+	uint64_t due_timestamp;				/* Planned time of the current 		 */
+										/* period, kept across retries		 */
+	uint8_t ready_index;				/* Position in the ready list heap,	 */
+										/* or SCHEDULER_NO_TASK				 */
+	uint32_t ready_sequence;			/* Insertion count, orders tasks	 */
+										/* due at the same time				 */
 	uint8_t num_consecutive_failures;
+	Scheduler_Breaker_State_t breaker_state;
+	uint32_t probe_interval_ms;			/* Time between probes while parked	 */
+	Scheduler_Run_Mode_t run_mode;
+	Scheduler_Catch_Up_t catch_up_policy;	/* Only used in fixed rate mode	 */
+	uint32_t budget_ms;					/* Expected worst case run time		 */
+	bool critical;						/* Watched by the watchdog			 */
+	Scheduler_Bus_t bus;
+	Scheduler_Task_Stats_t stats;
+	Scheduler_Successor_t successors[SCHEDULER_MAX_SUCCESSORS];
+	uint8_t num_successors;
+	Scheduler_Event_t awaited_event;	/* Event the task is parked on		 */
+	bool event_received;				/* Woken by awaited_event			 */
 	SYS_RESULT (*task_function)();
 	SYS_RESULT (*failure_handler)(struct Scheduler_Task*);
 }Scheduler_Task_t;
 
-typedef uint8_t Scheduler_Task_ID_t;
-enum {
-	AHT20_REQUEST_MEASUREMENT_TASK,
-	AHT20_GET_DATA_TASK,
-	SEN0169_GET_DATA_TASK,
-	SEN0244_GET_DATA_TASK,
-	AS7341_GET_DATA_TASK,
-	AS7341_CHECK_FOR_MIDNIGHT_TASK,
-	CNC_DISPENSE_SEEDS_TASK,
-	ILI9341_CHANGE_DASHBOARD_SCREEN_TASK,
-	ILI9341_UPDATE_UPTIME_TASK,
-
-	NUM_SCHEDULER_TASKS
-};
+/*-----------------------------------------------------------------------------
+TASK HANDLES
+-----------------------------------------------------------------------------*/
+extern Scheduler_Task_ID_t Scheduler_Send_Task_Stats_Task_ID;
 
 /*-----------------------------------------------------------------------------
 FUNCTION DECLARATIONS
 -----------------------------------------------------------------------------*/
 void Scheduler_Init();
 void Scheduler_Update();
+void Scheduler_Watchdog_Update();
+void Scheduler_Set_Bus_Hooks(Scheduler_Bus_t bus, void (*open)(), void (*close)());
+Scheduler_Task_ID_t Scheduler_Register_Task(const Scheduler_Task_Config_t *config);
+uint8_t Scheduler_Get_Num_Tasks();
 void Scheduler_Enable_Task(Scheduler_Task_ID_t task_id, uint32_t ms_delay);
 void Scheduler_Disable_Task(Scheduler_Task_ID_t task_id);
 void Scheduler_Set_Task_Interval(Scheduler_Task_ID_t task_id, uint32_t interval_ms);
 void Scheduler_Set_Task_Function(Scheduler_Task_ID_t task_id, SYS_RESULT (*task_function)());
 void Scheduler_Set_Task_Failure_Handler(Scheduler_Task_ID_t task_id, SYS_RESULT (*failure_handler)(struct Scheduler_Task*));
 void Scheduler_Schedule_Task_ms_From_Now(Scheduler_Task_ID_t task_id, uint32_t ms_from_now);
+uint32_t Scheduler_Get_Ms_Until_Next_Task();
+SYS_RESULT Scheduler_Add_Successor(Scheduler_Task_ID_t task_id, Scheduler_Task_ID_t successor_id, uint32_t delay_ms);
+Scheduler_Task_ID_t Scheduler_Get_Task_ID(struct Scheduler_Task *task);
+bool Scheduler_Sleep_Until(uint64_t timestamp);
+void Scheduler_Yield();
+Scheduler_Wait_Result_t Scheduler_Wait_For_Event(Scheduler_Event_t event, uint64_t timeout_timestamp);
+void Scheduler_Post_Event(Scheduler_Event_t event);
+Scheduler_Breaker_State_t Scheduler_Get_Task_Breaker_State(Scheduler_Task_ID_t task_id);
+uint32_t Scheduler_Get_Degraded_Task_Mask();
+void Scheduler_Set_Task_Run_Mode(Scheduler_Task_ID_t task_id, Scheduler_Run_Mode_t run_mode, Scheduler_Catch_Up_t catch_up_policy);
+void Scheduler_Set_Task_Budget(Scheduler_Task_ID_t task_id, uint32_t budget_ms);
+SYS_RESULT Scheduler_Get_Task_Stats(Scheduler_Task_ID_t task_id, Scheduler_Task_Stats_t *stats);
+void Scheduler_Reset_Task_Stats(Scheduler_Task_ID_t task_id);
+uint32_t Scheduler_Cycles_To_Us(uint32_t cycles);
+uint32_t Scheduler_Get_Task_WCET_ms(Scheduler_Task_ID_t task_id);
+SYS_RESULT Scheduler_Plan_Task_Offsets(Scheduler_Plan_Entry_t *entries, uint8_t num_entries);
+SYS_RESULT Scheduler_Enable_Tasks_Planned(Scheduler_Plan_Entry_t *entries, uint8_t num_entries);
+uint32_t Scheduler_Get_Planned_Utilization();
 
 
 #endif /* INC_SCHEDULER_H_ */
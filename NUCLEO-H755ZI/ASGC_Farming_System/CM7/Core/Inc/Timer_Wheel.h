@@ -0,0 +1,70 @@
+/*-----------------------------------------------------------------------------
+ *
+ * 	Timer_Wheel.h
+ *
+ * 		One-shot and periodic software timers, for timeouts and delayed
+ * 		actions that do not need a scheduler task. A module creates its
+ * 		timers once with a callback, then starts, restarts and cancels them;
+ * 		Timer_Wheel_Update() in the main loop runs the callbacks of the timers
+ * 		that are due. Nothing is polled while a timer runs, and the main loop
+ * 		sleeps until the next one is due (Timer_Wheel_Get_Ms_Until_Next()).
+ *
+ * 		The timers are kept in a hierarchical timing wheel of
+ * 		TIMER_WHEEL_NUM_LEVELS levels of TIMER_WHEEL_SLOTS slots, with a
+ * 		millisecond tick. Level 0 holds the timers due in the next 64 ms, one
+ * 		slot per millisecond, each level above 64 times as much. A timer is
+ * 		put straight in the slot of its deadline, and moved down a level as
+ * 		the deadline comes closer, so starting, cancelling and running a
+ * 		timer cost the same however many timers there are. Each level keeps
+ * 		a bitmap of the slots in use, so empty milliseconds are skipped.
+ *
+ * 		The timers can be started and cancelled from any task or interrupt.
+ * 		The callbacks run from Timer_Wheel_Update(), so they may take their
+ * 		time, but they hold up the main loop while they run.
+ *
+ *  Created on: Oct 16, 2026
+ *
+-----------------------------------------------------------------------------*/
+
+#ifndef INC_TIMER_WHEEL_H_
+#define INC_TIMER_WHEEL_H_
+
+/*-----------------------------------------------------------------------------
+INCLUDES
+-----------------------------------------------------------------------------*/
+#include "main.h"
+
+/*-----------------------------------------------------------------------------
+DEFINES
+-----------------------------------------------------------------------------*/
+#define TIMER_WHEEL_MAX_TIMERS									16
+#define TIMER_WHEEL_NO_TIMER									0xFF
+#define TIMER_WHEEL_NO_PENDING_TIMER_MS							0xFFFFFFFF
+
+#define TIMER_WHEEL_SLOT_BITS									6
+#define TIMER_WHEEL_SLOTS										(1 << TIMER_WHEEL_SLOT_BITS)
+#define TIMER_WHEEL_NUM_LEVELS									4
+						/* 64^4 ms, 4.6 hours. Longer timers wait in */
+						/* the last slot of the top level			 */
+
+/*-----------------------------------------------------------------------------
+TYPEDEFS
+-----------------------------------------------------------------------------*/
+typedef uint8_t Timer_Wheel_ID_t;
+
+typedef void (*Timer_Wheel_Callback_t)(uint32_t argument);
+
+/*-----------------------------------------------------------------------------
+FUNCTION DECLARATIONS
+-----------------------------------------------------------------------------*/
+void Timer_Wheel_Init();
+Timer_Wheel_ID_t Timer_Wheel_Create(Timer_Wheel_Callback_t callback, uint32_t argument);
+void Timer_Wheel_Start(Timer_Wheel_ID_t timer_id, uint32_t delay_ms, uint32_t period_ms);
+void Timer_Wheel_Restart(Timer_Wheel_ID_t timer_id);
+void Timer_Wheel_Cancel(Timer_Wheel_ID_t timer_id);
+bool Timer_Wheel_Is_Running(Timer_Wheel_ID_t timer_id);
+void Timer_Wheel_Update();
+uint32_t Timer_Wheel_Get_Ms_Until_Next();
+
+
+#endif /* INC_TIMER_WHEEL_H_ */
@@ -14,16 +14,35 @@
 #ifndef INC_VL53L1X_PRJ_H_
 #define INC_VL53L1X_PRJ_H_
 
+#include "main.h"
+#include "vl53l1_api.h"
+
 /*-----------------------------------------------------------------------------
 Defines
 -----------------------------------------------------------------------------*/
 #define VL53L1X_I2C_ADDRESS 0x52
 
+#define VL53L1X_TIMING_BUDGET_US				50000
+#define VL53L1X_INTER_MEASUREMENT_MS			200
+						/* Continuous ranging period of the sensor	 */
+#define VL53L1X_TASK_DEFAULT_INTERVAL_MS		250
+						/* Longer than the ranging period, so there	 */
+						/* is a new range on nearly every run		 */
+
+/*-----------------------------------------------------------------------------
+Scheduler task handles, SCHEDULER_NO_TASK if the VL53L1X is switchboard
+disabled
+-----------------------------------------------------------------------------*/
+extern Scheduler_Task_ID_t VL53L1X_Get_Data_Task_ID;
+
 /*-----------------------------------------------------------------------------
 Function Declarations
 -----------------------------------------------------------------------------*/
 void VL53L1X_prj_Init(VL53L1_DEV Dev, I2C_HandleTypeDef *hi2c);
+void VL53L1X_prj_Start_Ranging();
+void VL53L1X_prj_Stop_Ranging();
 
 void VL53L1X_GetRangingMeasurementData(VL53L1_DEV Dev, VL53L1_RangingMeasurementData_t *pRangingMeasurementData);
+SYS_RESULT VL53L1X_prj_Get_Range_mm(VL53L1_DEV Dev, uint16_t *range_mm, bool *new_range);
 
 #endif /* INC_VL53L1X_PRJ_H_ */
\ No newline at end of file
@@ -0,0 +1,67 @@
+/*-----------------------------------------------------------------------------
+ *
+ * 	Wall_Clock.h
+ *
+ * 		Wall clock time, kept by the RTC on the LSE and set from the unix
+ * 		time of the Raspberry Pi. The RTC calendar holds local time, so alarm
+ * 		A goes off every day at local midnight and rolls the DLI over to a
+ * 		new day. Nothing has to poll for midnight.
+ *
+ * 		The RTC is in the backup domain. It keeps time through a reset, and
+ * 		through a power loss if VBAT is supplied, so the checkpoint can tell
+ * 		whether a midnight went by while the board was down. The Pi time is
+ * 		asked for again every WALL_CLOCK_RESYNC_INTERVAL_MS to correct the
+ * 		drift of the crystal, and for a change of the UTC offset (daylight
+ * 		saving time).
+ *
+ *  Created on: Oct 16, 2026
+ *
+-----------------------------------------------------------------------------*/
+
+#ifndef INC_WALL_CLOCK_H_
+#define INC_WALL_CLOCK_H_
+
+/*-----------------------------------------------------------------------------
+INCLUDES
+-----------------------------------------------------------------------------*/
+#include "main.h"
+
+/*-----------------------------------------------------------------------------
+DEFINES
+-----------------------------------------------------------------------------*/
+#define WALL_CLOCK_SYNC_INTERVAL_MS								60000
+						/* Sync task period. Asks the Pi only when	 */
+						/* the clock is not set or a resync is due	 */
+#define WALL_CLOCK_RESYNC_INTERVAL_MS							21600000
+						/* 6 hours									 */
+#define WALL_CLOCK_SYNC_TIMEOUT_MS								10
+#define WALL_CLOCK_SYNC_TASK_BUDGET_MS							50
+#define WALL_CLOCK_MAX_DRIFT_S									2
+						/* Smaller errors are left alone, rewriting	 */
+						/* the calendar stops it for up to a second	 */
+#define WALL_CLOCK_MIN_UTC_OFFSET_H								-12
+#define WALL_CLOCK_MAX_UTC_OFFSET_H								14
+#define WALL_CLOCK_RTC_TIMEOUT_MS								10
+						/* Init mode and register syncs take a few	 */
+						/* RTC clock cycles							 */
+#define WALL_CLOCK_DAY_UNKNOWN									0xFFFFFFFF
+
+/*-----------------------------------------------------------------------------
+TASK HANDLES
+-----------------------------------------------------------------------------*/
+extern Scheduler_Task_ID_t Wall_Clock_Sync_Task_ID;
+						/* SCHEDULER_NO_TASK without the RTC or the	 */
+						/* Raspberry Pi interface					 */
+
+/*-----------------------------------------------------------------------------
+FUNCTION DECLARATIONS
+-----------------------------------------------------------------------------*/
+void Wall_Clock_Init();
+SYS_RESULT Wall_Clock_Set(uint32_t unix_time_s, int8_t utc_offset_h);
+SYS_RESULT Wall_Clock_Sync();
+bool Wall_Clock_Is_Set();
+uint32_t Wall_Clock_Get_Local_Day();
+void Wall_Clock_Alarm_IRQHandler();
+
+
+#endif /* INC_WALL_CLOCK_H_ */
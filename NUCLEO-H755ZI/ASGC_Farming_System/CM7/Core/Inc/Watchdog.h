@@ -0,0 +1,82 @@
+/*-----------------------------------------------------------------------------
+ *
+ * 	Watchdog.h
+ *
+ * 		Independent watchdog (IWDG1) of the CM7. The scheduler feeds it only
+ * 		while every critical task checks in on time, see
+ * 		Scheduler_Watchdog_Update(), so a HAL call that hangs resets the
+ * 		board within WATCHDOG_TIMEOUT_MS.
+ *
+ * 		Before the reset the scheduler leaves a breadcrumb naming the task
+ * 		that hung or ran late. The breadcrumb is kept in RAM that the startup
+ * 		code does not clear (.noinit), and is read back by Watchdog_Init()
+ * 		after the reset.
+ *
+ *  Created on: Oct 16, 2026
+ *
+-----------------------------------------------------------------------------*/
+
+#ifndef INC_WATCHDOG_H_
+#define INC_WATCHDOG_H_
+
+/*-----------------------------------------------------------------------------
+INCLUDES
+-----------------------------------------------------------------------------*/
+#include "main.h"
+
+/*-----------------------------------------------------------------------------
+DEFINES
+-----------------------------------------------------------------------------*/
+#define WATCHDOG_TIMEOUT_MS										4000
+						/* Longer than any task budget				 */
+#define WATCHDOG_MAX_IDLE_MS									(WATCHDOG_TIMEOUT_MS / 4)
+						/* The main loop wakes up to feed the		 */
+						/* watchdog at least this often				 */
+
+// IWDG1 counts the ~32kHz LSI divided by 64, so the 12 bit reload value
+// gives up to 8.1s
+#define WATCHDOG_LSI_HZ											32000
+#define WATCHDOG_PRESCALER_DIV									64
+#define WATCHDOG_PRESCALER_REG									4
+#define WATCHDOG_RELOAD											((WATCHDOG_TIMEOUT_MS * (WATCHDOG_LSI_HZ / WATCHDOG_PRESCALER_DIV)) / 1000)
+
+#if (WATCHDOG_RELOAD > 0xFFF)
+#error "WATCHDOG_TIMEOUT_MS is too long for the IWDG prescaler"
+#endif
+
+/*-----------------------------------------------------------------------------
+TYPEDEFS
+-----------------------------------------------------------------------------*/
+
+// Why the scheduler stopped feeding the watchdog
+typedef uint8_t Watchdog_Cause_t;
+enum {
+	WATCHDOG_CAUSE_NONE,
+	WATCHDOG_CAUSE_UNKNOWN,			// Hung outside of a task, e.g. in the FSM
+	WATCHDOG_CAUSE_TASK_HUNG,		// Task function never returned
+	WATCHDOG_CAUSE_TASK_LATE,		// Critical task did not run when due
+};
+
+// What the breadcrumb said after a watchdog reset
+typedef struct Watchdog_Reset_Info {
+	Watchdog_Cause_t cause;
+	Scheduler_Task_ID_t task_id;		/* SCHEDULER_NO_TASK if unknown		 */
+	uint32_t task_elapsed_ms;			/* Time the task had been running,	 */
+										/* or late, when the board reset	 */
+	uint32_t task_budget_ms;
+}Watchdog_Reset_Info_t;
+
+/*-----------------------------------------------------------------------------
+FUNCTION DECLARATIONS
+-----------------------------------------------------------------------------*/
+void Watchdog_Init();
+void Watchdog_Start();
+void Watchdog_Feed();
+void Watchdog_Set_Breadcrumb(Watchdog_Cause_t cause, Scheduler_Task_ID_t task_id, uint64_t since_timestamp, uint32_t budget_ms);
+void Watchdog_Clear_Breadcrumb();
+bool Watchdog_Get_Reset_Info(Watchdog_Reset_Info_t *info);
+void Watchdog_Clear_Reset_Info();
+uint32_t Watchdog_Get_Max_Feed_Gap_ms();
+
+
+#endif /* INC_WATCHDOG_H_ */
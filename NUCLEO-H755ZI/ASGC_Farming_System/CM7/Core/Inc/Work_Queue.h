@@ -0,0 +1,62 @@
+/*-----------------------------------------------------------------------------
+ *
+ * 	Work_Queue.h
+ *
+ * 		Deferred work queue. Interrupt handlers post a function and an
+ * 		argument with Work_Queue_Post() and return; the main loop runs the
+ * 		posted work with Work_Queue_Run(). Anything slow that a button press sets off, like
+ * 		redrawing the display, runs there instead of in the interrupt.
+ *
+ * 		Posting takes no lock and does not mask interrupts, so it can be
+ * 		called from any interrupt priority, also while a lower priority
+ * 		interrupt or the main loop is posting. Work_Queue_Run() must only be
+ * 		called from the main loop.
+ *
+ * 		Each priority has its own queue. Work_Queue_Run() empties the urgent
+ * 		queue before every item of the normal one.
+ *
+ *  Created on: Oct 16, 2026
+ *
+-----------------------------------------------------------------------------*/
+
+#ifndef INC_WORK_QUEUE_H_
+#define INC_WORK_QUEUE_H_
+
+/*-----------------------------------------------------------------------------
+INCLUDES
+-----------------------------------------------------------------------------*/
+#include "main.h"
+
+/*-----------------------------------------------------------------------------
+DEFINES
+-----------------------------------------------------------------------------*/
+#define WORK_QUEUE_LENGTH										8
+						/* Items per priority, power of 2			 */
+
+#if ((WORK_QUEUE_LENGTH & (WORK_QUEUE_LENGTH - 1)) != 0)
+#error "WORK_QUEUE_LENGTH must be a power of 2"
+#endif
+
+/*-----------------------------------------------------------------------------
+TYPEDEFS
+-----------------------------------------------------------------------------*/
+typedef uint8_t Work_Queue_Priority_t;
+enum {
+	WORK_QUEUE_PRIORITY_URGENT,			// E-stop
+	WORK_QUEUE_PRIORITY_NORMAL,			// Start button, anything else
+	WORK_QUEUE_NUM_PRIORITIES,
+};
+
+typedef void (*Work_Queue_Function_t)(uint32_t argument);
+
+/*-----------------------------------------------------------------------------
+FUNCTION DECLARATIONS
+-----------------------------------------------------------------------------*/
+void Work_Queue_Init();
+bool Work_Queue_Post(Work_Queue_Priority_t priority, Work_Queue_Function_t function, uint32_t argument);
+uint32_t Work_Queue_Run();
+bool Work_Queue_Is_Empty();
+uint32_t Work_Queue_Get_Dropped_Count();
+
+
+#endif /* INC_WORK_QUEUE_H_ */
@@ -23,5 +23,6 @@ FUNCTION DECLARATIONS
 bool Buttons_Init();
 SYS_RESULT Buttons_start_button_intrpt(bool * start_state);
 SYS_RESULT Buttons_estop_button_intrpt(bool * estop_state, bool start_state);
+bool Buttons_estop_is_released();
 
 #endif /* INC_BUTTONS_H_ */
@@ -40,6 +40,9 @@ extern "C" {
 /* Exported types ------------------------------------------------------------*/
 /* USER CODE BEGIN ET */
 
+// Handle of a task registered with the scheduler, see Scheduler_Register_Task()
+typedef uint8_t Scheduler_Task_ID_t;
+
 /* USER CODE END ET */
 
 /* Exported constants --------------------------------------------------------*/
@@ -172,44 +175,47 @@ void Error_Handler(void);
 #define ESTOP_BUTTON_ENABLED			            SYS_FEATURE_ENABLED
 	 /* Buttons.h */
 
+/* Tickless Idle (sleep between scheduler deadlines) -------------------------*/
+#define TICKLESS_IDLE_ENABLED			            SYS_FEATURE_ENABLED
+	 /* timer.c */
+
 /*------------------------------------------------------------------------------
  * Normal Defines
 ------------------------------------------------------------------------------*/
 #define SYSTEM_ON     true
 #define SYSTEM_OFF    false
 
-/*------------------------------------------------------------------------------
- * Defines for DispenseSeeds Helper Function
-------------------------------------------------------------------------------*/
-#define DISPENSE_MOVING_MS        (uint16_t)2000  // Max time to wait for gantry to move to hole in ms
-#define DISPENSE_SHUTTER_MS       (uint16_t)500   // Time to keep shutter open in ms
-#define DISPENSE_FINISH_MS        (uint16_t)5000  // Time to wait after dispensing is finished
-#define DISPENSE_SUCCESS          (uint8_t)0
-#define DISPENSE_FAIL_GANTRY      (uint8_t)1
-#define DISPENSE_FAIL_SHUTTER     (uint8_t)2
-#define DISPENSE_FAIL_XY_POS      (uint8_t)3
-#define DISPENSE_BUSY             (uint8_t)4
-#define DISPENSE_UNKNOWN_FAIL     (uint8_t)5
-
 /*------------------------------------------------------------------------------
  * Function Declarations
 ------------------------------------------------------------------------------*/
 void      ASGC_System_Startup();
 void      ASGC_System_ESTOP();
-uint8_t   DispenseSeeds_HelperFunc(float holeX, float holeY);
-uint16_t  ASGC_System_DispenseSeeds();
-void      Reset_DispenseSeeds_FSM();
+void      I2C1_Bus_Open();
+void      I2C1_Bus_Close();
 
 // TASK FUNCTIONS - These are all the functions that will be registered in Scheduler.c
 SYS_RESULT AHT20_Request_Measurement_TASK();
 SYS_RESULT AHT20_Get_Data_TASK();
 SYS_RESULT SEN0169_Get_Data_TASK();
 SYS_RESULT SEN0244_Get_Data_TASK();
+SYS_RESULT VL53L1X_Get_Data_TASK();
+SYS_RESULT Reservoir_Check_Fill_TASK();
+SYS_RESULT Checkpoint_Save_TASK();
+SYS_RESULT FSM_Check_EStop_Reset_TASK();
 SYS_RESULT AS7341_Get_Data_TASK();
-SYS_RESULT AS7341_Is_Midnight_TASK();
+SYS_RESULT AS7341_Integrate_DLI_TASK();
+SYS_RESULT RPI_UART_Send_Sensor_Data_TASK();
+SYS_RESULT ILI9341_Update_Sensor_Readings_TASK();
+SYS_RESULT Wall_Clock_Sync_TASK();
 SYS_RESULT CNC_Dispense_Seeds_TASK();
+SYS_RESULT CNC_Check_Homing_TASK();
 SYS_RESULT ILI9341_Change_Dashboard_Screen_TASK();
 SYS_RESULT ILI9341_Update_Uptime_TASK();
+SYS_RESULT Scheduler_Send_Task_Stats_TASK();
+
+// FAILURE HANDLERS - Called by Scheduler.c when a task's circuit breaker changes state
+struct Scheduler_Task;
+SYS_RESULT Device_Failure_Handler(struct Scheduler_Task *task);
 
 /* USER CODE END Private defines */
 
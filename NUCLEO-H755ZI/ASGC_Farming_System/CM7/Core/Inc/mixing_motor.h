@@ -60,7 +60,6 @@ SYS_RESULT mixing_motor_drive(uint16_t speed);
 SYS_RESULT mixing_motor_stop();
 SYS_RESULT mixing_motor_apply_brake();
 SYS_RESULT mixing_motor_mix_for_time(uint16_t timeout_ms);
-void mixing_motor_handle_state();
 
 
 #endif /* INC_MIXING_MOTOR_H_ */
@@ -12,14 +12,23 @@
 
 #include "main.h"
 
-// Defines for midnight/time calculation functions
-#define     IS_MIDNIGHT (uint8_t)1
-#define     NOT_MIDNIGHT (uint8_t)0
-#define     CST_OFFSET (int8_t)-5
+// Timebase. TIM2 is a 32 bit timer on the CM7 side (TIM5, the other one,
+// drives PWM), counting at 1MHz it wraps every 71.6 minutes.
+#define     TIMER_US_TIM                TIM2
+#define     TIMER_US_HZ                 1000000
+
+// Tickless idle. LPTIM1 counts the 32.768kHz LSE divided by 32, so a tick is
+// 1/1024s and the 16 bit counter wraps every 64s.
+#define     TIMER_IDLE_LPTIM_HZ         1024
+#define     TIMER_IDLE_MIN_MS           3       // Shorter idles wait on SysTick
+#define     TIMER_IDLE_MAX_MS           60000   // Must be less than a wrap
 
 void 		ASGC_Timer_Init();
 uint64_t 	getTimestamp();
-uint8_t     isMidnight();
-void        setUnixTimeMidnightRef(const uint32_t currentTimeSec, const int8_t TimeZoneOffsetUTCHours);
+uint64_t    getTimestampUs();
+void        ASGC_Timer_Wrap_IRQHandler();
+void        ASGC_Timer_Idle(uint32_t idle_ms);
+uint64_t    ASGC_Timer_Get_Idle_Time_ms();
+bool        ASGC_Timer_Start_LSE();
 
 #endif /* INC_TIMER_H_ */
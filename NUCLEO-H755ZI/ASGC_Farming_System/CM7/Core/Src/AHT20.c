@@ -8,10 +8,16 @@
 -----------------------------------------------------------------------------*/
 
 #include "AHT20.h"
+#include "Scheduler.h"
 
 
 bool AHT20_Initialized = false;
 
+Scheduler_Task_ID_t AHT20_Request_Measurement_Task_ID = SCHEDULER_NO_TASK;
+Scheduler_Task_ID_t AHT20_Get_Data_Task_ID = SCHEDULER_NO_TASK;
+
+static void AHT20_Register_Tasks();
+
 /*-----------------------------------------------------------------------------
  *
  * 		AHT20_Init
@@ -19,6 +25,7 @@ bool AHT20_Initialized = false;
  * 		Initializes the AHT20 Module.
  * 		NOTE: At least 40ms must have transpired between power on and this
  * 		function being called
+ * 		NOTE: Scheduler_Init() must have been called before this function
  *
  ----------------------------------------------------------------------------*/
 
@@ -32,6 +39,10 @@ bool AHT20_Init(I2C_HandleTypeDef *hi2c, uint32_t timeout) {
 		return AHT20_Initialized;
 	}
 
+	// Registered even if the sensor does not respond, so the scheduler can
+	// report it as degraded and keep probing it
+	AHT20_Register_Tasks();
+
 	// Send the Initialization Message
 	ret = HAL_I2C_Master_Transmit(hi2c, AHT20_I2C_ADDR_WRITE, outMsg, 3, timeout);
 
@@ -158,3 +169,44 @@ struct AHT20_Data AHT20_Get_Data(I2C_HandleTypeDef *hi2c) {
 
 	return newData;
 }
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		AHT20_Register_Tasks
+ *
+ * 		Registers the AHT20 scheduler tasks. The measurement request triggers
+ * 		the data retrieval AHT20_MEASUREMENT_TIME_MS later, which publishes
+ * 		the reading to the data bus.
+ *
+ ----------------------------------------------------------------------------*/
+static void AHT20_Register_Tasks() {
+	Scheduler_Task_Config_t requestTask = {
+		.task_function = AHT20_Request_Measurement_TASK,
+		.failure_handler = Device_Failure_Handler,
+		.interval_ms = AHT20_TASK_DEFAULT_INTERVAL_MS,
+		.budget_ms = SCHEDULER_DEFAULT_TASK_BUDGET_MS,
+		.run_mode = SCHEDULER_RUN_FIXED_RATE,
+		.catch_up_policy = SCHEDULER_CATCH_UP_SKIP,
+		.critical = true,
+		.bus = SCHEDULER_BUS_I2C1,
+	};
+	Scheduler_Task_Config_t getDataTask = {
+		.task_function = AHT20_Get_Data_TASK,
+		.failure_handler = Device_Failure_Handler,
+		.interval_ms = AHT20_TASK_DEFAULT_INTERVAL_MS,	// Reserved by the planner
+		.budget_ms = SCHEDULER_DEFAULT_TASK_BUDGET_MS,
+		.run_mode = SCHEDULER_RUN_TRIGGERED,
+		.catch_up_policy = SCHEDULER_CATCH_UP_SKIP,
+		.critical = true,
+		.bus = SCHEDULER_BUS_I2C1,
+	};
+
+	if (AHT20_Request_Measurement_Task_ID != SCHEDULER_NO_TASK) {
+		return;
+	}
+
+	AHT20_Request_Measurement_Task_ID = Scheduler_Register_Task(&requestTask);
+	AHT20_Get_Data_Task_ID = Scheduler_Register_Task(&getDataTask);
+	Scheduler_Add_Successor(AHT20_Request_Measurement_Task_ID, AHT20_Get_Data_Task_ID, AHT20_MEASUREMENT_TIME_MS);
+}
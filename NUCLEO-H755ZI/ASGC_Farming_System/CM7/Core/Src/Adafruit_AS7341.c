@@ -24,12 +24,23 @@
 #include "Adafruit_AS7341.h"
 
 #include "main.h" // For switchboard functionality
+#include "Scheduler.h"
+#include "Data_Bus.h"
 
 static uint8_t last_spectral_int_source = 0;
 static I2C_HandleTypeDef *i2c_han = NULL;///< Pointer to I2C bus interface
 static uint8_t i2c_addr = 0;
 static uint16_t _channel_readings[12];
 static as7341_waiting_t _readingState;
+static Data_Bus_Subscriber_ID_t _dli_subscriber = DATA_BUS_NO_SUBSCRIBER;
+static float _dli_mol_m2;        ///< Light integral since the last reset
+static float _dli_last_ppfd;     ///< PPFD of the last reading, umol/m^2/s
+static uint64_t _dli_last_timestamp;
+
+Scheduler_Task_ID_t AS7341_Get_Data_Task_ID = SCHEDULER_NO_TASK;
+Scheduler_Task_ID_t AS7341_Integrate_DLI_Task_ID = SCHEDULER_NO_TASK;
+
+static void Adafruit_AS7341_registerTasks(void);
 
 /*!
  *    @brief  Sets up the hardware and initializes I2C
@@ -49,9 +60,49 @@ bool Adafruit_AS7341_begin(uint8_t i2c_address, I2C_HandleTypeDef *i2c_handle,
 	i2c_han = i2c_handle;
 	i2c_addr = i2c_address << 1;
 
+	// Registered even if the sensor does not respond, so the scheduler can
+	// report it as degraded and keep probing it
+	if (AS7341_ENABLED == SYS_FEATURE_ENABLED) {
+		Adafruit_AS7341_registerTasks();
+	}
+
 	return Adafruit_AS7341__init(sensor_id);
 }
 
+/**
+ * @brief Registers the AS7341 scheduler tasks. The spectral reading task
+ * publishes its readings to the data bus, where the DLI integration task picks
+ * them up. Scheduler_Init() and Data_Bus_Init() must have been called before.
+ */
+static void Adafruit_AS7341_registerTasks(void) {
+	Scheduler_Task_Config_t getDataTask = {
+		.task_function = AS7341_Get_Data_TASK,
+		.failure_handler = Device_Failure_Handler,
+		.interval_ms = AS7341_TASK_DEFAULT_INTERVAL_MS,
+		.budget_ms = AS7341_TASK_BUDGET_MS,
+		.run_mode = SCHEDULER_RUN_FIXED_RATE,
+		.catch_up_policy = SCHEDULER_CATCH_UP_SKIP,
+		.critical = true,
+		.bus = SCHEDULER_BUS_I2C1,
+	};
+	Scheduler_Task_Config_t dliTask = {
+		.task_function = AS7341_Integrate_DLI_TASK,
+		.failure_handler = NULL,
+		.interval_ms = AS7341_DLI_TASK_INTERVAL_MS,
+		.budget_ms = SCHEDULER_DEFAULT_TASK_BUDGET_MS,
+		.run_mode = SCHEDULER_RUN_FIXED_DELAY,
+		.catch_up_policy = SCHEDULER_CATCH_UP_SKIP,
+	};
+
+	if (AS7341_Get_Data_Task_ID != SCHEDULER_NO_TASK) {
+		return;
+	}
+
+	AS7341_Get_Data_Task_ID = Scheduler_Register_Task(&getDataTask);
+	AS7341_Integrate_DLI_Task_ID = Scheduler_Register_Task(&dliTask);
+	_dli_subscriber = Data_Bus_Subscribe(DATA_BUS_TOPIC_MASK(DATA_BUS_TOPIC_AS7341));
+}
+
 /*!  @brief Initializer for post i2c/spi init
  *   @param sensor_id Optional unique ID for the sensor set
  *   @returns True if chip identified and initialized
@@ -832,6 +883,78 @@ float Adafruit_AS7341_toBasicCounts(uint16_t raw) {
 	return raw / (gain_val * (Adafruit_AS7341_getATIME() + 1) * (Adafruit_AS7341_getASTEP() + 1) * 2.78 / 1000);
 }
 
+/**
+ * @brief Integrates the spectral readings published since the last call into
+ * the daily light integral (DLI).
+ *
+ * Each reading's PPFD, estimated from the basic counts of the F1-F8 channels,
+ * is held until the next reading. Readings more than
+ * AS7341_DLI_MAX_SAMPLE_GAP_MS apart are not integrated, so a sensor outage
+ * does not add light that was never measured.
+ *
+ * @return float The DLI since the last reset, in mol/m^2
+ */
+float Adafruit_AS7341_updateDLI(void) {
+	static const as7341_color_channel_t parChannels[] = {
+		AS7341_CHANNEL_415nm_F1, AS7341_CHANNEL_445nm_F2, AS7341_CHANNEL_480nm_F3,
+		AS7341_CHANNEL_515nm_F4, AS7341_CHANNEL_555nm_F5, AS7341_CHANNEL_590nm_F6,
+		AS7341_CHANNEL_630nm_F7, AS7341_CHANNEL_680nm_F8,
+	};
+	Data_Bus_Sample_t sample;
+	float countsPerRaw = -1;
+	uint32_t rawSum;
+	uint64_t elapsedMs;
+
+	while (Data_Bus_Receive(_dli_subscriber, &sample)) {
+		// Gain and integration time only change at init, so read them once
+		if (countsPerRaw < 0) {
+			countsPerRaw = Adafruit_AS7341_toBasicCounts(1);
+		}
+
+		elapsedMs = sample.timestamp - _dli_last_timestamp;
+		if (_dli_last_timestamp != 0 && elapsedMs <= AS7341_DLI_MAX_SAMPLE_GAP_MS) {
+			// umol/m^2/s over elapsedMs, to mol/m^2
+			_dli_mol_m2 += _dli_last_ppfd * ((float)elapsedMs / 1000.0f) / 1000000.0f;
+		}
+
+		rawSum = 0;
+		for (uint8_t i = 0; i < sizeof(parChannels) / sizeof(parChannels[0]); i++) {
+			rawSum += sample.value.as7341[parChannels[i]];
+		}
+
+		_dli_last_ppfd = (float)rawSum * countsPerRaw * AS7341_PPFD_PER_BASIC_COUNT;
+		_dli_last_timestamp = sample.timestamp;
+	}
+
+	return _dli_mol_m2;
+}
+
+/**
+ * @brief Starts a new day for the daily light integral
+ */
+void Adafruit_AS7341_resetDLI(void) {
+	_dli_mol_m2 = 0;
+}
+
+/**
+ * @brief Returns the daily light integral so far, without integrating the
+ * readings that came in since the last Adafruit_AS7341_updateDLI()
+ *
+ * @return float The DLI since the last reset, in mol/m^2
+ */
+float Adafruit_AS7341_getDLI(void) {
+	return _dli_mol_m2;
+}
+
+/**
+ * @brief Carries on the daily light integral of a checkpoint after a reset
+ *
+ * @param dli_mol_m2 The DLI of the day so far, in mol/m^2
+ */
+void Adafruit_AS7341_restoreDLI(float dli_mol_m2) {
+	_dli_mol_m2 = dli_mol_m2;
+}
+
 /**
  * @brief Detect a flickering light
  * @return The frequency of a detected flicker or 1 if a flicker of
@@ -13,10 +13,36 @@
 
 #include "CNC.h"
 #include "RPI_UART.h"
+#include "Scheduler.h"
+#include "Coroutine.h"
+#include "PWM.h"
+#include "FSM.h"
+#include "Checkpoint.h"
 
 static CNC_NFT_Data CNC_DATA;
 bool CNC_Initialized = false;
 
+// Seed dispensing coroutine state, kept across its waits
+static Coroutine_t dispenseCoroutine;
+static bool dispensingSeeds;
+static uint8_t dispenseChannel;
+static uint8_t dispenseStep;			/* Holes done in dispenseChannel	 */
+static uint8_t dispenseHole;
+static uint8_t holesDispensed;			/* Holes done, in dispensing order,	 */
+										/* kept if dispensing is cut short	 */
+static uint64_t holeStartTimestamp;
+static uint8_t holeMoveAttempts;		/* Sends of the move to the hole	 */
+static bool holeMoveSent;
+static uint32_t holeMoveMs;				/* Time the gantry took to get there */
+static bool holeMoveConfirmed;			/* False if the move timed out		 */
+
+// Target of the last move sent, for CNC_Is_In_Position()
+static float moveTargetX;
+static float moveTargetY;
+
+Scheduler_Task_ID_t CNC_Dispense_Seeds_Task_ID = SCHEDULER_NO_TASK;
+Scheduler_Task_ID_t CNC_Check_Homing_Task_ID = SCHEDULER_NO_TASK;
+
 /*-----------------------------------------------------------------------------
  *
  * 		usb_send_gcode
@@ -63,7 +89,7 @@ SYS_RESULT usb_send_gcode( const char *gcode, uint32_t timeout ) {
  * 		structure with the NFT hole position values for the farming system.
  *
  * 		NOTE: This function should be called after the USB CDC interface has been
- * 		initialized.
+ * 		initialized, and after Scheduler_Init().
  *
  ----------------------------------------------------------------------------*/
 
@@ -75,6 +101,36 @@ SYS_RESULT CNC_Init() {
 		return SYS_SUCCESS;
 	}
 
+	Scheduler_Task_Config_t dispenseSeedsTask = {
+		.task_function = CNC_Dispense_Seeds_TASK,
+		.failure_handler = NULL,
+		.interval_ms = CNC_DISPENSE_SEEDS_TASK_DEFAULT_INTERVAL_MS,
+		.budget_ms = CNC_DISPENSE_SEEDS_TASK_BUDGET_MS,
+		.run_mode = SCHEDULER_RUN_FIXED_DELAY,
+		.catch_up_policy = SCHEDULER_CATCH_UP_SKIP,
+		.critical = true,
+		.bus = SCHEDULER_BUS_UART7,
+	};
+
+	Scheduler_Task_Config_t checkHomingTask = {
+		.task_function = CNC_Check_Homing_TASK,
+		.failure_handler = NULL,
+		.interval_ms = CNC_HOMING_POLL_MS,
+		.budget_ms = CNC_HOMING_TASK_BUDGET_MS,
+		.run_mode = SCHEDULER_RUN_FIXED_DELAY,
+		.catch_up_policy = SCHEDULER_CATCH_UP_SKIP,
+		.critical = true,
+		.bus = SCHEDULER_BUS_UART7,
+	};
+
+	if (CNC_Dispense_Seeds_Task_ID == SCHEDULER_NO_TASK) {
+		CNC_Dispense_Seeds_Task_ID = Scheduler_Register_Task(&dispenseSeedsTask);
+	}
+
+	if (CNC_Check_Homing_Task_ID == SCHEDULER_NO_TASK) {
+		CNC_Check_Homing_Task_ID = Scheduler_Register_Task(&checkHomingTask);
+	}
+
 	CNC_DATA = (CNC_NFT_Data) {
 		.channel_holes = {
 			// The (x, y) of each hole has been experimentally determined and
@@ -201,6 +257,115 @@ SYS_RESULT CNC_Home_Command() {
 }
 
 
+/*-----------------------------------------------------------------------------
+ *
+ * 		CNC_Start_Homing
+ *
+ * 		Sends the homing command and starts asking the Raspberry Pi every
+ * 		CNC_HOMING_POLL_MS whether it is done, see CNC_Check_Homing().
+ * 		Returns SYS_DEVICE_DISABLED, without sending anything, if the
+ * 		Raspberry Pi interface is disabled, so there is nothing to home.
+ *
+ ----------------------------------------------------------------------------*/
+
+SYS_RESULT CNC_Start_Homing() {
+
+	if (CNC_Check_Homing_Task_ID == SCHEDULER_NO_TASK) {
+		return SYS_DEVICE_DISABLED;
+	}
+
+	SYS_RESULT result = CNC_Home_Command();
+
+	if (result != SYS_SUCCESS) {
+		return result;
+	}
+
+	// Give Klipper time to take the G28 before the first poll
+	Scheduler_Enable_Task(CNC_Check_Homing_Task_ID, CNC_HOMING_POLL_MS);
+
+	return SYS_SUCCESS;
+}
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		CNC_Check_Homing
+ *
+ * 		Run by CNC_Check_Homing_TASK while homing. Asks the Raspberry Pi for
+ * 		the homed status of the axes, and once both are homed and the gantry
+ * 		has stopped, stops polling, lets the gantry be moved with
+ * 		CNC_Move_To_Pos() and tells the FSM with FSM_EVENT_CNC_HOMED.
+ * 		If Klipper reports an error it stops polling and posts
+ * 		FSM_EVENT_CNC_HOMING_FAILED instead. Returns SYS_FAIL if the
+ * 		Raspberry Pi does not answer, so the circuit breaker sees it.
+ *
+ ----------------------------------------------------------------------------*/
+
+SYS_RESULT CNC_Check_Homing() {
+	RPI_UART_Axes_Pos_Packet_t axesPos;
+
+	if (RPI_UART_Request_Axes_Pos_Pkt(&axesPos, 10) != SYS_SUCCESS) {
+		return SYS_FAIL;
+	}
+
+	if (axesPos.error) {
+		CNC_Stop_Homing();
+		FSM_Post_Event(FSM_EVENT_CNC_HOMING_FAILED);
+	}
+	else if (axesPos.homed && axesPos.idle) {
+		CNC_Stop_Homing();
+		CNC_Initialized = true;
+		FSM_Post_Event(FSM_EVENT_CNC_HOMED);
+	}
+
+	return SYS_SUCCESS;
+}
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		CNC_Stop_Homing
+ *
+ * 		Stops asking the Raspberry Pi whether homing is done. Does not stop
+ * 		the gantry.
+ *
+ ----------------------------------------------------------------------------*/
+
+void CNC_Stop_Homing() {
+	Scheduler_Disable_Task(CNC_Check_Homing_Task_ID);
+}
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		CNC_Emergency_Stop
+ *
+ * 		Stops homing and seed dispensing, closes the shutter, and shuts
+ * 		Klipper down with M112, which halts the gantry at once. Klipper has
+ * 		to be restarted from the Raspberry Pi before the gantry moves again,
+ * 		and the gantry homed, so moves are refused until CNC_Check_Homing()
+ * 		sees it homed again. The holes already dispensed are kept, so
+ * 		CNC_Start_Dispensing_Seeds() carries on after them.
+ *
+ ----------------------------------------------------------------------------*/
+
+SYS_RESULT CNC_Emergency_Stop() {
+	CNC_Stop_Homing();
+
+	Scheduler_Disable_Task(CNC_Dispense_Seeds_Task_ID);
+	dispensingSeeds = false;
+	PWM_ShutterServo_CloseTask(NULL);
+
+	if (RASPBERRY_PI_INTERFACE_ENABLED == SYS_FEATURE_DISABLED) {
+		return SYS_DEVICE_DISABLED;
+	}
+
+	CNC_Initialized = false;
+
+	return usb_send_gcode("M112", 100); // 100ms timeout
+}
+
+
 /*-----------------------------------------------------------------------------
  *
  * 		CNC_Move_To_Pos
@@ -247,6 +412,11 @@ SYS_RESULT CNC_Move_To_Pos(float x_pos, float y_pos) {
 	// A 600mm/min rate caused slipping. Unsure if this value could be higher.
 	SYS_RESULT result = usb_send_gcode(gcode, 75); // 75ms timeout
 
+	if (result == SYS_SUCCESS) {
+		moveTargetX = x_pos;
+		moveTargetY = y_pos;
+	}
+
 	return result; // Return the result of the G-code command
 }
 
@@ -296,20 +466,181 @@ SYS_RESULT CNC_Move_To_Hole(uint8_t channel_index, uint8_t hole_index, CNC_Tool_
 	return CNC_Move_To_Pos(x_destination, y_destination);
 }
 
+/*-----------------------------------------------------------------------------
+ *
+ * 		CNC_Dispense_Seeds
+ *
+ * 		Coroutine run by CNC_Dispense_Seeds_TASK that drops seeds in every net
+ * 		pot hole. The channels are covered in a serpentine, hole 0 to 9 on
+ * 		even channels and back from 9 to 0 on odd channels. At each hole the
+ * 		gantry is moved there, then the shutter is opened and closed, and the
+ * 		time the hole took is sent to the Raspberry Pi. Once
+ * 		every hole is done the head is parked, the task disables itself and
+ * 		tells the FSM with FSM_EVENT_SEEDS_DISPENSED.
+ *
+ * 		The shutter only opens once the gantry is confirmed in position,
+ * 		that is when the Raspberry Pi, asked every
+ * 		CNC_DISPENSE_POSITION_POLL_MS, reports Klipper idle at the hole. A
+ * 		move that can not be sent in CNC_DISPENSE_MOVE_ATTEMPTS tries, or is
+ * 		not confirmed within CNC_DISPENSE_MOVE_TIMEOUT_MS, stops dispensing
+ * 		and posts FSM_EVENT_SEED_DISPENSE_FAILED, as the gantry could still
+ * 		be over the last pot.
+ *
+ * 		Dispensing starts from the first hole not done yet, see
+ * 		CNC_Get_Holes_Dispensed(), and a checkpoint is saved after every
+ * 		hole, so a reset does not drop seeds in a pot twice.
+ *
+ ----------------------------------------------------------------------------*/
+
 SYS_RESULT CNC_Dispense_Seeds() {
-	// If CNC_Initialized is false, return error. 
-	// It should be initialized (homed) before this function is called.
-	if (!CNC_Initialized) {
-		return SYS_NOT_INITIALIZED;
+
+	CO_BEGIN(&dispenseCoroutine);
+
+	// Only the first channel can be partly done
+	for (dispenseChannel = holesDispensed / CNC_NUM_NET_POTS_PER_NFT_CHANNEL; dispenseChannel < CNC_NUM_NFT_CHANNELS; dispenseChannel++) {
+		for (dispenseStep = holesDispensed % CNC_NUM_NET_POTS_PER_NFT_CHANNEL; dispenseStep < CNC_NUM_NET_POTS_PER_NFT_CHANNEL; dispenseStep++) {
+
+			if (dispenseChannel % 2 == 0) {
+				dispenseHole = dispenseStep;
+			}
+			else {
+				dispenseHole = CNC_NUM_NET_POTS_PER_NFT_CHANNEL - 1 - dispenseStep;
+			}
+
+			holeStartTimestamp = getTimestamp();
+
+			// A failed send leaves the last target in place, try it again
+			holeMoveAttempts = 1;
+			holeMoveSent = (CNC_Move_To_Hole(dispenseChannel, dispenseHole, CNC_TOOL_SEED_DISPENSER) == SYS_SUCCESS);
+			while (!holeMoveSent && holeMoveAttempts < CNC_DISPENSE_MOVE_ATTEMPTS) {
+				CO_AWAIT_MS(&dispenseCoroutine, CNC_DISPENSE_MOVE_RETRY_MS);
+				holeMoveAttempts++;
+				holeMoveSent = (CNC_Move_To_Hole(dispenseChannel, dispenseHole, CNC_TOOL_SEED_DISPENSER) == SYS_SUCCESS);
+			}
+
+			holeMoveConfirmed = false;
+			while (holeMoveSent && !holeMoveConfirmed && getTimestamp() - holeStartTimestamp < CNC_DISPENSE_MOVE_TIMEOUT_MS) {
+				CO_AWAIT_MS(&dispenseCoroutine, CNC_DISPENSE_POSITION_POLL_MS);
+				holeMoveConfirmed = CNC_Is_In_Position();
+			}
+			holeMoveMs = (uint32_t)(getTimestamp() - holeStartTimestamp);
+
+			if (!holeMoveConfirmed) {
+				RPI_UART_Send_Dispense_Hole_Pkt(dispenseChannel, dispenseHole, holeMoveMs, holeMoveMs, false, 10);
+				Scheduler_Disable_Task(CNC_Dispense_Seeds_Task_ID);
+				dispensingSeeds = false;
+				FSM_Post_Event(FSM_EVENT_SEED_DISPENSE_FAILED);
+				CO_EXIT(&dispenseCoroutine, SYS_FAIL);
+			}
+
+			PWM_ShutterServo_OpenTask(NULL);
+			CO_AWAIT_MS(&dispenseCoroutine, CNC_DISPENSE_SHUTTER_OPEN_MS);
+
+			PWM_ShutterServo_CloseTask(NULL);
+			CO_AWAIT_MS(&dispenseCoroutine, CNC_DISPENSE_SHUTTER_CLOSE_MS);
+
+			RPI_UART_Send_Dispense_Hole_Pkt(dispenseChannel, dispenseHole, holeMoveMs,
+											(uint32_t)(getTimestamp() - holeStartTimestamp),
+											holeMoveConfirmed, 10);
+
+			holesDispensed++;
+			Checkpoint_Save();
+		}
 	}
-	
-	// Call the high-level wrapper function repeatedly until it returns a value
-	const uint16_t SEED_INDICATOR_VALUE = CNC_NUM_NFT_CHANNELS * CNC_NUM_NET_POTS_PER_NFT_CHANNEL + 1;
-	uint16_t seedsFailedToDispense = ASGC_System_DispenseSeeds();
 
-	// Add code to indicate we are ready for transition for the conditional:
-	// if(seedsFailedToDispense < SEED_INDICATOR_VALUE)
-	//		transition_to_next_state();
+	// Move head out of the way
+	CNC_Move_To_Pos(CNC_DISPENSE_PARK_X_POS_MM, CNC_DISPENSE_PARK_Y_POS_MM);
+	Scheduler_Disable_Task(CNC_Dispense_Seeds_Task_ID);
+	dispensingSeeds = false;
+	holesDispensed = 0;
+	FSM_Post_Event(FSM_EVENT_SEEDS_DISPENSED);
 
-	return SYS_SUCCESS;
+	CO_END(&dispenseCoroutine);
+}
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		CNC_Start_Dispensing_Seeds
+ *
+ * 		Starts the seed dispensing sequence from the first hole not done
+ * 		yet. That is the first hole, unless a checkpoint was resumed with
+ * 		CNC_Set_Holes_Dispensed() or the last sequence was cut short.
+ *
+ ----------------------------------------------------------------------------*/
+
+void CNC_Start_Dispensing_Seeds() {
+	CO_RESET(&dispenseCoroutine);
+	dispensingSeeds = (CNC_Dispense_Seeds_Task_ID != SCHEDULER_NO_TASK);
+	Scheduler_Enable_Task(CNC_Dispense_Seeds_Task_ID, 0);
+}
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		CNC_Is_Dispensing_Seeds
+ *
+ * 		Returns true while the seed dispensing sequence is running. Always
+ * 		false if the dispensing task is not registered.
+ *
+ ----------------------------------------------------------------------------*/
+
+bool CNC_Is_Dispensing_Seeds() {
+	return dispensingSeeds;
+}
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		CNC_Is_In_Position
+ *
+ * 		Asks the Raspberry Pi whether the gantry has finished its moves and
+ * 		stands within CNC_POSITION_TOLERANCE_MM of the last position sent
+ * 		with CNC_Move_To_Pos(). Returns false if the Raspberry Pi does not
+ * 		answer.
+ *
+ ----------------------------------------------------------------------------*/
+
+bool CNC_Is_In_Position() {
+	RPI_UART_Axes_Pos_Packet_t axesPos;
+
+	if (RPI_UART_Request_Axes_Pos_Pkt(&axesPos, 10) != SYS_SUCCESS) {
+		return false;
+	}
+
+	return (axesPos.idle
+			&& fabsf(axesPos.x_pos - moveTargetX) <= CNC_POSITION_TOLERANCE_MM
+			&& fabsf(axesPos.y_pos - moveTargetY) <= CNC_POSITION_TOLERANCE_MM);
+}
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		CNC_Get_Holes_Dispensed
+ *
+ * 		Returns the number of holes the running seed dispensing sequence is
+ * 		done with, in the order they are dispensed. 0 when not dispensing.
+ *
+ ----------------------------------------------------------------------------*/
+
+uint8_t CNC_Get_Holes_Dispensed() {
+	return holesDispensed;
+}
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		CNC_Set_Holes_Dispensed
+ *
+ * 		Makes the next CNC_Start_Dispensing_Seeds() skip the first 'holes'
+ * 		holes, e.g. those done before a reset.
+ *
+ ----------------------------------------------------------------------------*/
+
+void CNC_Set_Holes_Dispensed(uint8_t holes) {
+	if (holes > CNC_NUM_NFT_CHANNELS * CNC_NUM_NET_POTS_PER_NFT_CHANNEL) {
+		holes = CNC_NUM_NFT_CHANNELS * CNC_NUM_NET_POTS_PER_NFT_CHANNEL;
+	}
+
+	holesDispensed = holes;
 }
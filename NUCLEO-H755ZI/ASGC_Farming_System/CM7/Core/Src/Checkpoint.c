@@ -0,0 +1,212 @@
+/*-----------------------------------------------------------------------------
+ *
+ * 	Checkpoint.c
+ *
+ * 		Checkpoint of the FSM and seed dispensing progress in the backup
+ * 		SRAM, see Checkpoint.h.
+ *
+ *  Created on: Oct 16, 2026
+ *
+-----------------------------------------------------------------------------*/
+
+#include "Checkpoint.h"
+#include "Scheduler.h"
+#include "CNC.h"
+#include "Adafruit_AS7341.h"
+#include "Wall_Clock.h"
+#include "Reservoir.h"
+#include <stddef.h>
+#include <string.h>
+
+/*-----------------------------------------------------------------------------
+DEFINES
+-----------------------------------------------------------------------------*/
+#define CHECKPOINT_MAGIC						0x434B5054
+						/* Backup SRAM holds random data after the	 */
+						/* backup domain first powers up			 */
+#define CHECKPOINT_VERSION						3
+						/* Bump when Checkpoint_Data_t changes, so	 */
+						/* new firmware ignores an old checkpoint	 */
+#define CHECKPOINT_NUM_SLOTS					2
+#define CHECKPOINT_CRC32_POLY					0xEDB88320
+
+/*-----------------------------------------------------------------------------
+TYPEDEFS
+-----------------------------------------------------------------------------*/
+typedef struct Checkpoint_Record {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t sequence;					/* The newest valid slot is loaded	 */
+	Checkpoint_Data_t data;
+	uint32_t crc;						/* Of everything above				 */
+}Checkpoint_Record_t;
+
+/*-----------------------------------------------------------------------------
+STATIC VARIABLES
+-----------------------------------------------------------------------------*/
+Scheduler_Task_ID_t Checkpoint_Save_Task_ID = SCHEDULER_NO_TASK;
+
+static Checkpoint_Record_t *const Slots = (Checkpoint_Record_t *)D3_BKPSRAM_BASE;
+
+static Checkpoint_Data_t Loaded;			/* Found by Checkpoint_Init()	 */
+static bool Have_Loaded;
+static uint32_t Sequence;					/* Of the last slot written		 */
+
+/*-----------------------------------------------------------------------------
+STATIC FUNCTION DECLARATIONS
+-----------------------------------------------------------------------------*/
+static bool slot_is_valid(const Checkpoint_Record_t *slot);
+static uint32_t crc32(const void *buf, uint32_t len);
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		Checkpoint_Init()
+ *
+ * 		Turns on the backup SRAM and its regulator, reads the newest valid
+ * 		checkpoint, and registers the checkpoint task. Call after
+ * 		Scheduler_Init() and before FSM_Init(). The backup regulator only
+ * 		keeps the checkpoint through a power loss if VBAT is supplied.
+ *
+ ----------------------------------------------------------------------------*/
+ void Checkpoint_Init() {
+	int8_t newest = -1;
+
+	HAL_PWR_EnableBkUpAccess();
+	__HAL_RCC_BKPRAM_CLK_ENABLE();
+	HAL_PWREx_EnableBkUpReg();
+
+	for (int8_t i = 0; i < CHECKPOINT_NUM_SLOTS; i++) {
+		if (!slot_is_valid(&Slots[i])) {
+			continue;
+		}
+
+		// Sequence numbers compared across a wrap
+		if (newest < 0 || (int32_t)(Slots[i].sequence - Slots[newest].sequence) > 0) {
+			newest = i;
+		}
+	}
+
+	Have_Loaded = (newest >= 0);
+	Sequence = 0;
+
+	if (Have_Loaded) {
+		Loaded = Slots[newest].data;
+		Sequence = Slots[newest].sequence;
+	}
+
+	Scheduler_Task_Config_t saveTask = {
+		.task_function = Checkpoint_Save_TASK,
+		.failure_handler = NULL,
+		.interval_ms = CHECKPOINT_INTERVAL_MS,
+		.budget_ms = CHECKPOINT_TASK_BUDGET_MS,
+		.run_mode = SCHEDULER_RUN_FIXED_RATE,
+		.catch_up_policy = SCHEDULER_CATCH_UP_SKIP,
+		.critical = false,
+	};
+
+	if (Checkpoint_Save_Task_ID == SCHEDULER_NO_TASK) {
+		Checkpoint_Save_Task_ID = Scheduler_Register_Task(&saveTask);
+	}
+ }
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		Checkpoint_Load()
+ *
+ * 		Copies the checkpoint found by Checkpoint_Init() into 'data'. Returns
+ * 		false if there was none.
+ *
+ ----------------------------------------------------------------------------*/
+ bool Checkpoint_Load(Checkpoint_Data_t *data) {
+	if (!Have_Loaded || data == NULL) {
+		return false;
+	}
+
+	*data = Loaded;
+
+	return true;
+ }
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		Checkpoint_Save()
+ *
+ * 		Writes the current FSM state, state times, DLI, dispensing progress
+ * 		and reservoir calibration over the older slot. Safe to call from any task, the slot
+ * 		is written with interrupts masked.
+ *
+ ----------------------------------------------------------------------------*/
+ void Checkpoint_Save() {
+	Checkpoint_Record_t record;
+	Checkpoint_Record_t *slot;
+	uint32_t primask;
+
+	memset(&record, 0, sizeof(record));
+
+	record.magic = CHECKPOINT_MAGIC;
+	record.version = CHECKPOINT_VERSION;
+	record.data.state = FSM_Get_State();
+	record.data.uptime_ms = FSM_GetSystemUptime();
+	for (FSM_State s = 0; s < NUM_FSM_STATES; s++) {
+		record.data.state_residency_ms[s] = FSM_Get_State_Residency_ms(s);
+	}
+	record.data.dli_mol_m2 = Adafruit_AS7341_getDLI();
+	record.data.dli_day = Wall_Clock_Get_Local_Day();
+	record.data.holes_dispensed = CNC_Get_Holes_Dispensed();
+	record.data.fill_rate_mm_s = Reservoir_Get_Fill_Rate();
+	record.data.full_range_mm = Reservoir_Get_Full_Range_mm();
+
+	primask = __get_PRIMASK();
+	__disable_irq();
+
+	Sequence++;
+	record.sequence = Sequence;
+	record.crc = crc32(&record, offsetof(Checkpoint_Record_t, crc));
+
+	slot = &Slots[Sequence % CHECKPOINT_NUM_SLOTS];
+	*slot = record;
+	__DSB();
+
+	__set_PRIMASK(primask);
+ }
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		slot_is_valid()
+ *
+ * 		Returns true if a slot holds a whole checkpoint of this version.
+ *
+ ----------------------------------------------------------------------------*/
+ static bool slot_is_valid(const Checkpoint_Record_t *slot) {
+	return (slot->magic == CHECKPOINT_MAGIC
+		 && slot->version == CHECKPOINT_VERSION
+		 && slot->data.state < NUM_FSM_STATES
+		 && slot->crc == crc32(slot, offsetof(Checkpoint_Record_t, crc)));
+ }
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		crc32()
+ *
+ * 		CRC-32 (IEEE 802.3) of 'len' bytes, bit by bit. A checkpoint is a
+ * 		little over 100 bytes, so a table is not worth its flash.
+ *
+ ----------------------------------------------------------------------------*/
+ static uint32_t crc32(const void *buf, uint32_t len) {
+	const uint8_t *bytes = buf;
+	uint32_t crc = 0xFFFFFFFF;
+
+	for (uint32_t i = 0; i < len; i++) {
+		crc ^= bytes[i];
+
+		for (uint8_t bit = 0; bit < 8; bit++) {
+			crc = (crc >> 1) ^ ((crc & 1) ? CHECKPOINT_CRC32_POLY : 0);
+		}
+	}
+
+	return ~crc;
+ }
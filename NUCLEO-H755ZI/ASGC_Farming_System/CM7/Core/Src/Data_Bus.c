@@ -0,0 +1,297 @@
+/*-----------------------------------------------------------------------------
+ *
+ * 	Data_Bus.c
+ *
+ * 		Publish/subscribe bus for sensor readings, see Data_Bus.h.
+ *
+ *  Created on: Oct 16, 2026
+ *
+-----------------------------------------------------------------------------*/
+
+#include "Data_Bus.h"
+#include "timer.h"
+#include <string.h>
+
+/*-----------------------------------------------------------------------------
+TYPEDEFS
+-----------------------------------------------------------------------------*/
+
+// Newest reading of a topic. lock_sequence is odd while the reading is
+// being written.
+typedef struct Data_Bus_Slot {
+	volatile uint32_t lock_sequence;
+	Data_Bus_Sample_t sample;
+}Data_Bus_Slot_t;
+
+// Queue of the readings a subscriber has not read yet
+typedef struct Data_Bus_Subscriber {
+	uint32_t topic_mask;
+	Data_Bus_Sample_t queue[DATA_BUS_QUEUE_LENGTH];
+	uint8_t head;						/* Oldest unread reading			 */
+	uint8_t count;
+	uint32_t dropped_count;				/* Readings lost to a full queue	 */
+}Data_Bus_Subscriber_t;
+
+/*-----------------------------------------------------------------------------
+STATIC VARIABLES
+-----------------------------------------------------------------------------*/
+static Data_Bus_Slot_t Slots[DATA_BUS_NUM_TOPICS];
+static Data_Bus_Subscriber_t Subscribers[DATA_BUS_MAX_SUBSCRIBERS];
+static uint8_t Num_Subscribers;
+
+/*-----------------------------------------------------------------------------
+STATIC FUNCTION DECLARATIONS
+-----------------------------------------------------------------------------*/
+static void push_to_subscriber(Data_Bus_Subscriber_t *subscriber, const Data_Bus_Sample_t *sample);
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		Data_Bus_Init()
+ *
+ * 		Clears every topic and subscriber. Must be called before the device
+ * 		drivers are initialized, as the consumers subscribe from their init
+ * 		functions.
+ *
+ ----------------------------------------------------------------------------*/
+ void Data_Bus_Init() {
+	memset(Slots, 0, sizeof(Slots));
+	memset(Subscribers, 0, sizeof(Subscribers));
+	Num_Subscribers = 0;
+
+	for (Data_Bus_Topic_t t = 0; t < DATA_BUS_NUM_TOPICS; t++) {
+		Slots[t].sample.topic = t;
+	}
+ }
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		Data_Bus_Publish()
+ *
+ * 		Publishes a reading to a topic. The reading is timestamped, becomes
+ * 		the topic's latest value and is queued for every subscriber of the
+ * 		topic.
+ *
+ ----------------------------------------------------------------------------*/
+ void Data_Bus_Publish(Data_Bus_Topic_t topic, const Data_Bus_Value_t *value) {
+	Data_Bus_Slot_t *slot;
+	uint8_t s;
+
+	if (topic >= DATA_BUS_NUM_TOPICS || value == NULL) {
+		return;
+	}
+
+	slot = &Slots[topic];
+
+	// Readers retry while lock_sequence is odd or has changed under them
+	slot->lock_sequence++;
+	__DMB();
+
+	slot->sample.sequence++;
+	slot->sample.timestamp = getTimestamp();
+	slot->sample.value = *value;
+
+	__DMB();
+	slot->lock_sequence++;
+
+	for (s = 0; s < Num_Subscribers; s++) {
+		if (Subscribers[s].topic_mask & DATA_BUS_TOPIC_MASK(topic)) {
+			push_to_subscriber(&Subscribers[s], &slot->sample);
+		}
+	}
+ }
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		Data_Bus_Read_Latest()
+ *
+ * 		Copies the newest reading of a topic into 'sample'. Returns false if
+ * 		nothing was published to the topic yet, or if the reading could not
+ * 		be copied because the caller interrupted its publisher.
+ * 		sample->sequence tells a consumer whether the reading is new to it.
+ *
+ ----------------------------------------------------------------------------*/
+ bool Data_Bus_Read_Latest(Data_Bus_Topic_t topic, Data_Bus_Sample_t *sample) {
+	Data_Bus_Slot_t *slot;
+	uint32_t lockSequence;
+
+	if (topic >= DATA_BUS_NUM_TOPICS || sample == NULL) {
+		return false;
+	}
+
+	slot = &Slots[topic];
+
+	for (uint8_t attempt = 0; attempt < DATA_BUS_SEQLOCK_MAX_RETRIES; attempt++) {
+		lockSequence = slot->lock_sequence;
+
+		// Being published
+		if (lockSequence & 1) {
+			continue;
+		}
+
+		__DMB();
+		*sample = slot->sample;
+		__DMB();
+
+		if (slot->lock_sequence == lockSequence) {
+			return (sample->sequence != 0);
+		}
+	}
+
+	return false;
+ }
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		Data_Bus_Subscribe()
+ *
+ * 		Gives a consumer a queue of the readings published on the topics in
+ * 		topic_mask (see DATA_BUS_TOPIC_MASK()) from now on. Returns
+ * 		DATA_BUS_NO_SUBSCRIBER if all DATA_BUS_MAX_SUBSCRIBERS are taken,
+ * 		which the other functions ignore.
+ *
+ ----------------------------------------------------------------------------*/
+ Data_Bus_Subscriber_ID_t Data_Bus_Subscribe(uint32_t topic_mask) {
+	Data_Bus_Subscriber_t *subscriber;
+
+	if (topic_mask == 0 || Num_Subscribers >= DATA_BUS_MAX_SUBSCRIBERS) {
+		return DATA_BUS_NO_SUBSCRIBER;
+	}
+
+	subscriber = &Subscribers[Num_Subscribers];
+	subscriber->head = 0;
+	subscriber->count = 0;
+	subscriber->dropped_count = 0;
+	subscriber->topic_mask = topic_mask;
+
+	return Num_Subscribers++;
+ }
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		Data_Bus_Peek()
+ *
+ * 		Copies the oldest unread reading of a subscriber into 'sample',
+ * 		without removing it from the queue. Returns false if the queue is
+ * 		empty. Lets a consumer keep a reading it failed to handle, e.g. a
+ * 		packet that could not be sent, and retry it.
+ *
+ ----------------------------------------------------------------------------*/
+ bool Data_Bus_Peek(Data_Bus_Subscriber_ID_t subscriber_id, Data_Bus_Sample_t *sample) {
+	Data_Bus_Subscriber_t *subscriber;
+	uint32_t primask;
+	bool available;
+
+	if (subscriber_id >= Num_Subscribers || sample == NULL) {
+		return false;
+	}
+
+	subscriber = &Subscribers[subscriber_id];
+
+	primask = __get_PRIMASK();
+	__disable_irq();
+
+	available = (subscriber->count > 0);
+	if (available) {
+		*sample = subscriber->queue[subscriber->head];
+	}
+
+	__set_PRIMASK(primask);
+
+	return available;
+ }
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		Data_Bus_Consume()
+ *
+ * 		Removes the oldest unread reading from a subscriber's queue.
+ *
+ ----------------------------------------------------------------------------*/
+ void Data_Bus_Consume(Data_Bus_Subscriber_ID_t subscriber_id) {
+	Data_Bus_Subscriber_t *subscriber;
+	uint32_t primask;
+
+	if (subscriber_id >= Num_Subscribers) {
+		return;
+	}
+
+	subscriber = &Subscribers[subscriber_id];
+
+	primask = __get_PRIMASK();
+	__disable_irq();
+
+	if (subscriber->count > 0) {
+		subscriber->head = (subscriber->head + 1) % DATA_BUS_QUEUE_LENGTH;
+		subscriber->count--;
+	}
+
+	__set_PRIMASK(primask);
+ }
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		Data_Bus_Receive()
+ *
+ * 		Takes the oldest unread reading of a subscriber. Returns false if
+ * 		the queue is empty.
+ *
+ ----------------------------------------------------------------------------*/
+ bool Data_Bus_Receive(Data_Bus_Subscriber_ID_t subscriber_id, Data_Bus_Sample_t *sample) {
+	if (!Data_Bus_Peek(subscriber_id, sample)) {
+		return false;
+	}
+
+	Data_Bus_Consume(subscriber_id);
+
+	return true;
+ }
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		Data_Bus_Get_Dropped_Count()
+ *
+ * 		Returns the number of readings a subscriber lost because it fell more
+ * 		than DATA_BUS_QUEUE_LENGTH readings behind.
+ *
+ ----------------------------------------------------------------------------*/
+ uint32_t Data_Bus_Get_Dropped_Count(Data_Bus_Subscriber_ID_t subscriber_id) {
+	if (subscriber_id >= Num_Subscribers) {
+		return 0;
+	}
+
+	return Subscribers[subscriber_id].dropped_count;
+ }
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		push_to_subscriber()
+ *
+ * 		Queues a reading for a subscriber. A full queue drops its oldest
+ * 		reading, so a consumer that falls behind gets the newest readings.
+ *
+ ----------------------------------------------------------------------------*/
+ static void push_to_subscriber(Data_Bus_Subscriber_t *subscriber, const Data_Bus_Sample_t *sample) {
+	uint32_t primask;
+
+	primask = __get_PRIMASK();
+	__disable_irq();
+
+	if (subscriber->count == DATA_BUS_QUEUE_LENGTH) {
+		subscriber->head = (subscriber->head + 1) % DATA_BUS_QUEUE_LENGTH;
+		subscriber->count--;
+		subscriber->dropped_count++;
+	}
+
+	subscriber->queue[(subscriber->head + subscriber->count) % DATA_BUS_QUEUE_LENGTH] = *sample;
+	subscriber->count++;
+
+	__set_PRIMASK(primask);
+ }
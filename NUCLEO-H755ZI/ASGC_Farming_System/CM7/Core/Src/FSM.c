@@ -5,6 +5,39 @@
  * 		The main (Finite State Machine) state controller of the ASGC Farming
  *      Robot
  *
+ *      The FSM only moves on events. Interrupt work, tasks and the state
+ *      timer post them with FSM_Post_Event(), and FSM_Update() looks each one
+ *      up in the current state's transition table. The whole transition graph
+ *      is the FSM_STATES table below, and can be checked with
+ *      FSM_Check_Transition_Table().
+ *
+ *      Work that runs alongside a state, like CNC homing during the
+ *      reservoir fill, is forked by starting it in the state's activation
+ *      function and joined by deferring its completion event: a state that
+ *      lists an event in deferredEvents keeps it, and it is posted again
+ *      once the FSM moves on, so the state that waits for it sees it even if
+ *      it came early.
+ *
+ *      Every transition is recorded in a trace ring of FSM_TRACE_LENGTH
+ *      entries, and the time spent in each state is summed up, to see where
+ *      the cycle time goes. Both are sent to the Raspberry Pi and the
+ *      residency is shown on the dashboard.
+ *
+ *      Every transition saves a checkpoint, see Checkpoint.h. FSM_Init()
+ *      resumes from it after a reset: the growth phase is entered again
+ *      straight away, and a reset during the fill, homing or dispensing
+ *      goes through them again without waiting for the start button, as
+ *      the gantry has to be homed again. Dispensing then carries on from
+ *      the first hole not done. Nothing before the start button, no fault
+ *      and no E-stop is resumed.
+ *
+ *      The E-stop takes the FSM to FSM_STATE_ESTOP_PRESSED from any state,
+ *      see FSM_EStop(). The actuators are stopped but the Raspberry Pi link,
+ *      the sensors and the display keep running, and a reset of the E-stop
+ *      from the Raspberry Pi, checked by FSM_Check_EStop_Reset(), takes the
+ *      FSM back to where it can safely carry on, the same way a checkpoint
+ *      is resumed.
+ *
  *  Created on: Sep 3, 2025
  *
 -----------------------------------------------------------------------------*/
@@ -15,52 +48,207 @@
 #include "gpio_switching_intf.h"
 #include "ILI9341/ILI9341_GFX.h"
 #include "RPI_UART.h"
+#include "Reservoir.h"
+#include "VL53L1X_prj.h"
+#include "Checkpoint.h"
+#include "Wall_Clock.h"
+#include "Timer_Wheel.h"
+#include <string.h>
+
+/*-----------------------------------------------------------------------------
+DEFINES
+-----------------------------------------------------------------------------*/
+#define FSM_TRANSITIONS(table)      .transitions = (table), \
+                                    .numTransitions = sizeof(table) / sizeof((table)[0])
+
+/*-----------------------------------------------------------------------------
+TRANSITION TABLES
+-----------------------------------------------------------------------------*/
+static const FSM_Transition_t INIT_TRANSITIONS[] = {
+    { FSM_EVENT_INITIALIZED,        FSM_STATE_WAITING_ON_START },
+    { FSM_EVENT_RESUMED,            FSM_STATE_GROWTH_MONITORING },
+};
+
+static const FSM_Transition_t WAITING_ON_START_TRANSITIONS[] = {
+    { FSM_EVENT_START_PRESSED,      FSM_STATE_FILL_RESERVOIR },
+};
+
+static const FSM_Transition_t FILL_RESERVOIR_TRANSITIONS[] = {
+    { FSM_EVENT_RESERVOIR_FILLED,   FSM_STATE_CNC_HOMING },
+    { FSM_EVENT_TIMEOUT,            FSM_STATE_CNC_HOMING },
+    { FSM_EVENT_CNC_HOMING_FAILED,  FSM_STATE_FAULT },
+};
+
+static const FSM_Transition_t CNC_HOMING_TRANSITIONS[] = {
+    { FSM_EVENT_CNC_HOMED,          FSM_STATE_SEED_DISPENSE },
+    { FSM_EVENT_CNC_HOMING_FAILED,  FSM_STATE_FAULT },
+    { FSM_EVENT_TIMEOUT,            FSM_STATE_FAULT },
+};
+
+static const FSM_Transition_t SEED_DISPENSE_TRANSITIONS[] = {
+    { FSM_EVENT_SEEDS_DISPENSED,    FSM_STATE_GROWTH_MONITORING },
+    { FSM_EVENT_SEED_DISPENSE_FAILED, FSM_STATE_FAULT },
+};
+
+static const FSM_Transition_t ESTOP_PRESSED_TRANSITIONS[] = {
+    { FSM_EVENT_ESTOP_RESET,        FSM_STATE_FILL_RESERVOIR },
+    { FSM_EVENT_RESUMED,            FSM_STATE_GROWTH_MONITORING },
+};
 
 /*-----------------------------------------------------------------------------
 STATIC VARIABLES
 -----------------------------------------------------------------------------*/
-struct FSM_State_Struct FSM_STATES[NUM_FSM_STATES];
+struct FSM_State_Struct FSM_STATES[NUM_FSM_STATES] = {
+    [FSM_STATE_INIT] = {
+        .state_activation_funciton = NULL,
+        FSM_TRANSITIONS(INIT_TRANSITIONS),
+    },
+    [FSM_STATE_WAITING_ON_START] = {
+        .state_activation_funciton = FSM_State_WAITING_ON_START_SAF,
+        FSM_TRANSITIONS(WAITING_ON_START_TRANSITIONS),
+    },
+    [FSM_STATE_FILL_RESERVOIR] = {
+        .state_activation_funciton = FSM_State_FILL_RESERVOIR_SAF,
+        .timeout_ms = FSM_STATE_FILL_RESERVOIR_TIMEOUT,
+        FSM_TRANSITIONS(FILL_RESERVOIR_TRANSITIONS),
+        .deferredEvents = FSM_EVENT_MASK(FSM_EVENT_CNC_HOMED),
+    },
+    [FSM_STATE_CNC_HOMING] = {
+        .state_activation_funciton = FSM_State_CNC_HOMING_SAF,
+        .timeout_ms = FSM_STATE_CNC_HOMING_TIMEOUT,
+        FSM_TRANSITIONS(CNC_HOMING_TRANSITIONS),
+    },
+    [FSM_STATE_SEED_DISPENSE] = {
+        .state_activation_funciton = FSM_State_SEED_DISPENSE_SAF,
+        FSM_TRANSITIONS(SEED_DISPENSE_TRANSITIONS),
+    },
+    [FSM_STATE_GROWTH_MONITORING] = {
+        .state_activation_funciton = FSM_State_GROWTH_MONITORING_SAF,
+    },
+    [FSM_STATE_FAULT] = {
+        .state_activation_funciton = FSM_State_FAULT_SAF,
+    },
+    [FSM_STATE_ESTOP_PRESSED] = {
+        .state_activation_funciton = FSM_State_ESTOP_PRESSED_SAF,
+        FSM_TRANSITIONS(ESTOP_PRESSED_TRANSITIONS),
+    },
+};
 FSM_State currentFSMState;
 
+// Short enough for a dashboard line
+static const char *const FSM_STATE_NAMES[NUM_FSM_STATES] = {
+    [FSM_STATE_INIT]              = "Init",
+    [FSM_STATE_WAITING_ON_START]  = "Waiting",
+    [FSM_STATE_FILL_RESERVOIR]    = "Filling",
+    [FSM_STATE_CNC_HOMING]        = "Homing",
+    [FSM_STATE_SEED_DISPENSE]     = "Dispense",
+    [FSM_STATE_GROWTH_MONITORING] = "Growing",
+    [FSM_STATE_FAULT]             = "Fault",
+    [FSM_STATE_ESTOP_PRESSED]     = "E-Stop",
+};
+
+static FSM_Event_t eventQueue[FSM_EVENT_QUEUE_LENGTH];
+static uint8_t eventQueueHead;                  /* Oldest event                  */
+static uint8_t eventQueueCount;
+static uint32_t droppedEventCount;              /* Events lost to a full queue   */
+
+static uint32_t deferredEventMask;              /* Kept by the current state     */
+
+static FSM_Trace_Entry_t traceEntries[FSM_TRACE_LENGTH];
+static uint32_t numTransitions;                 /* Next entry is at this modulo  */
+                                                /* FSM_TRACE_LENGTH              */
+static uint64_t stateResidencyMs[NUM_FSM_STATES];   /* Time in each state, not   */
+                                                    /* counting the current stay */
+
+static uint64_t uptimeBeforeResetMs;            /* Resumed from the checkpoint   */
+static uint64_t systemStartTimestamp;           /* Uptime counts from here, set  */
+static bool systemStarted;                      /* once on the first fill or the */
+                                                /* resume, not on re-entries     */
+static bool resumingGrowth;                     /* The growth phase is entered   */
+                                                /* from FSM_STATE_INIT           */
+
+static FSM_State estopFromState;                /* State the E-stop was pressed  */
+                                                /* in                            */
+static uint32_t estopToken;                     /* New for every E-stop, the     */
+                                                /* reset must echo it            */
+
+static Timer_Wheel_ID_t stateTimer = TIMER_WHEEL_NO_TIMER;
+static bool stateTimerExpired;                  /* FSM_EVENT_TIMEOUT is due      */
+
 extern bool SYSTEM_START_STATE;
+extern bool SYSTEM_ESTOP_STATE;
+
+Scheduler_Task_ID_t FSM_Check_EStop_Reset_Task_ID = SCHEDULER_NO_TASK;
+
+/*-----------------------------------------------------------------------------
+STATIC FUNCTION DECLARATIONS
+-----------------------------------------------------------------------------*/
+static bool pop_event(FSM_Event_t *event);
+static void dispatch_event(FSM_Event_t event);
+static void enter_state(FSM_State state, FSM_Event_t cause);
+static void state_timer_callback(uint32_t argument);
+static FSM_Event_t resume_checkpoint();
+static void start_monitoring();
 
 /*-----------------------------------------------------------------------------
  *
  * 		FSM_Init()
  *
- * 		Initializes the finite state machine's states
+ * 		Initializes the finite state machine in FSM_STATE_INIT. The first
+ *      FSM_Update() moves it on to FSM_STATE_WAITING_ON_START, or to where
+ *      the checkpoint left off, and registers the E-stop reset task. Call
+ *      after Scheduler_Init() and Checkpoint_Init(). Returns SYS_FAIL if the
+ *      transition table is broken.
  *
  ----------------------------------------------------------------------------*/
 SYS_RESULT FSM_Init() {
     currentFSMState = FSM_STATE_INIT;
 
-    FSM_STATES[FSM_STATE_INIT].stateActivated = true;
-    FSM_STATES[FSM_STATE_INIT].state_activation_funciton = NULL;
-    FSM_STATES[FSM_STATE_INIT].transition_check_function = FSM_State_INIT_TCF;
+    eventQueueHead = 0;
+    eventQueueCount = 0;
+    droppedEventCount = 0;
+    deferredEventMask = 0;
+    stateTimerExpired = false;
 
-    FSM_STATES[FSM_STATE_WAITING_ON_START].stateActivated = false;
-    FSM_STATES[FSM_STATE_WAITING_ON_START].state_activation_funciton = FSM_State_WAITING_ON_START_SAF;
-    FSM_STATES[FSM_STATE_WAITING_ON_START].transition_check_function = FSM_State_WAITING_ON_START_TCF;
+    numTransitions = 0;
+    memset(stateResidencyMs, 0, sizeof(stateResidencyMs));
+    uptimeBeforeResetMs = 0;
+    systemStarted = false;
+    resumingGrowth = false;
 
-    FSM_STATES[FSM_STATE_FILL_RESERVOIR].stateActivated = false;
-    FSM_STATES[FSM_STATE_FILL_RESERVOIR].state_activation_funciton = FSM_State_FILL_RESERVOIR_SAF;
-    FSM_STATES[FSM_STATE_FILL_RESERVOIR].transition_check_function = FSM_State_FILL_RESERVOIR_TCF;
+    FSM_STATES[FSM_STATE_INIT].stateStartTimestamp = getTimestamp();
 
-    FSM_STATES[FSM_STATE_CNC_HOMING].stateActivated = false;
-    FSM_STATES[FSM_STATE_CNC_HOMING].state_activation_funciton = FSM_State_CNC_HOMING_SAF;
-    FSM_STATES[FSM_STATE_CNC_HOMING].transition_check_function = FSM_State_CNC_HOMING_TCF;
+    if (FSM_Check_Transition_Table() != SYS_SUCCESS) {
+        return SYS_FAIL;
+    }
 
-    FSM_STATES[FSM_STATE_SEED_DISPENSE].stateActivated = false;
-    FSM_STATES[FSM_STATE_SEED_DISPENSE].state_activation_funciton = FSM_State_SEED_DISPENSE_SAF;
-    FSM_STATES[FSM_STATE_SEED_DISPENSE].transition_check_function = FSM_State_SEED_DISPENSE_TCF;
+    if (stateTimer == TIMER_WHEEL_NO_TIMER) {
+        stateTimer = Timer_Wheel_Create(state_timer_callback, 0);
+    }
 
-    FSM_STATES[FSM_STATE_GROWTH_MONITORING].stateActivated = false;
-    FSM_STATES[FSM_STATE_GROWTH_MONITORING].state_activation_funciton = FSM_State_GROWTH_MONITORING_SAF;
-    FSM_STATES[FSM_STATE_GROWTH_MONITORING].transition_check_function = FSM_State_GROWTH_MONITORING_TCF;
+    if (stateTimer == TIMER_WHEEL_NO_TIMER) {
+        return SYS_FAIL;
+    }
 
-    FSM_STATES[FSM_STATE_ESTOP_PRESSED].stateActivated = false;
-    FSM_STATES[FSM_STATE_ESTOP_PRESSED].state_activation_funciton = NULL;
-    FSM_STATES[FSM_STATE_ESTOP_PRESSED].transition_check_function = NULL;
+    // The reset of the E-stop comes from the Raspberry Pi
+    if (RASPBERRY_PI_INTERFACE_ENABLED == SYS_FEATURE_ENABLED) {
+        Scheduler_Task_Config_t estopResetTask = {
+            .task_function = FSM_Check_EStop_Reset_TASK,
+            .failure_handler = NULL,
+            .interval_ms = FSM_ESTOP_RESET_POLL_MS,
+            .budget_ms = FSM_ESTOP_RESET_TASK_BUDGET_MS,
+            .run_mode = SCHEDULER_RUN_FIXED_DELAY,
+            .catch_up_policy = SCHEDULER_CATCH_UP_SKIP,
+            .critical = false,
+            .bus = SCHEDULER_BUS_UART7,
+        };
+
+        if (FSM_Check_EStop_Reset_Task_ID == SCHEDULER_NO_TASK) {
+            FSM_Check_EStop_Reset_Task_ID = Scheduler_Register_Task(&estopResetTask);
+        }
+    }
+
+    FSM_Post_Event(resume_checkpoint());
 
     return SYS_SUCCESS;
 }
@@ -70,10 +258,14 @@ SYS_RESULT FSM_Init() {
  *
  * 		FSM_Update()
  *
- * 		The main update function of the Finite State Machine
+ * 		The main update function of the Finite State Machine. Handles every
+ *      queued event, and the state timer once it expires. Does nothing when
+ *      neither is pending.
  *
  ----------------------------------------------------------------------------*/
 void FSM_Update() {
+    FSM_Event_t event;
+
     if (currentFSMState >= NUM_FSM_STATES) {
         // This is probably an unrecoverable hard fault, unless if a lot of
         // resources are invested in making compelling fault recovery
@@ -83,51 +275,611 @@ void FSM_Update() {
         return;
     }
 
-    // If the current state's activation function has not been executed
-    if (!FSM_STATES[currentFSMState].stateActivated && FSM_STATES[currentFSMState].state_activation_funciton != NULL) {
-        FSM_STATES[currentFSMState].state_activation_funciton();
-        FSM_STATES[currentFSMState].stateActivated = true;
+    // The timeout is not queued, so it can not reach the state after the one
+    // that armed it
+    for (;;) {
+        if (pop_event(&event)) {
+            dispatch_event(event);
+        }
+        else if (stateTimerExpired) {
+            stateTimerExpired = false;
+            dispatch_event(FSM_EVENT_TIMEOUT);
+        }
+        else {
+            return;
+        }
+    }
+}
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		FSM_Post_Event()
+ *
+ * 		Queues an event for FSM_Update(). Safe to call from tasks and
+ *      interrupts. Returns false if the queue is full, or for the events
+ *      that are not queued: FSM_EVENT_TIMEOUT and FSM_EVENT_ESTOP_PRESSED.
+ *
+ ----------------------------------------------------------------------------*/
+bool FSM_Post_Event(FSM_Event_t event) {
+    uint32_t primask;
+    bool queued = false;
+
+    if (event >= NUM_FSM_EVENTS || event == FSM_EVENT_TIMEOUT || event == FSM_EVENT_ESTOP_PRESSED) {
+        return false;
     }
 
-    // Run the current state's transition check
-    if (FSM_STATES[currentFSMState].transition_check_function != NULL) {
-        FSM_STATES[currentFSMState].transition_check_function();
+    primask = __get_PRIMASK();
+    __disable_irq();
+
+    if (eventQueueCount < FSM_EVENT_QUEUE_LENGTH) {
+        eventQueue[(eventQueueHead + eventQueueCount) % FSM_EVENT_QUEUE_LENGTH] = event;
+        eventQueueCount++;
+        queued = true;
     }
+    else {
+        droppedEventCount++;
+    }
+
+    __set_PRIMASK(primask);
 
+    return queued;
 }
 
-/*XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
 
-    FSM_STATE_INIT
+/*-----------------------------------------------------------------------------
+ *
+ * 		FSM_Get_Ms_Until_Next_Update()
+ *
+ * 		Returns the number of milliseconds until FSM_Update() has something
+ *      to do, so the main loop knows how long it may idle for: 0 while
+ *      events are queued or the state timer has run out, otherwise
+ *      FSM_NO_PENDING_UPDATE_MS. Whatever posts the events also wakes the
+ *      core, and the state timer is waited on by the timer wheel.
+ *
+ ----------------------------------------------------------------------------*/
+uint32_t FSM_Get_Ms_Until_Next_Update() {
+    if (currentFSMState >= NUM_FSM_STATES) {
+        return FSM_NO_PENDING_UPDATE_MS;
+    }
 
-    Transitions into this state: 
-        NONE, this is the entry point of the FSM
+    if (eventQueueCount > 0 || stateTimerExpired) {
+        return 0;
+    }
 
-    Action Upon State Activation:
-        NONE, this is the entry point of the FSM
+    return FSM_NO_PENDING_UPDATE_MS;
+}
 
-    Transitions out of this state:
-        -> FSM_STATE_WAITING_ON_START
-            Unconditionally transition to this state once the FSM is
-            initialized.
 
-XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX*/
+/*-----------------------------------------------------------------------------
+ *
+ * 		FSM_Get_State()
+ *
+ * 		Returns the current state of the FSM.
+ *
+ ----------------------------------------------------------------------------*/
+FSM_State FSM_Get_State() {
+    return currentFSMState;
+}
+
 
 /*-----------------------------------------------------------------------------
  *
- * 		FSM_State_INIT_TCF()
+ * 		FSM_Check_Transition_Table()
  *
- * 		The transition check function for FSM_STATE_INIT
- *      This TCF simply unconditionally moves to FSM_STATE_WAITING_ON_START
+ * 		Checks the transition tables in FSM_STATES: every row must name a
+ *      real event and state, a state must not handle the same event twice,
+ *      and every state but FSM_STATE_ESTOP_PRESSED (entered by the E-stop,
+ *      not by an event) must be reachable from FSM_STATE_INIT. A state with
+ *      FSM_EVENT_TIMEOUT in its table must have a timeout_ms, and a state
+ *      must not defer an event it handles, or FSM_EVENT_TIMEOUT. Returns
+ *      SYS_FAIL if any check fails.
  *
  ----------------------------------------------------------------------------*/
-SYS_RESULT FSM_State_INIT_TCF() {
-    currentFSMState = FSM_STATE_WAITING_ON_START;
+SYS_RESULT FSM_Check_Transition_Table() {
+    bool reachable[NUM_FSM_STATES] = { false };
+    bool changed;
+    const FSM_State_Struct_t *state;
+    FSM_State s;
+    uint8_t i, j;
+
+    // Deferred events are kept in a 32 bit mask
+    if (NUM_FSM_EVENTS > 32) {
+        return SYS_FAIL;
+    }
+
+    for (s = 0; s < NUM_FSM_STATES; s++) {
+        state = &FSM_STATES[s];
+
+        if (state->numTransitions > 0 && state->transitions == NULL) {
+            return SYS_FAIL;
+        }
+
+        if ((state->deferredEvents & FSM_EVENT_MASK(FSM_EVENT_TIMEOUT))
+        || (state->deferredEvents >> NUM_FSM_EVENTS) != 0) {
+            return SYS_FAIL;
+        }
+
+        for (i = 0; i < state->numTransitions; i++) {
+            if (state->transitions[i].event >= NUM_FSM_EVENTS
+            || state->transitions[i].nextState >= NUM_FSM_STATES) {
+                return SYS_FAIL;
+            }
+
+            if (state->transitions[i].event == FSM_EVENT_TIMEOUT && state->timeout_ms == 0) {
+                return SYS_FAIL;
+            }
+
+            if (state->deferredEvents & FSM_EVENT_MASK(state->transitions[i].event)) {
+                return SYS_FAIL;
+            }
+
+            for (j = i + 1; j < state->numTransitions; j++) {
+                if (state->transitions[j].event == state->transitions[i].event) {
+                    return SYS_FAIL;
+                }
+            }
+        }
+    }
+
+    // Flood the graph from FSM_STATE_INIT
+    reachable[FSM_STATE_INIT] = true;
+    do {
+        changed = false;
+
+        for (s = 0; s < NUM_FSM_STATES; s++) {
+            if (!reachable[s]) {
+                continue;
+            }
+
+            for (i = 0; i < FSM_STATES[s].numTransitions; i++) {
+                if (!reachable[FSM_STATES[s].transitions[i].nextState]) {
+                    reachable[FSM_STATES[s].transitions[i].nextState] = true;
+                    changed = true;
+                }
+            }
+        }
+    } while (changed);
+
+    for (s = 0; s < NUM_FSM_STATES; s++) {
+        if (!reachable[s] && s != FSM_STATE_ESTOP_PRESSED) {
+            return SYS_FAIL;
+        }
+    }
 
     return SYS_SUCCESS;
 }
 
 
+/*-----------------------------------------------------------------------------
+ *
+ * 		FSM_Get_Trace()
+ *
+ * 		Copies up to maxEntries of the latest transitions into 'entries',
+ *      oldest first. Returns the number copied, at most FSM_TRACE_LENGTH.
+ *      Compare FSM_Get_Num_Transitions() between reads to tell how many
+ *      were overwritten in between.
+ *
+ ----------------------------------------------------------------------------*/
+uint8_t FSM_Get_Trace(FSM_Trace_Entry_t *entries, uint8_t maxEntries) {
+    uint32_t primask;
+    uint32_t first;
+    uint8_t count;
+
+    if (entries == NULL) {
+        return 0;
+    }
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+
+    count = (numTransitions < FSM_TRACE_LENGTH) ? numTransitions : FSM_TRACE_LENGTH;
+    if (count > maxEntries) {
+        count = maxEntries;
+    }
+
+    first = numTransitions - count;
+    for (uint8_t i = 0; i < count; i++) {
+        entries[i] = traceEntries[(first + i) % FSM_TRACE_LENGTH];
+    }
+
+    __set_PRIMASK(primask);
+
+    return count;
+}
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		FSM_Get_Num_Transitions()
+ *
+ * 		Returns the number of transitions since FSM_Init().
+ *
+ ----------------------------------------------------------------------------*/
+uint32_t FSM_Get_Num_Transitions() {
+    return numTransitions;
+}
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		FSM_Get_State_Residency_ms()
+ *
+ * 		Returns the total time spent in 'state' since FSM_Init(), including
+ *      the stay so far if it is the current state.
+ *
+ ----------------------------------------------------------------------------*/
+uint64_t FSM_Get_State_Residency_ms(FSM_State state) {
+    uint32_t primask;
+    uint64_t residency;
+
+    if (state >= NUM_FSM_STATES) {
+        return 0;
+    }
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+
+    residency = stateResidencyMs[state];
+    if (state == currentFSMState) {
+        residency += getTimestamp() - FSM_STATES[state].stateStartTimestamp;
+    }
+
+    __set_PRIMASK(primask);
+
+    return residency;
+}
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		FSM_Get_State_Name()
+ *
+ * 		Returns a short name of 'state' for the display.
+ *
+ ----------------------------------------------------------------------------*/
+const char *FSM_Get_State_Name(FSM_State state) {
+    if (state >= NUM_FSM_STATES || FSM_STATE_NAMES[state] == NULL) {
+        return "?";
+    }
+
+    return FSM_STATE_NAMES[state];
+}
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		FSM_EStop()
+ *
+ * 		Enters FSM_STATE_ESTOP_PRESSED at once, from whatever state the FSM
+ *      is in. Queued and deferred events are dropped, so nothing posted
+ *      before the E-stop can start an actuator again. Must be called from
+ *      the thread that runs FSM_Update(), like the work posted by the E-stop
+ *      button.
+ *
+ ----------------------------------------------------------------------------*/
+void FSM_EStop() {
+    uint32_t primask;
+
+    if (currentFSMState == FSM_STATE_ESTOP_PRESSED || currentFSMState >= NUM_FSM_STATES) {
+        return;
+    }
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+
+    eventQueueCount = 0;
+    deferredEventMask = 0;
+
+    __set_PRIMASK(primask);
+
+    estopFromState = currentFSMState;
+    enter_state(FSM_STATE_ESTOP_PRESSED, FSM_EVENT_ESTOP_PRESSED);
+}
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		FSM_Check_EStop_Reset()
+ *
+ * 		Run by FSM_Check_EStop_Reset_TASK while the E-stop is pressed. Asks
+ *      the Raspberry Pi whether the operator has reset the E-stop, and takes
+ *      the reset only if the E-stop button is released and the reply echoes
+ *      this E-stop's token along with its inverse. The E-stop button is then
+ *      armed again, and the FSM goes back to the growth phase if that is
+ *      where the E-stop was pressed, or through the fill and homing
+ *      otherwise, as the gantry lost its position. An E-stop pressed in
+ *      FSM_STATE_FAULT is not reset, the fault still needs a power cycle.
+ *      Returns SYS_FAIL if the Raspberry Pi does not answer.
+ *
+ ----------------------------------------------------------------------------*/
+SYS_RESULT FSM_Check_EStop_Reset() {
+    RPI_UART_EStop_Reset_Packet_t reply;
+    bool released;
+
+    if (currentFSMState != FSM_STATE_ESTOP_PRESSED) {
+        Scheduler_Disable_Task(FSM_Check_EStop_Reset_Task_ID);
+        return SYS_SUCCESS;
+    }
+
+    released = Buttons_estop_is_released();
+
+    if (RPI_UART_Request_EStop_Reset_Pkt(estopToken, estopFromState, released, &reply, 10) != SYS_SUCCESS) {
+        return SYS_FAIL;
+    }
+
+    if (!reply.reset || !released
+    || reply.token != estopToken || reply.token_check != ~estopToken
+    || estopFromState == FSM_STATE_FAULT) {
+        return SYS_SUCCESS;
+    }
+
+    Scheduler_Disable_Task(FSM_Check_EStop_Reset_Task_ID);
+    SYSTEM_ESTOP_STATE = SYSTEM_OFF;
+
+    if (estopFromState == FSM_STATE_GROWTH_MONITORING) {
+        resumingGrowth = true;
+        FSM_Post_Event(FSM_EVENT_RESUMED);
+    }
+    else {
+        FSM_Post_Event(FSM_EVENT_ESTOP_RESET);
+    }
+
+    return SYS_SUCCESS;
+}
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		pop_event()
+ *
+ * 		Takes the oldest queued event. Returns false if there is none.
+ *
+ ----------------------------------------------------------------------------*/
+static bool pop_event(FSM_Event_t *event) {
+    uint32_t primask;
+    bool available;
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+
+    available = (eventQueueCount > 0);
+    if (available) {
+        *event = eventQueue[eventQueueHead];
+        eventQueueHead = (eventQueueHead + 1) % FSM_EVENT_QUEUE_LENGTH;
+        eventQueueCount--;
+    }
+
+    __set_PRIMASK(primask);
+
+    return available;
+}
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		dispatch_event()
+ *
+ * 		Looks an event up in the current state's transition table and enters
+ *      the state it leads to. Events the state does not handle are dropped,
+ *      unless the state defers them.
+ *
+ ----------------------------------------------------------------------------*/
+static void dispatch_event(FSM_Event_t event) {
+    const FSM_State_Struct_t *state = &FSM_STATES[currentFSMState];
+
+    for (uint8_t i = 0; i < state->numTransitions; i++) {
+        if (state->transitions[i].event == event) {
+            enter_state(state->transitions[i].nextState, event);
+            return;
+        }
+    }
+
+    if (state->deferredEvents & FSM_EVENT_MASK(event)) {
+        deferredEventMask |= FSM_EVENT_MASK(event);
+    }
+}
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		enter_state()
+ *
+ * 		Makes 'state' the current state, arms its timer and runs its
+ *      activation function. The transition is added to the trace and the
+ *      stay in the state left to its residency. Events deferred by the state
+ *      left are posted again, ahead of anything the activation function
+ *      posts. The checkpoint is saved once the state is set up.
+ *
+ ----------------------------------------------------------------------------*/
+static void enter_state(FSM_State state, FSM_Event_t cause) {
+    FSM_State_Struct_t *next = &FSM_STATES[state];
+    FSM_Trace_Entry_t *entry;
+    uint64_t curTime = getTimestamp();
+
+    stateResidencyMs[currentFSMState] += curTime - FSM_STATES[currentFSMState].stateStartTimestamp;
+
+    entry = &traceEntries[numTransitions % FSM_TRACE_LENGTH];
+    entry->timestamp = curTime;
+    entry->fromState = currentFSMState;
+    entry->toState = state;
+    entry->cause = cause;
+    numTransitions++;
+
+    currentFSMState = state;
+    next->stateStartTimestamp = curTime;
+
+    stateTimerExpired = false;
+
+    if (next->timeout_ms != 0) {
+        Timer_Wheel_Start(stateTimer, next->timeout_ms, 0);
+    }
+    else {
+        Timer_Wheel_Cancel(stateTimer);
+    }
+
+    for (FSM_Event_t event = 0; deferredEventMask != 0; event++) {
+        if (deferredEventMask & FSM_EVENT_MASK(event)) {
+            deferredEventMask &= ~FSM_EVENT_MASK(event);
+            FSM_Post_Event(event);
+        }
+    }
+
+    if (next->state_activation_funciton != NULL) {
+        next->state_activation_funciton();
+    }
+
+    Checkpoint_Save();
+}
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		state_timer_callback()
+ *
+ * 		Runs from Timer_Wheel_Update() when the current state's timer runs
+ *      out. FSM_Update() dispatches FSM_EVENT_TIMEOUT after the queued
+ *      events, unless one of them leaves the state first.
+ *
+ ----------------------------------------------------------------------------*/
+static void state_timer_callback(uint32_t argument) {
+    (void)argument;
+
+    stateTimerExpired = true;
+}
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		resume_checkpoint()
+ *
+ * 		Restores the reservoir calibration of the checkpoint, whatever its
+ *      state. Restores the state times, DLI and dispensing progress too, if
+ *      it is of a state worth resuming, and counts the start button as
+ *      pressed. The DLI is not restored if the wall clock shows a
+ *      midnight went by since it was saved. Returns the event that leaves
+ *      FSM_STATE_INIT.
+ *
+ ----------------------------------------------------------------------------*/
+static FSM_Event_t resume_checkpoint() {
+    Checkpoint_Data_t checkpoint;
+    uint32_t today;
+
+    if (!Checkpoint_Load(&checkpoint)) {
+        return FSM_EVENT_INITIALIZED;
+    }
+
+    // Learned on the reservoir, not tied to the run
+    Reservoir_Restore_Calibration(checkpoint.fill_rate_mm_s, checkpoint.full_range_mm);
+
+    switch (checkpoint.state) {
+    case FSM_STATE_FILL_RESERVOIR:
+    case FSM_STATE_CNC_HOMING:
+    case FSM_STATE_SEED_DISPENSE:
+    case FSM_STATE_GROWTH_MONITORING:
+        break;
+
+    // Not started yet, or a fault or E-stop that needs a look before
+    // starting over
+    default:
+        return FSM_EVENT_INITIALIZED;
+    }
+
+    memcpy(stateResidencyMs, checkpoint.state_residency_ms, sizeof(stateResidencyMs));
+    uptimeBeforeResetMs = checkpoint.uptime_ms;
+    systemStartTimestamp = getTimestamp();
+    systemStarted = true;
+    CNC_Set_Holes_Dispensed(checkpoint.holes_dispensed);
+
+    // Without a date on either side, the DLI is taken to be of today
+    today = Wall_Clock_Get_Local_Day();
+    if (checkpoint.dli_day == today || checkpoint.dli_day == WALL_CLOCK_DAY_UNKNOWN || today == WALL_CLOCK_DAY_UNKNOWN) {
+        Adafruit_AS7341_restoreDLI(checkpoint.dli_mol_m2);
+    }
+
+    // Pressed before the reset. Also arms the E-stop button.
+    SYSTEM_START_STATE = SYSTEM_ON;
+
+    if (checkpoint.state == FSM_STATE_GROWTH_MONITORING) {
+        resumingGrowth = true;
+        return FSM_EVENT_RESUMED;
+    }
+
+    // Filling and homing again are quick with the reservoir full and the
+    // gantry near home, and homing is needed before dispensing anyway
+    return FSM_EVENT_INITIALIZED;
+}
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		start_monitoring()
+ *
+ * 		Shows the dashboard and enables the periodic sensor, display, Raspberry
+ *      Pi, checkpoint and wall clock sync tasks, which run from the fill on.
+ *
+ ----------------------------------------------------------------------------*/
+static void start_monitoring() {
+    ILI9341_Update_Uptime(FSM_GetSystemUptime());
+    ILI9431_Set_Current_Dashboard_Page(DASHBOARD_PAGE_TDS_PH_HUMIDITY);
+    Write_Logo();
+    Display_Dashboard();
+
+    /*-------------------------------------------------------------------------
+    The start offsets of the periodic tasks are planned by the scheduler from
+    each task's interval and worst case execution time (its budget until it
+    has been measured, see Scheduler_Get_Task_Stats()), so that the tasks do
+    not run into each other. AHT20 data retrieval is pinned to the AHT20
+    measurement request. If the planner reports the set as infeasible the
+    tasks are still enabled, and the utilization is reported to the Raspberry
+    Pi with the task statistics. The sensor tasks publish their readings to
+    the data bus, and the Raspberry Pi link, the display and the DLI
+    integrator pick them up on their own intervals. The VL53L1X task is not
+    part of the plan, it only runs while the reservoir fills, see
+    Reservoir_Start_Fill(). The handles of switchboard disabled devices are
+    SCHEDULER_NO_TASK, which the scheduler ignores.
+    -------------------------------------------------------------------------*/
+
+    Scheduler_Plan_Entry_t taskPlan[] = {
+        { AHT20_Request_Measurement_Task_ID,       SCHEDULER_NO_TASK,                 0,                         0 },
+        { AHT20_Get_Data_Task_ID,                  AHT20_Request_Measurement_Task_ID, AHT20_MEASUREMENT_TIME_MS, 0 },
+        { SEN0169_Get_Data_Task_ID,                SCHEDULER_NO_TASK,                 0,                         0 },
+        { SEN0244_Get_Data_Task_ID,                SCHEDULER_NO_TASK,                 0,                         0 },
+        { AS7341_Get_Data_Task_ID,                 SCHEDULER_NO_TASK,                 0,                         0 },
+        { AS7341_Integrate_DLI_Task_ID,            SCHEDULER_NO_TASK,                 0,                         0 },
+        { ILI9341_Change_Dashboard_Screen_Task_ID, SCHEDULER_NO_TASK,                 0,                         0 },
+        { ILI9341_Update_Uptime_Task_ID,           SCHEDULER_NO_TASK,                 0,                         0 },
+        { ILI9341_Update_Sensor_Readings_Task_ID,  SCHEDULER_NO_TASK,                 0,                         0 },
+        { RPI_UART_Send_Sensor_Data_Task_ID,       SCHEDULER_NO_TASK,                 0,                         0 },
+        { Scheduler_Send_Task_Stats_Task_ID,       SCHEDULER_NO_TASK,                 0,                         0 },
+        { Checkpoint_Save_Task_ID,                 SCHEDULER_NO_TASK,                 0,                         0 },
+        { Wall_Clock_Sync_Task_ID,                 SCHEDULER_NO_TASK,                 0,                         0 },
+    };
+
+    Scheduler_Enable_Tasks_Planned(taskPlan, sizeof(taskPlan) / sizeof(taskPlan[0]));
+}
+
+/*XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+
+    FSM_STATE_INIT
+
+    Transitions into this state: 
+        NONE, this is the entry point of the FSM
+
+    Action Upon State Activation:
+        NONE, this is the entry point of the FSM
+
+    Transitions out of this state:
+        -> FSM_STATE_WAITING_ON_START
+            FSM_EVENT_INITIALIZED, posted by FSM_Init(). With a checkpoint of
+            the fill, homing or dispensing the start button counts as
+            pressed, and the waiting state is left right away
+        -> FSM_STATE_GROWTH_MONITORING
+            FSM_EVENT_RESUMED, posted by FSM_Init() with a checkpoint of the
+            growth phase
+
+XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX*/
+
 /*XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
 
     FSM_STATE_WAITING_ON_START
@@ -141,21 +893,18 @@ SYS_RESULT FSM_State_INIT_TCF() {
 
     Transitions out of this state:
         -> FSM_STATE_FILL_RESERVOIR
-            When the start button has been pressed, transition to the first
-            'real' state in the system
+            FSM_EVENT_START_PRESSED, when the start button has been pressed,
+            transition to the first 'real' state in the system
 
 XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX*/
 
 
 SYS_RESULT FSM_State_WAITING_ON_START_SAF() {
     Display_StartupScreen();
-    return SYS_SUCCESS;
-}
 
-SYS_RESULT FSM_State_WAITING_ON_START_TCF() {
+    // Start button pressed before this state, or switchboard disabled
     if (SYSTEM_START_STATE == SYSTEM_ON) {
-        currentFSMState = FSM_STATE_FILL_RESERVOIR;
-        FSM_STATES[FSM_STATE_WAITING_ON_START].stateActivated = false;
+        FSM_Post_Event(FSM_EVENT_START_PRESSED);
     }
 
     return SYS_SUCCESS;
@@ -167,59 +916,60 @@ SYS_RESULT FSM_State_WAITING_ON_START_TCF() {
 
     Transitions into this state: 
         -> FSM_STATE_WAITING_ON_START
+        -> FSM_STATE_ESTOP_PRESSED
+            FSM_EVENT_ESTOP_RESET, when the E-stop pressed in any other state
+            is reset
 
     Action Upon State Activation:
-        Open Fill Valve, Enable AHT20 Task, Enable SEN0169 Task, Enable SEN0244
-        Task, Enable AS7341 Task, enable ILI9341 dashboard tasks
+        Open Fill Valve, Enable VL53L1X Task and watch the reservoir level
+        until the fill ends, Enable AHT20 Task, Enable SEN0169 Task, Enable
+        SEN0244 Task, Enable AS7341 Task, enable ILI9341 dashboard tasks and
+        the checkpoint task, start CNC homing, which runs while the reservoir
+        fills
 
     Transitions out of this state:
         -> CNC_HOMING
-            After 120 Seconds have elapsed, transition into CNC_HOMING
+            FSM_EVENT_RESERVOIR_FILLED, as soon as the VL53L1X sees the
+            reservoir full
+        -> CNC_HOMING
+            FSM_EVENT_TIMEOUT, after 120 Seconds have elapsed. The only way
+            out without the VL53L1X, and the fill that calibrates the full
+            level
+        -> FSM_STATE_FAULT
+            FSM_EVENT_CNC_HOMING_FAILED, without waiting for the fill
+
+    Deferred events:
+        FSM_EVENT_CNC_HOMED, homing usually finishes before the fill, it is
+        handled by FSM_STATE_CNC_HOMING
 
 XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX*/
 
 SYS_RESULT FSM_State_FILL_RESERVOIR_SAF() {
-    FSM_STATES[FSM_STATE_FILL_RESERVOIR].stateStartTimestamp = getTimestamp();
+    // The first fill starts the uptime, a fill after an E-stop reset does not
+    if (!systemStarted) {
+        systemStartTimestamp = getTimestamp();
+        systemStarted = true;
+    }
 
-    GPIO_set_fill_valve(VALVE_OPEN);
+    // Posts FSM_EVENT_RESERVOIR_FILLED once full, if there is a level sensor
+    Reservoir_Start_Fill();
 
     ILI9341_Update_PumpStatus(PUMP_OFF);
-    ILI9341_Update_Uptime(FSM_STATES[FSM_STATE_FILL_RESERVOIR].stateStartTimestamp);
-    ILI9431_Set_Current_Dashboard_Page(DASHBOARD_PAGE_TDS_PH_HUMIDITY);
-    Write_Logo();
-    Display_Dashboard();
-
-    /*-------------------------------------------------------------------------
-    Experimentally determined task time to complete, as of the commit AFTER 3757dc0:
-    AHT20_REQUEST_MEASUREMENT_TASK: ~1ms
-    AHT20_GET_DATA_TASK: ~1ms
-    SEN0169_GET_DATA_TASK: ~2ms
-    SEN0244_GET_DATA_TASK: ~1ms
-    AS7341_GET_DATA_TASK: ~535ms
-    Placing 35ms offset between tasks, as tasks may grow with implementation of
-    data sharing with Raspberry Pi and Display.
-    See the 'SW Task Timing' sheet in the ASGC_Automated_Farming_System 
-    spreadsheet for a visualization of the task scheduling.
-    -------------------------------------------------------------------------*/ 
-    Scheduler_Enable_Task(AHT20_REQUEST_MEASUREMENT_TASK, 0);
-    Scheduler_Enable_Task(SEN0169_GET_DATA_TASK, 5);
-    Scheduler_Enable_Task(SEN0244_GET_DATA_TASK, 40);
-    Scheduler_Enable_Task(AHT20_GET_DATA_TASK, 81);
-    Scheduler_Enable_Task(ILI9341_CHANGE_DASHBOARD_SCREEN_TASK, 100);
-    Scheduler_Enable_Task(AS7341_GET_DATA_TASK, 116);
-    Scheduler_Enable_Task(ILI9341_UPDATE_UPTIME_TASK, 2);
+    start_monitoring();
 
+    // The gantry does not need the reservoir, so home it while it fills
+    switch (CNC_Start_Homing()) {
+    case SYS_SUCCESS:
+        break;
 
-    return SYS_SUCCESS;
-}
-
+    // Nothing to home
+    case SYS_DEVICE_DISABLED:
+        FSM_Post_Event(FSM_EVENT_CNC_HOMED);
+        break;
 
-SYS_RESULT FSM_State_FILL_RESERVOIR_TCF() {
-
-    // If FSM_STATE_FILL_RESERVOIR_DWELL_TIME time has elapsed since entering state
-    if ( ( getTimestamp() - FSM_STATES[FSM_STATE_FILL_RESERVOIR].stateStartTimestamp ) >= FSM_STATE_FILL_RESERVOIR_DWELL_TIME) {
-        currentFSMState = FSM_STATE_CNC_HOMING;
-        FSM_STATES[FSM_STATE_FILL_RESERVOIR].stateActivated = false;
+    default:
+        FSM_Post_Event(FSM_EVENT_CNC_HOMING_FAILED);
+        break;
     }
 
     return SYS_SUCCESS;
@@ -234,45 +984,32 @@ SYS_RESULT FSM_State_FILL_RESERVOIR_TCF() {
         -> FSM_STATE_FILL_RESERVOIR
 
     Action Upon State Activation:
-        Turn on circulating pump, close fill valve, send CNC Homing command to
-        Raspberry Pi
+        Turn on circulating pump, close fill valve. Homing was started by
+        FSM_STATE_FILL_RESERVOIR, this state waits for it to finish
 
     Transitions out of this state:
         -> FSM_STATE_SEED_DISPENSE
-        Raspberry Pi returns that the CNC system has been successfully homed
+        FSM_EVENT_CNC_HOMED, posted by the homing check task as soon as the
+        Raspberry Pi reports X and Y homed and the gantry idle. Posted right
+        away if the Raspberry Pi interface is disabled. If homing finished
+        during the fill, this is the deferred event and the state is left
+        as soon as it is entered
+        -> FSM_STATE_FAULT
+        FSM_EVENT_CNC_HOMING_FAILED, if the homing command could not be sent
+        or the Raspberry Pi reports a Klipper error
+        -> FSM_STATE_FAULT
+        FSM_EVENT_TIMEOUT, if homing is not done 90 seconds after the fill
 
 XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX*/
 
 SYS_RESULT FSM_State_CNC_HOMING_SAF() {
-    FSM_STATES[FSM_STATE_CNC_HOMING].stateStartTimestamp = getTimestamp();
-
-    GPIO_set_fill_valve(VALVE_CLOSED);
+    Reservoir_Stop_Fill();
     GPIO_set_circulating_pump(PUMP_ON);
     ILI9341_Update_PumpStatus(PUMP_ON);
-    CNC_Home_Command();
-
-    return SYS_SUCCESS;
-}
-
-SYS_RESULT FSM_State_CNC_HOMING_TCF() {
-    // Wait a short amount of time.
-    // Send command to Raspberry Pi to verify homing is complete.
-    // If homing is complete, transition to next state.
-    // otherwise, wait another short amount of time and check again.
-
-	// NOTE: THIS IS THE 'smoke and mirrors' solution to this state transition.
-	// This transition should actually poll the Raspberry Pi to tell if the CNC is homed or not
-
-	// If 1.5 minutes have elapsed in this state
-	if (getTimestamp() - FSM_STATES[FSM_STATE_CNC_HOMING].stateStartTimestamp > 90000) {
-		currentFSMState = FSM_STATE_SEED_DISPENSE;
-		FSM_STATES[FSM_STATE_CNC_HOMING].stateActivated = false;
-	}
 
     return SYS_SUCCESS;
 }
 
-
 /*XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
 
     FSM_STATE_SEED_DISPENSE
@@ -281,122 +1018,161 @@ SYS_RESULT FSM_State_CNC_HOMING_TCF() {
         -> FSM_STATE_CNC_HOMING
 
     Action Upon State Activation:
-        Get Unix Time reference value from RPi
         Activate Seed Dispensing Task
 
     Transitions out of this state:
         -> FSM_STATE_GROWTH_MONITORING
-        Seed dispensing task finishes
+        FSM_EVENT_SEEDS_DISPENSED, posted when the seed dispensing task
+        finishes
+        -> FSM_STATE_FAULT
+        FSM_EVENT_SEED_DISPENSE_FAILED, posted when the gantry can not be
+        confirmed at a hole
 
 XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX*/
 
 SYS_RESULT FSM_State_SEED_DISPENSE_SAF() {
-    FSM_STATES[FSM_STATE_SEED_DISPENSE].stateStartTimestamp = getTimestamp();
+    CNC_Start_Dispensing_Seeds();
 
-    // Request the unix time reference from the Raspberry Pi
-    if (RPI_UART_Send_RPI_UNIX_TIME_REQUEST_Pkt(10) != SYS_SUCCESS) {
-        // GO TO ERROR MODE
-    };
+    // No dispensing task to wait for
+    if (!CNC_Is_Dispensing_Seeds()) {
+        FSM_Post_Event(FSM_EVENT_SEEDS_DISPENSED);
+    }
 
     return SYS_SUCCESS;
 }
 
-SYS_RESULT FSM_State_SEED_DISPENSE_TCF() {
-    /* IMPLEMENT ME */
-	static uint8_t channel_index = 0;
-	static uint8_t hole = 0;
-	static uint64_t timestampOfLastHole;
-	static uint8_t doOnce = 1;
-
-
-	// NOTE: This is the 'smoke and mirrors' method of
-	// the seed dispensing code. The real code will poll
-	// the raspberry pi to determine if the pi has made it to its
-	// destination, before moving to the next location.
-
-	if (doOnce) {
-		CNC_Move_To_Hole(0, 0, CNC_TOOL_SEED_DISPENSER);
-		doOnce = 0;
-		timestampOfLastHole = getTimestamp();
-	}
-
-	// If 40 seconds have elapsed since last move command
-	if (getTimestamp() - timestampOfLastHole > 40000) {
-        if (channel_index == 0 || channel_index == 2) {
-            hole++;
-        }
-        else if (channel_index == 1 || channel_index == 3) {
-            if (hole == 0) {
-                channel_index++;
-            }
-            else {
-                hole--;
-            }
-        }
+/*XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
 
-		if (hole == 10) {
-			channel_index++;
-            hole = 9;
-		}
+    FSM_STATE_GROWTH_MONITORING
+
+    Transitions into this state: 
+        -> FSM_STATE_SEED_DISPENSE
+        -> FSM_STATE_INIT
+            FSM_EVENT_RESUMED, when the checkpoint was saved in this state
+        -> FSM_STATE_ESTOP_PRESSED
+            FSM_EVENT_RESUMED, when the E-stop pressed in this state is reset
+
+    Action Upon State Activation:
+        When resumed, turn on the circulating pump and the tasks enabled by
+        the fill. The DLI is rolled over by the RTC midnight alarm
+        (Wall_Clock.h)
+
+    Transitions out of this state:
+        -> XXXXX
+            XXXX
 
-		if (channel_index >= 4) {
-			currentFSMState = FSM_STATE_GROWTH_MONITORING;
-			FSM_STATES[FSM_STATE_SEED_DISPENSE].stateActivated = false;
-            // Move head out of the way
-            CNC_Move_To_Pos(10.0, 10.0);
-			return SYS_SUCCESS;
-		}
+XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX*/
 
-		CNC_Move_To_Hole(channel_index, (hole % 10), CNC_TOOL_SEED_DISPENSER);
-		timestampOfLastHole = getTimestamp();
+SYS_RESULT FSM_State_GROWTH_MONITORING_SAF() {
+    if (resumingGrowth) {
+        resumingGrowth = false;
 
-	}
+        GPIO_set_circulating_pump(PUMP_ON);
+        ILI9341_Update_PumpStatus(PUMP_ON);
+        start_monitoring();
+    }
 
     return SYS_SUCCESS;
 }
 
-
 /*XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
 
-    FSM_STATE_GROWTH_MONITORING
+    FSM_STATE_FAULT
 
     Transitions into this state: 
+        -> FSM_STATE_FILL_RESERVOIR
         -> FSM_STATE_CNC_HOMING
+        -> FSM_STATE_SEED_DISPENSE
 
     Action Upon State Activation:
-        Enable the AS7341 midnight checker task
+        Stop polling the CNC, close fill valve, display the fault screen on
+        the ILI9341 with what failed
 
     Transitions out of this state:
-        -> XXXXX
-            XXXX
+        NONE, the system must be power cycled
 
 XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX*/
 
-SYS_RESULT FSM_State_GROWTH_MONITORING_SAF() {
-    FSM_STATES[FSM_STATE_GROWTH_MONITORING].stateStartTimestamp = getTimestamp();
+SYS_RESULT FSM_State_FAULT_SAF() {
+    // The transition into this state is the last one traced
+    FSM_Event_t cause = traceEntries[(numTransitions - 1) % FSM_TRACE_LENGTH].cause;
+
+    CNC_Stop_Homing();
+    Reservoir_Stop_Fill();
 
-    // Once we are monitoring the seeds growth, we begin checking if we've hit midnight (for DLI integral purposes)
-    Scheduler_Enable_Task(AS7341_CHECK_FOR_MIDNIGHT_TASK, 0);
+    ILI9341_Fill_Screen(BLACK);
+    Display_FaultScreen((cause == FSM_EVENT_SEED_DISPENSE_FAILED) ? "Seed Dispense" : "CNC Homing");
 
     return SYS_SUCCESS;
 }
 
-SYS_RESULT FSM_State_GROWTH_MONITORING_TCF() {
-    /* IMPLEMENT ME */
+/*XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+
+    FSM_STATE_ESTOP_PRESSED
+
+    Transitions into this state: 
+        Any state, FSM_EStop() when the E-stop button is pressed
+
+    Action Upon State Activation:
+        Stop the gantry, homing and dispensing, close the fill valve, turn
+        off the circulating pump, the mixing motor and the fans, stop the
+        dashboard and display the E-stop screen on the ILI9341. The sensor
+        tasks and the Raspberry Pi link keep running. Start asking the
+        Raspberry Pi for a reset
+
+    Transitions out of this state:
+        -> FSM_STATE_GROWTH_MONITORING
+            FSM_EVENT_RESUMED, when the E-stop was pressed in the growth
+            phase and has been reset
+        -> FSM_STATE_FILL_RESERVOIR
+            FSM_EVENT_ESTOP_RESET, when the E-stop was pressed in any other
+            state and has been reset. Filling the full reservoir is quick,
+            the gantry is homed again, and dispensing carries on after the
+            holes already done
+
+XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX*/
+
+SYS_RESULT FSM_State_ESTOP_PRESSED_SAF() {
+    CNC_Emergency_Stop();
+    Reservoir_Stop_Fill();
+    GPIO_set_circulating_pump(PUMP_OFF);
+    mixing_motor_stop();
+
+    // Fans will still spin at a minimum RPM at 0%
+    FAN_pwm_intf_set_duty(FAN_PWM_INTF_0_PCT_DUTY);
+
+    // The dashboard would draw over the E-stop screen
+    Scheduler_Disable_Task(ILI9341_Change_Dashboard_Screen_Task_ID);
+    Scheduler_Disable_Task(ILI9341_Update_Uptime_Task_ID);
+    Scheduler_Disable_Task(ILI9341_Update_Sensor_Readings_Task_ID);
+
+    ILI9341_Update_PumpStatus(PUMP_OFF);
+    ILI9341_Fill_Screen(BLACK);
+    Display_EStopScreen();
+
+    // No two E-stops are entered in the same millisecond
+    estopToken = (uint32_t)FSM_STATES[FSM_STATE_ESTOP_PRESSED].stateStartTimestamp;
+    Scheduler_Enable_Task(FSM_Check_EStop_Reset_Task_ID, FSM_ESTOP_RESET_POLL_MS);
+
     return SYS_SUCCESS;
 }
 
-
 /*-----------------------------------------------------------------------------
  *
  * 		FSM_GetSystemUptime()
  *
  * 		Returns the number of milliseconds since FSM_STATE_FILL_RESERVOIR was
- *      activated. This state start time is what is displayed on the ILI9341
- *      as uptime.
+ *      first activated, or the checkpoint was resumed, plus the uptime
+ *      resumed from the checkpoint. Re-entering the fill after an E-stop
+ *      does not restart it. This is what is displayed on the ILI9341 as
+ *      uptime.
  *
  ----------------------------------------------------------------------------*/
 
 uint64_t FSM_GetSystemUptime() {
-    return getTimestamp() - FSM_STATES[FSM_STATE_FILL_RESERVOIR].stateStartTimestamp;
+    if (!systemStarted) {
+        return uptimeBeforeResetMs;
+    }
+
+    return getTimestamp() - systemStartTimestamp + uptimeBeforeResetMs;
 }
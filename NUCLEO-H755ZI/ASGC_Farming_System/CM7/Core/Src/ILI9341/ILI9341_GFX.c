@@ -74,6 +74,15 @@ static uint16_t uptimeMins = 0;
 static uint32_t waterTDSValue = 50000; //Default to 500.00 ppm
 static uint16_t waterpHValue = 000; //Default to 0.0
 static uint16_t humidityValue = 5000; //Default to 100.00%
+static uint8_t numDegradedDevices = 0; //Default to no failed devices
+
+// Time spent in each FSM state, one line per state
+static const char *stateTimeNames[DASHBOARD_MAX_STATE_LINES];
+static uint32_t stateTimeMins[DASHBOARD_MAX_STATE_LINES];
+
+static void Draw_Degraded_Status();
+static void Draw_Message_Screen(const char *TextLine1, const char *TextLine2, const char *TextLine3);
+static void Draw_State_Time_Line(uint8_t line);
 
 /*
 	This method displays the startup screen
@@ -115,16 +124,33 @@ void Display_StartupScreen()
 
 /*
 	This method displays the EStop screen
-	This should ideally encourage the user to power cycle the system to restart
+	This should ideally encourage the user to release the EStop and reset it
+	from the Raspberry Pi
 */
 void Display_EStopScreen()
+{
+	Draw_Message_Screen("ESTOP Pressed", "Release and", "Reset on Pi");
+}
+
+/*
+	This method displays the fault screen, naming what failed in 'reason'
+	(13 characters fit on a line). Shown when the FSM gives up, e.g. when the
+	CNC fails to home
+*/
+void Display_FaultScreen(const char *reason)
+{
+	Draw_Message_Screen("FAULT", reason, "Power Cycle");
+}
+
+/*
+	Draws three centered lines of text, the first in red, and takes the
+	screen away from the dashboard
+*/
+static void Draw_Message_Screen(const char *TextLine1, const char *TextLine2, const char *TextLine3)
 {
 	currentDashboardPage = DASHBOARD_NOT_ACTIVE;
 	
-	// Declare our text and font size
-	const char *TextLine1 = "ESTOP Pressed";
-	const char *TextLine2 = "Power Cycle";
-	const char *TextLine3 = "to Reset";
+	// Declare our font size
 	uint8_t fontSize = 4;
 
 	// Find the pixel width and height of our first line
@@ -172,7 +198,8 @@ void Display_EStopScreen()
 
 	Page 0: Water TDS, Water pH and Humidity
 	Page 1: Temperature, Pump Status, Uptime and Daily Light Target
-	Page 2+: (Reserved for future use)
+	Page 2: Total time spent in each FSM state
+	Page 3+: (Reserved for future use)
 
 	--- Example of sample data displayed ---
 	Water TDS: 640ppm
@@ -289,7 +316,17 @@ void Display_Dashboard()
 			ILI9341_Draw_Text("Humidity", DASHBOARD_STARTING_X_POS, StartingYPos + (4*DASHBOARD_TEXT_FONT_HEIGHT_PIXELS), BLUE, DASHBOARD_TEXT_FONT_SIZE, BLACK);
 			ILI9341_Draw_Text(humidityText, DASHBOARD_STARTING_X_POS, StartingYPos + (5*DASHBOARD_TEXT_FONT_HEIGHT_PIXELS), DASHBOARD_DISPLAY_VALUE_COLOR, DASHBOARD_VALUE_FONT_SIZE, BLACK);
 			break;
+		case DASHBOARD_PAGE_STATE_TIME:
+
+			ILI9341_Draw_Text("State Time", DASHBOARD_STARTING_X_POS, StartingYPos, BLUE, DASHBOARD_TEXT_FONT_SIZE, BLACK);
+
+			for (uint8_t line = 0; line < DASHBOARD_MAX_STATE_LINES; line++) {
+				Draw_State_Time_Line(line);
+			}
+			break;
 	}
+
+	Draw_Degraded_Status();
 }
 
 /*
@@ -423,6 +460,72 @@ void ILI9341_Update_PumpStatus(_Bool isPumpOnlineNew)
 	}
 }
 
+/*
+	Shows a "DEGRADED" indicator next to the logo while any sensor has been
+	parked by the scheduler after repeated failures
+*/
+void ILI9341_Update_Degraded_Status(uint8_t numDegradedDevicesNew)
+{
+	numDegradedDevices = numDegradedDevicesNew;
+
+	if (currentDashboardPage != DASHBOARD_NOT_ACTIVE) {
+		Draw_Degraded_Status();
+	}
+}
+
+/*
+	Sets one line of the state time page: the name of an FSM state and the
+	total time spent in it. Lines without a name are left blank
+*/
+void ILI9341_Update_State_Time(uint8_t line, const char *stateName, uint64_t msInState)
+{
+	if (line >= DASHBOARD_MAX_STATE_LINES) {
+		return;
+	}
+
+	stateTimeNames[line] = stateName;
+	stateTimeMins[line] = (uint32_t)(msInState / 60000);
+
+	if (currentDashboardPage == DASHBOARD_PAGE_STATE_TIME) {
+		Draw_State_Time_Line(line);
+	}
+}
+
+static void Draw_State_Time_Line(uint8_t line)
+{
+	uint16_t yPos = yBoundary + 10 + DASHBOARD_TEXT_FONT_HEIGHT_PIXELS + (line * CHAR_HEIGHT * DASHBOARD_VALUE_FONT_SIZE);
+	char stateTimeText[24];
+
+	if (stateTimeNames[line] == NULL) {
+		return;
+	}
+
+	// e.g. "Filling  0d 02h 00m", 21 characters at most
+	sprintf(stateTimeText, "%-8.8s %lud %02luh %02lum", stateTimeNames[line],
+			stateTimeMins[line] / (24 * 60), (stateTimeMins[line] / 60) % 24, stateTimeMins[line] % 60);
+
+	ILI9341_Draw_Text(stateTimeText, DASHBOARD_STARTING_X_POS, yPos, DASHBOARD_DISPLAY_VALUE_COLOR, DASHBOARD_VALUE_FONT_SIZE, BLACK);
+}
+
+static void Draw_Degraded_Status()
+{
+	uint16_t xPos = xBoundary + 6;
+	uint16_t yPos = 5;
+	char degradedText[8];
+
+	// Clear the indicator area (two lines of size 1 text)
+	ILI9341_Draw_Filled_Rectangle_Coord(xPos, yPos, ILI9341_SCREEN_WIDTH - 1, yPos + (2 * CHAR_HEIGHT), BLACK);
+
+	if (numDegradedDevices == 0) {
+		return;
+	}
+
+	sprintf(degradedText, "%u DEV", numDegradedDevices);
+
+	ILI9341_Draw_Text("DEGRADED", xPos, yPos, RED, 1, BLACK);
+	ILI9341_Draw_Text(degradedText, xPos, yPos + CHAR_HEIGHT, RED, 1, BLACK);
+}
+
 Dashboard_page_t ILI9431_Get_Current_Dashboard_Page() {
 	return currentDashboardPage;
 }
@@ -59,10 +59,12 @@
 #define DASHBOARD_SCALING_FACTOR            100
 
 #define DASHBOARD_DISPLAY_VALUE_COLOR       WHITE
+#define DASHBOARD_MAX_STATE_LINES           8
 
 enum {
     DASHBOARD_PAGE_TDS_PH_HUMIDITY,
     DASHBOARD_PAGE_TEMP_PUMP_DLI,
+    DASHBOARD_PAGE_STATE_TIME,
     //...
     NUM_DASHBOARD_PAGES,
     DASHBOARD_NOT_ACTIVE = NUM_DASHBOARD_PAGES
@@ -72,6 +74,7 @@ typedef uint8_t Dashboard_page_t;
 // Aeroponics Project Drawing Methods
 void Display_StartupScreen();
 void Display_EStopScreen();
+void Display_FaultScreen(const char *reason);
 void Display_Dashboard();
 void Write_Logo();
 
@@ -86,6 +89,8 @@ void ILI9341_Update_WaterpH(double pHValueNew);
 void ILI9341_Update_WaterTDS(double tdsValueNew);
 void ILI9341_Update_Uptime(uint64_t msSinceStart);
 void ILI9341_Update_PumpStatus(_Bool isPumpOnlineNew);
+void ILI9341_Update_Degraded_Status(uint8_t numDegradedDevicesNew);
+void ILI9341_Update_State_Time(uint8_t line, const char *stateName, uint64_t msInState);
 Dashboard_page_t ILI9431_Get_Current_Dashboard_Page();
 void ILI9431_Set_Current_Dashboard_Page(Dashboard_page_t page);
 
@@ -109,11 +109,18 @@
 #include "ILI9341_STM32_Driver.h"
 #include "stm32h7xx_hal_spi.h"
 #include "stm32h7xx_hal_gpio.h"
+#include "Scheduler.h"
 
 /* Global Variables ------------------------------------------------------------------*/
 volatile uint16_t LCD_HEIGHT = ILI9341_SCREEN_HEIGHT;
 volatile uint16_t LCD_WIDTH	 = ILI9341_SCREEN_WIDTH;
 
+Scheduler_Task_ID_t ILI9341_Change_Dashboard_Screen_Task_ID = SCHEDULER_NO_TASK;
+Scheduler_Task_ID_t ILI9341_Update_Uptime_Task_ID = SCHEDULER_NO_TASK;
+Scheduler_Task_ID_t ILI9341_Update_Sensor_Readings_Task_ID = SCHEDULER_NO_TASK;
+
+static void ILI9341_Register_Tasks(void);
+
 /* Initialize SPI */
 void ILI9341_SPI_Init(void)
 {
@@ -354,6 +361,49 @@ ILI9341_Write_Command(0x29);
 
 //STARTING ROTATION
 ILI9341_Set_Rotation(SCREEN_VERTICAL_1);
+
+//DASHBOARD TASKS, SCHEDULER_INIT() MUST HAVE BEEN CALLED BEFORE
+if (ILI9341_ENABLED == SYS_FEATURE_ENABLED) {
+	ILI9341_Register_Tasks();
+}
+}
+
+/*Register the dashboard scheduler tasks*/
+static void ILI9341_Register_Tasks(void)
+{
+Scheduler_Task_Config_t changeScreenTask = {
+	.task_function = ILI9341_Change_Dashboard_Screen_TASK,
+	.failure_handler = NULL,
+	.interval_ms = ILI9341_TASK_DEFAULT_INTERVAL_MS,
+	.budget_ms = ILI9341_TASK_BUDGET_MS,
+	.run_mode = SCHEDULER_RUN_FIXED_DELAY,
+	.catch_up_policy = SCHEDULER_CATCH_UP_SKIP,
+	.bus = SCHEDULER_BUS_SPI1,
+};
+Scheduler_Task_Config_t uptimeTask = {
+	.task_function = ILI9341_Update_Uptime_TASK,
+	.failure_handler = NULL,
+	.interval_ms = ILI9341_UPDATE_UPTIME_INTERVAL_MS,
+	.budget_ms = ILI9341_TASK_BUDGET_MS,
+	.run_mode = SCHEDULER_RUN_FIXED_DELAY,
+	.catch_up_policy = SCHEDULER_CATCH_UP_SKIP,
+	.bus = SCHEDULER_BUS_SPI1,
+};
+Scheduler_Task_Config_t sensorReadingsTask = {
+	.task_function = ILI9341_Update_Sensor_Readings_TASK,
+	.failure_handler = NULL,
+	.interval_ms = ILI9341_SENSOR_READINGS_INTERVAL_MS,
+	.budget_ms = ILI9341_TASK_BUDGET_MS,
+	.run_mode = SCHEDULER_RUN_FIXED_DELAY,
+	.catch_up_policy = SCHEDULER_CATCH_UP_SKIP,
+	.bus = SCHEDULER_BUS_SPI1,
+};
+
+if (ILI9341_Change_Dashboard_Screen_Task_ID != SCHEDULER_NO_TASK) return;
+
+ILI9341_Change_Dashboard_Screen_Task_ID = Scheduler_Register_Task(&changeScreenTask);
+ILI9341_Update_Uptime_Task_ID = Scheduler_Register_Task(&uptimeTask);
+ILI9341_Update_Sensor_Readings_Task_ID = Scheduler_Register_Task(&sensorReadingsTask);
 }
 
 //INTERNAL FUNCTION OF LIBRARY, USAGE NOT RECOMENDED, USE Draw_Pixel INSTEAD
@@ -115,6 +115,17 @@
 #define ILI9341_SCREEN_HEIGHT 240 
 #define ILI9341_SCREEN_WIDTH 	320
 
+//DASHBOARD SCHEDULER TASKS
+#define ILI9341_TASK_DEFAULT_INTERVAL_MS		20000
+#define ILI9341_UPDATE_UPTIME_INTERVAL_MS		60000
+#define ILI9341_SENSOR_READINGS_INTERVAL_MS		1000
+#define ILI9341_TASK_BUDGET_MS					250
+
+//SCHEDULER TASK HANDLES, SCHEDULER_NO_TASK IF THE DISPLAY IS SWITCHBOARD DISABLED
+extern Scheduler_Task_ID_t ILI9341_Change_Dashboard_Screen_Task_ID;
+extern Scheduler_Task_ID_t ILI9341_Update_Uptime_Task_ID;
+extern Scheduler_Task_ID_t ILI9341_Update_Sensor_Readings_Task_ID;
+
 extern SPI_HandleTypeDef hspi1;
 
 //SPI INSTANCE
@@ -42,12 +42,15 @@
 -----------------------------------------------------------------------------*/
 
 #include "PWM.h"
+#include "Coroutine.h"
 
 /*-----------------------------------------------------------------------------
 Static Variable Declaration
  ----------------------------------------------------------------------------*/
 static uint16_t vlifter_duty_cycle;
 static uint16_t shutter_duty_cycle;
+static Coroutine_t vlifter_down_coroutine;
+static Coroutine_t vlifter_up_coroutine;
 
 /*-----------------------------------------------------------------------------
 Servo Configs
@@ -77,9 +80,6 @@ Function Implementations
 	bool ret_val = PWM_INIT_FAIL;
 	uint8_t pwm_ret_val;
 
-	// Init PWM counter to 0
-	pwm_counter = 0;
-
 	// Init duty cycle to 0
 	shutter_duty_cycle = 0;
 
@@ -110,9 +110,9 @@ Function Implementations
 	bool ret_val = PWM_INIT_FAIL;
 	uint8_t pwm_ret_val;
 
-	// Init PWM counter to 0
-	pwm_counter = 0;
-	VLifter_BobUp = 0;
+	// Reset the lifter motions
+	CO_RESET(&vlifter_down_coroutine);
+	CO_RESET(&vlifter_up_coroutine);
 	VLifter_State = VLIFTER_RESET;
 
 	// Init duty cycle to midpoint of MaxDuty (midpoint = no action for vertical lifter)
@@ -220,86 +220,69 @@ uint16_t PWMServo_GetDutyForConfig(PWM_Servo_Config config) {
  *
  * 		SYS_RESULT PWM_VerticalServo_DownTask(void *arg)
  *
- * 		Task function to move the vertical lifter downwards
- * 		Returns SYS_SUCCESS once 'Down' motion is complete
- * 		Returns SYS_DEVICE_DISABLED if task is working
- * 		Returns SYS_FAILURE if Duty Config couldn't be set
+ * 		Task function to move the vertical lifter downwards, then bob it
+ * 		slightly back up and stop it. Call it until
+ * 		PWM_VerticalServo_Is_Moving() returns false.
+ * 		Returns SYS_SUCCESS while moving and once the motion is complete
+ * 		Returns SYS_FAIL if Duty Config couldn't be set, the motion is
+ * 		restarted on the next call
  *
  ----------------------------------------------------------------------------*/
 SYS_RESULT PWM_VerticalServo_DownTask(void *arg) {
-	uint16_t msToGoDown = 3000;
-	uint16_t msToGoUp = 500;
 
-	// Bob up motion complete
-	if ((VLifter_BobUp == 1) && ((pwm_counter + msToGoUp) >= getTimestamp())) {
-		pwm_counter = 0;
-		VLifter_BobUp = 0;
-		return (SYS_RESULT) SYS_SUCCESS;
-	}
+	CO_BEGIN(&vlifter_down_coroutine);
 
-	// Begin down motion
-	if (pwm_counter == 0) {
-		pwm_counter = getTimestamp();
-		if (PWMServo_SetDutyForConfig(VERTICAL_LIFTER_SERVO_CONFIG, PWM_VLIFTER_30_PCT_DUTY) != (SYS_SUCCESS)) {
-			return (SYS_RESULT) SYS_FAIL;
-		}
+	// Down motion
+	if (PWMServo_SetDutyForConfig(VERTICAL_LIFTER_SERVO_CONFIG, PWM_VLIFTER_30_PCT_DUTY) != SYS_SUCCESS) {
+		CO_EXIT(&vlifter_down_coroutine, SYS_FAIL);
 	}
+	CO_AWAIT_MS(&vlifter_down_coroutine, PWM_VLIFTER_DOWN_MS);
 
-	// Down motion complete
-	if ((pwm_counter + msToGoDown) >= getTimestamp()) {
-		pwm_counter = 1;
-		VLifter_BobUp = 1;
+	// Slight bob up motion
+	if (PWMServo_SetDutyForConfig(VERTICAL_LIFTER_SERVO_CONFIG, PWM_VLIFTER_70_PCT_DUTY) != SYS_SUCCESS) {
+		CO_EXIT(&vlifter_down_coroutine, SYS_FAIL);
 	}
+	CO_AWAIT_MS(&vlifter_down_coroutine, PWM_VLIFTER_BOB_UP_MS);
 
-	// Start slight bob up motion
-	if ((VLifter_BobUp == 1) && (pwm_counter == 1)) {
-		pwm_counter = getTimestamp();
-		if (PWMServo_SetDutyForConfig(VERTICAL_LIFTER_SERVO_CONFIG, PWM_VLIFTER_70_PCT_DUTY) != (SYS_SUCCESS)) {
-			return (SYS_RESULT) SYS_FAIL;
-		}
-	}
-	
-	pwm_counter = getTimestamp();
+	PWM_VerticalServo_ResetDutyTask(NULL);
 
-	return (SYS_RESULT) SYS_DEVICE_DISABLED;
+	CO_END(&vlifter_down_coroutine);
 }
 
 /*-----------------------------------------------------------------------------
  *
  * 		SYS_RESULT PWM_VerticalServo_UpTask(void *arg)
  *
- * 		Task function to move the vertical lifter upwards
- * 		Returns SYS_DEVICE_DISABLED if task is currently working
+ * 		Task function to move the vertical lifter upwards and stop it. Call
+ * 		it until PWM_VerticalServo_Is_Moving() returns false.
+ * 		Returns SYS_SUCCESS while moving and once the motion is complete
+ * 		Returns SYS_FAIL if Duty Config couldn't be set
  *
  ----------------------------------------------------------------------------*/
 SYS_RESULT PWM_VerticalServo_UpTask(void *arg) {
-	uint16_t msToGoUp = 2500;
 
-	// Begin up motion
-	if (pwm_counter == 0) {
-		pwm_counter = getTimestamp();
-		if (PWMServo_SetDutyForConfig(VERTICAL_LIFTER_SERVO_CONFIG, PWM_VLIFTER_70_PCT_DUTY) != (SYS_SUCCESS)) {
-			return (SYS_RESULT) SYS_FAIL;
-		}
-	}
+	CO_BEGIN(&vlifter_up_coroutine);
 
-	// Up motion complete
-	if ((pwm_counter + msToGoUp) >= getTimestamp()) {
-		pwm_counter = 0;
-		VLifter_BobUp = ;
-		return (SYS_RESULT) SYS_SUCCESS;
+	if (PWMServo_SetDutyForConfig(VERTICAL_LIFTER_SERVO_CONFIG, PWM_VLIFTER_70_PCT_DUTY) != SYS_SUCCESS) {
+		CO_EXIT(&vlifter_up_coroutine, SYS_FAIL);
 	}
+	CO_AWAIT_MS(&vlifter_up_coroutine, PWM_VLIFTER_UP_MS);
 
-	// Start slight bob down motion
-	if ((VLifter_BobUp == 1) && (pwm_counter == 1)) {
-		pwm_counter = getTimestamp();
-		if (PWMServo_SetDutyForConfig(VERTICAL_LIFTER_SERVO_CONFIG, PWM_VLIFTER_30_PCT_DUTY) != (SYS_SUCCESS)) {
-			return (SYS_RESULT) SYS_FAIL;
-		}
-	}
+	PWM_VerticalServo_ResetDutyTask(NULL);
 
-	pwm_counter = getTimestamp();
-	return (SYS_RESULT) SYS_DEVICE_DISABLED;
+	CO_END(&vlifter_up_coroutine);
+}
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		bool PWM_VerticalServo_Is_Moving()
+ *
+ * 		Returns true while an up or down motion of the vertical lifter is in
+ * 		progress
+ *
+ ----------------------------------------------------------------------------*/
+bool PWM_VerticalServo_Is_Moving() {
+	return CO_IS_RUNNING(&vlifter_down_coroutine) || CO_IS_RUNNING(&vlifter_up_coroutine);
 }
 
 /*-----------------------------------------------------------------------------
@@ -12,12 +12,106 @@
 
 #include "RPI_UART.h"
 #include "timer.h"
+#include "Wall_Clock.h"
 #include <string.h>
 
 extern UART_HandleTypeDef huart7;
 
+Scheduler_Task_ID_t RPI_UART_Send_Sensor_Data_Task_ID = SCHEDULER_NO_TASK;
+
+static Data_Bus_Subscriber_ID_t Sensor_Data_Subscriber = DATA_BUS_NO_SUBSCRIBER;
+
 static HAL_StatusTypeDef _send_uart_packet( uint8_t *packetData, uint16_t packetSize, RPI_UART_Header_Packet_t *header_pkt, uint32_t timeout );
-static HAL_StatusTypeDef _send_uart_unix_time_packet( uint8_t *packetData, uint16_t packetSize, RPI_UART_Unix_Time_t *unixTimePacket, uint32_t timeout );
+static HAL_StatusTypeDef _send_uart_request( uint8_t *packetData, uint16_t packetSize, uint8_t *response, uint16_t responseSize, RPI_Packet_ID responseId, uint32_t timeout );
+
+/*-----------------------------------------------------------------------------
+ *
+ * RPI_UART_Init
+ *
+ * 		Subscribes the Raspberry Pi link to the sensor readings on the data
+ * 		bus and registers the task sending them. Data_Bus_Init() and
+ * 		Scheduler_Init() must have been called before.
+ *
+-----------------------------------------------------------------------------*/
+void RPI_UART_Init() {
+	Scheduler_Task_Config_t sendSensorDataTask = {
+		.task_function = RPI_UART_Send_Sensor_Data_TASK,
+		.failure_handler = NULL,
+		.interval_ms = RPI_UART_SENSOR_DATA_TASK_INTERVAL_MS,
+		.budget_ms = RPI_UART_SENSOR_DATA_TASK_BUDGET_MS,
+		.run_mode = SCHEDULER_RUN_FIXED_DELAY,
+		.catch_up_policy = SCHEDULER_CATCH_UP_SKIP,
+		.bus = SCHEDULER_BUS_UART7,
+	};
+
+	if (RPI_UART_Send_Sensor_Data_Task_ID != SCHEDULER_NO_TASK) {
+		return;
+	}
+
+	Sensor_Data_Subscriber = Data_Bus_Subscribe( DATA_BUS_TOPIC_MASK(DATA_BUS_TOPIC_AHT20)
+											   | DATA_BUS_TOPIC_MASK(DATA_BUS_TOPIC_SEN0169)
+											   | DATA_BUS_TOPIC_MASK(DATA_BUS_TOPIC_SEN0244)
+											   | DATA_BUS_TOPIC_MASK(DATA_BUS_TOPIC_AS7341) );
+
+	RPI_UART_Send_Sensor_Data_Task_ID = Scheduler_Register_Task(&sendSensorDataTask);
+}
+
+/*-----------------------------------------------------------------------------
+ *
+ * RPI_UART_Send_Sensor_Data
+ *
+ * 		Sends the sensor readings published since the last call to the
+ * 		Raspberry Pi, oldest first. A reading that fails to send stays queued
+ * 		and is retried on the next call, in front of the newer readings.
+ *
+ * 		Returns SYS_SUCCESS once the queue is empty, otherwise the result of
+ * 		the failed send.
+ *
+-----------------------------------------------------------------------------*/
+SYS_RESULT RPI_UART_Send_Sensor_Data() {
+	/*-------------------------------------------------------------------------
+	Local Variables
+	-------------------------------------------------------------------------*/
+	Data_Bus_Sample_t sample;
+	SYS_RESULT ret_val;
+
+	while (Data_Bus_Peek(Sensor_Data_Subscriber, &sample)) {
+		switch (sample.topic) {
+			case DATA_BUS_TOPIC_AHT20:
+				ret_val = RPI_UART_Send_AHT20_Pkt(sample.value.aht20, 4);
+				break;
+
+			case DATA_BUS_TOPIC_SEN0169:
+				ret_val = RPI_UART_Send_SEN0169_Pkt(sample.value.pH, 4);
+				break;
+
+			case DATA_BUS_TOPIC_SEN0244:
+				ret_val = RPI_UART_Send_SEN0244_Pkt(sample.value.tds, 4);
+				break;
+
+			case DATA_BUS_TOPIC_AS7341:
+				ret_val = RPI_UART_Send_AS7341_Pkt(sample.value.as7341, 5);
+				break;
+
+			default:
+				ret_val = SYS_INVALID;
+				break;
+		}
+
+		/*---------------------------------------------------------------------
+		Leave a reading that could not be sent at the front of the queue.
+		Readings that can never be sent are dropped, so they do not hold up
+		the queue.
+		---------------------------------------------------------------------*/
+		if (ret_val == SYS_FAIL) {
+			return ret_val;
+		}
+
+		Data_Bus_Consume(Sensor_Data_Subscriber);
+	}
+
+	return SYS_SUCCESS;
+}
 
 /*-----------------------------------------------------------------------------
  *
@@ -228,18 +322,358 @@ SYS_RESULT RPI_UART_Send_RPI_UNIX_TIME_REQUEST_Pkt(uint32_t timeout) {
 	/*-------------------------------------------------------------------------
 	Send packet
 	-------------------------------------------------------------------------*/
-	status = _send_uart_unix_time_packet((uint8_t*)&header_pkt, RPI_UART_HEADER_PACKET_SIZE, &UNIX_TIME_pkt, timeout);
+	status = _send_uart_request((uint8_t*)&header_pkt, RPI_UART_HEADER_PACKET_SIZE, (uint8_t*)&UNIX_TIME_pkt, RPI_UART_Unix_Time_SIZE, RPI_UNIX_TIME_PKT_ID, timeout);
 
 	if (status != HAL_OK) {
 			return SYS_FAIL;
 	}
 
 	/*-------------------------------------------------------------------------
-	Store unix time reference values
+	Set the wall clock
 	-------------------------------------------------------------------------*/
-	setUnixTimeMidnightRef(UNIX_TIME_pkt.UNIX_time_value, UNIX_TIME_pkt.Offset);
+	return Wall_Clock_Set(UNIX_TIME_pkt.UNIX_time_value, UNIX_TIME_pkt.Offset);
+}
 
-	return status;
+/*-----------------------------------------------------------------------------
+ *
+ * RPI_UART_Request_Axes_Pos_Pkt
+ *
+ * 		Asks the Raspberry Pi where the gantry is, and whether Klipper has
+ * 		finished every queued move (what M400 waits for). The answer is
+ * 		copied into 'axes_pos'.
+ *
+-----------------------------------------------------------------------------*/
+SYS_RESULT RPI_UART_Request_Axes_Pos_Pkt(RPI_UART_Axes_Pos_Packet_t *axes_pos, uint32_t timeout) {
+	/*-------------------------------------------------------------------------
+	Local Variables
+	-------------------------------------------------------------------------*/
+	RPI_UART_Header_Packet_t header_pkt;
+	HAL_StatusTypeDef status;
+
+	if (axes_pos == NULL) {
+		return SYS_INVALID;
+	}
+
+	/*-------------------------------------------------------------------------
+	Clear structs
+	-------------------------------------------------------------------------*/
+	memset(&header_pkt, 0, RPI_UART_HEADER_PACKET_SIZE);
+
+	/*-------------------------------------------------------------------------
+	Pack the packet
+	-------------------------------------------------------------------------*/
+	header_pkt.packet_id = RPI_GET_AXES_POS_PKT_ID;
+
+	/*-------------------------------------------------------------------------
+	Send packet
+	-------------------------------------------------------------------------*/
+	status = _send_uart_request((uint8_t*)&header_pkt, RPI_UART_HEADER_PACKET_SIZE, (uint8_t*)axes_pos, RPI_UART_AXES_POS_PACKET_SIZE, RPI_AXES_POS_PKT_ID, timeout);
+
+	if (status != HAL_OK) {
+		return SYS_FAIL;
+	}
+
+	return SYS_SUCCESS;
+}
+
+/*-----------------------------------------------------------------------------
+ *
+ * RPI_UART_Send_Dispense_Hole_Pkt
+ *
+ * 		Tells the Raspberry Pi how long seeding one net pot hole took, to log
+ * 		the dispensing cycle time.
+ *
+-----------------------------------------------------------------------------*/
+SYS_RESULT RPI_UART_Send_Dispense_Hole_Pkt(uint8_t channel, uint8_t hole, uint32_t move_ms, uint32_t cycle_ms, bool move_confirmed, uint32_t timeout) {
+	/*-------------------------------------------------------------------------
+	Local Variables
+	-------------------------------------------------------------------------*/
+	RPI_UART_Dispense_Hole_Packet_t hole_pkt;
+	RPI_UART_Header_Packet_t header_pkt;
+	HAL_StatusTypeDef status;
+
+	/*-------------------------------------------------------------------------
+	Clear structs
+	-------------------------------------------------------------------------*/
+	memset(&hole_pkt, 0, RPI_UART_DISPENSE_HOLE_PACKET_SIZE);
+	memset(&header_pkt, 0, RPI_UART_HEADER_PACKET_SIZE);
+
+	/*-------------------------------------------------------------------------
+	Pack the packet
+	-------------------------------------------------------------------------*/
+	hole_pkt.packet_id = RPI_DISPENSE_HOLE_PKT_ID;
+	header_pkt.packet_id = RPI_DISPENSE_HOLE_PKT_ID;
+	hole_pkt.channel = channel;
+	hole_pkt.hole = hole;
+	hole_pkt.move_confirmed = move_confirmed;
+	hole_pkt.move_ms = move_ms;
+	hole_pkt.cycle_ms = cycle_ms;
+
+	/*-------------------------------------------------------------------------
+	Send packet
+	-------------------------------------------------------------------------*/
+	status = _send_uart_packet((uint8_t*)&hole_pkt, RPI_UART_DISPENSE_HOLE_PACKET_SIZE, &header_pkt, timeout);
+
+	if (status != HAL_OK) {
+		return SYS_FAIL;
+	}
+
+	return SYS_SUCCESS;
+}
+
+/*-----------------------------------------------------------------------------
+ *
+ * RPI_UART_Send_Task_Stats_Pkt
+ *
+ * 		Sends the execution statistics of every registered scheduler task to
+ * 		the Raspberry Pi. The packet has room for SCHEDULER_MAX_TASKS tasks
+ * 		and is ~520 bytes, so the timeout should allow for ~45ms of transmit
+ * 		time at 115200 baud.
+ *
+-----------------------------------------------------------------------------*/
+SYS_RESULT RPI_UART_Send_Task_Stats_Pkt(uint32_t timeout) {
+	/*-------------------------------------------------------------------------
+	Local Variables
+	-------------------------------------------------------------------------*/
+	RPI_UART_Task_Stats_Packet_t stats_pkt;
+	RPI_UART_Header_Packet_t header_pkt;
+	Scheduler_Task_Stats_t stats;
+	HAL_StatusTypeDef status;
+
+	/*-------------------------------------------------------------------------
+	Clear structs
+	-------------------------------------------------------------------------*/
+	memset(&stats_pkt, 0, RPI_UART_TASK_STATS_PACKET_SIZE);
+	memset(&header_pkt, 0, RPI_UART_HEADER_PACKET_SIZE);
+
+	/*-------------------------------------------------------------------------
+	Pack the packet
+	-------------------------------------------------------------------------*/
+	stats_pkt.packet_id = RPI_TASK_STATS_PKT_ID;
+	header_pkt.packet_id = RPI_TASK_STATS_PKT_ID;
+	stats_pkt.num_tasks = Scheduler_Get_Num_Tasks();
+	stats_pkt.planned_utilization = (uint16_t)Scheduler_Get_Planned_Utilization();
+	stats_pkt.idle_time_s = (uint32_t)(ASGC_Timer_Get_Idle_Time_ms() / 1000);
+	stats_pkt.max_watchdog_feed_gap_ms = Watchdog_Get_Max_Feed_Gap_ms();
+
+	for (Scheduler_Task_ID_t i = 0; i < Scheduler_Get_Num_Tasks(); i++) {
+		if (Scheduler_Get_Task_Stats(i, &stats) != SYS_SUCCESS || stats.run_count == 0) {
+			continue;
+		}
+
+		stats_pkt.task_stats[i].run_count = stats.run_count;
+		stats_pkt.task_stats[i].last_us = Scheduler_Cycles_To_Us(stats.last_cycles);
+		stats_pkt.task_stats[i].min_us = Scheduler_Cycles_To_Us(stats.min_cycles);
+		stats_pkt.task_stats[i].max_us = Scheduler_Cycles_To_Us(stats.max_cycles);
+		stats_pkt.task_stats[i].mean_us = Scheduler_Cycles_To_Us((uint32_t)(stats.total_cycles / stats.run_count));
+		stats_pkt.task_stats[i].overrun_count = stats.overrun_count;
+		stats_pkt.task_stats[i].max_start_jitter_ms = stats.max_start_jitter_ms;
+		stats_pkt.task_stats[i].missed_periods = stats.missed_periods;
+	}
+
+	/*-------------------------------------------------------------------------
+	Send packet
+	-------------------------------------------------------------------------*/
+	status = _send_uart_packet((uint8_t*)&stats_pkt, RPI_UART_TASK_STATS_PACKET_SIZE, &header_pkt, timeout);
+
+	if (status != HAL_OK) {
+		return SYS_FAIL;
+	}
+
+	return SYS_SUCCESS;
+}
+
+/*-----------------------------------------------------------------------------
+ *
+ * RPI_UART_Send_FSM_Trace_Pkt
+ *
+ * 		Sends the FSM transition trace and the time spent in each state to
+ * 		the Raspberry Pi. The packet is ~300 bytes, ~26ms of transmit time at
+ * 		115200 baud.
+ *
+-----------------------------------------------------------------------------*/
+SYS_RESULT RPI_UART_Send_FSM_Trace_Pkt(uint32_t timeout) {
+	/*-------------------------------------------------------------------------
+	Local Variables
+	-------------------------------------------------------------------------*/
+	RPI_UART_FSM_Trace_Packet_t trace_pkt;
+	RPI_UART_Header_Packet_t header_pkt;
+	FSM_Trace_Entry_t entries[FSM_TRACE_LENGTH];
+	HAL_StatusTypeDef status;
+
+	/*-------------------------------------------------------------------------
+	Clear structs
+	-------------------------------------------------------------------------*/
+	memset(&trace_pkt, 0, RPI_UART_FSM_TRACE_PACKET_SIZE);
+	memset(&header_pkt, 0, RPI_UART_HEADER_PACKET_SIZE);
+
+	/*-------------------------------------------------------------------------
+	Pack the packet
+	-------------------------------------------------------------------------*/
+	trace_pkt.packet_id = RPI_FSM_TRACE_PKT_ID;
+	header_pkt.packet_id = RPI_FSM_TRACE_PKT_ID;
+	trace_pkt.current_state = (uint8_t)FSM_Get_State();
+	trace_pkt.num_transitions = FSM_Get_Num_Transitions();
+	trace_pkt.timestamp_ms = getTimestamp();
+	trace_pkt.num_entries = FSM_Get_Trace(entries, FSM_TRACE_LENGTH);
+
+	for (FSM_State s = 0; s < NUM_FSM_STATES; s++) {
+		trace_pkt.residency_s[s] = (uint32_t)(FSM_Get_State_Residency_ms(s) / 1000);
+	}
+
+	for (uint8_t i = 0; i < trace_pkt.num_entries; i++) {
+		trace_pkt.entries[i].timestamp_ms = entries[i].timestamp;
+		trace_pkt.entries[i].from_state = (uint8_t)entries[i].fromState;
+		trace_pkt.entries[i].to_state = (uint8_t)entries[i].toState;
+		trace_pkt.entries[i].cause = entries[i].cause;
+	}
+
+	/*-------------------------------------------------------------------------
+	Send packet
+	-------------------------------------------------------------------------*/
+	status = _send_uart_packet((uint8_t*)&trace_pkt, RPI_UART_FSM_TRACE_PACKET_SIZE, &header_pkt, timeout);
+
+	if (status != HAL_OK) {
+		return SYS_FAIL;
+	}
+
+	return SYS_SUCCESS;
+}
+
+/*-----------------------------------------------------------------------------
+ *
+ * RPI_UART_Send_Device_Status_Pkt
+ *
+ * 		Tells the Raspberry Pi that a task's device has been parked or put
+ * 		back into service, along with the set of all parked tasks.
+ *
+-----------------------------------------------------------------------------*/
+SYS_RESULT RPI_UART_Send_Device_Status_Pkt(Scheduler_Task_ID_t task_id, Scheduler_Breaker_State_t breaker_state, uint32_t degraded_task_mask, uint32_t timeout) {
+	/*-------------------------------------------------------------------------
+	Local Variables
+	-------------------------------------------------------------------------*/
+	RPI_UART_Device_Status_Packet_t status_pkt;
+	RPI_UART_Header_Packet_t header_pkt;
+	HAL_StatusTypeDef status;
+
+	/*-------------------------------------------------------------------------
+	Clear structs
+	-------------------------------------------------------------------------*/
+	memset(&status_pkt, 0, RPI_UART_DEVICE_STATUS_PACKET_SIZE);
+	memset(&header_pkt, 0, RPI_UART_HEADER_PACKET_SIZE);
+
+	/*-------------------------------------------------------------------------
+	Pack the packet
+	-------------------------------------------------------------------------*/
+	status_pkt.packet_id = RPI_DEVICE_STATUS_PKT_ID;
+	header_pkt.packet_id = RPI_DEVICE_STATUS_PKT_ID;
+	status_pkt.task_id = task_id;
+	status_pkt.breaker_state = breaker_state;
+	status_pkt.degraded_task_mask = degraded_task_mask;
+
+	/*-------------------------------------------------------------------------
+	Send packet
+	-------------------------------------------------------------------------*/
+	status = _send_uart_packet((uint8_t*)&status_pkt, RPI_UART_DEVICE_STATUS_PACKET_SIZE, &header_pkt, timeout);
+
+	if (status != HAL_OK) {
+		return SYS_FAIL;
+	}
+
+	return SYS_SUCCESS;
+}
+
+/*-----------------------------------------------------------------------------
+ *
+ * RPI_UART_Send_Watchdog_Reset_Pkt
+ *
+ * 		Tells the Raspberry Pi that the watchdog reset the board, and which
+ * 		task the watchdog breadcrumb blamed.
+ *
+-----------------------------------------------------------------------------*/
+SYS_RESULT RPI_UART_Send_Watchdog_Reset_Pkt(const Watchdog_Reset_Info_t *reset_info, uint32_t timeout) {
+	/*-------------------------------------------------------------------------
+	Local Variables
+	-------------------------------------------------------------------------*/
+	RPI_UART_Watchdog_Reset_Packet_t reset_pkt;
+	RPI_UART_Header_Packet_t header_pkt;
+	HAL_StatusTypeDef status;
+
+	if (reset_info == NULL) {
+		return SYS_INVALID;
+	}
+
+	/*-------------------------------------------------------------------------
+	Clear structs
+	-------------------------------------------------------------------------*/
+	memset(&reset_pkt, 0, RPI_UART_WATCHDOG_RESET_PACKET_SIZE);
+	memset(&header_pkt, 0, RPI_UART_HEADER_PACKET_SIZE);
+
+	/*-------------------------------------------------------------------------
+	Pack the packet
+	-------------------------------------------------------------------------*/
+	reset_pkt.packet_id = RPI_WATCHDOG_RESET_PKT_ID;
+	header_pkt.packet_id = RPI_WATCHDOG_RESET_PKT_ID;
+	reset_pkt.cause = reset_info->cause;
+	reset_pkt.task_id = reset_info->task_id;
+	reset_pkt.task_elapsed_ms = reset_info->task_elapsed_ms;
+	reset_pkt.task_budget_ms = reset_info->task_budget_ms;
+
+	/*-------------------------------------------------------------------------
+	Send packet
+	-------------------------------------------------------------------------*/
+	status = _send_uart_packet((uint8_t*)&reset_pkt, RPI_UART_WATCHDOG_RESET_PACKET_SIZE, &header_pkt, timeout);
+
+	if (status != HAL_OK) {
+		return SYS_FAIL;
+	}
+
+	return SYS_SUCCESS;
+}
+
+/*-----------------------------------------------------------------------------
+ *
+ * RPI_UART_Request_EStop_Reset_Pkt
+ *
+ * 		Tells the Raspberry Pi the E-stop is pressed and asks whether the
+ * 		operator has reset it. The reply is copied into 'reset', it is up to
+ * 		the caller to check its token.
+ *
+-----------------------------------------------------------------------------*/
+SYS_RESULT RPI_UART_Request_EStop_Reset_Pkt(uint32_t token, uint8_t state_before, bool released, RPI_UART_EStop_Reset_Packet_t *reset, uint32_t timeout) {
+	/*-------------------------------------------------------------------------
+	Local Variables
+	-------------------------------------------------------------------------*/
+	RPI_UART_EStop_Status_Packet_t status_pkt;
+	HAL_StatusTypeDef status;
+
+	if (reset == NULL) {
+		return SYS_INVALID;
+	}
+
+	/*-------------------------------------------------------------------------
+	Clear structs
+	-------------------------------------------------------------------------*/
+	memset(&status_pkt, 0, RPI_UART_ESTOP_STATUS_PACKET_SIZE);
+
+	/*-------------------------------------------------------------------------
+	Pack the packet
+	-------------------------------------------------------------------------*/
+	status_pkt.packet_id = RPI_ESTOP_STATUS_PKT_ID;
+	status_pkt.state_before = state_before;
+	status_pkt.released = released;
+	status_pkt.token = token;
+
+	/*-------------------------------------------------------------------------
+	Send packet
+	-------------------------------------------------------------------------*/
+	status = _send_uart_request((uint8_t*)&status_pkt, RPI_UART_ESTOP_STATUS_PACKET_SIZE, (uint8_t*)reset, RPI_UART_ESTOP_RESET_PACKET_SIZE, RPI_ESTOP_RESET_PKT_ID, timeout);
+
+	if (status != HAL_OK) {
+		return SYS_FAIL;
+	}
+
+	return SYS_SUCCESS;
 }
 
 static HAL_StatusTypeDef _send_uart_packet( uint8_t *packetData, uint16_t packetSize, RPI_UART_Header_Packet_t *header_pkt, uint32_t timeout ) {
@@ -279,7 +713,7 @@ static HAL_StatusTypeDef _send_uart_packet( uint8_t *packetData, uint16_t packet
 	return status;
 }
 
-static HAL_StatusTypeDef _send_uart_unix_time_packet( uint8_t *packetData, uint16_t packetSize, RPI_UART_Unix_Time_t *unixTimePacket, uint32_t timeout ) {
+static HAL_StatusTypeDef _send_uart_request( uint8_t *packetData, uint16_t packetSize, uint8_t *response, uint16_t responseSize, RPI_Packet_ID responseId, uint32_t timeout ) {
 	HAL_StatusTypeDef status;
 	uint8_t i;
 
@@ -292,21 +726,27 @@ static HAL_StatusTypeDef _send_uart_unix_time_packet( uint8_t *packetData, uint1
 			status = HAL_UART_Transmit(&huart7, packetData, packetSize, timeout);
 
 			/*-------------------------------------------------------------------------
-			If we sent the packet successfully, wait for ack packet
+			If we sent the packet successfully, wait for the response packet
 			-------------------------------------------------------------------------*/
 			if (status == HAL_OK) {
 				HAL_Delay(3);
 
 				/*---------------------------------------------------------------------
-				Receive the Unix time packet
+				Receive the response packet, its first byte is the packet ID
 				---------------------------------------------------------------------*/
-				status = HAL_UART_Receive(&huart7, (uint8_t*)unixTimePacket, RPI_UART_Unix_Time_SIZE, timeout);
+				status = HAL_UART_Receive(&huart7, response, responseSize, timeout);
 
-				if (status == HAL_OK && unixTimePacket->packet_id == RPI_UNIX_TIME_PKT_ID) {
-					break;
+				if (status == HAL_OK && response[0] == responseId) {
+					return HAL_OK;
 				}
 			}
 		}
+
+	if (status == HAL_OK) {
+		// Answered with the wrong packet every time
+		status = HAL_ERROR;
+	}
+
 	return status;
 
 }
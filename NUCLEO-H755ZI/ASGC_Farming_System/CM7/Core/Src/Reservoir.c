@@ -0,0 +1,271 @@
+/*-----------------------------------------------------------------------------
+ *
+ * 	Reservoir.c
+ *
+ * 		Level controlled fill of the reservoir, see Reservoir.h.
+ *
+ *  Created on: Oct 16, 2026
+ *
+-----------------------------------------------------------------------------*/
+
+#include "Reservoir.h"
+#include "Scheduler.h"
+#include "Data_Bus.h"
+#include "FSM.h"
+#include "gpio_switching_intf.h"
+#include "timer.h"
+#include "VL53L1X_prj.h"
+
+/*-----------------------------------------------------------------------------
+STATIC VARIABLES
+-----------------------------------------------------------------------------*/
+Scheduler_Task_ID_t Reservoir_Check_Fill_Task_ID = SCHEDULER_NO_TASK;
+
+static bool Filling;
+static uint64_t Fill_Start_Timestamp;
+static bool Have_Level;						/* A range was read this fill	 */
+static uint16_t Start_Range_mm;
+static uint64_t Start_Timestamp;			/* Of the first range			 */
+static uint16_t Last_Range_mm;
+static uint64_t Last_Timestamp;
+static float Fill_Rate;						/* mm/s the level rises at,		 */
+											/* RESERVOIR_FILL_RATE_UNKNOWN	 */
+											/* until a fill is done			 */
+static uint16_t Full_Range_mm;				/* Range to a full reservoir,	 */
+											/* RESERVOIR_FULL_RANGE_UNKNOWN	 */
+											/* until calibrated				 */
+
+/*-----------------------------------------------------------------------------
+STATIC FUNCTION DECLARATIONS
+-----------------------------------------------------------------------------*/
+static void finish_fill();
+static void learn_fill_rate();
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		Reservoir_Init()
+ *
+ * 		Registers the fill check task, unless the VL53L1X is switchboard
+ * 		disabled. Call after Scheduler_Init().
+ *
+ ----------------------------------------------------------------------------*/
+ void Reservoir_Init() {
+	Filling = false;
+	Fill_Rate = RESERVOIR_FILL_RATE_UNKNOWN;
+	Full_Range_mm = RESERVOIR_FULL_RANGE_UNKNOWN;
+
+	if (VL53L1X_ENABLED == SYS_FEATURE_DISABLED) {
+		return;
+	}
+
+	Scheduler_Task_Config_t checkFillTask = {
+		.task_function = Reservoir_Check_Fill_TASK,
+		.failure_handler = NULL,
+		.interval_ms = RESERVOIR_CHECK_INTERVAL_MS,
+		.budget_ms = SCHEDULER_DEFAULT_TASK_BUDGET_MS,
+		.run_mode = SCHEDULER_RUN_FIXED_RATE,
+		.catch_up_policy = SCHEDULER_CATCH_UP_SKIP,
+		.critical = true,
+	};
+
+	if (Reservoir_Check_Fill_Task_ID == SCHEDULER_NO_TASK) {
+		Reservoir_Check_Fill_Task_ID = Scheduler_Register_Task(&checkFillTask);
+	}
+ }
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		Reservoir_Start_Fill()
+ *
+ * 		Opens the fill valve, starts the VL53L1X ranging and watches the
+ * 		level. FSM_EVENT_RESERVOIR_FILLED is posted once the reservoir is
+ * 		full. Returns SYS_DEVICE_DISABLED, with the valve open, if there is
+ * 		no level sensor, the caller then has to time the fill and close the
+ * 		valve.
+ *
+ ----------------------------------------------------------------------------*/
+ SYS_RESULT Reservoir_Start_Fill() {
+	SYS_RESULT result;
+
+	result = GPIO_set_fill_valve(VALVE_OPEN);
+
+	if (Reservoir_Check_Fill_Task_ID == SCHEDULER_NO_TASK) {
+		return SYS_DEVICE_DISABLED;
+	}
+
+	if (result != SYS_SUCCESS && result != SYS_DEVICE_DISABLED) {
+		return result;
+	}
+
+	Filling = true;
+	Fill_Start_Timestamp = getTimestamp();
+	Have_Level = false;
+	Last_Timestamp = 0;
+
+	VL53L1X_prj_Start_Ranging();
+	Scheduler_Enable_Task(Reservoir_Check_Fill_Task_ID, 0);
+
+	return SYS_SUCCESS;
+ }
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		Reservoir_Check_Fill()
+ *
+ * 		Run by Reservoir_Check_Fill_TASK while filling. Takes the newest
+ * 		range from the data bus, extrapolates the level to now with the
+ * 		learned fill rate, and ends the fill once it is at the full range.
+ * 		Until the first range of a fill comes in, while the ranges are stale
+ * 		and no rate has been learned yet, or before the full range is
+ * 		calibrated, nothing is closed and the FSM timeout ends the fill.
+ *
+ ----------------------------------------------------------------------------*/
+ SYS_RESULT Reservoir_Check_Fill() {
+	Data_Bus_Sample_t level;
+	uint64_t curTime = getTimestamp();
+	float predictedRange;
+
+	if (!Filling) {
+		return SYS_SUCCESS;
+	}
+
+	if (Data_Bus_Read_Latest(DATA_BUS_TOPIC_VL53L1X, &level)
+	 && level.timestamp != Last_Timestamp
+	 && curTime - level.timestamp <= RESERVOIR_LEVEL_MAX_AGE_MS) {
+		Last_Range_mm = level.value.vl53l1x_range_mm;
+		Last_Timestamp = level.timestamp;
+
+		if (!Have_Level) {
+			Start_Range_mm = Last_Range_mm;
+			Start_Timestamp = Last_Timestamp;
+			Have_Level = true;
+		}
+	}
+
+	if (!Have_Level || Full_Range_mm == RESERVOIR_FULL_RANGE_UNKNOWN) {
+		return SYS_SUCCESS;
+	}
+
+	// The level has risen since the last range, by the learned rate
+	predictedRange = (float)Last_Range_mm - Fill_Rate * (float)(curTime - Last_Timestamp) / 1000.0f;
+
+	if (predictedRange <= (float)Full_Range_mm) {
+		finish_fill();
+		FSM_Post_Event(FSM_EVENT_RESERVOIR_FILLED);
+	}
+
+	return SYS_SUCCESS;
+ }
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		Reservoir_Stop_Fill()
+ *
+ * 		Closes the fill valve and stops watching the level and ranging, e.g.
+ * 		when the FSM ends the fill on its timeout. Nothing is learned from a
+ * 		fill that is stopped, except from the timed fill before the full
+ * 		range is calibrated: its last range, if still fresh, becomes the
+ * 		full range.
+ *
+ ----------------------------------------------------------------------------*/
+ void Reservoir_Stop_Fill() {
+	uint64_t curTime = getTimestamp();
+
+	if (Filling && Full_Range_mm == RESERVOIR_FULL_RANGE_UNKNOWN && Have_Level
+	 && curTime - Fill_Start_Timestamp >= RESERVOIR_CALIBRATION_FILL_MS
+	 && curTime - Last_Timestamp <= RESERVOIR_LEVEL_MAX_AGE_MS) {
+		Full_Range_mm = Last_Range_mm;
+		learn_fill_rate();
+	}
+
+	Filling = false;
+	Scheduler_Disable_Task(Reservoir_Check_Fill_Task_ID);
+	VL53L1X_prj_Stop_Ranging();
+	GPIO_set_fill_valve(VALVE_CLOSED);
+ }
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		Reservoir_Get_Fill_Rate()
+ *
+ * 		Returns the learned rate the level rises at in mm/s, or
+ * 		RESERVOIR_FILL_RATE_UNKNOWN before the first full fill.
+ *
+ ----------------------------------------------------------------------------*/
+ float Reservoir_Get_Fill_Rate() {
+	return Fill_Rate;
+ }
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		Reservoir_Get_Full_Range_mm()
+ *
+ * 		Returns the range to the water surface of a full reservoir, or
+ * 		RESERVOIR_FULL_RANGE_UNKNOWN before the first timed fill.
+ *
+ ----------------------------------------------------------------------------*/
+ uint16_t Reservoir_Get_Full_Range_mm() {
+	return Full_Range_mm;
+ }
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		Reservoir_Restore_Calibration()
+ *
+ * 		Restores the fill rate and full range learned before a reset, from
+ * 		the checkpoint. Either may still be unknown.
+ *
+ ----------------------------------------------------------------------------*/
+ void Reservoir_Restore_Calibration(float fill_rate, uint16_t full_range_mm) {
+	if (fill_rate > 0.0f) {
+		Fill_Rate = fill_rate;
+	}
+
+	Full_Range_mm = full_range_mm;
+ }
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		finish_fill()
+ *
+ * 		Closes the valve, and learns from the fill.
+ *
+ ----------------------------------------------------------------------------*/
+ static void finish_fill() {
+	Reservoir_Stop_Fill();
+	learn_fill_rate();
+ }
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		learn_fill_rate()
+ *
+ * 		Folds the rate of this fill into the learned one. Only the part of
+ * 		the fill between the first and the last range is measured, the
+ * 		extrapolated end is not.
+ *
+ ----------------------------------------------------------------------------*/
+ static void learn_fill_rate() {
+	float rate;
+
+	if (Start_Range_mm < Last_Range_mm + RESERVOIR_MIN_LEARN_RISE_MM || Last_Timestamp <= Start_Timestamp) {
+		return;
+	}
+
+	rate = (float)(Start_Range_mm - Last_Range_mm) * 1000.0f / (float)(Last_Timestamp - Start_Timestamp);
+
+	if (Fill_Rate == RESERVOIR_FILL_RATE_UNKNOWN) {
+		Fill_Rate = rate;
+	}
+	else {
+		Fill_Rate += RESERVOIR_FILL_RATE_WEIGHT * (rate - Fill_Rate);
+	}
+ }
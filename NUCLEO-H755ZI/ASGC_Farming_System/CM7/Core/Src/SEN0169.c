@@ -12,12 +12,16 @@
 #include "SEN0169.h"
 #include "timer.h"
 #include "FS_math.h"
+#include "Scheduler.h"
 
 // ADC hanldler declared in main.c
 extern ADC_HandleTypeDef hadc1;
 bool SEN0169_ADC_On = false;
 
+Scheduler_Task_ID_t SEN0169_Get_Data_Task_ID = SCHEDULER_NO_TASK;
+
 static void clamp_pH(SEN0169_pH_Data *pH_Data);
+static void SEN0169_Register_Tasks();
 
 
 bool SEN0169_Init() {
@@ -26,6 +30,8 @@ bool SEN0169_Init() {
 			return SEN0169_INIT_SUCCEED;
 	}
 
+	SEN0169_Register_Tasks();
+
 	/*-------------------------------------------------------------------------
 	Run ADC Calibration
 	-------------------------------------------------------------------------*/
@@ -214,3 +220,30 @@ void SEN0169_Stop_ADC() {
 	HAL_ADC_Stop(&hadc1);
 	SEN0169_ADC_On = false;
 }
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		SEN0169_Register_Tasks
+ *
+ * 		Registers the SEN0169 scheduler task. The measurement task publishes
+ * 		its reading to the data bus.
+ *
+ ----------------------------------------------------------------------------*/
+static void SEN0169_Register_Tasks() {
+	Scheduler_Task_Config_t getDataTask = {
+		.task_function = SEN0169_Get_Data_TASK,
+		.failure_handler = Device_Failure_Handler,
+		.interval_ms = SEN0169_TASK_DEFAULT_INTERVAL_MS,
+		.budget_ms = SCHEDULER_DEFAULT_TASK_BUDGET_MS,
+		.run_mode = SCHEDULER_RUN_FIXED_RATE,
+		.catch_up_policy = SCHEDULER_CATCH_UP_SKIP,
+		.critical = true,
+	};
+
+	if (SEN0169_Get_Data_Task_ID != SCHEDULER_NO_TASK) {
+		return;
+	}
+
+	SEN0169_Get_Data_Task_ID = Scheduler_Register_Task(&getDataTask);
+}
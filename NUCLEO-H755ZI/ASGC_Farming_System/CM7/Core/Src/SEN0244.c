@@ -11,17 +11,24 @@
 
 #include "SEN0244.h"
 #include "FS_math.h"
+#include "Scheduler.h"
 
 // ADC hanldler declared in main.c
 extern ADC_HandleTypeDef hadc2;
 bool SEN0244_ADC_On = false;
 
+Scheduler_Task_ID_t SEN0244_Get_Data_Task_ID = SCHEDULER_NO_TASK;
+
+static void SEN0244_Register_Tasks();
+
 
 /*-----------------------------------------------------------------------------
  *
  * 		SEN0244_Init
  *
  * 		Initializes the ADC for the SEN0244 EC sensor.
+ * 		NOTE: Call after AHT20_Init(), the AHT20 readings are used for
+ * 		temperature compensation
  *
  ----------------------------------------------------------------------------*/
 
@@ -34,6 +41,8 @@ bool SEN0244_Init() {
 		return SEN0244_INIT_SUCCEED;
 	}
 
+	SEN0244_Register_Tasks();
+
 	/*-------------------------------------------------------------------------
 	Run ADC Calibration
 	-------------------------------------------------------------------------*/
@@ -99,7 +108,7 @@ SYS_RESULT SEN0244_Measure( SEN0244_TDS_Data *tdsData, float tempData) {
 	4) TDS = (133.42*V^3 - 255.86*V^2 + 857.39*V)*0.5 + probe calibration offset
 	--------------------------------------------------------------------------*/
 	medianVoltage = ( ( getMedian_u32(measurement, SEN0244_NUM_MEASUREMENTS) * 3.3 ) / 4096.0);
-	tempCompensation = medianVoltage / ( 1.0 + ( 0.02*(tempData-25.0 ) ) );
+	tempCompensation = medianVoltage / ( 1.0 + ( 0.02*(tempData-SEN0244_DEFAULT_TEMPERATURE_C ) ) );
 	*tdsData = ( (133.42*tempCompensation*tempCompensation*tempCompensation - 255.86*tempCompensation*tempCompensation + 857.39*tempCompensation)*0.5) + SEN0244_PROBE_CALIBRATION_OFFSET;
 
 	return ret_val;
@@ -118,3 +127,31 @@ void SEN0244_Stop_ADC() {
 	HAL_ADC_Stop(&hadc2);
 	SEN0244_ADC_On = false;
 }
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		SEN0244_Register_Tasks
+ *
+ * 		Registers the SEN0244 scheduler task. The measurement task publishes
+ * 		its reading to the data bus, and reads the latest AHT20 reading from
+ * 		the bus for temperature compensation.
+ *
+ ----------------------------------------------------------------------------*/
+static void SEN0244_Register_Tasks() {
+	Scheduler_Task_Config_t getDataTask = {
+		.task_function = SEN0244_Get_Data_TASK,
+		.failure_handler = Device_Failure_Handler,
+		.interval_ms = SEN0244_TASK_DEFAULT_INTERVAL_MS,
+		.budget_ms = SCHEDULER_DEFAULT_TASK_BUDGET_MS,
+		.run_mode = SCHEDULER_RUN_FIXED_RATE,
+		.catch_up_policy = SCHEDULER_CATCH_UP_SKIP,
+		.critical = true,
+	};
+
+	if (SEN0244_Get_Data_Task_ID != SCHEDULER_NO_TASK) {
+		return;
+	}
+
+	SEN0244_Get_Data_Task_ID = Scheduler_Register_Task(&getDataTask);
+}
@@ -9,99 +9,179 @@
 -----------------------------------------------------------------------------*/
 
 #include "Scheduler.h"
+#include "Watchdog.h"
+#include <string.h>
 
 /*-----------------------------------------------------------------------------
 STATIC VARIABLES
 -----------------------------------------------------------------------------*/
-struct Scheduler_Task Task_List[NUM_SCHEDULER_TASKS];
+struct Scheduler_Task Task_List[SCHEDULER_MAX_TASKS];
+static uint8_t Num_Tasks;					/* Registered tasks, the pool is */
+											/* filled from the start		 */
+static Scheduler_Task_ID_t Ready_List[SCHEDULER_MAX_TASKS];
+											/* Enabled tasks, binary min-heap*/
+											/* on next_run_timestamp		 */
+static uint8_t Ready_List_Size;
+static uint32_t Ready_Sequence;				/* Insertions so far			 */
+static uint32_t Planned_Utilization;		/* Permille, from the last plan	 */
+static Scheduler_Task_ID_t Running_Task;	/* Task whose function is running */
+static bool Running_Task_Yielded;			/* Running task asked to resume	 */
+static uint64_t Running_Task_Resume_Timestamp;	/* at this time				 */
+static volatile Scheduler_Event_t Pending_Events;	/* Posted, not yet handled */
+static void (*Bus_Open_Hook[SCHEDULER_NUM_BUSES])();
+static void (*Bus_Close_Hook[SCHEDULER_NUM_BUSES])();
+static bool Bus_Open[SCHEDULER_NUM_BUSES];	/* Buses are clocked after init	 */
+
+/*-----------------------------------------------------------------------------
+TASK HANDLES
+-----------------------------------------------------------------------------*/
+Scheduler_Task_ID_t Scheduler_Send_Task_Stats_Task_ID = SCHEDULER_NO_TASK;
+
+/*-----------------------------------------------------------------------------
+STATIC FUNCTION DECLARATIONS
+-----------------------------------------------------------------------------*/
+static void insert_into_ready_list(Scheduler_Task_ID_t task_id);
+static void remove_from_ready_list(Scheduler_Task_ID_t task_id);
+static Scheduler_Task_ID_t ready_list_head();
+static bool ready_list_before(Scheduler_Task_ID_t a, Scheduler_Task_ID_t b);
+static void ready_list_place(uint8_t index, Scheduler_Task_ID_t task_id);
+static void ready_list_sift_up(uint8_t index);
+static void ready_list_sift_down(uint8_t index);
+static Scheduler_Task_ID_t ready_list_find(uint16_t index, uint64_t due_by, bool (*match)(Scheduler_Task_ID_t task_id, uint64_t arg), uint64_t arg);
+static bool is_batchable_on_bus(Scheduler_Task_ID_t task_id, uint64_t bus);
+static bool is_on_bus(Scheduler_Task_ID_t task_id, uint64_t bus);
+static bool is_late_critical(Scheduler_Task_ID_t task_id, uint64_t cur_time);
+static void update_task_stats(Scheduler_Task_ID_t task_id, uint32_t cycles);
+static void advance_task_deadline(Scheduler_Task_ID_t task_id, uint64_t due_time);
+static void handle_task_success(Scheduler_Task_ID_t task_id);
+static void handle_task_failure(Scheduler_Task_ID_t task_id);
+static void trigger_successors(Scheduler_Task_ID_t task_id);
+static void wake_event_waiters(Scheduler_Event_t events);
+static Scheduler_Task_ID_t next_batched_task(Scheduler_Bus_t bus);
+static bool bus_is_idle(Scheduler_Bus_t bus);
+static bool plan_bus_offset(Scheduler_Plan_Entry_t *entries, uint8_t *placed, uint8_t num_placed, uint8_t entry, uint32_t *offset_ms);
+static uint32_t plan_chain_wcet_ms(Scheduler_Task_ID_t task_id, uint8_t depth);
+static uint32_t gcd(uint32_t a, uint32_t b);
+static int32_t plan_offset_slack(Scheduler_Plan_Entry_t *entries, uint8_t *placed, uint8_t num_placed, uint8_t entry, uint32_t offset_ms);
 
 /*-----------------------------------------------------------------------------
  *
  * 		Scheduler_Init()
  *
- * 		Initializes the scheduler module and the task list.
+ * 		Initializes the scheduler module and empties the task pool. Must be
+ * 		called before the device drivers are initialized, as they register
+ * 		their tasks from their init functions.
  *
  ----------------------------------------------------------------------------*/
  void Scheduler_Init() {
-	// AHT20 Data Request Task
-	Task_List[AHT20_REQUEST_MEASUREMENT_TASK].enabled = false;
-	Task_List[AHT20_REQUEST_MEASUREMENT_TASK].interval_ms = AHT20_TASK_DEFAULT_INTERVAL_MS;
-	Task_List[AHT20_REQUEST_MEASUREMENT_TASK].last_run_timestamp = 0;
-	Task_List[AHT20_REQUEST_MEASUREMENT_TASK].num_consecutive_failures = 0;
-	Task_List[AHT20_REQUEST_MEASUREMENT_TASK].task_function = AHT20_Request_Measurement_TASK;
-	Task_List[AHT20_REQUEST_MEASUREMENT_TASK].failure_handler = NULL; // Add failure handler later
-
-	// AHT20 Data Retrieval Task
-	Task_List[AHT20_GET_DATA_TASK].enabled = false;
-	Task_List[AHT20_GET_DATA_TASK].interval_ms = AHT20_TASK_DEFAULT_INTERVAL_MS;
-	Task_List[AHT20_GET_DATA_TASK].last_run_timestamp = 0;
-	Task_List[AHT20_GET_DATA_TASK].num_consecutive_failures = 0;
-	Task_List[AHT20_GET_DATA_TASK].task_function = AHT20_Get_Data_TASK;
-	Task_List[AHT20_GET_DATA_TASK].failure_handler = NULL; // Add failure handler later
-
-
-	// SEN0169 pH Data Retrieval Task
-	Task_List[SEN0169_GET_DATA_TASK].enabled = false;
-	Task_List[SEN0169_GET_DATA_TASK].interval_ms = SEN0169_TASK_DEFAULT_INTERVAL_MS;
-	Task_List[SEN0169_GET_DATA_TASK].last_run_timestamp = 0;
-	Task_List[SEN0169_GET_DATA_TASK].num_consecutive_failures = 0;
-	Task_List[SEN0169_GET_DATA_TASK].task_function = SEN0169_Get_Data_TASK;
-	Task_List[SEN0169_GET_DATA_TASK].failure_handler = NULL; // Add failure handler later
-
-	// SEN0244 TDS Data Retrieval Task
-	Task_List[SEN0244_GET_DATA_TASK].enabled = false;
-	Task_List[SEN0244_GET_DATA_TASK].interval_ms = SEN0244_TASK_DEFAULT_INTERVAL_MS;
-	Task_List[SEN0244_GET_DATA_TASK].last_run_timestamp = 0;
-	Task_List[SEN0244_GET_DATA_TASK].num_consecutive_failures = 0;
-	Task_List[SEN0244_GET_DATA_TASK].task_function = SEN0244_Get_Data_TASK;
-	Task_List[SEN0244_GET_DATA_TASK].failure_handler = NULL; // Add failure handler later
-
-	// AS7341 Spectral Data Retrieval and DLI Calculation Task
-	Task_List[AS7341_GET_DATA_TASK].enabled = false;
-	Task_List[AS7341_GET_DATA_TASK].interval_ms = AS7341_TASK_DEFAULT_INTERVAL_MS;
-	Task_List[AS7341_GET_DATA_TASK].last_run_timestamp = 0;
-	Task_List[AS7341_GET_DATA_TASK].num_consecutive_failures = 0;
-	Task_List[AS7341_GET_DATA_TASK].task_function = AS7341_Get_Data_TASK;
-	Task_List[AS7341_GET_DATA_TASK].failure_handler = NULL; // Add failure handler later
-
-	// AS7341 Midnight Check Task
-	Task_List[AS7341_CHECK_FOR_MIDNIGHT_TASK].enabled = false;
-	Task_List[AS7341_CHECK_FOR_MIDNIGHT_TASK].interval_ms = AS7341_MIDNIGHT_CHECK_DEFAULT_INTERVAL_MS;
-	Task_List[AS7341_CHECK_FOR_MIDNIGHT_TASK].last_run_timestamp = 0;
-	Task_List[AS7341_CHECK_FOR_MIDNIGHT_TASK].num_consecutive_failures = 0;
-	Task_List[AS7341_CHECK_FOR_MIDNIGHT_TASK].task_function = AS7341_Is_Midnight_TASK;
-	Task_List[AS7341_CHECK_FOR_MIDNIGHT_TASK].failure_handler = NULL; // No failure handler needed
-
-	// CNC Dispense Seeds Task
-	Task_List[CNC_DISPENSE_SEEDS_TASK].enabled = false;
-	Task_List[CNC_DISPENSE_SEEDS_TASK].interval_ms = CNC_DISPENSE_SEEDS_TASK_DEFAULT_INTERVAL_MS;
-	Task_List[CNC_DISPENSE_SEEDS_TASK].last_run_timestamp = 0;
-	Task_List[CNC_DISPENSE_SEEDS_TASK].num_consecutive_failures = 0;
-	Task_List[CNC_DISPENSE_SEEDS_TASK].task_function = CNC_Dispense_Seeds_TASK;
-	Task_List[CNC_DISPENSE_SEEDS_TASK].failure_handler = NULL; // Add failure handler later
-
-	// ILI9341 Change Dashboard Screen Task
-	Task_List[ILI9341_CHANGE_DASHBOARD_SCREEN_TASK].enabled = false;
-	Task_List[ILI9341_CHANGE_DASHBOARD_SCREEN_TASK].interval_ms = ILI9341_TASK_DEFAULT_INTERVAL_MS;
-	Task_List[ILI9341_CHANGE_DASHBOARD_SCREEN_TASK].last_run_timestamp = 0;
-	Task_List[ILI9341_CHANGE_DASHBOARD_SCREEN_TASK].num_consecutive_failures = 0;
-	Task_List[ILI9341_CHANGE_DASHBOARD_SCREEN_TASK].task_function = ILI9341_Change_Dashboard_Screen_TASK;
-	Task_List[ILI9341_CHANGE_DASHBOARD_SCREEN_TASK].failure_handler = NULL; // Add failure handler later
-
-	// ILI9341 Update 'Uptime' Dashboard Item Task
-	Task_List[ILI9341_UPDATE_UPTIME_TASK].enabled = false;
-	Task_List[ILI9341_UPDATE_UPTIME_TASK].interval_ms = ILI9341_UPDATE_UPTIME_INTERVAL_MS;
-	Task_List[ILI9341_UPDATE_UPTIME_TASK].last_run_timestamp = 0;
-	Task_List[ILI9341_UPDATE_UPTIME_TASK].num_consecutive_failures = 0;
-	Task_List[ILI9341_UPDATE_UPTIME_TASK].task_function = ILI9341_Update_Uptime_TASK;
-	Task_List[ILI9341_UPDATE_UPTIME_TASK].failure_handler = NULL; // Add failure handler later
+	Ready_List_Size = 0;
+	Ready_Sequence = 0;
+	Pending_Events = SCHEDULER_EVENT_NONE;
+	Num_Tasks = 0;
+	Running_Task = SCHEDULER_NO_TASK;
+	Running_Task_Yielded = false;
+
+	for (Scheduler_Bus_t b = 0; b < SCHEDULER_NUM_BUSES; b++) {
+		Bus_Open_Hook[b] = NULL;
+		Bus_Close_Hook[b] = NULL;
+		Bus_Open[b] = true;
+	}
+
+	// The scheduler's own task reporting the task statistics. The device
+	// drivers register their tasks from their init functions.
+	Scheduler_Task_Config_t statsTask = {
+		.task_function = Scheduler_Send_Task_Stats_TASK,
+		.failure_handler = NULL,
+		.interval_ms = SCHEDULER_SEND_TASK_STATS_INTERVAL_MS,
+		.budget_ms = SCHEDULER_SEND_TASK_STATS_BUDGET_MS,
+		.run_mode = SCHEDULER_RUN_FIXED_DELAY,
+		.catch_up_policy = SCHEDULER_CATCH_UP_SKIP,
+		.bus = SCHEDULER_BUS_UART7,
+	};
+	Scheduler_Send_Task_Stats_Task_ID = Scheduler_Register_Task(&statsTask);
+
+	/*-------------------------------------------------------------------------
+	Enable the DWT cycle counter used to time the task functions. The lock
+	access register has to be unlocked on the Cortex-M7 before the DWT can be
+	written to.
+	-------------------------------------------------------------------------*/
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->LAR = 0xC5ACCE55;
+	DWT->CYCCNT = 0;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+ }
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		Scheduler_Register_Task()
+ *
+ * 		Adds a task to the task pool and returns its handle. The task starts
+ * 		disabled. Returns SCHEDULER_NO_TASK if the pool is full, every other
+ * 		scheduler function ignores that handle.
+ *
+ ----------------------------------------------------------------------------*/
+ Scheduler_Task_ID_t Scheduler_Register_Task(const Scheduler_Task_Config_t *config) {
+	Scheduler_Task_ID_t task_id;
+	struct Scheduler_Task *task;
+
+	if (config == NULL || config->task_function == NULL || Num_Tasks >= SCHEDULER_MAX_TASKS) {
+		return SCHEDULER_NO_TASK;
+	}
+
+	task_id = Num_Tasks;
+	task = &Task_List[task_id];
+
+	task->enabled = false;
+	task->interval_ms = config->interval_ms;
+	task->last_run_timestamp = 0;
+	task->next_run_timestamp = 0;
+	task->due_timestamp = 0;
+	task->ready_index = SCHEDULER_NO_TASK;
+	task->ready_sequence = 0;
+	task->num_consecutive_failures = 0;
+	task->breaker_state = SCHEDULER_BREAKER_CLOSED;
+	task->probe_interval_ms = SCHEDULER_BREAKER_PROBE_INTERVAL_MS;
+	task->run_mode = config->run_mode;
+	task->catch_up_policy = config->catch_up_policy;
+	task->budget_ms = config->budget_ms;
+	task->critical = config->critical;
+	task->bus = (config->bus < SCHEDULER_NUM_BUSES) ? config->bus : SCHEDULER_BUS_NONE;
+	task->num_successors = 0;
+	task->awaited_event = SCHEDULER_EVENT_NONE;
+	task->event_received = false;
+	task->task_function = config->task_function;
+	task->failure_handler = config->failure_handler;
+
+	Num_Tasks++;
+	Scheduler_Reset_Task_Stats(task_id);
+
+	return task_id;
+ }
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		Scheduler_Get_Num_Tasks()
+ *
+ * 		Returns the number of registered tasks. Registered tasks have the
+ * 		handles 0 to Scheduler_Get_Num_Tasks() - 1.
+ *
+ ----------------------------------------------------------------------------*/
+ uint8_t Scheduler_Get_Num_Tasks() {
+	return Num_Tasks;
  }
 
+
 /*-----------------------------------------------------------------------------
  *
  * 		Scheduler_Update()
  *
  * 		The main update function for the scheduler, called in the main loop.
+ * 		Enabled tasks are kept in a ready list ordered by the time they are
+ * 		next due, so only the head of the list has to be checked on each pass.
+ * 		The list is a binary min-heap, so taking a task out and putting it
+ * 		back after its run costs O(log n). The timestamp is only fetched once
+ * 		per pass when no task is due. The watchdog is fed after each pass.
  *
  ----------------------------------------------------------------------------*/
  void Scheduler_Update() {
@@ -109,39 +189,219 @@ struct Scheduler_Task Task_List[NUM_SCHEDULER_TASKS];
 	Local Variables
 	-------------------------------------------------------------------------*/
 	Scheduler_Task_ID_t i;
+	Scheduler_Bus_t bus = SCHEDULER_BUS_NONE;
+	bool openBus;
+	uint8_t num_tasks_run;
+	uint64_t curTime;
+	uint64_t startTime;
+	uint64_t dueTime;
+	uint32_t startCycles;
+	uint32_t cycles;
+	uint32_t primask;
+	Scheduler_Event_t events;
+	SYS_RESULT result;
+
+	// Wake the tasks waiting on events posted since the last pass. Events
+	// can be posted from interrupts.
+	if (Pending_Events != SCHEDULER_EVENT_NONE) {
+		primask = __get_PRIMASK();
+		__disable_irq();
+		events = Pending_Events;
+		Pending_Events = SCHEDULER_EVENT_NONE;
+		__set_PRIMASK(primask);
+
+		wake_event_waiters(events);
+	}
+
+	curTime = getTimestamp();
+	num_tasks_run = 0;
 
 	/*-------------------------------------------------------------------------
-	For every task:
+	While a task is due. A pass runs at most Num_Tasks tasks, so tasks that
+	reschedule themselves or each other for 'now' can not starve the main
+	loop. A task put back as due goes behind the tasks already due at that
+	time. After a task that uses a bus, the tasks on the same bus that are
+	due within the batch window go first, so the bus work runs back to back.
 	-------------------------------------------------------------------------*/
-	for (i = 0; i < NUM_SCHEDULER_TASKS; i++) {
-		// If the task is enabled
-		if ( Task_List[i].enabled ) {
+	while (num_tasks_run < Num_Tasks) {
+		i = next_batched_task(bus);
+
+		if (i == SCHEDULER_NO_TASK && ready_list_head() != SCHEDULER_NO_TASK
+		&& Task_List[ready_list_head()].next_run_timestamp <= curTime) {
+			i = ready_list_head();
+		}
+		if (i == SCHEDULER_NO_TASK) {
+			break;
+		}
 
-			// If the task interval has elapsed since the last time it was ran successfully
-			if ( (getTimestamp() - Task_List[i].last_run_timestamp) >= Task_List[i].interval_ms ) {
+		remove_from_ready_list(i);
+		num_tasks_run++;
 
-				// Run the task function. If the task function succeeds, update the last run timestamp
-				if (Task_List[i].task_function() == SYS_SUCCESS) {
-					Task_List[i].last_run_timestamp = getTimestamp();
-					Task_List[i].num_consecutive_failures = 0;
-				}
-				// If the task function fails
-				else {
-					Task_List[i].num_consecutive_failures++;
-				}
+		// Record how late the task is starting compared to when it was due
+		dueTime = Task_List[i].due_timestamp;
+		startTime = getTimestamp();
+		Task_List[i].stats.last_start_jitter_ms = (startTime > dueTime) ? (uint32_t)(startTime - dueTime) : 0;
+		if (Task_List[i].stats.last_start_jitter_ms > Task_List[i].stats.max_start_jitter_ms) {
+			Task_List[i].stats.max_start_jitter_ms = Task_List[i].stats.last_start_jitter_ms;
+		}
 
-				// If the task has failed 5 times in a row, handle the failure
-				if (Task_List[i].num_consecutive_failures >= 5) {
-					// Call a task failure handler function here
+		// A parked task that comes due runs as a probe
+		if (Task_List[i].breaker_state == SCHEDULER_BREAKER_OPEN) {
+			Task_List[i].breaker_state = SCHEDULER_BREAKER_HALF_OPEN;
+		}
 
-					// This is just a placeholder to reset the timestamp for now
-					Task_List[i].last_run_timestamp = getTimestamp();
-					Task_List[i].num_consecutive_failures = 0;
-				}
-				
-			}
+		// Wake the bus up if the last window closed it
+		bus = Task_List[i].bus;
+		openBus = (bus != SCHEDULER_BUS_NONE && !Bus_Open[bus] && Bus_Open_Hook[bus] != NULL);
+		if (openBus) {
+			Bus_Open[bus] = true;
+			Bus_Open_Hook[bus]();
+		}
+
+		// The main loop can not see a task that never returns, the task is
+		// named before it runs in case the watchdog resets the board
+		Watchdog_Set_Breadcrumb(WATCHDOG_CAUSE_TASK_HUNG, i, startTime, Task_List[i].budget_ms);
+
+		// Run the task function and time it
+		Running_Task = i;
+		Running_Task_Yielded = false;
+
+		startCycles = DWT->CYCCNT;
+		result = Task_List[i].task_function();
+		cycles = DWT->CYCCNT - startCycles;
+
+		Running_Task = SCHEDULER_NO_TASK;
+		Watchdog_Clear_Breadcrumb();
+		update_task_stats(i, cycles);
+
+		// A switchboard disabled device is not a failure
+		if (result == SYS_SUCCESS || result == SYS_DEVICE_DISABLED) {
+			handle_task_success(i);
+		}
+		else {
+			handle_task_failure(i);
+		}
+
+		// Put the task back in the ready list, unless the task function
+		// disabled it or it is waiting to be triggered
+		if (Task_List[i].enabled && Task_List[i].next_run_timestamp != SCHEDULER_NOT_SCHEDULED) {
+			insert_into_ready_list(i);
+		}
+
+		// End of the bus window, nothing else on the bus is due soon
+		if (bus_is_idle(bus)) {
+			Bus_Open[bus] = false;
+			Bus_Close_Hook[bus]();
 		}
 	}
+
+	Scheduler_Watchdog_Update();
+ }
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		Scheduler_Watchdog_Update()
+ *
+ * 		Feeds the watchdog if every critical task has checked in, that is
+ * 		returned from its last run on time. A critical task blocks the feed
+ * 		when it has been due for longer than its budget plus
+ * 		SCHEDULER_WATCHDOG_GRACE_MS without running, e.g. starved by the
+ * 		tasks ahead of it. A task that hangs stops the feed by never
+ * 		returning to the main loop. Disabled tasks and tasks parked by their
+ * 		circuit breaker are not expected to check in. The offending task is
+ * 		left in the watchdog breadcrumb, so it is known after the reset.
+ * 		Called at the end of Scheduler_Update().
+ *
+ ----------------------------------------------------------------------------*/
+ void Scheduler_Watchdog_Update() {
+	/*-------------------------------------------------------------------------
+	Local Variables
+	-------------------------------------------------------------------------*/
+	Scheduler_Task_ID_t i = SCHEDULER_NO_TASK;
+	uint64_t curTime;
+
+	curTime = getTimestamp();
+
+	/*-------------------------------------------------------------------------
+	The critical task that has been late the longest. Only the tasks due more
+	than the grace period ago are looked at.
+	-------------------------------------------------------------------------*/
+	if (curTime > SCHEDULER_WATCHDOG_GRACE_MS) {
+		i = ready_list_find(0, curTime - SCHEDULER_WATCHDOG_GRACE_MS - 1, is_late_critical, curTime);
+	}
+
+	if (i != SCHEDULER_NO_TASK) {
+		Watchdog_Set_Breadcrumb(WATCHDOG_CAUSE_TASK_LATE, i, Task_List[i].next_run_timestamp, Task_List[i].budget_ms);
+	}
+	else {
+		Watchdog_Clear_Breadcrumb();
+		Watchdog_Feed();
+	}
+ }
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		Scheduler_Set_Bus_Hooks()
+ *
+ * 		Sets the functions that wake a bus up before the first task of a
+ * 		window and put it to sleep (clock gate it, power down its devices)
+ * 		after the last one. Both or neither must be given. The bus is taken
+ * 		to be open when the hooks are set.
+ *
+ ----------------------------------------------------------------------------*/
+ void Scheduler_Set_Bus_Hooks(Scheduler_Bus_t bus, void (*open)(), void (*close)()) {
+	if (bus == SCHEDULER_BUS_NONE || bus >= SCHEDULER_NUM_BUSES || (open == NULL) != (close == NULL)) {
+		return;
+	}
+
+	Bus_Open_Hook[bus] = open;
+	Bus_Close_Hook[bus] = close;
+	Bus_Open[bus] = true;
+ }
+
+
+ /*-----------------------------------------------------------------------------
+ *
+ * 		Scheduler_Get_Ms_Until_Next_Task()
+ *
+ * 		Returns the number of milliseconds until the next enabled task is due.
+ * 		Returns 0 if a task is already due or an event is waiting to be
+ * 		handled, and SCHEDULER_NO_PENDING_TASK_MS
+ * 		if no task is enabled. Used by the main loop to idle between tasks.
+ *
+ ----------------------------------------------------------------------------*/
+ uint32_t Scheduler_Get_Ms_Until_Next_Task() {
+	uint64_t nextRun;
+	uint64_t curTime;
+	uint64_t msUntilNext;
+
+	if (Pending_Events != SCHEDULER_EVENT_NONE) {
+		return 0;
+	}
+
+	// The head of the ready list is the next task due
+	nextRun = (ready_list_head() == SCHEDULER_NO_TASK) ? SCHEDULER_NOT_SCHEDULED : Task_List[ready_list_head()].next_run_timestamp;
+
+	if (nextRun == SCHEDULER_NOT_SCHEDULED) {
+		return SCHEDULER_NO_PENDING_TASK_MS;
+	}
+
+	curTime = getTimestamp();
+
+	if (nextRun <= curTime) {
+		return 0;
+	}
+
+	msUntilNext = nextRun - curTime;
+
+	// Clamp to the 32 bit return value
+	if (msUntilNext >= SCHEDULER_NO_PENDING_TASK_MS) {
+		return SCHEDULER_NO_PENDING_TASK_MS - 1;
+	}
+
+	return (uint32_t)msUntilNext;
  }
 
 
@@ -154,32 +414,23 @@ struct Scheduler_Task Task_List[NUM_SCHEDULER_TASKS];
  * 		ms_delay: The delay in milliseconds before the task is first run.
  * 		If ms_delay is 0, the task will run immediately the next time 
  *    	Scheduler_Update() is called.
+ * 		Triggered tasks ignore ms_delay, they run when a predecessor triggers
+ * 		them.
  *
  ----------------------------------------------------------------------------*/
  void Scheduler_Enable_Task(Scheduler_Task_ID_t task_id, uint32_t ms_delay) {
-	 /*------------------------------------------------------------------------
-	   LOCAL VARIABLES
-	  -----------------------------------------------------------------------*/
-	 uint64_t curTime;
-	 uint64_t newLastRunTime;
-
 	// If the task ID is valid
-	if (task_id < NUM_SCHEDULER_TASKS) {
-		curTime = getTimestamp();
-		newLastRunTime = curTime - Task_List[task_id].interval_ms;
-
-		// Protect from underflow of last_run_timestamp
-		if (newLastRunTime > curTime) {
-			newLastRunTime = ms_delay;
-		}
-		// Add delay
-		else {
-			newLastRunTime = newLastRunTime + ms_delay;
-		}
-
+	if (task_id < Num_Tasks) {
 		Task_List[task_id].enabled = true;
-		Task_List[task_id].last_run_timestamp = newLastRunTime;
 		Task_List[task_id].num_consecutive_failures = 0;
+
+		// Triggered tasks wait for their predecessor
+		if (Task_List[task_id].run_mode != SCHEDULER_RUN_TRIGGERED) {
+			Task_List[task_id].next_run_timestamp = getTimestamp() + ms_delay;
+			Task_List[task_id].due_timestamp = Task_List[task_id].next_run_timestamp;
+
+			insert_into_ready_list(task_id);
+		}
 	}
  }
 
@@ -193,8 +444,9 @@ struct Scheduler_Task Task_List[NUM_SCHEDULER_TASKS];
  ----------------------------------------------------------------------------*/
 void Scheduler_Disable_Task(Scheduler_Task_ID_t task_id) {
 	// If the task ID is valid
-	if (task_id < NUM_SCHEDULER_TASKS) {
+	if (task_id < Num_Tasks) {
 		Task_List[task_id].enabled = false;
+		remove_from_ready_list(task_id);
 	}
  }
 
@@ -203,13 +455,22 @@ void Scheduler_Disable_Task(Scheduler_Task_ID_t task_id) {
  *
  * 		Scheduler_Set_Task_Interval()
  *
- * 		Sets the interval of a task in the scheduler.
+ * 		Sets the interval of a task in the scheduler. If the task is enabled,
+ * 		its next run is moved to interval_ms after its last run.
  *
  ----------------------------------------------------------------------------*/
  void Scheduler_Set_Task_Interval(Scheduler_Task_ID_t task_id, uint32_t interval_ms) {
 	// If the task ID is valid
-	if (task_id < NUM_SCHEDULER_TASKS) {
+	if (task_id < Num_Tasks) {
 		Task_List[task_id].interval_ms = interval_ms;
+
+		// Tasks that have not run yet keep the delay they were enabled with
+		if ( Task_List[task_id].enabled && Task_List[task_id].last_run_timestamp != 0
+		&& Task_List[task_id].run_mode != SCHEDULER_RUN_TRIGGERED ) {
+			Task_List[task_id].next_run_timestamp = Task_List[task_id].last_run_timestamp + interval_ms;
+			Task_List[task_id].due_timestamp = Task_List[task_id].next_run_timestamp;
+			insert_into_ready_list(task_id);
+		}
 	}
  }
 
@@ -226,7 +487,7 @@ void Scheduler_Disable_Task(Scheduler_Task_ID_t task_id) {
  ----------------------------------------------------------------------------*/
  void Scheduler_Set_Task_Function(Scheduler_Task_ID_t task_id, SYS_RESULT (*task_function)()) {
 	// If the task ID is valid
-	if (task_id < NUM_SCHEDULER_TASKS) {
+	if (task_id < Num_Tasks) {
 		Task_List[task_id].task_function = task_function;
 	}
  }
@@ -244,7 +505,7 @@ void Scheduler_Disable_Task(Scheduler_Task_ID_t task_id) {
  ----------------------------------------------------------------------------*/
  void Scheduler_Set_Task_Failure_Handler(Scheduler_Task_ID_t task_id, SYS_RESULT (*failure_handler)(struct Scheduler_Task*)) {
 	// If the task ID is valid
-	if (task_id < NUM_SCHEDULER_TASKS) {
+	if (task_id < Num_Tasks) {
 		Task_List[task_id].failure_handler = failure_handler;
 	}
  }
@@ -257,19 +518,1226 @@ void Scheduler_Disable_Task(Scheduler_Task_ID_t task_id) {
  *
  ----------------------------------------------------------------------------*/
  void Scheduler_Schedule_Task_ms_From_Now(Scheduler_Task_ID_t task_id, uint32_t ms_from_now) {
-	uint64_t curTime = getTimestamp();
-
 	// If task ID is valid
-	if (task_id < NUM_SCHEDULER_TASKS) {
-
-		// protect from underflow
-		if ((curTime - Task_List[task_id].interval_ms) > curTime) {
-			return;
-		} 
-
+	if (task_id < Num_Tasks) {
 		Task_List[task_id].enabled = true;
 
 		// Set next run to be ms_from_now
-		Task_List[task_id].last_run_timestamp = curTime - Task_List[task_id].interval_ms + ms_from_now;
+		Task_List[task_id].next_run_timestamp = getTimestamp() + ms_from_now;
+		Task_List[task_id].due_timestamp = Task_List[task_id].next_run_timestamp;
+
+		insert_into_ready_list(task_id);
+	}
+ }
+
+
+ /*-----------------------------------------------------------------------------
+ *
+ * 		Scheduler_Add_Successor()
+ *
+ * 		Links successor_id after task_id. Every time task_id succeeds,
+ * 		successor_id is run delay_ms later. The successor should be in
+ * 		SCHEDULER_RUN_TRIGGERED mode. Readings are not handed down the link,
+ * 		they go through the data bus.
+ *
+ ----------------------------------------------------------------------------*/
+ SYS_RESULT Scheduler_Add_Successor(Scheduler_Task_ID_t task_id, Scheduler_Task_ID_t successor_id, uint32_t delay_ms) {
+	Scheduler_Successor_t *link;
+
+	if (task_id >= Num_Tasks || successor_id >= Num_Tasks) {
+		return SYS_INVALID;
+	}
+
+	if (Task_List[task_id].num_successors >= SCHEDULER_MAX_SUCCESSORS) {
+		return SYS_FAIL;
+	}
+
+	link = &Task_List[task_id].successors[Task_List[task_id].num_successors];
+	link->task_id = successor_id;
+	link->delay_ms = delay_ms;
+	Task_List[task_id].num_successors++;
+
+	return SYS_SUCCESS;
+ }
+
+
+ /*-----------------------------------------------------------------------------
+ *
+ * 		Scheduler_Get_Task_ID()
+ *
+ * 		Returns the ID of the task that 'task' points to, for use in failure
+ * 		handlers. Returns SCHEDULER_NO_TASK if 'task' is not in the task list.
+ *
+ ----------------------------------------------------------------------------*/
+ Scheduler_Task_ID_t Scheduler_Get_Task_ID(struct Scheduler_Task *task) {
+	if (task < &Task_List[0] || task >= &Task_List[Num_Tasks]) {
+		return SCHEDULER_NO_TASK;
+	}
+
+	return (Scheduler_Task_ID_t)(task - &Task_List[0]);
+ }
+
+
+ /*-----------------------------------------------------------------------------
+ *
+ * 		Scheduler_Sleep_Until()
+ *
+ * 		Returns true once timestamp has passed. Until then, returns false and
+ * 		has the running task run next at timestamp instead of after its
+ * 		interval. Used by CO_AWAIT_MS() in Coroutine.h.
+ *
+ ----------------------------------------------------------------------------*/
+ bool Scheduler_Sleep_Until(uint64_t timestamp) {
+	if (getTimestamp() >= timestamp) {
+		return true;
+	}
+
+	if (Running_Task != SCHEDULER_NO_TASK) {
+		Running_Task_Yielded = true;
+		Running_Task_Resume_Timestamp = timestamp;
+	}
+
+	return false;
+ }
+
+
+ /*-----------------------------------------------------------------------------
+ *
+ * 		Scheduler_Yield()
+ *
+ * 		Has the running task run again after its interval, without counting
+ * 		the run as finished, so its successors are not triggered. Used by
+ * 		CO_AWAIT_CONDITION() in Coroutine.h.
+ *
+ ----------------------------------------------------------------------------*/
+ void Scheduler_Yield() {
+	if (Running_Task != SCHEDULER_NO_TASK) {
+		Running_Task_Yielded = true;
+		Running_Task_Resume_Timestamp = getTimestamp() + Task_List[Running_Task].interval_ms;
+	}
+ }
+
+
+ /*-----------------------------------------------------------------------------
+ *
+ * 		Scheduler_Wait_For_Event()
+ *
+ * 		Called by a running task function, repeatedly, to wait for event.
+ * 		Returns SCHEDULER_WAIT_PENDING and parks the task until the event is
+ * 		posted or timeout_timestamp passes, whichever is first. The task is
+ * 		then run again and the call returns SCHEDULER_WAIT_EVENT or
+ * 		SCHEDULER_WAIT_TIMEOUT. Pass SCHEDULER_NOT_SCHEDULED to wait without
+ * 		a timeout. Used by CO_AWAIT_EVENT() in Coroutine.h.
+ * 		Events are not latched, an event posted before the task starts to
+ * 		wait is missed.
+ *
+ ----------------------------------------------------------------------------*/
+ Scheduler_Wait_Result_t Scheduler_Wait_For_Event(Scheduler_Event_t event, uint64_t timeout_timestamp) {
+	struct Scheduler_Task *task;
+	Scheduler_Wait_Result_t result;
+
+	// Only scheduler tasks can be woken by an event
+	if (Running_Task == SCHEDULER_NO_TASK) {
+		return SCHEDULER_WAIT_TIMEOUT;
+	}
+
+	task = &Task_List[Running_Task];
+
+
+	if (task->event_received) {
+		task->event_received = false;
+		result = SCHEDULER_WAIT_EVENT;
+	}
+	else if (getTimestamp() >= timeout_timestamp) {
+		task->awaited_event = SCHEDULER_EVENT_NONE;
+		result = SCHEDULER_WAIT_TIMEOUT;
+	}
+	else {
+		task->awaited_event = event;
+		Running_Task_Yielded = true;
+		Running_Task_Resume_Timestamp = timeout_timestamp;
+		result = SCHEDULER_WAIT_PENDING;
+	}
+
+
+	return result;
+ }
+
+
+ /*-----------------------------------------------------------------------------
+ *
+ * 		Scheduler_Post_Event()
+ *
+ * 		Wakes the tasks waiting on event on the next Scheduler_Update(). Safe
+ * 		to call from an interrupt.
+ *
+ ----------------------------------------------------------------------------*/
+ void Scheduler_Post_Event(Scheduler_Event_t event) {
+	uint32_t primask;
+
+	primask = __get_PRIMASK();
+	__disable_irq();
+	Pending_Events |= event;
+	__set_PRIMASK(primask);
+ }
+
+
+ /*-----------------------------------------------------------------------------
+ *
+ * 		Scheduler_Get_Task_Breaker_State()
+ *
+ * 		Returns the circuit breaker state of a task.
+ *
+ ----------------------------------------------------------------------------*/
+ Scheduler_Breaker_State_t Scheduler_Get_Task_Breaker_State(Scheduler_Task_ID_t task_id) {
+	if (task_id >= Num_Tasks) {
+		return SCHEDULER_BREAKER_CLOSED;
+	}
+
+	return Task_List[task_id].breaker_state;
+ }
+
+
+ /*-----------------------------------------------------------------------------
+ *
+ * 		Scheduler_Get_Degraded_Task_Mask()
+ *
+ * 		Returns a bit mask of the tasks that are currently parked by their
+ * 		circuit breaker, bit n set for task ID n.
+ *
+ ----------------------------------------------------------------------------*/
+ uint32_t Scheduler_Get_Degraded_Task_Mask() {
+	uint32_t mask = 0;
+
+	for (Scheduler_Task_ID_t i = 0; i < Num_Tasks && i < 32; i++) {
+		if (Task_List[i].breaker_state != SCHEDULER_BREAKER_CLOSED) {
+			mask |= (1UL << i);
+		}
+	}
+
+	return mask;
+ }
+
+
+ /*-----------------------------------------------------------------------------
+ *
+ * 		Scheduler_Set_Task_Run_Mode()
+ *
+ * 		Sets how the next run of a task is timed.
+ * 		SCHEDULER_RUN_FIXED_DELAY: the task next runs interval_ms after it
+ * 		finished, so its period stretches by its own run time.
+ * 		SCHEDULER_RUN_FIXED_RATE: the task next runs interval_ms after it was
+ * 		due, so it keeps a stable period. catch_up_policy selects what happens
+ * 		when whole periods were missed.
+ *
+ ----------------------------------------------------------------------------*/
+ void Scheduler_Set_Task_Run_Mode(Scheduler_Task_ID_t task_id, Scheduler_Run_Mode_t run_mode, Scheduler_Catch_Up_t catch_up_policy) {
+	// If the task ID is valid
+	if (task_id < Num_Tasks) {
+		Task_List[task_id].run_mode = run_mode;
+		Task_List[task_id].catch_up_policy = catch_up_policy;
+	}
+ }
+
+
+ /*-----------------------------------------------------------------------------
+ *
+ * 		Scheduler_Set_Task_Budget()
+ *
+ * 		Sets the execution time budget of a task. Runs that take longer than
+ * 		budget_ms are counted in the task's overrun_count.
+ *
+ ----------------------------------------------------------------------------*/
+ void Scheduler_Set_Task_Budget(Scheduler_Task_ID_t task_id, uint32_t budget_ms) {
+	// If the task ID is valid
+	if (task_id < Num_Tasks) {
+		Task_List[task_id].budget_ms = budget_ms;
+	}
+ }
+
+
+ /*-----------------------------------------------------------------------------
+ *
+ * 		Scheduler_Get_Task_Stats()
+ *
+ * 		Copies the execution statistics of a task into 'stats'.
+ * 		Returns SYS_INVALID if the task ID or 'stats' is invalid.
+ *
+ ----------------------------------------------------------------------------*/
+ SYS_RESULT Scheduler_Get_Task_Stats(Scheduler_Task_ID_t task_id, Scheduler_Task_Stats_t *stats) {
+	if (task_id >= Num_Tasks || stats == NULL) {
+		return SYS_INVALID;
 	}
- }
\ No newline at end of file
+
+	*stats = Task_List[task_id].stats;
+
+	return SYS_SUCCESS;
+ }
+
+
+ /*-----------------------------------------------------------------------------
+ *
+ * 		Scheduler_Reset_Task_Stats()
+ *
+ * 		Clears the execution statistics of a task.
+ *
+ ----------------------------------------------------------------------------*/
+ void Scheduler_Reset_Task_Stats(Scheduler_Task_ID_t task_id) {
+	// If the task ID is valid
+	if (task_id < Num_Tasks) {
+		memset(&Task_List[task_id].stats, 0, sizeof(Scheduler_Task_Stats_t));
+		Task_List[task_id].stats.min_cycles = UINT32_MAX;
+	}
+ }
+
+
+ /*-----------------------------------------------------------------------------
+ *
+ * 		Scheduler_Cycles_To_Us()
+ *
+ * 		Converts a DWT cycle count into microseconds at the current core
+ * 		clock.
+ *
+ ----------------------------------------------------------------------------*/
+ uint32_t Scheduler_Cycles_To_Us(uint32_t cycles) {
+	return cycles / (SystemCoreClock / 1000000);
+ }
+
+
+ /*-----------------------------------------------------------------------------
+ *
+ * 		Scheduler_Get_Task_WCET_ms()
+ *
+ * 		Returns the worst case execution time of a task in milliseconds,
+ * 		rounded up. Until a task has been run and measured, its budget_ms is
+ * 		used as the estimate.
+ *
+ ----------------------------------------------------------------------------*/
+ uint32_t Scheduler_Get_Task_WCET_ms(Scheduler_Task_ID_t task_id) {
+	uint64_t cyclesPerMs;
+	uint32_t wcet_ms;
+
+	if (task_id >= Num_Tasks) {
+		return 0;
+	}
+
+	// Use the declared budget until the task has been measured
+	if (Task_List[task_id].stats.run_count == 0) {
+		return Task_List[task_id].budget_ms;
+	}
+
+	cyclesPerMs = SystemCoreClock / 1000;
+	wcet_ms = (uint32_t)((Task_List[task_id].stats.max_cycles + cyclesPerMs - 1) / cyclesPerMs);
+
+	return (wcet_ms == 0) ? 1 : wcet_ms;
+ }
+
+
+ /*-----------------------------------------------------------------------------
+ *
+ * 		Scheduler_Plan_Task_Offsets()
+ *
+ * 		Assigns a start offset to each entry so that the tasks' execution
+ * 		windows (offset + k*interval, WCET long) overlap as little as possible
+ * 		over the hyperperiod of the task set.
+ *
+ * 		Two tasks with intervals Ta and Tb only ever start a multiple of
+ * 		g = gcd(Ta, Tb) apart, shifted by their offsets. So with
+ * 		r = (offset_a - offset_b) mod g, the tasks never collide if
+ * 		r >= WCET_b and g - r >= WCET_a. Tasks are placed longest WCET first,
+ * 		each at the offset in [0, interval) with the largest worst case
+ * 		margin to every task already placed.
+ *
+ * 		A task's window includes the successors it triggers with no delay,
+ * 		as they run straight after it.
+ *
+ * 		Entries for SCHEDULER_NO_TASK, the handle of a task that was never
+ * 		registered, are skipped.
+ *
+ * 		Entries with an after_task are not searched for, they are pinned
+ * 		after_delay_ms after after_task (e.g. AHT20 data retrieval 80ms after
+ * 		the measurement request).
+ *
+ * 		Tasks on the same bus are placed back to back instead of apart: an
+ * 		entry whose bus already has tasks placed goes at the first offset
+ * 		without overlap after them, so the bus sees one window per period.
+ *
+ * 		Returns SYS_FAIL if the set is not feasible, i.e. its utilization is
+ * 		over 100% or some tasks could not be placed without overlapping. The
+ * 		offsets are still filled in with the best placement found.
+ * 		Returns SYS_INVALID if an entry is invalid.
+ *
+ * 		Note that tasks only keep their planned phase if they run in
+ * 		SCHEDULER_RUN_FIXED_RATE mode; fixed delay tasks drift by their run
+ * 		time each interval.
+ *
+ ----------------------------------------------------------------------------*/
+ SYS_RESULT Scheduler_Plan_Task_Offsets(Scheduler_Plan_Entry_t *entries, uint8_t num_entries) {
+	/*-------------------------------------------------------------------------
+	Local Variables
+	-------------------------------------------------------------------------*/
+	uint8_t order[SCHEDULER_MAX_TASKS];
+	uint8_t placed[SCHEDULER_MAX_TASKS];
+	uint8_t num_free;
+	uint8_t num_placed;
+	uint8_t e, f;
+	uint8_t i, j;
+	uint8_t tmp;
+	uint32_t utilization;
+	uint32_t offset;
+	int32_t slack;
+	int32_t best_slack;
+	bool feasible;
+
+	if (entries == NULL || num_entries == 0 || num_entries > SCHEDULER_MAX_TASKS) {
+		return SYS_INVALID;
+	}
+
+	/*-------------------------------------------------------------------------
+	Validate the entries, total up the utilization and collect the entries
+	that need to be placed
+	-------------------------------------------------------------------------*/
+	utilization = 0;
+	num_free = 0;
+
+	for (e = 0; e < num_entries; e++) {
+		entries[e].offset_ms = 0;
+
+		// Tasks of switchboard disabled devices are never registered
+		if (entries[e].task_id == SCHEDULER_NO_TASK) {
+			continue;
+		}
+
+		if (entries[e].task_id >= Num_Tasks || Task_List[entries[e].task_id].interval_ms == 0) {
+			return SYS_INVALID;
+		}
+
+		utilization += (plan_chain_wcet_ms(entries[e].task_id, 0) * SCHEDULER_PLAN_FULL_UTILIZATION)
+						/ Task_List[entries[e].task_id].interval_ms;
+
+		if (entries[e].after_task == SCHEDULER_NO_TASK) {
+			order[num_free++] = e;
+			continue;
+		}
+
+		// A pinned entry must follow a task that is placed by the planner
+		for (f = 0; f < num_entries; f++) {
+			if (entries[f].task_id == entries[e].after_task && entries[f].after_task == SCHEDULER_NO_TASK) {
+				break;
+			}
+		}
+
+		if (f == num_entries) {
+			return SYS_INVALID;
+		}
+	}
+
+	feasible = (utilization <= SCHEDULER_PLAN_FULL_UTILIZATION);
+	Planned_Utilization = utilization;
+
+	/*-------------------------------------------------------------------------
+	Sort the free entries by descending WCET, then by ascending interval
+	-------------------------------------------------------------------------*/
+	for (i = 1; i < num_free; i++) {
+		for (j = i; j > 0; j--) {
+			uint32_t wcet_a = plan_chain_wcet_ms(entries[order[j - 1]].task_id, 0);
+			uint32_t wcet_b = plan_chain_wcet_ms(entries[order[j]].task_id, 0);
+
+			if ( wcet_a > wcet_b || ( wcet_a == wcet_b
+			&& Task_List[entries[order[j - 1]].task_id].interval_ms <= Task_List[entries[order[j]].task_id].interval_ms ) ) {
+				break;
+			}
+
+			tmp = order[j - 1];
+			order[j - 1] = order[j];
+			order[j] = tmp;
+		}
+	}
+
+	/*-------------------------------------------------------------------------
+	Place each free entry, followed by the entries pinned to it
+	-------------------------------------------------------------------------*/
+	num_placed = 0;
+
+	for (i = 0; i < num_free; i++) {
+		e = order[i];
+		entries[e].offset_ms = 0;
+		best_slack = INT32_MIN;
+
+		if (num_placed == 0) {
+			best_slack = INT32_MAX;
+		}
+		else if (plan_bus_offset(entries, placed, num_placed, e, &offset)) {
+			best_slack = plan_offset_slack(entries, placed, num_placed, e, offset);
+			entries[e].offset_ms = offset;
+		}
+		else {
+			for (offset = 0; offset < Task_List[entries[e].task_id].interval_ms; offset++) {
+				slack = plan_offset_slack(entries, placed, num_placed, e, offset);
+
+				if (slack > best_slack) {
+					best_slack = slack;
+					entries[e].offset_ms = offset;
+				}
+			}
+		}
+
+		if (best_slack < 0) {
+			feasible = false;
+		}
+
+		placed[num_placed++] = e;
+
+		for (f = 0; f < num_entries; f++) {
+			if (entries[f].after_task != entries[e].task_id || entries[f].task_id == SCHEDULER_NO_TASK) {
+				continue;
+			}
+
+			entries[f].offset_ms = entries[e].offset_ms + entries[f].after_delay_ms;
+
+			if (plan_offset_slack(entries, placed, num_placed, f, entries[f].offset_ms) < 0) {
+				feasible = false;
+			}
+
+			placed[num_placed++] = f;
+		}
+	}
+
+	return feasible ? SYS_SUCCESS : SYS_FAIL;
+ }
+
+
+ /*-----------------------------------------------------------------------------
+ *
+ * 		Scheduler_Enable_Tasks_Planned()
+ *
+ * 		Plans the start offsets of the given tasks with
+ * 		Scheduler_Plan_Task_Offsets(), then enables each task at its offset.
+ * 		Tasks are enabled even if the plan is not feasible, the return value
+ * 		is the result of the planner.
+ *
+ ----------------------------------------------------------------------------*/
+ SYS_RESULT Scheduler_Enable_Tasks_Planned(Scheduler_Plan_Entry_t *entries, uint8_t num_entries) {
+	SYS_RESULT result;
+
+	result = Scheduler_Plan_Task_Offsets(entries, num_entries);
+
+	if (result != SYS_INVALID) {
+		for (uint8_t e = 0; e < num_entries; e++) {
+			Scheduler_Enable_Task(entries[e].task_id, entries[e].offset_ms);
+		}
+	}
+
+	return result;
+ }
+
+
+ /*-----------------------------------------------------------------------------
+ *
+ * 		Scheduler_Get_Planned_Utilization()
+ *
+ * 		Returns the processor utilization of the last planned task set, in
+ * 		permille. Over SCHEDULER_PLAN_FULL_UTILIZATION means the task set can
+ * 		not meet its intervals.
+ *
+ ----------------------------------------------------------------------------*/
+ uint32_t Scheduler_Get_Planned_Utilization() {
+	return Planned_Utilization;
+ }
+
+
+ /*-----------------------------------------------------------------------------
+ *
+ * 		update_task_stats()
+ *
+ * 		Adds a run of 'cycles' core clock cycles to a task's statistics. The
+ * 		32 bit CYCCNT wraps after 2^32 cycles (~14s at 300MHz), so longer runs
+ * 		are not measured correctly.
+ *
+ ----------------------------------------------------------------------------*/
+ static void update_task_stats(Scheduler_Task_ID_t task_id, uint32_t cycles) {
+	Scheduler_Task_Stats_t *stats = &Task_List[task_id].stats;
+
+	stats->run_count++;
+	stats->last_cycles = cycles;
+	stats->total_cycles += cycles;
+
+	if (cycles < stats->min_cycles) {
+		stats->min_cycles = cycles;
+	}
+
+	if (cycles > stats->max_cycles) {
+		stats->max_cycles = cycles;
+	}
+
+	if ( (uint64_t)cycles > (uint64_t)Task_List[task_id].budget_ms * (SystemCoreClock / 1000) ) {
+		stats->overrun_count++;
+	}
+ }
+
+
+ /*-----------------------------------------------------------------------------
+ *
+ * 		advance_task_deadline()
+ *
+ * 		Sets the next run of a task after it ran. due_time is when the run
+ * 		was due. Fixed rate tasks advance by exactly interval_ms from due_time;
+ * 		if that is already in the past, the catch up policy decides how many
+ * 		of the missed periods are still run.
+ *
+ ----------------------------------------------------------------------------*/
+ static void advance_task_deadline(Scheduler_Task_ID_t task_id, uint64_t due_time) {
+	/*-------------------------------------------------------------------------
+	Local Variables
+	-------------------------------------------------------------------------*/
+	struct Scheduler_Task *task = &Task_List[task_id];
+	uint64_t curTime;
+	uint64_t missed;
+	uint64_t dropped;
+
+	// Wait for the next trigger
+	if (task->run_mode == SCHEDULER_RUN_TRIGGERED) {
+		task->next_run_timestamp = SCHEDULER_NOT_SCHEDULED;
+		task->due_timestamp = SCHEDULER_NOT_SCHEDULED;
+		return;
+	}
+
+	if (task->run_mode != SCHEDULER_RUN_FIXED_RATE || task->interval_ms == 0) {
+		task->next_run_timestamp = task->last_run_timestamp + task->interval_ms;
+		task->due_timestamp = task->next_run_timestamp;
+		return;
+	}
+
+	task->next_run_timestamp = due_time + task->interval_ms;
+	task->due_timestamp = task->next_run_timestamp;
+	curTime = getTimestamp();
+
+	if (task->next_run_timestamp > curTime) {
+		return;
+	}
+
+	// Number of period starts that have already passed
+	missed = (curTime - task->next_run_timestamp) / task->interval_ms + 1;
+
+	switch (task->catch_up_policy) {
+		// Run once now, then continue on the original phase
+		case SCHEDULER_CATCH_UP_RUN_ONCE:
+			dropped = missed - 1;
+			break;
+
+		// Run back to back until caught up, dropping the oldest periods
+		// beyond the burst limit
+		case SCHEDULER_CATCH_UP_BURST:
+			dropped = (missed > SCHEDULER_MAX_BURST_RUNS) ? missed - SCHEDULER_MAX_BURST_RUNS : 0;
+			break;
+
+		// Wait for the next period start
+		case SCHEDULER_CATCH_UP_SKIP:
+		default:
+			dropped = missed;
+			break;
+	}
+
+	task->next_run_timestamp += dropped * task->interval_ms;
+	task->due_timestamp = task->next_run_timestamp;
+	task->stats.missed_periods += (uint32_t)dropped;
+ }
+
+
+ /*-----------------------------------------------------------------------------
+ *
+ * 		handle_task_success()
+ *
+ * 		Schedules the next run of a task that succeeded. If the run was a
+ * 		probe of a parked task, the task is put back into service and its
+ * 		failure handler is told. A task that yielded (see
+ * 		Scheduler_Sleep_Until()) runs next at the time it asked for.
+ *
+ ----------------------------------------------------------------------------*/
+ static void handle_task_success(Scheduler_Task_ID_t task_id) {
+	struct Scheduler_Task *task = &Task_List[task_id];
+
+	task->last_run_timestamp = getTimestamp();
+	task->num_consecutive_failures = 0;
+
+	if (task->breaker_state != SCHEDULER_BREAKER_CLOSED) {
+		task->breaker_state = SCHEDULER_BREAKER_CLOSED;
+		task->probe_interval_ms = SCHEDULER_BREAKER_PROBE_INTERVAL_MS;
+
+		if (task->failure_handler != NULL) {
+			task->failure_handler(task);
+		}
+	}
+
+	// A coroutine waiting part way through its sequence has not finished
+	// yet, so it does not hand anything to its successors
+	if (Running_Task_Yielded) {
+		task->next_run_timestamp = Running_Task_Resume_Timestamp;
+		task->due_timestamp = task->next_run_timestamp;
+		return;
+	}
+
+	advance_task_deadline(task_id, task->due_timestamp);
+	trigger_successors(task_id);
+ }
+
+
+ /*-----------------------------------------------------------------------------
+ *
+ * 		wake_event_waiters()
+ *
+ * 		Runs the tasks waiting on any of events now. Disabled tasks stop
+ * 		waiting but are not run.
+ *
+ ----------------------------------------------------------------------------*/
+ static void wake_event_waiters(Scheduler_Event_t events) {
+	Scheduler_Task_ID_t i;
+
+	for (i = 0; i < Num_Tasks; i++) {
+		if ((Task_List[i].awaited_event & events) == SCHEDULER_EVENT_NONE) {
+			continue;
+		}
+
+		Task_List[i].awaited_event = SCHEDULER_EVENT_NONE;
+
+		if (!Task_List[i].enabled) {
+			continue;
+		}
+
+		Task_List[i].event_received = true;
+		Task_List[i].next_run_timestamp = getTimestamp();
+		Task_List[i].due_timestamp = Task_List[i].next_run_timestamp;
+		insert_into_ready_list(i);
+	}
+ }
+
+
+ /*-----------------------------------------------------------------------------
+ *
+ * 		trigger_successors()
+ *
+ * 		Schedules the successors of a task that succeeded delay_ms from now.
+ * 		Successors that are disabled or parked by their circuit breaker are
+ * 		not triggered.
+ *
+ ----------------------------------------------------------------------------*/
+ static void trigger_successors(Scheduler_Task_ID_t task_id) {
+	/*-------------------------------------------------------------------------
+	Local Variables
+	-------------------------------------------------------------------------*/
+	Scheduler_Successor_t *link;
+	struct Scheduler_Task *successor;
+	uint8_t i;
+
+	for (i = 0; i < Task_List[task_id].num_successors; i++) {
+		link = &Task_List[task_id].successors[i];
+		successor = &Task_List[link->task_id];
+
+		if (!successor->enabled || successor->breaker_state == SCHEDULER_BREAKER_OPEN) {
+			continue;
+		}
+
+		successor->num_consecutive_failures = 0;
+		successor->next_run_timestamp = getTimestamp() + link->delay_ms;
+		successor->due_timestamp = successor->next_run_timestamp;
+
+		insert_into_ready_list(link->task_id);
+	}
+ }
+
+
+ /*-----------------------------------------------------------------------------
+ *
+ * 		handle_task_failure()
+ *
+ * 		Schedules the retry of a task that failed.
+ * 		- Healthy tasks are retried after an exponential backoff, starting at
+ * 		  SCHEDULER_BACKOFF_BASE_MS, so a missing device does not block every
+ * 		  other task with its bus timeout on every pass.
+ * 		- After SCHEDULER_BREAKER_FAILURE_THRESHOLD failures in a row the
+ * 		  circuit breaker opens. The task is parked and only probed every
+ * 		  probe_interval_ms, and its failure handler is told.
+ * 		- A failed probe parks the task again, doubling the probe interval up
+ * 		  to SCHEDULER_BREAKER_PROBE_MAX_INTERVAL_MS.
+ *
+ ----------------------------------------------------------------------------*/
+ static void handle_task_failure(Scheduler_Task_ID_t task_id) {
+	/*-------------------------------------------------------------------------
+	Local Variables
+	-------------------------------------------------------------------------*/
+	struct Scheduler_Task *task = &Task_List[task_id];
+	uint64_t curTime;
+	uint32_t backoff_ms;
+
+	curTime = getTimestamp();
+	task->stats.failure_count++;
+
+	// A failed run abandons any event it was waiting on
+	task->awaited_event = SCHEDULER_EVENT_NONE;
+	task->event_received = false;
+
+	if (task->num_consecutive_failures < UINT8_MAX) {
+		task->num_consecutive_failures++;
+	}
+
+	// Probe of a parked task failed, wait longer before the next probe
+	if (task->breaker_state == SCHEDULER_BREAKER_HALF_OPEN) {
+		task->probe_interval_ms *= 2;
+		if (task->probe_interval_ms > SCHEDULER_BREAKER_PROBE_MAX_INTERVAL_MS) {
+			task->probe_interval_ms = SCHEDULER_BREAKER_PROBE_MAX_INTERVAL_MS;
+		}
+
+		task->breaker_state = SCHEDULER_BREAKER_OPEN;
+		task->next_run_timestamp = curTime + task->probe_interval_ms;
+		task->due_timestamp = task->next_run_timestamp;
+	}
+	// Too many failures in a row, park the task
+	else if (task->num_consecutive_failures >= SCHEDULER_BREAKER_FAILURE_THRESHOLD) {
+		task->breaker_state = SCHEDULER_BREAKER_OPEN;
+		task->probe_interval_ms = SCHEDULER_BREAKER_PROBE_INTERVAL_MS;
+		task->next_run_timestamp = curTime + task->probe_interval_ms;
+		task->due_timestamp = task->next_run_timestamp;
+		task->stats.breaker_trip_count++;
+
+		if (task->failure_handler != NULL) {
+			task->failure_handler(task);
+		}
+	}
+	// Retry after a backoff, keeping the planned time of the period
+	else {
+		backoff_ms = SCHEDULER_BACKOFF_BASE_MS << (task->num_consecutive_failures - 1);
+		if (backoff_ms > SCHEDULER_BACKOFF_MAX_MS) {
+			backoff_ms = SCHEDULER_BACKOFF_MAX_MS;
+		}
+
+		task->next_run_timestamp = curTime + backoff_ms;
+	}
+ }
+
+
+ /*-----------------------------------------------------------------------------
+ *
+ * 		gcd()
+ *
+ * 		Greatest common divisor of a and b.
+ *
+ ----------------------------------------------------------------------------*/
+ static uint32_t gcd(uint32_t a, uint32_t b) {
+	uint32_t tmp;
+
+	while (b != 0) {
+		tmp = a % b;
+		a = b;
+		b = tmp;
+	}
+
+	return a;
+ }
+
+
+ /*-----------------------------------------------------------------------------
+ *
+ * 		plan_chain_wcet_ms()
+ *
+ * 		Returns the WCET of a task plus the WCET of the successors it
+ * 		triggers with no delay, which run straight after it.
+ *
+ ----------------------------------------------------------------------------*/
+ static uint32_t plan_chain_wcet_ms(Scheduler_Task_ID_t task_id, uint8_t depth) {
+	Scheduler_Successor_t *link;
+	uint32_t wcet_ms;
+
+	wcet_ms = Scheduler_Get_Task_WCET_ms(task_id);
+
+	// Guard against successor loops
+	if (depth >= SCHEDULER_MAX_TASKS) {
+		return wcet_ms;
+	}
+
+	for (uint8_t i = 0; i < Task_List[task_id].num_successors; i++) {
+		link = &Task_List[task_id].successors[i];
+
+		if (link->delay_ms == 0) {
+			wcet_ms += plan_chain_wcet_ms(link->task_id, depth + 1);
+		}
+	}
+
+	return wcet_ms;
+ }
+
+
+ /*-----------------------------------------------------------------------------
+ *
+ * 		plan_offset_slack()
+ *
+ * 		Returns the smallest gap in milliseconds between the execution window
+ * 		of 'entry' at offset_ms and the windows of the placed entries, over
+ * 		the hyperperiod. A negative result means the windows overlap.
+ *
+ ----------------------------------------------------------------------------*/
+ static int32_t plan_offset_slack(Scheduler_Plan_Entry_t *entries, uint8_t *placed, uint8_t num_placed, uint8_t entry, uint32_t offset_ms) {
+	/*-------------------------------------------------------------------------
+	Local Variables
+	-------------------------------------------------------------------------*/
+	int32_t min_slack;
+	int32_t slack_before;
+	int32_t slack_after;
+	int64_t g;
+	int64_t r;
+	uint8_t p;
+	uint8_t i;
+
+	min_slack = INT32_MAX;
+
+	for (i = 0; i < num_placed; i++) {
+		p = placed[i];
+		g = gcd(Task_List[entries[entry].task_id].interval_ms, Task_List[entries[p].task_id].interval_ms);
+
+		// Distance from the start of the placed task to the start of this one
+		r = ((int64_t)offset_ms - (int64_t)entries[p].offset_ms) % g;
+		if (r < 0) {
+			r += g;
+		}
+
+		slack_before = (int32_t)(r - plan_chain_wcet_ms(entries[p].task_id, 0));
+		slack_after = (int32_t)(g - r - plan_chain_wcet_ms(entries[entry].task_id, 0));
+
+		if (slack_before < min_slack) {
+			min_slack = slack_before;
+		}
+		if (slack_after < min_slack) {
+			min_slack = slack_after;
+		}
+	}
+
+	return min_slack;
+ }
+
+
+ /*-----------------------------------------------------------------------------
+ *
+ * 		plan_bus_offset()
+ *
+ * 		Finds the offset that puts 'entry' straight after the entries already
+ * 		placed on its bus, at the first offset where it overlaps no placed
+ * 		entry. Returns false if the entry has no bus, nothing is placed on
+ * 		its bus yet, or no such offset exists.
+ *
+ ----------------------------------------------------------------------------*/
+ static bool plan_bus_offset(Scheduler_Plan_Entry_t *entries, uint8_t *placed, uint8_t num_placed, uint8_t entry, uint32_t *offset_ms) {
+	/*-------------------------------------------------------------------------
+	Local Variables
+	-------------------------------------------------------------------------*/
+	Scheduler_Bus_t bus = Task_List[entries[entry].task_id].bus;
+	uint32_t interval = Task_List[entries[entry].task_id].interval_ms;
+	uint32_t windowEnd = 0;
+	bool busPlaced = false;
+	uint8_t p;
+
+	if (bus == SCHEDULER_BUS_NONE) {
+		return false;
+	}
+
+	// End of the bus window so far
+	for (uint8_t i = 0; i < num_placed; i++) {
+		p = placed[i];
+
+		if (Task_List[entries[p].task_id].bus == bus) {
+			busPlaced = true;
+
+			if (entries[p].offset_ms + plan_chain_wcet_ms(entries[p].task_id, 0) > windowEnd) {
+				windowEnd = entries[p].offset_ms + plan_chain_wcet_ms(entries[p].task_id, 0);
+			}
+		}
+	}
+
+	if (!busPlaced) {
+		return false;
+	}
+
+	for (uint32_t delay = 0; delay < interval; delay++) {
+		*offset_ms = (windowEnd + delay) % interval;
+
+		if (plan_offset_slack(entries, placed, num_placed, entry, *offset_ms) >= 0) {
+			return true;
+		}
+	}
+
+	return false;
+ }
+
+
+ /*-----------------------------------------------------------------------------
+ *
+ * 		insert_into_ready_list()
+ *
+ * 		Inserts a task into the ready list by next_run_timestamp. Tasks due
+ * 		at the same time keep the order they were inserted in. If the task is
+ * 		already in the list it is moved.
+ *
+ ----------------------------------------------------------------------------*/
+ static void insert_into_ready_list(Scheduler_Task_ID_t task_id) {
+	remove_from_ready_list(task_id);
+
+	Task_List[task_id].ready_sequence = Ready_Sequence++;
+	ready_list_place(Ready_List_Size, task_id);
+	Ready_List_Size++;
+
+	ready_list_sift_up(Task_List[task_id].ready_index);
+ }
+
+
+ /*-----------------------------------------------------------------------------
+ *
+ * 		remove_from_ready_list()
+ *
+ * 		Removes a task from the ready list. Does nothing if the task is not
+ * 		in the list. The last task of the heap takes its place.
+ *
+ ----------------------------------------------------------------------------*/
+ static void remove_from_ready_list(Scheduler_Task_ID_t task_id) {
+	uint8_t index = Task_List[task_id].ready_index;
+
+	if (index == SCHEDULER_NO_TASK) {
+		return;
+	}
+
+	Task_List[task_id].ready_index = SCHEDULER_NO_TASK;
+	Ready_List_Size--;
+
+	if (index != Ready_List_Size) {
+		ready_list_place(index, Ready_List[Ready_List_Size]);
+		ready_list_sift_down(index);
+		ready_list_sift_up(Task_List[Ready_List[index]].ready_index);
+	}
+ }
+
+
+ /*-----------------------------------------------------------------------------
+ *
+ * 		ready_list_head()
+ *
+ * 		Returns the task that is due first, or SCHEDULER_NO_TASK if no task
+ * 		is in the ready list.
+ *
+ ----------------------------------------------------------------------------*/
+ static Scheduler_Task_ID_t ready_list_head() {
+	return (Ready_List_Size == 0) ? SCHEDULER_NO_TASK : Ready_List[0];
+ }
+
+
+ /*-----------------------------------------------------------------------------
+ *
+ * 		ready_list_before()
+ *
+ * 		Returns true if task a runs before task b: a is due earlier, or both
+ * 		are due at the same time and a was inserted first.
+ *
+ ----------------------------------------------------------------------------*/
+ static bool ready_list_before(Scheduler_Task_ID_t a, Scheduler_Task_ID_t b) {
+	if (Task_List[a].next_run_timestamp != Task_List[b].next_run_timestamp) {
+		return Task_List[a].next_run_timestamp < Task_List[b].next_run_timestamp;
+	}
+
+	// The sequence count may wrap
+	return (int32_t)(Task_List[a].ready_sequence - Task_List[b].ready_sequence) < 0;
+ }
+
+
+ /*-----------------------------------------------------------------------------
+ *
+ * 		ready_list_place()
+ *
+ * 		Puts a task at 'index' of the heap.
+ *
+ ----------------------------------------------------------------------------*/
+ static void ready_list_place(uint8_t index, Scheduler_Task_ID_t task_id) {
+	Ready_List[index] = task_id;
+	Task_List[task_id].ready_index = index;
+ }
+
+
+ /*-----------------------------------------------------------------------------
+ *
+ * 		ready_list_sift_up()
+ *
+ * 		Moves the task at 'index' up the heap while it runs before its parent.
+ *
+ ----------------------------------------------------------------------------*/
+ static void ready_list_sift_up(uint8_t index) {
+	Scheduler_Task_ID_t task_id = Ready_List[index];
+	uint8_t parent;
+
+	while (index > 0) {
+		parent = (index - 1) / 2;
+
+		if (!ready_list_before(task_id, Ready_List[parent])) {
+			break;
+		}
+
+		ready_list_place(index, Ready_List[parent]);
+		index = parent;
+	}
+
+	ready_list_place(index, task_id);
+ }
+
+
+ /*-----------------------------------------------------------------------------
+ *
+ * 		ready_list_sift_down()
+ *
+ * 		Moves the task at 'index' down the heap while one of its children
+ * 		runs before it.
+ *
+ ----------------------------------------------------------------------------*/
+ static void ready_list_sift_down(uint8_t index) {
+	Scheduler_Task_ID_t task_id = Ready_List[index];
+	uint16_t child;
+
+	while ((child = 2 * (uint16_t)index + 1) < Ready_List_Size) {
+		if (child + 1 < Ready_List_Size && ready_list_before(Ready_List[child + 1], Ready_List[child])) {
+			child++;
+		}
+
+		if (!ready_list_before(Ready_List[child], task_id)) {
+			break;
+		}
+
+		ready_list_place(index, Ready_List[child]);
+		index = (uint8_t)child;
+	}
+
+	ready_list_place(index, task_id);
+ }
+
+
+ /*-----------------------------------------------------------------------------
+ *
+ * 		ready_list_find()
+ *
+ * 		Returns the first task to run, out of the heap below 'index', that is
+ * 		due by 'due_by' and for which match(task, arg) is true. Returns
+ * 		SCHEDULER_NO_TASK if there is none. A task is never due before its
+ * 		parent, so the search does not go below a task due after 'due_by', and
+ * 		only looks at the tasks due by then and their children.
+ *
+ ----------------------------------------------------------------------------*/
+ static Scheduler_Task_ID_t ready_list_find(uint16_t index, uint64_t due_by, bool (*match)(Scheduler_Task_ID_t task_id, uint64_t arg), uint64_t arg) {
+	Scheduler_Task_ID_t task_id;
+	Scheduler_Task_ID_t left;
+	Scheduler_Task_ID_t right;
+
+	if (index >= Ready_List_Size) {
+		return SCHEDULER_NO_TASK;
+	}
+
+	task_id = Ready_List[index];
+
+	if (Task_List[task_id].next_run_timestamp > due_by) {
+		return SCHEDULER_NO_TASK;
+	}
+
+	// Runs before everything below it
+	if (match(task_id, arg)) {
+		return task_id;
+	}
+
+	left = ready_list_find(2 * index + 1, due_by, match, arg);
+	right = ready_list_find(2 * index + 2, due_by, match, arg);
+
+	if (left == SCHEDULER_NO_TASK || (right != SCHEDULER_NO_TASK && ready_list_before(right, left))) {
+		return right;
+	}
+
+	return left;
+ }
+
+
+ /*-----------------------------------------------------------------------------
+ *
+ * 		is_batchable_on_bus()
+ *
+ * 		ready_list_find() match for next_batched_task(). True for a task on
+ * 		'bus' that is on its regular schedule.
+ *
+ ----------------------------------------------------------------------------*/
+ static bool is_batchable_on_bus(Scheduler_Task_ID_t task_id, uint64_t bus) {
+	return ( Task_List[task_id].bus == bus
+		&& Task_List[task_id].run_mode != SCHEDULER_RUN_TRIGGERED
+		&& Task_List[task_id].breaker_state == SCHEDULER_BREAKER_CLOSED
+		&& Task_List[task_id].awaited_event == SCHEDULER_EVENT_NONE
+		&& Task_List[task_id].next_run_timestamp == Task_List[task_id].due_timestamp );
+ }
+
+
+ /*-----------------------------------------------------------------------------
+ *
+ * 		is_on_bus()
+ *
+ * 		ready_list_find() match for bus_is_idle().
+ *
+ ----------------------------------------------------------------------------*/
+ static bool is_on_bus(Scheduler_Task_ID_t task_id, uint64_t bus) {
+	return (Task_List[task_id].bus == bus);
+ }
+
+
+ /*-----------------------------------------------------------------------------
+ *
+ * 		is_late_critical()
+ *
+ * 		ready_list_find() match for Scheduler_Watchdog_Update(). True for a
+ * 		critical task that has been due for longer than its budget plus
+ * 		SCHEDULER_WATCHDOG_GRACE_MS at cur_time.
+ *
+ ----------------------------------------------------------------------------*/
+ static bool is_late_critical(Scheduler_Task_ID_t task_id, uint64_t cur_time) {
+	return ( Task_List[task_id].critical && Task_List[task_id].breaker_state == SCHEDULER_BREAKER_CLOSED
+		&& cur_time - Task_List[task_id].next_run_timestamp > Task_List[task_id].budget_ms + SCHEDULER_WATCHDOG_GRACE_MS );
+ }
+
+
+ /*-----------------------------------------------------------------------------
+ *
+ * 		next_batched_task()
+ *
+ * 		Returns the first task on 'bus' that is due within
+ * 		SCHEDULER_BUS_BATCH_WINDOW_MS, or SCHEDULER_NO_TASK. Only
+ * 		tasks on their regular schedule are run early; triggered tasks,
+ * 		retries and waiting or parked tasks keep their time.
+ *
+ ----------------------------------------------------------------------------*/
+ static Scheduler_Task_ID_t next_batched_task(Scheduler_Bus_t bus) {
+	uint64_t windowEnd;
+
+	if (bus == SCHEDULER_BUS_NONE) {
+		return SCHEDULER_NO_TASK;
+	}
+
+	windowEnd = getTimestamp() + SCHEDULER_BUS_BATCH_WINDOW_MS;
+
+	return ready_list_find(0, windowEnd, is_batchable_on_bus, bus);
+ }
+
+
+ /*-----------------------------------------------------------------------------
+ *
+ * 		bus_is_idle()
+ *
+ * 		Returns true if 'bus' is open, has hooks to close it, and no task on
+ * 		it is due within SCHEDULER_BUS_BATCH_WINDOW_MS.
+ *
+ ----------------------------------------------------------------------------*/
+ static bool bus_is_idle(Scheduler_Bus_t bus) {
+	uint64_t windowEnd;
+
+	if (bus == SCHEDULER_BUS_NONE || !Bus_Open[bus] || Bus_Close_Hook[bus] == NULL) {
+		return false;
+	}
+
+	windowEnd = getTimestamp() + SCHEDULER_BUS_BATCH_WINDOW_MS;
+
+	return (ready_list_find(0, windowEnd, is_on_bus, bus) == SCHEDULER_NO_TASK);
+ }
+
@@ -0,0 +1,530 @@
+/*-----------------------------------------------------------------------------
+ *
+ * 	Timer_Wheel.c
+ *
+ * 		Software timers on a hierarchical timing wheel, see Timer_Wheel.h.
+ *
+ * 		Next_Tick is the first millisecond not run yet. A timer due in less
+ * 		than 64 ms from it is in the level 0 slot of its deadline. A timer
+ * 		due within 64^(L+1) ms is in the level L slot of its deadline divided
+ * 		by 64^L, and its slot is cascaded (its timers put back in the wheel,
+ * 		a level or more lower) when Next_Tick reaches the start of that
+ * 		slot. Every slot is a doubly linked list of timer indices, so a
+ * 		timer is taken out of its slot in constant time.
+ *
+ *  Created on: Oct 16, 2026
+ *
+-----------------------------------------------------------------------------*/
+
+#include "Timer_Wheel.h"
+#include "timer.h"
+#include <string.h>
+
+/*-----------------------------------------------------------------------------
+DEFINES
+-----------------------------------------------------------------------------*/
+#define TIMER_WHEEL_SLOT_MASK					(TIMER_WHEEL_SLOTS - 1)
+#define TIMER_WHEEL_LEVEL_SHIFT(level)			((level) * TIMER_WHEEL_SLOT_BITS)
+#define TIMER_WHEEL_EXPIRED						TIMER_WHEEL_NUM_LEVELS
+						/* 'level' of a timer whose callback is		 */
+						/* about to run								 */
+
+/*-----------------------------------------------------------------------------
+TYPEDEFS
+-----------------------------------------------------------------------------*/
+typedef struct Timer_Wheel_Timer {
+	Timer_Wheel_Callback_t callback;
+	uint32_t argument;
+	uint64_t deadline;					/* Tick (getTimestamp()) it is due	 */
+	uint32_t delay_ms;					/* Of the last start, for restarts	 */
+	uint32_t period_ms;					/* 0 for a one-shot timer			 */
+	Timer_Wheel_ID_t next;				/* In its slot						 */
+	Timer_Wheel_ID_t prev;
+	uint8_t level;
+	uint8_t slot;
+	bool running;
+}Timer_Wheel_Timer_t;
+
+/*-----------------------------------------------------------------------------
+STATIC VARIABLES
+-----------------------------------------------------------------------------*/
+static Timer_Wheel_Timer_t Timers[TIMER_WHEEL_MAX_TIMERS];
+static uint8_t Num_Timers;
+
+static Timer_Wheel_ID_t Slots[TIMER_WHEEL_NUM_LEVELS][TIMER_WHEEL_SLOTS];
+static uint64_t Slots_In_Use[TIMER_WHEEL_NUM_LEVELS];
+											/* Bit per non-empty slot		 */
+static Timer_Wheel_ID_t Expired;			/* Timers of the tick being run	 */
+static uint64_t Next_Tick;
+
+/*-----------------------------------------------------------------------------
+STATIC FUNCTION DECLARATIONS
+-----------------------------------------------------------------------------*/
+static void insert_timer(Timer_Wheel_ID_t timer_id);
+static void link_timer(Timer_Wheel_ID_t timer_id, uint8_t level, uint8_t slot);
+static void unlink_timer(Timer_Wheel_ID_t timer_id);
+static void cascade(uint8_t level, uint8_t slot);
+static uint64_t next_busy_tick();
+static uint64_t rotate_right(uint64_t bits, uint8_t n);
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		Timer_Wheel_Init()
+ *
+ * 		Empties the wheel. Call after ASGC_Timer_Init(), and before the
+ * 		modules that create timers are initialized.
+ *
+ ----------------------------------------------------------------------------*/
+ void Timer_Wheel_Init() {
+	memset(Slots, TIMER_WHEEL_NO_TIMER, sizeof(Slots));
+	memset(Slots_In_Use, 0, sizeof(Slots_In_Use));
+
+	Num_Timers = 0;
+	Expired = TIMER_WHEEL_NO_TIMER;
+	Next_Tick = getTimestamp() + 1;
+ }
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		Timer_Wheel_Create()
+ *
+ * 		Adds a stopped timer, which calls callback(argument) when it runs
+ * 		out. Returns TIMER_WHEEL_NO_TIMER if every timer is taken. Call from
+ * 		the module init functions, like Scheduler_Register_Task().
+ *
+ ----------------------------------------------------------------------------*/
+ Timer_Wheel_ID_t Timer_Wheel_Create(Timer_Wheel_Callback_t callback, uint32_t argument) {
+	Timer_Wheel_Timer_t *timer;
+
+	if (callback == NULL || Num_Timers >= TIMER_WHEEL_MAX_TIMERS) {
+		return TIMER_WHEEL_NO_TIMER;
+	}
+
+	timer = &Timers[Num_Timers];
+	memset(timer, 0, sizeof(*timer));
+	timer->callback = callback;
+	timer->argument = argument;
+	timer->next = TIMER_WHEEL_NO_TIMER;
+	timer->prev = TIMER_WHEEL_NO_TIMER;
+
+	return Num_Timers++;
+ }
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		Timer_Wheel_Start()
+ *
+ * 		Starts a timer, or starts it over if it is running. It runs out
+ * 		delay_ms from now, at the earliest on the next millisecond, and then
+ * 		every period_ms if period_ms is not 0. A periodic timer keeps to its
+ * 		period, and skips the periods missed while the main loop was held up.
+ *
+ ----------------------------------------------------------------------------*/
+ void Timer_Wheel_Start(Timer_Wheel_ID_t timer_id, uint32_t delay_ms, uint32_t period_ms) {
+	Timer_Wheel_Timer_t *timer;
+	uint32_t primask;
+
+	if (timer_id >= Num_Timers) {
+		return;
+	}
+
+	timer = &Timers[timer_id];
+
+	primask = __get_PRIMASK();
+	__disable_irq();
+
+	if (timer->running) {
+		unlink_timer(timer_id);
+	}
+
+	timer->delay_ms = delay_ms;
+	timer->period_ms = period_ms;
+	timer->deadline = getTimestamp() + delay_ms;
+	timer->running = true;
+	insert_timer(timer_id);
+
+	__set_PRIMASK(primask);
+ }
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		Timer_Wheel_Restart()
+ *
+ * 		Starts a timer over with the delay and period it was last started
+ * 		with, e.g. to push a timeout back.
+ *
+ ----------------------------------------------------------------------------*/
+ void Timer_Wheel_Restart(Timer_Wheel_ID_t timer_id) {
+	if (timer_id >= Num_Timers) {
+		return;
+	}
+
+	Timer_Wheel_Start(timer_id, Timers[timer_id].delay_ms, Timers[timer_id].period_ms);
+ }
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		Timer_Wheel_Cancel()
+ *
+ * 		Stops a timer. Its callback does not run, unless it is already
+ * 		running on another task.
+ *
+ ----------------------------------------------------------------------------*/
+ void Timer_Wheel_Cancel(Timer_Wheel_ID_t timer_id) {
+	uint32_t primask;
+
+	if (timer_id >= Num_Timers) {
+		return;
+	}
+
+	primask = __get_PRIMASK();
+	__disable_irq();
+
+	if (Timers[timer_id].running) {
+		unlink_timer(timer_id);
+		Timers[timer_id].running = false;
+	}
+
+	__set_PRIMASK(primask);
+ }
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		Timer_Wheel_Is_Running()
+ *
+ * 		Returns true if a timer has been started and has not run out or
+ * 		been cancelled. A periodic timer runs until it is cancelled.
+ *
+ ----------------------------------------------------------------------------*/
+ bool Timer_Wheel_Is_Running(Timer_Wheel_ID_t timer_id) {
+	return (timer_id < Num_Timers && Timers[timer_id].running);
+ }
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		Timer_Wheel_Update()
+ *
+ * 		Runs the callbacks of the timers that are due, in the order of their
+ * 		deadlines. Call from the main loop only. The wheel is moved on from
+ * 		one slot in use to the next, so the time since the last update costs
+ * 		one step per 64 ms at most.
+ *
+ ----------------------------------------------------------------------------*/
+ void Timer_Wheel_Update() {
+	Timer_Wheel_Timer_t *timer;
+	Timer_Wheel_ID_t timer_id;
+	Timer_Wheel_Callback_t callback;
+	uint32_t argument;
+	uint64_t curTime = getTimestamp();
+	uint64_t tick;
+	uint32_t primask;
+	int8_t level;
+
+	primask = __get_PRIMASK();
+	__disable_irq();
+
+	while (Next_Tick <= curTime) {
+		tick = next_busy_tick();
+
+		if (tick > curTime) {
+			Next_Tick = curTime + 1;
+			break;
+		}
+
+		Next_Tick = tick;
+
+		/*---------------------------------------------------------------------
+		At the start of a level 1 slot, bring its timers down a level, and
+		those of the levels above first if it also starts one of their slots
+		---------------------------------------------------------------------*/
+		if ((tick & TIMER_WHEEL_SLOT_MASK) == 0) {
+			level = TIMER_WHEEL_NUM_LEVELS - 1;
+
+			while (level > 0 && (tick & ((1ULL << TIMER_WHEEL_LEVEL_SHIFT(level)) - 1)) != 0) {
+				level--;
+			}
+
+			for (; level > 0; level--) {
+				cascade(level, (tick >> TIMER_WHEEL_LEVEL_SHIFT(level)) & TIMER_WHEEL_SLOT_MASK);
+			}
+		}
+
+		/*---------------------------------------------------------------------
+		Move the timers due now off the wheel, then run them one at a time
+		with interrupts enabled. A callback may start or cancel any timer,
+		including the ones still waiting to run.
+		---------------------------------------------------------------------*/
+		while (Slots[0][tick & TIMER_WHEEL_SLOT_MASK] != TIMER_WHEEL_NO_TIMER) {
+			timer_id = Slots[0][tick & TIMER_WHEEL_SLOT_MASK];
+			unlink_timer(timer_id);
+			link_timer(timer_id, TIMER_WHEEL_EXPIRED, 0);
+		}
+
+		Next_Tick = tick + 1;
+
+		while (Expired != TIMER_WHEEL_NO_TIMER) {
+			timer_id = Expired;
+			timer = &Timers[timer_id];
+			unlink_timer(timer_id);
+
+			if (timer->period_ms == 0) {
+				timer->running = false;
+			}
+			else {
+				timer->deadline += timer->period_ms;
+
+				if (timer->deadline <= curTime) {
+					timer->deadline += ((curTime - timer->deadline) / timer->period_ms + 1) * timer->period_ms;
+				}
+
+				insert_timer(timer_id);
+			}
+
+			callback = timer->callback;
+			argument = timer->argument;
+
+			__set_PRIMASK(primask);
+			callback(argument);
+			primask = __get_PRIMASK();
+			__disable_irq();
+		}
+	}
+
+	__set_PRIMASK(primask);
+ }
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		Timer_Wheel_Get_Ms_Until_Next()
+ *
+ * 		Returns the number of milliseconds until Timer_Wheel_Update() may
+ * 		have a callback to run, so the main loop knows how long it may idle
+ * 		for, or TIMER_WHEEL_NO_PENDING_TIMER_MS if no timer is running. For a
+ * 		timer on an upper level this is when its slot is cascaded, which is
+ * 		at or before its deadline.
+ *
+ ----------------------------------------------------------------------------*/
+ uint32_t Timer_Wheel_Get_Ms_Until_Next() {
+	uint64_t curTime = getTimestamp();
+	uint64_t next = UINT64_MAX;
+	uint64_t tick;
+	uint64_t block;
+	uint32_t primask;
+
+	primask = __get_PRIMASK();
+	__disable_irq();
+
+	for (uint8_t level = 0; level < TIMER_WHEEL_NUM_LEVELS; level++) {
+		if (Slots_In_Use[level] == 0) {
+			continue;
+		}
+
+		if (level == 0) {
+			tick = Next_Tick + __builtin_ctzll(rotate_right(Slots_In_Use[0], Next_Tick & TIMER_WHEEL_SLOT_MASK));
+		}
+		else {
+			// The first slot start not passed yet
+			block = (Next_Tick + (1ULL << TIMER_WHEEL_LEVEL_SHIFT(level)) - 1) >> TIMER_WHEEL_LEVEL_SHIFT(level);
+			block += __builtin_ctzll(rotate_right(Slots_In_Use[level], block & TIMER_WHEEL_SLOT_MASK));
+			tick = block << TIMER_WHEEL_LEVEL_SHIFT(level);
+		}
+
+		if (tick < next) {
+			next = tick;
+		}
+	}
+
+	__set_PRIMASK(primask);
+
+	if (next == UINT64_MAX) {
+		return TIMER_WHEEL_NO_PENDING_TIMER_MS;
+	}
+
+	if (next <= curTime) {
+		return 0;
+	}
+
+	if (next - curTime >= TIMER_WHEEL_NO_PENDING_TIMER_MS) {
+		return TIMER_WHEEL_NO_PENDING_TIMER_MS - 1;
+	}
+
+	return (uint32_t)(next - curTime);
+ }
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		insert_timer()
+ *
+ * 		Puts a timer in the slot of its deadline, on the lowest level that
+ * 		reaches it. A deadline already passed is moved to Next_Tick.
+ * 		Interrupts must be masked.
+ *
+ ----------------------------------------------------------------------------*/
+ static void insert_timer(Timer_Wheel_ID_t timer_id) {
+	Timer_Wheel_Timer_t *timer = &Timers[timer_id];
+	uint64_t delta;
+	uint8_t level;
+	uint8_t shift;
+
+	if (timer->deadline < Next_Tick) {
+		timer->deadline = Next_Tick;
+	}
+
+	delta = timer->deadline - Next_Tick;
+
+	for (level = 0; level < TIMER_WHEEL_NUM_LEVELS; level++) {
+		shift = TIMER_WHEEL_LEVEL_SHIFT(level);
+
+		if (delta < (1ULL << (shift + TIMER_WHEEL_SLOT_BITS))) {
+			link_timer(timer_id, level, (timer->deadline >> shift) & TIMER_WHEEL_SLOT_MASK);
+			return;
+		}
+	}
+
+	// Beyond the top level. Waits in the top level slot that comes up last,
+	// and is put back in the wheel from there.
+	shift = TIMER_WHEEL_LEVEL_SHIFT(TIMER_WHEEL_NUM_LEVELS - 1);
+	link_timer(timer_id, TIMER_WHEEL_NUM_LEVELS - 1, (Next_Tick >> shift) & TIMER_WHEEL_SLOT_MASK);
+ }
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		link_timer(), unlink_timer()
+ *
+ * 		Adds a timer to the front of a slot, or to the expired list, and
+ * 		takes it out of the one it is in. Interrupts must be masked.
+ *
+ ----------------------------------------------------------------------------*/
+ static void link_timer(Timer_Wheel_ID_t timer_id, uint8_t level, uint8_t slot) {
+	Timer_Wheel_Timer_t *timer = &Timers[timer_id];
+	Timer_Wheel_ID_t *head;
+
+	if (level == TIMER_WHEEL_EXPIRED) {
+		head = &Expired;
+	}
+	else {
+		head = &Slots[level][slot];
+		Slots_In_Use[level] |= (1ULL << slot);
+	}
+
+	timer->level = level;
+	timer->slot = slot;
+	timer->prev = TIMER_WHEEL_NO_TIMER;
+	timer->next = *head;
+
+	if (*head != TIMER_WHEEL_NO_TIMER) {
+		Timers[*head].prev = timer_id;
+	}
+
+	*head = timer_id;
+ }
+
+ static void unlink_timer(Timer_Wheel_ID_t timer_id) {
+	Timer_Wheel_Timer_t *timer = &Timers[timer_id];
+	Timer_Wheel_ID_t *head;
+
+	if (timer->level == TIMER_WHEEL_EXPIRED) {
+		head = &Expired;
+	}
+	else {
+		head = &Slots[timer->level][timer->slot];
+	}
+
+	if (timer->prev != TIMER_WHEEL_NO_TIMER) {
+		Timers[timer->prev].next = timer->next;
+	}
+	else {
+		*head = timer->next;
+	}
+
+	if (timer->next != TIMER_WHEEL_NO_TIMER) {
+		Timers[timer->next].prev = timer->prev;
+	}
+
+	if (*head == TIMER_WHEEL_NO_TIMER && timer->level != TIMER_WHEEL_EXPIRED) {
+		Slots_In_Use[timer->level] &= ~(1ULL << timer->slot);
+	}
+
+	timer->next = TIMER_WHEEL_NO_TIMER;
+	timer->prev = TIMER_WHEEL_NO_TIMER;
+ }
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		cascade()
+ *
+ * 		Puts the timers of an upper level slot back in the wheel, which
+ * 		takes them a level or more down. The slot is emptied first, as a
+ * 		timer due a whole turn of the level later goes back in the same
+ * 		slot. Interrupts must be masked.
+ *
+ ----------------------------------------------------------------------------*/
+ static void cascade(uint8_t level, uint8_t slot) {
+	Timer_Wheel_ID_t timer_id = Slots[level][slot];
+	Timer_Wheel_ID_t next;
+
+	Slots[level][slot] = TIMER_WHEEL_NO_TIMER;
+	Slots_In_Use[level] &= ~(1ULL << slot);
+
+	while (timer_id != TIMER_WHEEL_NO_TIMER) {
+		next = Timers[timer_id].next;
+		insert_timer(timer_id);
+		timer_id = next;
+	}
+ }
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		next_busy_tick()
+ *
+ * 		Returns the first tick from Next_Tick on with something to do: a
+ * 		level 0 slot in use, or the start of the next level 1 slot, where the
+ * 		upper levels are cascaded. Interrupts must be masked.
+ *
+ ----------------------------------------------------------------------------*/
+ static uint64_t next_busy_tick() {
+	uint8_t index = Next_Tick & TIMER_WHEEL_SLOT_MASK;
+	uint64_t inUse;
+
+	if (index == 0) {
+		return Next_Tick;
+	}
+
+	// The slots left before level 0 wraps
+	inUse = Slots_In_Use[0] >> index;
+
+	if (inUse != 0) {
+		return Next_Tick + __builtin_ctzll(inUse);
+	}
+
+	return (Next_Tick | TIMER_WHEEL_SLOT_MASK) + 1;
+ }
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		rotate_right()
+ *
+ * 		Rotates a slot bitmap, so bit 0 is slot n.
+ *
+ ----------------------------------------------------------------------------*/
+ static uint64_t rotate_right(uint64_t bits, uint8_t n) {
+	n &= TIMER_WHEEL_SLOT_MASK;
+
+	if (n == 0) {
+		return bits;
+	}
+
+	return (bits >> n) | (bits << (TIMER_WHEEL_SLOTS - n));
+ }
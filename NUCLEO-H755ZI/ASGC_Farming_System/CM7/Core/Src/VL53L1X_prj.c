@@ -13,16 +13,33 @@
 
 #include "vl53l1_api.h"
 #include "VL53L1X_prj.h"
+#include "Scheduler.h"
+
+Scheduler_Task_ID_t VL53L1X_Get_Data_Task_ID = SCHEDULER_NO_TASK;
+
+static bool Ranging;				// Continuous ranging is running on the sensor
+static bool Ranging_Wanted;			// Between Start_Ranging() and Stop_Ranging()
+
+static void VL53L1X_Register_Tasks();
 
 /*-----------------------------------------------------------------------------
  *
  * 		VL53L1X_prj_Init
  *
  * 		Calls numerous VL53L1X API functions to initialize the VL53L1X device.
+ * 		The sensor looks down at the water surface of the reservoir, see
+ * 		Reservoir.h. It only ranges while the reservoir fills, see
+ * 		VL53L1X_prj_Start_Ranging().
  *
  ----------------------------------------------------------------------------*/
 
 void VL53L1X_prj_Init(VL53L1_DEV Dev, I2C_HandleTypeDef *hi2c) {
+
+	// If the VL53L1X is switchboard disabled, do not try to initialize it
+	if (VL53L1X_ENABLED == SYS_FEATURE_DISABLED) {
+		return;
+	}
+
 	Dev->I2cHandle = hi2c;
 	Dev->I2cDevAddr = VL53L1X_I2C_ADDRESS;
 	
@@ -31,9 +48,57 @@ void VL53L1X_prj_Init(VL53L1_DEV Dev, I2C_HandleTypeDef *hi2c) {
 	VL53L1_DataInit( Dev );
 	VL53L1_StaticInit( Dev );
 	VL53L1_SetDistanceMode( Dev, VL53L1_DISTANCEMODE_LONG );
-	VL53L1_SetMeasurementTimingBudgetMicroSeconds( Dev, 50000 );
-	VL53L1_SetInterMeasurementPeriodMilliSeconds( Dev, 500 );
-	VL53L1_StartMeasurement( Dev );
+	VL53L1_SetMeasurementTimingBudgetMicroSeconds( Dev, VL53L1X_TIMING_BUDGET_US );
+	VL53L1_SetInterMeasurementPeriodMilliSeconds( Dev, VL53L1X_INTER_MEASUREMENT_MS );
+
+	Ranging = false;
+	Ranging_Wanted = false;
+
+	VL53L1X_Register_Tasks();
+}
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		VL53L1X_prj_Start_Ranging
+ *
+ * 		Enables the VL53L1X task, which starts continuous ranging on its
+ * 		first run, inside an I2C1 window.
+ *
+ ----------------------------------------------------------------------------*/
+
+void VL53L1X_prj_Start_Ranging() {
+	if (VL53L1X_Get_Data_Task_ID == SCHEDULER_NO_TASK) {
+		return;
+	}
+
+	Ranging_Wanted = true;
+	Scheduler_Enable_Task(VL53L1X_Get_Data_Task_ID, 0);
+}
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		VL53L1X_prj_Stop_Ranging
+ *
+ * 		Stops continuous ranging. If the sensor is ranging, the VL53L1X task
+ * 		runs once more to stop it and then disables itself.
+ *
+ ----------------------------------------------------------------------------*/
+
+void VL53L1X_prj_Stop_Ranging() {
+	if (VL53L1X_Get_Data_Task_ID == SCHEDULER_NO_TASK) {
+		return;
+	}
+
+	Ranging_Wanted = false;
+
+	if (Ranging) {
+		Scheduler_Enable_Task(VL53L1X_Get_Data_Task_ID, 0);
+	}
+	else {
+		Scheduler_Disable_Task(VL53L1X_Get_Data_Task_ID);
+	}
 }
 
 
@@ -51,4 +116,109 @@ void VL53L1X_GetRangingMeasurementData(VL53L1_DEV Dev, VL53L1_RangingMeasurement
     VL53L1_GetRangingMeasurementData( Dev, pRangingMeasurementData );
     VL53L1_ClearInterruptAndStartMeasurement( Dev );
 
-	}
\ No newline at end of file
+	}
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		VL53L1X_prj_Get_Range_mm
+ *
+ * 		Reads the latest range in mm without waiting for one. 'new_range' is
+ * 		false, and 'range_mm' left alone, if the sensor has not finished a
+ * 		new measurement since the last read. Returns
+ * 		SYS_MEASUREMENT_GET_FAIL if the sensor does not answer or flags the
+ * 		range as invalid.
+ *
+ * 		Also starts and stops continuous ranging as asked by
+ * 		VL53L1X_prj_Start_Ranging() and VL53L1X_prj_Stop_Ranging(), as this
+ * 		is called by the VL53L1X task, with I2C1 clocked. The task is
+ * 		disabled once ranging has stopped.
+ *
+ ----------------------------------------------------------------------------*/
+
+SYS_RESULT VL53L1X_prj_Get_Range_mm(VL53L1_DEV Dev, uint16_t *range_mm, bool *new_range) {
+	VL53L1_RangingMeasurementData_t rangingData;
+	uint8_t dataReady = 0;
+
+	if (VL53L1X_ENABLED == SYS_FEATURE_DISABLED) {
+		return SYS_DEVICE_DISABLED;
+	}
+
+	if (range_mm == NULL || new_range == NULL) {
+		return SYS_INVALID;
+	}
+
+	*new_range = false;
+
+	if (!Ranging_Wanted) {
+		if (Ranging && VL53L1_StopMeasurement( Dev ) != VL53L1_ERROR_NONE) {
+			return SYS_MEASUREMENT_GET_FAIL;
+		}
+
+		Ranging = false;
+		Scheduler_Disable_Task(VL53L1X_Get_Data_Task_ID);
+		return SYS_SUCCESS;
+	}
+
+	if (!Ranging) {
+		if (VL53L1_StartMeasurement( Dev ) != VL53L1_ERROR_NONE) {
+			return SYS_MEASUREMENT_GET_FAIL;
+		}
+
+		Ranging = true;
+		return SYS_SUCCESS;
+	}
+
+	if (VL53L1_GetMeasurementDataReady( Dev, &dataReady ) != VL53L1_ERROR_NONE) {
+		return SYS_MEASUREMENT_GET_FAIL;
+	}
+
+	if (!dataReady) {
+		return SYS_SUCCESS;
+	}
+
+	if (VL53L1_GetRangingMeasurementData( Dev, &rangingData ) != VL53L1_ERROR_NONE) {
+		return SYS_MEASUREMENT_GET_FAIL;
+	}
+
+	VL53L1_ClearInterruptAndStartMeasurement( Dev );
+
+	// Splashes and foam give out of range or wrapped readings
+	if (rangingData.RangeStatus != VL53L1_RANGESTATUS_RANGE_VALID || rangingData.RangeMilliMeter < 0) {
+		return SYS_MEASUREMENT_GET_FAIL;
+	}
+
+	*range_mm = (uint16_t)rangingData.RangeMilliMeter;
+	*new_range = true;
+
+	return SYS_SUCCESS;
+}
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		VL53L1X_Register_Tasks
+ *
+ * 		Registers the VL53L1X scheduler task, which publishes each new range
+ * 		to the data bus. The task starts disabled, the fill enables it.
+ *
+ ----------------------------------------------------------------------------*/
+
+static void VL53L1X_Register_Tasks() {
+	Scheduler_Task_Config_t getDataTask = {
+		.task_function = VL53L1X_Get_Data_TASK,
+		.failure_handler = Device_Failure_Handler,
+		.interval_ms = VL53L1X_TASK_DEFAULT_INTERVAL_MS,
+		.budget_ms = SCHEDULER_DEFAULT_TASK_BUDGET_MS,
+		.run_mode = SCHEDULER_RUN_FIXED_RATE,
+		.catch_up_policy = SCHEDULER_CATCH_UP_SKIP,
+		.critical = true,
+		.bus = SCHEDULER_BUS_I2C1,
+	};
+
+	if (VL53L1X_Get_Data_Task_ID != SCHEDULER_NO_TASK) {
+		return;
+	}
+
+	VL53L1X_Get_Data_Task_ID = Scheduler_Register_Task(&getDataTask);
+}
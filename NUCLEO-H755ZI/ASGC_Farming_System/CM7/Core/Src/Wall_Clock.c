@@ -0,0 +1,471 @@
+/*-----------------------------------------------------------------------------
+ *
+ * 	Wall_Clock.c
+ *
+ * 		Wall clock time on the RTC, with the midnight alarm, see
+ * 		Wall_Clock.h.
+ *
+ *  Created on: Oct 16, 2026
+ *
+-----------------------------------------------------------------------------*/
+
+#include "Wall_Clock.h"
+#include "Scheduler.h"
+#include "Work_Queue.h"
+#include "Checkpoint.h"
+#include "RPI_UART.h"
+#include "Adafruit_AS7341.h"
+#include "timer.h"
+
+/*-----------------------------------------------------------------------------
+DEFINES
+-----------------------------------------------------------------------------*/
+#define SEC_IN_DAY								86400
+#define SEC_IN_HOUR								3600
+#define SEC_IN_MIN								60
+
+// The RTC counts the years 2000 to 2099
+#define WALL_CLOCK_FIRST_S						946684800
+						/* 2000-01-01 00:00:00						 */
+#define WALL_CLOCK_LAST_S						4102444799
+						/* 2099-12-31 23:59:59						 */
+
+#define WALL_CLOCK_PREDIV_A						127
+#define WALL_CLOCK_PREDIV_S						255
+						/* 32768Hz / 128 / 256 = 1Hz				 */
+#define WALL_CLOCK_ALARM_IRQ_PRIORITY			15
+						/* Lowest, the alarm only posts work		 */
+
+/*-----------------------------------------------------------------------------
+STATIC VARIABLES
+-----------------------------------------------------------------------------*/
+Scheduler_Task_ID_t Wall_Clock_Sync_Task_ID = SCHEDULER_NO_TASK;
+
+static bool Clock_Ready;					/* RTC running on the LSE		 */
+static bool Have_Synced;					/* Set from the Pi since reset	 */
+static uint64_t Last_Sync_Timestamp;
+
+/*-----------------------------------------------------------------------------
+STATIC FUNCTION DECLARATIONS
+-----------------------------------------------------------------------------*/
+static void new_day_work(uint32_t argument);
+static bool set_midnight_alarm();
+static SYS_RESULT write_calendar(uint32_t local_time_s);
+static uint32_t read_local_time();
+static bool wait_for_flag(uint32_t flag);
+static void unlock_rtc();
+static void lock_rtc();
+static uint32_t days_from_civil(uint32_t year, uint32_t month, uint32_t day);
+static void civil_from_days(uint32_t days, uint32_t *year, uint32_t *month, uint32_t *day);
+static uint32_t to_bcd(uint32_t value);
+static uint32_t from_bcd(uint32_t bcd);
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		Wall_Clock_Init()
+ *
+ * 		Starts the RTC on the LSE, unless it is already running from before
+ * 		the reset, arms the midnight alarm, and registers the sync task. The
+ * 		wall clock stays off if the LSE does not start, or if the RTC was
+ * 		put on another clock, which only a backup domain reset can change.
+ * 		Call after Scheduler_Init().
+ *
+ ----------------------------------------------------------------------------*/
+ void Wall_Clock_Init() {
+	Clock_Ready = false;
+	Have_Synced = false;
+
+	if (!ASGC_Timer_Start_LSE()) {
+		return;
+	}
+
+	switch (RCC->BDCR & RCC_BDCR_RTCSEL) {
+	case 0:
+		MODIFY_REG(RCC->BDCR, RCC_BDCR_RTCSEL, RCC_BDCR_RTCSEL_0);
+		break;
+
+	case RCC_BDCR_RTCSEL_0:
+		break;
+
+	default:
+		return;
+	}
+
+	RCC->BDCR |= RCC_BDCR_RTCEN;
+	RCC->APB4ENR |= RCC_APB4ENR_RTCAPBEN;
+	RCC->APB4LPENR |= RCC_APB4LPENR_RTCAPBLPEN;
+	(void)RCC->APB4ENR;
+
+	/*-------------------------------------------------------------------------
+	The calendar can only be read once it has been synchronized after the
+	reset. A midnight that went by during the reset is not run, the
+	checkpoint tells the FSM about it.
+	-------------------------------------------------------------------------*/
+	unlock_rtc();
+	RTC->ISR = (uint32_t)~(RTC_ISR_INIT | RTC_ISR_RSF);
+
+	if (!wait_for_flag(RTC_ISR_RSF) || !set_midnight_alarm()) {
+		lock_rtc();
+		return;
+	}
+
+	RTC->ISR = (uint32_t)~(RTC_ISR_INIT | RTC_ISR_ALRAF);
+	lock_rtc();
+
+	// Alarm A reaches the CM7 on EXTI line 17
+	EXTI->RTSR1 |= EXTI_RTSR1_TR17;
+	EXTI_D1->PR1 = EXTI_PR1_PR17;
+	EXTI_D1->IMR1 |= EXTI_IMR1_IM17;
+
+	NVIC_SetPriority(RTC_Alarm_IRQn, WALL_CLOCK_ALARM_IRQ_PRIORITY);
+	NVIC_ClearPendingIRQ(RTC_Alarm_IRQn);
+	NVIC_EnableIRQ(RTC_Alarm_IRQn);
+
+	Clock_Ready = true;
+
+	// The time comes from the Raspberry Pi
+	if (RASPBERRY_PI_INTERFACE_ENABLED == SYS_FEATURE_DISABLED) {
+		return;
+	}
+
+	Scheduler_Task_Config_t syncTask = {
+		.task_function = Wall_Clock_Sync_TASK,
+		.failure_handler = NULL,
+		.interval_ms = WALL_CLOCK_SYNC_INTERVAL_MS,
+		.budget_ms = WALL_CLOCK_SYNC_TASK_BUDGET_MS,
+		.run_mode = SCHEDULER_RUN_FIXED_DELAY,
+		.catch_up_policy = SCHEDULER_CATCH_UP_SKIP,
+		.critical = false,
+		.bus = SCHEDULER_BUS_UART7,
+	};
+
+	if (Wall_Clock_Sync_Task_ID == SCHEDULER_NO_TASK) {
+		Wall_Clock_Sync_Task_ID = Scheduler_Register_Task(&syncTask);
+	}
+ }
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		Wall_Clock_Set()
+ *
+ * 		Sets the RTC to the local time of a unix time and a UTC offset in
+ * 		hours (UTC-5 is -5). An error of up to WALL_CLOCK_MAX_DRIFT_S is
+ * 		left alone. If the clock is stepped forward over a midnight, which
+ * 		the alarm then never sees, the new day is started here.
+ *
+ ----------------------------------------------------------------------------*/
+ SYS_RESULT Wall_Clock_Set(uint32_t unix_time_s, int8_t utc_offset_h) {
+	int64_t localTime;
+	uint32_t curTime;
+	uint32_t oldDay = WALL_CLOCK_DAY_UNKNOWN;
+	SYS_RESULT result;
+
+	if (!Clock_Ready) {
+		return SYS_DEVICE_DISABLED;
+	}
+
+	localTime = (int64_t)unix_time_s + (int64_t)utc_offset_h * SEC_IN_HOUR;
+
+	if (utc_offset_h < WALL_CLOCK_MIN_UTC_OFFSET_H || utc_offset_h > WALL_CLOCK_MAX_UTC_OFFSET_H
+	 || localTime < WALL_CLOCK_FIRST_S || localTime > WALL_CLOCK_LAST_S) {
+		return SYS_FAIL;
+	}
+
+	if (Wall_Clock_Is_Set()) {
+		curTime = read_local_time();
+		oldDay = curTime / SEC_IN_DAY;
+
+		if (localTime - curTime <= WALL_CLOCK_MAX_DRIFT_S && curTime - localTime <= WALL_CLOCK_MAX_DRIFT_S) {
+			Have_Synced = true;
+			Last_Sync_Timestamp = getTimestamp();
+			return SYS_SUCCESS;
+		}
+	}
+
+	result = write_calendar((uint32_t)localTime);
+	if (result != SYS_SUCCESS) {
+		return result;
+	}
+
+	Have_Synced = true;
+	Last_Sync_Timestamp = getTimestamp();
+
+	if (oldDay != WALL_CLOCK_DAY_UNKNOWN && (uint32_t)localTime / SEC_IN_DAY > oldDay) {
+		new_day_work(0);
+	}
+
+	return SYS_SUCCESS;
+ }
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		Wall_Clock_Sync()
+ *
+ * 		Run by Wall_Clock_Sync_TASK. Asks the Raspberry Pi for the time if
+ * 		it has not been asked since the reset, or a resync is due.
+ *
+ ----------------------------------------------------------------------------*/
+ SYS_RESULT Wall_Clock_Sync() {
+	if (Have_Synced && getTimestamp() - Last_Sync_Timestamp < WALL_CLOCK_RESYNC_INTERVAL_MS) {
+		return SYS_SUCCESS;
+	}
+
+	return RPI_UART_Send_RPI_UNIX_TIME_REQUEST_Pkt(WALL_CLOCK_SYNC_TIMEOUT_MS);
+ }
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		Wall_Clock_Is_Set()
+ *
+ * 		Returns true if the RTC holds the time, which it keeps through a
+ * 		reset once it has been set.
+ *
+ ----------------------------------------------------------------------------*/
+ bool Wall_Clock_Is_Set() {
+	return (Clock_Ready && (RTC->ISR & RTC_ISR_INITS) != 0);
+ }
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		Wall_Clock_Get_Local_Day()
+ *
+ * 		Returns the local date as days since 1970-01-01, which changes at
+ * 		local midnight. WALL_CLOCK_DAY_UNKNOWN if the clock is not set.
+ *
+ ----------------------------------------------------------------------------*/
+ uint32_t Wall_Clock_Get_Local_Day() {
+	if (!Wall_Clock_Is_Set()) {
+		return WALL_CLOCK_DAY_UNKNOWN;
+	}
+
+	return read_local_time() / SEC_IN_DAY;
+ }
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		Wall_Clock_Alarm_IRQHandler()
+ *
+ * 		Called by RTC_Alarm_IRQHandler() at local midnight. The new day is
+ * 		started from the main loop.
+ *
+ ----------------------------------------------------------------------------*/
+ void Wall_Clock_Alarm_IRQHandler() {
+	if (RTC->ISR & RTC_ISR_ALRAF) {
+		RTC->ISR = (uint32_t)~(RTC_ISR_INIT | RTC_ISR_ALRAF) | (RTC->ISR & RTC_ISR_INIT);
+		Work_Queue_Post(WORK_QUEUE_PRIORITY_NORMAL, new_day_work, 0);
+	}
+
+	EXTI_D1->PR1 = EXTI_PR1_PR17;
+ }
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		new_day_work()
+ *
+ * 		Starts the DLI of the new day, and saves the checkpoint, so a reset
+ * 		does not bring back the DLI of the day before.
+ *
+ ----------------------------------------------------------------------------*/
+ static void new_day_work(uint32_t argument) {
+	(void)argument;
+
+	Adafruit_AS7341_resetDLI();
+	Checkpoint_Save();
+ }
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		set_midnight_alarm()
+ *
+ * 		Sets alarm A to 00:00:00 on any date, with its interrupt. The RTC
+ * 		must be unlocked. Returns false if the alarm could not be written.
+ *
+ ----------------------------------------------------------------------------*/
+ static bool set_midnight_alarm() {
+	RTC->CR &= ~(RTC_CR_ALRAE | RTC_CR_ALRAIE);
+
+	if (!wait_for_flag(RTC_ISR_ALRAWF)) {
+		return false;
+	}
+
+	RTC->ALRMAR = RTC_ALRMAR_MSK4;
+	RTC->ALRMASSR = 0;
+	RTC->CR |= RTC_CR_ALRAE | RTC_CR_ALRAIE;
+
+	return true;
+ }
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		write_calendar()
+ *
+ * 		Sets the RTC calendar to a local time, in seconds since 1970-01-01.
+ * 		The calendar stops while it is written, and the subseconds restart.
+ *
+ ----------------------------------------------------------------------------*/
+ static SYS_RESULT write_calendar(uint32_t local_time_s) {
+	uint32_t days = local_time_s / SEC_IN_DAY;
+	uint32_t secs = local_time_s % SEC_IN_DAY;
+	uint32_t year, month, day;
+	uint32_t weekday;
+	uint32_t time;
+	uint32_t date;
+	bool synced;
+
+	civil_from_days(days, &year, &month, &day);
+	weekday = ((days + 3) % 7) + 1;			// 1 is Monday, 1970-01-01 was a Thursday
+
+	time = (to_bcd(secs / SEC_IN_HOUR) << RTC_TR_HU_Pos)
+		 | (to_bcd((secs % SEC_IN_HOUR) / SEC_IN_MIN) << RTC_TR_MNU_Pos)
+		 | (to_bcd(secs % SEC_IN_MIN) << RTC_TR_SU_Pos);
+
+	date = (to_bcd(year - 2000) << RTC_DR_YU_Pos)
+		 | (weekday << RTC_DR_WDU_Pos)
+		 | (to_bcd(month) << RTC_DR_MU_Pos)
+		 | (to_bcd(day) << RTC_DR_DU_Pos);
+
+	unlock_rtc();
+
+	// Writing 1 to the flags leaves them alone
+	RTC->ISR = 0xFFFFFFFF;
+	if (!wait_for_flag(RTC_ISR_INITF)) {
+		RTC->ISR = (uint32_t)~RTC_ISR_INIT;
+		lock_rtc();
+		return SYS_FAIL;
+	}
+
+	RTC->CR &= ~RTC_CR_FMT;
+	RTC->PRER = WALL_CLOCK_PREDIV_S;
+	RTC->PRER |= (WALL_CLOCK_PREDIV_A << RTC_PRER_PREDIV_A_Pos);
+	RTC->TR = time;
+	RTC->DR = date;
+
+	RTC->ISR = (uint32_t)~(RTC_ISR_INIT | RTC_ISR_RSF);
+	synced = wait_for_flag(RTC_ISR_RSF);
+
+	lock_rtc();
+
+	return synced ? SYS_SUCCESS : SYS_FAIL;
+ }
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		read_local_time()
+ *
+ * 		Returns the RTC calendar as local seconds since 1970-01-01. Reading
+ * 		the time register holds the date register until it is read, so the
+ * 		two agree.
+ *
+ ----------------------------------------------------------------------------*/
+ static uint32_t read_local_time() {
+	uint32_t time = RTC->TR;
+	uint32_t date = RTC->DR;
+	uint32_t days;
+
+	days = days_from_civil(2000 + from_bcd((date & (RTC_DR_YT | RTC_DR_YU)) >> RTC_DR_YU_Pos),
+						   from_bcd((date & (RTC_DR_MT | RTC_DR_MU)) >> RTC_DR_MU_Pos),
+						   from_bcd((date & (RTC_DR_DT | RTC_DR_DU)) >> RTC_DR_DU_Pos));
+
+	return days * SEC_IN_DAY
+		 + from_bcd((time & (RTC_TR_HT | RTC_TR_HU)) >> RTC_TR_HU_Pos) * SEC_IN_HOUR
+		 + from_bcd((time & (RTC_TR_MNT | RTC_TR_MNU)) >> RTC_TR_MNU_Pos) * SEC_IN_MIN
+		 + from_bcd((time & (RTC_TR_ST | RTC_TR_SU)) >> RTC_TR_SU_Pos);
+ }
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		wait_for_flag()
+ *
+ * 		Waits for an RTC_ISR flag to be set. Returns false if it is not set
+ * 		within WALL_CLOCK_RTC_TIMEOUT_MS.
+ *
+ ----------------------------------------------------------------------------*/
+ static bool wait_for_flag(uint32_t flag) {
+	uint32_t startTick = HAL_GetTick();
+
+	while ((RTC->ISR & flag) == 0) {
+		if ((HAL_GetTick() - startTick) > WALL_CLOCK_RTC_TIMEOUT_MS) {
+			return false;
+		}
+	}
+
+	return true;
+ }
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		unlock_rtc(), lock_rtc()
+ *
+ * 		The RTC registers are write protected, apart from the flags.
+ *
+ ----------------------------------------------------------------------------*/
+ static void unlock_rtc() {
+	RTC->WPR = 0xCA;
+	RTC->WPR = 0x53;
+ }
+
+ static void lock_rtc() {
+	RTC->WPR = 0xFF;
+ }
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		days_from_civil(), civil_from_days()
+ *
+ * 		Converts between a date and days since 1970-01-01, in the proleptic
+ * 		Gregorian calendar. The year is counted from March, so the leap day
+ * 		is the last day of the year.
+ *
+ ----------------------------------------------------------------------------*/
+ static uint32_t days_from_civil(uint32_t year, uint32_t month, uint32_t day) {
+	uint32_t era, yearOfEra, dayOfYear, dayOfEra;
+
+	year -= (month <= 2);
+	era = year / 400;
+	yearOfEra = year - era * 400;
+	dayOfYear = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+	dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+
+	return era * 146097 + dayOfEra - 719468;
+ }
+
+ static void civil_from_days(uint32_t days, uint32_t *year, uint32_t *month, uint32_t *day) {
+	uint32_t era, yearOfEra, dayOfYear, dayOfEra, monthFromMarch;
+
+	days += 719468;
+	era = days / 146097;
+	dayOfEra = days - era * 146097;
+	yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+	dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+	monthFromMarch = (5 * dayOfYear + 2) / 153;
+
+	*day = dayOfYear - (153 * monthFromMarch + 2) / 5 + 1;
+	*month = (monthFromMarch < 10) ? monthFromMarch + 3 : monthFromMarch - 9;
+	*year = yearOfEra + era * 400 + (*month <= 2);
+ }
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		to_bcd(), from_bcd()
+ *
+ ----------------------------------------------------------------------------*/
+ static uint32_t to_bcd(uint32_t value) {
+	return ((value / 10) << 4) | (value % 10);
+ }
+
+ static uint32_t from_bcd(uint32_t bcd) {
+	return (bcd >> 4) * 10 + (bcd & 0x0F);
+ }
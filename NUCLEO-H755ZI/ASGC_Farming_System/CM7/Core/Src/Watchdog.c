@@ -0,0 +1,231 @@
+/*-----------------------------------------------------------------------------
+ *
+ * 	Watchdog.c
+ *
+ * 		Independent watchdog of the CM7 and the breadcrumb that survives its
+ * 		reset, see Watchdog.h.
+ *
+ *  Created on: Oct 16, 2026
+ *
+-----------------------------------------------------------------------------*/
+
+#include "Watchdog.h"
+#include "Scheduler.h"
+#include "timer.h"
+
+/*-----------------------------------------------------------------------------
+DEFINES
+-----------------------------------------------------------------------------*/
+#define WATCHDOG_KEY_RELOAD						0xAAAA
+#define WATCHDOG_KEY_UNLOCK						0x5555
+#define WATCHDOG_KEY_START						0xCCCC
+
+#define WATCHDOG_BREADCRUMB_MAGIC				0x57444F47
+						/* RAM holds random data after a power on	 */
+
+/*-----------------------------------------------------------------------------
+TYPEDEFS
+-----------------------------------------------------------------------------*/
+typedef struct Watchdog_Breadcrumb {
+	uint32_t magic;
+	Watchdog_Cause_t cause;
+	Scheduler_Task_ID_t task_id;
+	uint32_t budget_ms;
+	uint64_t since_timestamp;			/* Task start, or when it was due	 */
+	uint64_t last_feed_timestamp;		/* The reset is WATCHDOG_TIMEOUT_MS	 */
+										/* after this						 */
+}Watchdog_Breadcrumb_t;
+
+/*-----------------------------------------------------------------------------
+STATIC VARIABLES
+-----------------------------------------------------------------------------*/
+
+// Not cleared by the startup code, so it survives the watchdog reset
+static Watchdog_Breadcrumb_t Breadcrumb __attribute__((section(".noinit")));
+
+static Watchdog_Reset_Info_t Reset_Info;
+static bool Reset_Info_Pending;				/* Last reset was the watchdog,	 */
+											/* not yet reported				 */
+static bool Started;
+static uint32_t Max_Feed_Gap_ms;
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		Watchdog_Init()
+ *
+ * 		Reads the breadcrumb left before a watchdog reset, then clears it and
+ * 		the reset flags. Call before anything that could set the breadcrumb.
+ * 		The watchdog itself is only started by Watchdog_Start(), once the
+ * 		slow device initialization is done.
+ *
+ ----------------------------------------------------------------------------*/
+ void Watchdog_Init() {
+	uint64_t resetTime;
+
+	Reset_Info_Pending = false;
+	Started = false;
+	Max_Feed_Gap_ms = 0;
+
+	if (RCC->RSR & RCC_RSR_IWDG1RSTF) {
+		Reset_Info.cause = WATCHDOG_CAUSE_UNKNOWN;
+		Reset_Info.task_id = SCHEDULER_NO_TASK;
+		Reset_Info.task_elapsed_ms = 0;
+		Reset_Info.task_budget_ms = 0;
+
+		if (Breadcrumb.magic == WATCHDOG_BREADCRUMB_MAGIC && Breadcrumb.cause != WATCHDOG_CAUSE_NONE) {
+			// The reset came one timeout after the last feed
+			resetTime = Breadcrumb.last_feed_timestamp + WATCHDOG_TIMEOUT_MS;
+
+			Reset_Info.cause = Breadcrumb.cause;
+			Reset_Info.task_id = Breadcrumb.task_id;
+			Reset_Info.task_budget_ms = Breadcrumb.budget_ms;
+			if (resetTime > Breadcrumb.since_timestamp) {
+				Reset_Info.task_elapsed_ms = (uint32_t)(resetTime - Breadcrumb.since_timestamp);
+			}
+		}
+
+		Reset_Info_Pending = true;
+	}
+
+	RCC->RSR |= RCC_RSR_RMVF;
+
+	Breadcrumb.magic = WATCHDOG_BREADCRUMB_MAGIC;
+	Breadcrumb.last_feed_timestamp = 0;
+	Watchdog_Clear_Breadcrumb();
+ }
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		Watchdog_Start()
+ *
+ * 		Starts IWDG1 with a timeout of WATCHDOG_TIMEOUT_MS. It can not be
+ * 		stopped again. Debug builds freeze it while the core is halted by the
+ * 		debugger.
+ *
+ ----------------------------------------------------------------------------*/
+ void Watchdog_Start() {
+#ifdef DEBUG
+	DBGMCU->APB4FZ1 |= DBGMCU_APB4FZ1_DBG_IWDG1;
+#endif
+
+	IWDG1->KR = WATCHDOG_KEY_START;
+	IWDG1->KR = WATCHDOG_KEY_UNLOCK;
+	IWDG1->PR = WATCHDOG_PRESCALER_REG;
+	IWDG1->RLR = WATCHDOG_RELOAD;
+
+	// The new values take a few LSI cycles to reach the watchdog
+	while (IWDG1->SR != 0) {
+	}
+
+	IWDG1->KR = WATCHDOG_KEY_RELOAD;
+
+	Breadcrumb.last_feed_timestamp = getTimestamp();
+	Started = true;
+ }
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		Watchdog_Feed()
+ *
+ * 		Reloads the watchdog, and records the longest time between two feeds
+ * 		to show how close the system came to a reset.
+ *
+ ----------------------------------------------------------------------------*/
+ void Watchdog_Feed() {
+	uint64_t curTime;
+	uint32_t gapMs;
+
+	if (!Started) {
+		return;
+	}
+
+	IWDG1->KR = WATCHDOG_KEY_RELOAD;
+
+	curTime = getTimestamp();
+	gapMs = (uint32_t)(curTime - Breadcrumb.last_feed_timestamp);
+	if (gapMs > Max_Feed_Gap_ms) {
+		Max_Feed_Gap_ms = gapMs;
+	}
+
+	Breadcrumb.last_feed_timestamp = curTime;
+ }
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		Watchdog_Set_Breadcrumb()
+ *
+ * 		Records the task that will be blamed if the watchdog resets the
+ * 		board. since_timestamp is when the task started, or when it was due
+ * 		for a task that is late.
+ *
+ ----------------------------------------------------------------------------*/
+ void Watchdog_Set_Breadcrumb(Watchdog_Cause_t cause, Scheduler_Task_ID_t task_id, uint64_t since_timestamp, uint32_t budget_ms) {
+	Breadcrumb.task_id = task_id;
+	Breadcrumb.since_timestamp = since_timestamp;
+	Breadcrumb.budget_ms = budget_ms;
+	Breadcrumb.cause = cause;
+ }
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		Watchdog_Clear_Breadcrumb()
+ *
+ * 		Clears the breadcrumb, a reset after this is reported as
+ * 		WATCHDOG_CAUSE_UNKNOWN.
+ *
+ ----------------------------------------------------------------------------*/
+ void Watchdog_Clear_Breadcrumb() {
+	Breadcrumb.cause = WATCHDOG_CAUSE_NONE;
+	Breadcrumb.task_id = SCHEDULER_NO_TASK;
+	Breadcrumb.since_timestamp = 0;
+	Breadcrumb.budget_ms = 0;
+ }
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		Watchdog_Get_Reset_Info()
+ *
+ * 		Copies what the breadcrumb said into 'info' if the last reset was
+ * 		caused by the watchdog and has not been reported yet, see
+ * 		Watchdog_Clear_Reset_Info(). Returns false otherwise.
+ *
+ ----------------------------------------------------------------------------*/
+ bool Watchdog_Get_Reset_Info(Watchdog_Reset_Info_t *info) {
+	if (!Reset_Info_Pending || info == NULL) {
+		return false;
+	}
+
+	*info = Reset_Info;
+
+	return true;
+ }
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		Watchdog_Clear_Reset_Info()
+ *
+ * 		Marks the last watchdog reset as reported.
+ *
+ ----------------------------------------------------------------------------*/
+ void Watchdog_Clear_Reset_Info() {
+	Reset_Info_Pending = false;
+ }
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		Watchdog_Get_Max_Feed_Gap_ms()
+ *
+ * 		Returns the longest time between two feeds since the watchdog was
+ * 		started. The board resets when it reaches WATCHDOG_TIMEOUT_MS.
+ *
+ ----------------------------------------------------------------------------*/
+ uint32_t Watchdog_Get_Max_Feed_Gap_ms() {
+	return Max_Feed_Gap_ms;
+ }
@@ -0,0 +1,233 @@
+/*-----------------------------------------------------------------------------
+ *
+ * 	Work_Queue.c
+ *
+ * 		Deferred work queue, see Work_Queue.h.
+ *
+ * 		Each queue is a ring of slots with a sequence number per slot. A
+ * 		producer claims the slot at the tail by moving the tail forward with
+ * 		LDREX/STREX, which fails and retries if an interrupt posted in
+ * 		between, then fills the slot and publishes it by setting its
+ * 		sequence. The consumer only takes a slot once it is published.
+ *
+ *  Created on: Oct 16, 2026
+ *
+-----------------------------------------------------------------------------*/
+
+#include "Work_Queue.h"
+
+/*-----------------------------------------------------------------------------
+DEFINES
+-----------------------------------------------------------------------------*/
+#define WORK_QUEUE_INDEX_MASK					(WORK_QUEUE_LENGTH - 1)
+
+/*-----------------------------------------------------------------------------
+TYPEDEFS
+-----------------------------------------------------------------------------*/
+
+// A slot is free for the producer claiming position 'pos' when its
+// sequence is pos, and holds work for the consumer at 'pos' when it is
+// pos + 1
+typedef struct Work_Queue_Item {
+	volatile uint32_t sequence;
+	Work_Queue_Function_t function;
+	uint32_t argument;
+}Work_Queue_Item_t;
+
+typedef struct Work_Queue_Ring {
+	Work_Queue_Item_t items[WORK_QUEUE_LENGTH];
+	volatile uint32_t tail;				/* Next position to claim, producers */
+	uint32_t head;						/* Next position to run, consumer	 */
+}Work_Queue_Ring_t;
+
+/*-----------------------------------------------------------------------------
+STATIC VARIABLES
+-----------------------------------------------------------------------------*/
+static Work_Queue_Ring_t Rings[WORK_QUEUE_NUM_PRIORITIES];
+static volatile uint32_t Dropped_Count;		/* Work lost to a full queue	 */
+
+/*-----------------------------------------------------------------------------
+STATIC FUNCTION DECLARATIONS
+-----------------------------------------------------------------------------*/
+static bool run_one(Work_Queue_Ring_t *ring);
+static bool ring_is_empty(const Work_Queue_Ring_t *ring);
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		Work_Queue_Init()
+ *
+ * 		Empties every queue. Must be called before the interrupts that post
+ * 		work are enabled, i.e. before MX_GPIO_Init().
+ *
+ ----------------------------------------------------------------------------*/
+ void Work_Queue_Init() {
+	Work_Queue_Priority_t p;
+	uint32_t i;
+
+	for (p = 0; p < WORK_QUEUE_NUM_PRIORITIES; p++) {
+		for (i = 0; i < WORK_QUEUE_LENGTH; i++) {
+			Rings[p].items[i].sequence = i;
+			Rings[p].items[i].function = NULL;
+			Rings[p].items[i].argument = 0;
+		}
+
+		Rings[p].tail = 0;
+		Rings[p].head = 0;
+	}
+
+	Dropped_Count = 0;
+ }
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		Work_Queue_Post()
+ *
+ * 		Queues function(argument) to run from the main loop. Safe to call from
+ * 		any interrupt. Returns false, and counts the work as dropped, if the
+ * 		queue of that priority is full.
+ *
+ ----------------------------------------------------------------------------*/
+ bool Work_Queue_Post(Work_Queue_Priority_t priority, Work_Queue_Function_t function, uint32_t argument) {
+	Work_Queue_Ring_t *ring;
+	Work_Queue_Item_t *item;
+	uint32_t pos;
+
+	if (priority >= WORK_QUEUE_NUM_PRIORITIES || function == NULL) {
+		return false;
+	}
+
+	ring = &Rings[priority];
+
+	// Claim the slot at the tail. The store fails if an interrupt came in
+	// since the load, as that interrupt may have claimed the same slot.
+	do {
+		pos = __LDREXW(&ring->tail);
+		item = &ring->items[pos & WORK_QUEUE_INDEX_MASK];
+
+		// The consumer has not run the work from the last lap yet
+		if (item->sequence != pos) {
+			__CLREX();
+			Dropped_Count++;
+			return false;
+		}
+	} while (__STREXW(pos + 1, &ring->tail) != 0);
+
+	item->function = function;
+	item->argument = argument;
+
+	// Publish the slot only once it is filled
+	__DMB();
+	item->sequence = pos + 1;
+
+	return true;
+ }
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		Work_Queue_Run()
+ *
+ * 		Runs all posted work, urgent work first. Urgent work posted while
+ * 		normal work is running goes next. Returns the number of items run.
+ * 		Must only be called from the main loop.
+ *
+ ----------------------------------------------------------------------------*/
+ uint32_t Work_Queue_Run() {
+	uint32_t count = 0;
+
+	for (;;) {
+		if (run_one(&Rings[WORK_QUEUE_PRIORITY_URGENT])) {
+			count++;
+		}
+		else if (run_one(&Rings[WORK_QUEUE_PRIORITY_NORMAL])) {
+			count++;
+		}
+		else {
+			return count;
+		}
+	}
+ }
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		Work_Queue_Is_Empty()
+ *
+ * 		Returns true if there is no work for Work_Queue_Run(). The idle code
+ * 		checks this with interrupts masked, so work posted just before the
+ * 		core goes to sleep is not left waiting for the whole sleep.
+ *
+ ----------------------------------------------------------------------------*/
+ bool Work_Queue_Is_Empty() {
+	Work_Queue_Priority_t p;
+
+	for (p = 0; p < WORK_QUEUE_NUM_PRIORITIES; p++) {
+		if (!ring_is_empty(&Rings[p])) {
+			return false;
+		}
+	}
+
+	return true;
+ }
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		Work_Queue_Get_Dropped_Count()
+ *
+ * 		Returns the number of posts that were lost because their queue was
+ * 		full.
+ *
+ ----------------------------------------------------------------------------*/
+ uint32_t Work_Queue_Get_Dropped_Count() {
+	return Dropped_Count;
+ }
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		run_one()
+ *
+ * 		Takes the oldest published item from a queue, frees its slot and runs
+ * 		it. Returns false if there is none. A slot that is claimed but not
+ * 		filled yet stops the queue until its producer is done.
+ *
+ ----------------------------------------------------------------------------*/
+ static bool run_one(Work_Queue_Ring_t *ring) {
+	Work_Queue_Item_t *item;
+	Work_Queue_Function_t function;
+	uint32_t argument;
+
+	if (ring_is_empty(ring)) {
+		return false;
+	}
+
+	item = &ring->items[ring->head & WORK_QUEUE_INDEX_MASK];
+
+	__DMB();
+	function = item->function;
+	argument = item->argument;
+	__DMB();
+
+	// Free the slot for the producer one lap later, before running the
+	// work, so the work can post again
+	item->sequence = ring->head + WORK_QUEUE_LENGTH;
+	ring->head++;
+
+	function(argument);
+
+	return true;
+ }
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		ring_is_empty()
+ *
+ * 		Returns true if the slot at the head of a queue is not published.
+ *
+ ----------------------------------------------------------------------------*/
+ static bool ring_is_empty(const Work_Queue_Ring_t *ring) {
+	return (ring->items[ring->head & WORK_QUEUE_INDEX_MASK].sequence != ring->head + 1);
+ }
@@ -10,11 +10,23 @@
 -----------------------------------------------------------------------------*/
 
 #include "Buttons.h"
+#include "Work_Queue.h"
+#include "FSM.h"
+#include "gpio_switching_intf.h"
+#include "mixing_motor.h"
+#include "fan_pwm_intf.h"
 
 /*-----------------------------------------------------------------------------
 	Static Values
  ----------------------------------------------------------------------------*/
 
+/*-----------------------------------------------------------------------------
+	Static Function Declarations
+ ----------------------------------------------------------------------------*/
+static void start_button_work(uint32_t argument);
+static void estop_button_work(uint32_t argument);
+static void estop_stop_actuators();
+
 /*-----------------------------------------------------------------------------
  *
  * 		Buttons_Init()
@@ -51,7 +63,9 @@ bool Buttons_Init(bool *SYSTEM_START_STATE) {
  *
  * 		Buttons_start_button_intrpt()
  *
- * 		Start Button's interrupt. Handles
+ * 		Start Button's interrupt. Handles the start state, and posts the
+ * 		startup work (redrawing the display) to the main loop, as it is far
+ * 		too slow for an interrupt.
  *
  ----------------------------------------------------------------------------*/
 
@@ -70,7 +84,7 @@ SYS_RESULT Buttons_start_button_intrpt(bool * start_state) {
 	if (*start_state == SYSTEM_OFF) {
 
 		*start_state = SYSTEM_ON;
-		ASGC_System_Startup();
+		Work_Queue_Post(WORK_QUEUE_PRIORITY_NORMAL, start_button_work, 0);
 	}
 
 	if (*start_state == SYSTEM_ON) {
@@ -87,7 +101,10 @@ SYS_RESULT Buttons_start_button_intrpt(bool * start_state) {
  *
  * 		Buttons_estop_button_intrpt()
  *
- * 		E-Stop Button's interrupt function. Triggers entire system shutdown
+ * 		E-Stop Button's interrupt function. Switches the actuators off right
+ * 		away, then triggers the rest of the system shutdown (the FSM, the
+ * 		CNC stop, the display), which runs from the main loop as urgent work,
+ * 		ahead of anything else posted.
  *
  ----------------------------------------------------------------------------*/
 
@@ -108,8 +125,83 @@ SYS_RESULT Buttons_estop_button_intrpt(bool * estop_state, bool start_state) {
 	/* If transitioning from system state on to ESTOP on (estop pressed) 	 */
 	else if (*estop_state == SYSTEM_OFF) {
 		*estop_state = SYSTEM_ON;
-		ASGC_System_ESTOP();
+		estop_stop_actuators();
+		Work_Queue_Post(WORK_QUEUE_PRIORITY_URGENT, estop_button_work, 0);
 	}
 
 	return ret_val;
 }
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		Buttons_estop_is_released()
+ *
+ * 		Returns true if the E-stop button is released, i.e. both of its
+ * 		contacts read the opposite of a press: PC8 low and PC7 high. Always
+ * 		true if the E-stop button is switchboard disabled.
+ *
+ ----------------------------------------------------------------------------*/
+
+bool Buttons_estop_is_released() {
+
+	if (ESTOP_BUTTON_ENABLED == SYS_FEATURE_DISABLED) {
+		return true;
+	}
+
+	return ( HAL_GPIO_ReadPin(GPIOC, GPIO_PIN_8) == GPIO_PIN_RESET
+		  && HAL_GPIO_ReadPin(GPIOC, GPIO_PIN_7) == GPIO_PIN_SET );
+}
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		start_button_work()
+ *
+ * 		Work posted by the start button interrupt, run from the main loop.
+ * 		Clears the screen, then lets the FSM leave FSM_STATE_WAITING_ON_START.
+ *
+ ----------------------------------------------------------------------------*/
+
+static void start_button_work(uint32_t argument) {
+	(void)argument;
+
+	ASGC_System_Startup();
+	FSM_Post_Event(FSM_EVENT_START_PRESSED);
+}
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		estop_button_work()
+ *
+ * 		Work posted by the E-stop button interrupt, run from the main loop.
+ * 		The button is armed again once the FSM accepts a reset, see
+ * 		FSM_Check_EStop_Reset().
+ *
+ ----------------------------------------------------------------------------*/
+
+static void estop_button_work(uint32_t argument) {
+	(void)argument;
+
+	ASGC_System_ESTOP();
+}
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		estop_stop_actuators()
+ *
+ * 		Called from the E-stop interrupt. Closes the fill valve, and stops
+ * 		the circulating pump, the mixing motor and the fans. These are only
+ * 		GPIO and timer register writes, so they are safe in an interrupt and
+ * 		do not wait for the main loop. FSM_State_ESTOP_PRESSED_SAF() does
+ * 		the same again, along with the slow parts.
+ *
+ ----------------------------------------------------------------------------*/
+
+static void estop_stop_actuators() {
+
+	GPIO_set_fill_valve(VALVE_CLOSED);
+	GPIO_set_circulating_pump(PUMP_OFF);
+	mixing_motor_stop();
+
+	// Fans will still spin at a minimum RPM at 0%
+	FAN_pwm_intf_set_duty(FAN_PWM_INTF_0_PCT_DUTY);
+}
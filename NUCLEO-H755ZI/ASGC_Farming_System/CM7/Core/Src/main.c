@@ -38,7 +38,14 @@
 #include "vl53l1_api.h"
 #include "FSM.h"
 #include "Scheduler.h"
+#include "Data_Bus.h"
+#include "Watchdog.h"
+#include "Work_Queue.h"
 #include "VL53L1X_prj.h"
+#include "Reservoir.h"
+#include "Checkpoint.h"
+#include "Wall_Clock.h"
+#include "Timer_Wheel.h"
 #include "RPI_UART.h"
 
 /* USER CODE END Includes */
@@ -93,17 +100,9 @@ VL53L1_RangingMeasurementData_t RangingData;
 VL53L1_Dev_t  vl53l1_c; // center module
 VL53L1_DEV    Dev = &vl53l1_c;
 
-// AHT20 Temperature and Humidity Data
-struct AHT20_Data AHT20_data;
-
-// SEN0169 pH Data
-SEN0169_pH_Data pH_Data;
-
-// SEN0244 TDS Data
-SEN0244_TDS_Data tdsData;
-
-// AS7341 Spectral Sensor Data
-uint16_t AS7341_Values[12];
+// Tasks whose circuit breaker changed since the last device status report
+static uint32_t changedDeviceMask = 0;
+static bool deviceReportPosted = false;
 
 /*-----------------------------------------------------------------------------
 FUNCTION PROTOTYPES
@@ -125,7 +124,7 @@ static void MX_SPI1_Init(void);
 static void MX_UART7_Init(void);
 static void MX_TIM5_Init(void);
 /* USER CODE BEGIN PFP */
-
+static void Report_Device_Status(uint32_t argument);
 /* USER CODE END PFP */
 
 /* Private user code ---------------------------------------------------------*/
@@ -144,6 +143,9 @@ int main(void)
 {
 
   /* USER CODE BEGIN 1 */
+  uint32_t idleMs;
+  uint32_t fsmIdleMs;
+  uint32_t timerIdleMs;
 
   SYSTEM_START_STATE = SYSTEM_OFF;
   SYSTEM_ESTOP_STATE = SYSTEM_OFF;
@@ -195,6 +197,11 @@ Error_Handler();
 /* USER CODE END Boot_Mode_Sequence_2 */
 
   /* USER CODE BEGIN SysInit */
+
+  // The button interrupts post to the work queue as soon as MX_GPIO_Init()
+  // enables them
+  Work_Queue_Init();
+
   /*---------------------------------------------------------------------------
   PERIPHERAL INITIALIZATION
   ---------------------------------------------------------------------------*/
@@ -214,11 +221,24 @@ Error_Handler();
   MX_TIM5_Init();
   /* USER CODE BEGIN 2 */
 
+  // Start the timebase first, everything below timestamps with getTimestamp()
+  ASGC_Timer_Init();
+  Timer_Wheel_Init();
+
+  // Read what the watchdog breadcrumb says, before the scheduler overwrites it
+  Watchdog_Init();
+
+  /*---------------------------------------------------------------------------
+  SCHEDULER INITIALIZATION - The device drivers register their tasks with the
+  scheduler when they are initialized, so it has to be initialized first
+  ---------------------------------------------------------------------------*/
+  Scheduler_Init();
+  Data_Bus_Init();
+
   /*---------------------------------------------------------------------------
   DEVICE DRIVER INITIALIZATION
   ---------------------------------------------------------------------------*/
   Buttons_Init(&SYSTEM_START_STATE);
-  ASGC_Timer_Init();
   FAN_pwm_intf_Init(htim3);
   // PWM_VerticalServo_Init(htim); // add timer reference here
   // PWM_ShutterServo_Init(htim);  // add timer reference here
@@ -230,7 +250,12 @@ Error_Handler();
   GPIO_switching_intf_Init();
   Adafruit_AS7341_begin(AS7341_I2CADDR_DEFAULT, &hi2c1, 0);
   VL53L1X_prj_Init(Dev, &hi2c1);
+  Reservoir_Init();
   ILI9341_Init();
+  RPI_UART_Init();
+
+  // Gate I2C1 between the windows in which its tasks are batched
+  Scheduler_Set_Bus_Hooks(SCHEDULER_BUS_I2C1, I2C1_Bus_Open, I2C1_Bus_Close);
 
   if (CNC_Init() == SYS_SUCCESS) {
 
@@ -242,8 +267,15 @@ Error_Handler();
   /*---------------------------------------------------------------------------
   INITIALIZE ALL HIGH-LEVEL MODULES
   ---------------------------------------------------------------------------*/
-  FSM_Init();
-  Scheduler_Init();
+
+  // Read the checkpoint the FSM resumes from, and the date it is from
+  Checkpoint_Init();
+  Wall_Clock_Init();
+
+  if (FSM_Init() != SYS_SUCCESS) {
+    // The FSM transition table is broken
+    Error_Handler();
+  }
   
   // Set screen orientation and background
   ILI9341_Set_Rotation(SCREEN_HORIZONTAL_2);
@@ -255,6 +287,10 @@ Error_Handler();
 
   HAL_Delay(100);
 
+  // The device initialization above can block for seconds (AHT20 timeout),
+  // so the watchdog is only started once it is done
+  Watchdog_Start();
+
   /* USER CODE END 2 */
 
   /* Infinite loop */
@@ -268,6 +304,12 @@ Error_Handler();
     // Update global timestamp
   globalTimestamp = getTimestamp();
 
+    // Run the work the button interrupts deferred to the main loop
+	Work_Queue_Run();
+
+    // Run the callbacks of the software timers that are due
+	Timer_Wheel_Update();
+
     // Update the FSM state
 	FSM_Update();
     // Run the scheduler update every loop iteration
@@ -286,7 +328,24 @@ Error_Handler();
 //    GPIO_set_ph_up_valve(VALVE_CLOSED);
 //    HAL_Delay(3000);
 
-    mixing_motor_handle_state();
+    // Sleep until the next scheduler task, software timer or FSM update is
+    // due, or until an interrupt (buttons, UART) wakes the core.
+    idleMs = Scheduler_Get_Ms_Until_Next_Task();
+    fsmIdleMs = FSM_Get_Ms_Until_Next_Update();
+    timerIdleMs = Timer_Wheel_Get_Ms_Until_Next();
+
+    if (fsmIdleMs < idleMs) {
+    	idleMs = fsmIdleMs;
+    }
+    if (timerIdleMs < idleMs) {
+    	idleMs = timerIdleMs;
+    }
+    if (idleMs > WATCHDOG_MAX_IDLE_MS) {
+    	idleMs = WATCHDOG_MAX_IDLE_MS;
+    }
+    if (idleMs > 0) {
+    	ASGC_Timer_Idle(idleMs);
+    }
 
   }
   /* USER CODE END 3 */
@@ -1041,7 +1100,8 @@ static void MX_GPIO_Init(void)
  *
  * 	HAL_GPIO_EXTI_Callback
  *
- * 		Interrupt Callback function for GPIO Interrupts
+ * 		Interrupt Callback function for GPIO Interrupts. The button handlers
+ * 		only update the system state and post the rest to the work queue.
  *
 ------------------------------------------------------------------------------*/
 void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin)
@@ -1082,293 +1142,50 @@ void ASGC_System_Startup() {
  * 	ASGC_System_ESTOP
  *
  * 		Function called to stop all movement and pacify the system when the
- * 		estop button is pressed. Function will need to be expanded as
- * 		functionality is implemented.
+ * 		estop button is pressed. The FSM stops the actuators in
+ *    FSM_STATE_ESTOP_PRESSED, and keeps the Raspberry Pi link and the display
+ *    running until the E-stop is reset from the Raspberry Pi.
  *
 ------------------------------------------------------------------------------*/
 void ASGC_System_ESTOP() {
-
-	// Disable all tasks
-	for (Scheduler_Task_ID_t i = 0; i < NUM_SCHEDULER_TASKS; i++) {
-		Scheduler_Disable_Task(i);
-	}
-
-	//Send stop movement command over USB
-
-	//Stop the mixing motor
-
-	//Close all valves and stop all pumps
-
-	//Set fans to 0 duty cycle (Will not fully stop fans, these fans will still
-  //still spin at a minimum RPM at 0%)
-  FAN_pwm_intf_set_duty(FAN_PWM_INTF_0_PCT_DUTY);
-
-	//Send information to display indicating ESTOP Press
-
-	//Send information to Raspberry Pi indicating ESTOP Press
-  ILI9341_Fill_Screen(BLACK);
-  Display_EStopScreen();
-	//Stop USB Host Traffic
-
-	//Shut down any analog traffic (EC/pH sensors)
-
-	//Stop I2C Traffic
-  HAL_I2C_DeInit(&hi2c1);
-
-  //(Potentially) Deregister interrupts?
-
-  // Disable interrupts
-  __disable_irq();
-  // Locked in loop until power cycle
-  while(1) {
-    //May need to send data to the display here
-  }
-
+  FSM_EStop();
 }
 
 /*------------------------------------------------------------------------------
  *
- * 	uint8_t ASGC_System_DispenseSeeds(float holeX, float holeY)
+ * 	I2C1_Bus_Open
  *
- *    This function is a helper function which will:
- *      Move the gantry to the specified position (using G-Code)
- *      Poll for confirmation that gantry is at the hole
- *      Send PWM Signal to open the seed dispenser shutter
- *      Confirm the shutter has opened, then Wait for seeds to dispense
- *      Send PWM Signal to close seed dispenser shutter
- *      Confirm the shutter has closed, then Wait for 2 seconds
- * 
- *    This function has the following return codes:
- *        0 = Success
- *        1 = Gantry failed to reach position
- *        2 = Shutter failed to open/close
- *        3 = X/Y Position is invalid
- *        4 = Helper function is busy/working
+ * 		Called by the scheduler before the first task of an I2C1 window
+ *    (AHT20, AS7341, and the VL53L1X while the reservoir fills). Turns the
+ *    I2C1 clock back on and wakes the AS7341 up.
  *
 ------------------------------------------------------------------------------*/
-uint8_t DispenseSeeds_HelperFunc(float holeX, float holeY) {
-
-/*  // Enum for different states
-  typedef enum {
-    COMPLETE = 0,
-    MOVING_TO_HOLE,
-    OPENING_SHUTTER,
-    CLOSING_SHUTTER,
-    BUSY_WAITING
-  } DISPENSING_STATE;
-
-  // Initialize static vars
-  static uint64_t referenceTimestamp = 0;
-  static DISPENSING_STATE functionState = MOVING_TO_HOLE;
-  static DISPENSING_STATE previousState = BUSY_WAITING;
-
-  switch (functionState) {
-    case MOVING_TO_HOLE:
-      // Check X/Y position is within bounds -- if not, return XY error code
-      if (holeX < CNC_MIN_X_POS_MM || holeX > CNC_MAX_X_POS_MM
-          || holeY < CNC_MIN_Y_POS_MM || holeY > CNC_MAX_Y_POS_MM) {
-        return DISPENSE_FAIL_XY_POS;
-      }
-
-      // Update state machine variables
-      functionState = BUSY_WAITING;
-      previousState = MOVING_TO_HOLE;
-      // referenceTimestamp = getTimestamp(); // wait until Timer.h is included to update timestamp with current time
-
-      // Perform associated function (move to hole)
-      CNC_Move_To_Pos(holeX, holeY);
-      break;
-
-    case OPENING_SHUTTER:
-      // Update state machine variables
-      functionState = BUSY_WAITING;
-      previousState = OPENING_SHUTTER;
-      // referenceTimestamp = getTimestamp(); // wait until Timer.h is included to update timestamp with current time
-
-      // Perform associated function (open shutter)
-      // open_shutter();
-      break;
-
-    case CLOSING_SHUTTER:
-      // Update state machine variables
-      functionState = BUSY_WAITING;
-      previousState = OPENING_SHUTTER;
-      // referenceTimestamp = getTimestamp(); // wait until Timer.h is included to use getTimestamp()
-
-      // Perform associated function (close shutter)
-      // close_shutter();
-      break;
-
-    case BUSY_WAITING:
-
-      // Use our previous state to determine our logic in waiting
-      switch (previousState) {
-        case MOVING_TO_HOLE:
-          // After we've given some time to move, confirm gantry is at hole
-          // if (getTimestamp() - referenceTimestamp > DISPENSE_MOVING_MS) { // wait until Timer.h is included to use getTimestamp()
-
-          // Check if gantry is in position
-          //   if (GantryInPosition)
-          //    functionState = OPENING_SHUTTER;
-          //    previousState = BUSY_WAITING;
-          //    return DISPENSE_BUSY;
-
-          // If gantry is not in position, return gantry fail code
-          //   functionState = MOVING_TO_HOLE;
-          //   previousState = BUSY_WAITING;
-          //   referenceTimestamp = 0;
-          //   return DISPENSE_FAIL_GANTRY;
-          // }
-          break;
-
-        case OPENING_SHUTTER:
-          // Confirm shutter is open and that seeds have had time to dispense (0.5s)
-          // if (ShutterIsOpen && seedsHadTimeToDisperse)
-          //  functionState = CLOSING_SHUTTER;
-          //  previousState = BUSY_WAITING;
-          //  return DISPENSE_BUSY;
-
-          // If the shutter doesn't open after 2 seconds, return shutter fail code
-          // if (getTimestamp() - referenceTimestamp > 2000) { // wait until Timer.h is included to use getTimestamp()
-          //   functionState = MOVING_TO_HOLE;
-          //   previousState = BUSY_WAITING;
-          //   referenceTimestamp = 0;
-          //   return DISPENSE_FAIL_SHUTTER;
-          // }
-          break;
-
-        case CLOSING_SHUTTER:
-          // Confirm shutter is closed
-          // if (ShutterIsClosed)
-          //  functionState = MOVING_TO_HOLE;
-          //  previousState = BUSY_WAITING;
-          //  referenceTimestamp = 0;
-          //  return COMPLETE;
-
-          // If the shutter doesn't open after 2 seconds, return shutter fail code
-          // if (getTimestamp() - referenceTimestamp > 2000) { // wait until Timer.h is included to use getTimestamp()
-          //   functionState = MOVING_TO_HOLE;
-          //   previousState = BUSY_WAITING;
-          //   referenceTimestamp = 0;
-          //   return DISPENSE_FAIL_SHUTTER;
-          // }
-          break;
-
-        // This should never execute, but just incase, reset our FSM
-        default:
-          functionState = MOVING_TO_HOLE;
-          previousState = BUSY_WAITING;
-          referenceTimestamp = 0;
-          return DISPENSE_UNKNOWN_FAIL;
-      }
-
-      return DISPENSE_BUSY;
-      break;
-
-    // This should never execute, but just incase, reset our FSM
-    default:
-      functionState = MOVING_TO_HOLE;
-      previousState = BUSY_WAITING;
-      referenceTimestamp = 0;
-      return DISPENSE_UNKNOWN_FAIL;
-  }
-
-  // Return as busy if we break out of switch statement
-  return DISPENSE_BUSY;
-  */
- return DISPENSE_SUCCESS;
+void I2C1_Bus_Open() {
+  __HAL_RCC_I2C1_CLK_ENABLE();
+
+  if (AS7341_ENABLED == SYS_FEATURE_ENABLED
+  && Scheduler_Get_Task_Breaker_State(AS7341_Get_Data_Task_ID) == SCHEDULER_BREAKER_CLOSED) {
+    Adafruit_AS7341_powerEnable(true);
+  }
 }
 
 /*------------------------------------------------------------------------------
  *
- * 	uint16_t ASGC_System_DispenseSeeds()
+ * 	I2C1_Bus_Close
  *
- * 		Function called to dispense seeds over the course of several minutes
- *    This function is non-blocking and designed to be called repeatedly
- * 
- *    This function returns the number of seeds that FAILED to dispense
- *      (so ideally, this function returns 0)
- * 
- *    If this function returns a value less than or equal to the number of seeds
- *    in the system, then it's caller knows it is finished dispensing
- * 
- *    Otherwise, if this function returns a value greater than the number of seeds
- *    in the system, then it's caller knows it is still working (SYSTEM_BUSY)
+ * 		Called by the scheduler once no I2C1 task is due within
+ *    SCHEDULER_BUS_BATCH_WINDOW_MS. Puts the AS7341 to sleep and gates the
+ *    I2C1 clock until the next window. The AHT20 goes to sleep by itself
+ *    after each measurement.
  *
 ------------------------------------------------------------------------------*/
-uint16_t ASGC_System_DispenseSeeds() {
-
-  static uint8_t channel = 0;
-  static uint8_t hole = 0;
-  static uint16_t failed_dispenses = 0;
-
-  /*  
-    Constant indicating the system is busy and has not yet finished dispensing
-    This value is guaranteed to be greater than the maximum number of seeds
-    in the system, so if this value is returned, the caller knows the system is working
-  */
-/*
-  const uint16_t SYSTEM_BUSY = CNC_NUM_NFT_CHANNELS * CNC_NUM_NET_POTS_PER_NFT_CHANNEL + 1;
-
-  // Check if the current hole is filled -- if so, skip it
-  if (!CNC_DATA.channel_holes[channel][hole].is_empty) {
-    // Move to next hole
-    hole++;
-    if (hole >= CNC_NUM_NET_POTS_PER_NFT_CHANNEL) {
-      hole = 0;
-      channel++;
-      if (channel >= CNC_NUM_NFT_CHANNELS) {
-
-        // If we've iterated through all channels and holes, reset all static values to 0
-        uint16_t returnValue = failed_dispenses;
-        channel = 0;
-        hole = 0;
-        failed_dispenses = 0;
-        return returnValue;
-      }
-    }
-
-    // Return as busy if we haven't iterated through all holes
-    return SYSTEM_BUSY;
+void I2C1_Bus_Close() {
+  if (AS7341_ENABLED == SYS_FEATURE_ENABLED
+  && Scheduler_Get_Task_Breaker_State(AS7341_Get_Data_Task_ID) == SCHEDULER_BREAKER_CLOSED) {
+    Adafruit_AS7341_powerEnable(false);
   }
 
-  // Attempt to dispense a seed at the current channel&hole location
-  uint8_t dispense_result = DispenseSeeds_HelperFunc(CNC_DATA.channel_holes[channel][hole].x_pos, CNC_DATA.channel_holes[channel][hole].y_pos);
-
-  // If we're busy-waiting (safely, non-blocking), keep the same channel/hole indexes and return early
-  if (dispense_result == DISPENSE_BUSY) {
-      return SYSTEM_BUSY;
-  }
-  
-  // If dispense failed for any reason other than busy, increment failed dispense counter
-  else if (dispense_result != DISPENSE_SUCCESS) {
-    failed_dispenses++;
-  }
-
-  // Update CNC Data so hole is not empty
-  else if (dispense_result == DISPENSE_SUCCESS) {
-    CNC_DATA.channel_holes[channel][hole].is_empty = 0;
-  }
-
-  // Move to next hole as dispense attempt was completed
-  hole++;
-  if (hole >= CNC_NUM_NET_POTS_PER_NFT_CHANNEL) {
-    hole = 0;
-    channel++;
-    if (channel >= CNC_NUM_NFT_CHANNELS) {
-
-      // If we've iterated through all channels and holes, reset all static values to 0
-      uint16_t returnValue = failed_dispenses;
-      channel = 0;
-      hole = 0;
-      failed_dispenses = 0;
-      return returnValue;
-    }
-  }
-
-  // Return as busy if we haven't iterated through all holes
-  return SYSTEM_BUSY; */
-  return SYS_SUCCESS;
+  __HAL_RCC_I2C1_CLK_DISABLE();
 }
 
 /*XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
@@ -1386,41 +1203,36 @@ XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX*/
  *
  * 	AHT20_Request_Measurement_TASK
  *
- * 		Scheduler task to request the AHT20 sensor to take a .
+ * 		Scheduler task to request the AHT20 sensor to take a measurement.
+ *    The scheduler triggers AHT20_Get_Data_TASK once the measurement is done.
  *    Tasks should do very little computation beyond calling functions.
  *    All task functions should return a SYS_RESULT value.
  *
 ------------------------------------------------------------------------------*/
 SYS_RESULT AHT20_Request_Measurement_TASK() {
-  SYS_RESULT ret_val;
-
-  ret_val = AHT20_Request_Measurement(&hi2c1);
-
-  if (ret_val == SYS_SUCCESS) {
-    // Measurement collection and calculation for AHT20 takes 80ms.
-    Scheduler_Schedule_Task_ms_From_Now(AHT20_GET_DATA_TASK, 80);
-  }
-
-  return ret_val;
+  return AHT20_Request_Measurement(&hi2c1);
 }
 
 /*------------------------------------------------------------------------------
  *
  * 	AHT20_Get_Data_TASK
  *
- * 		Scheduler task to get data from the AHT20 sensor.
+ * 		Scheduler task to get data from the AHT20 sensor. The reading is
+ *    published to the data bus.
  *    Tasks should do very little computation beyond calling functions.
  *    All task functions should return a SYS_RESULT value.
  *
 ------------------------------------------------------------------------------*/
 SYS_RESULT AHT20_Get_Data_TASK() {
-  AHT20_data = AHT20_Get_Data(&hi2c1);
+  Data_Bus_Value_t value;
 
-  // Send Data to Raspberry Pi
-  RPI_UART_Send_AHT20_Pkt(AHT20_data, 4);
-  // Send Data to Display
-  ILI9341_Update_Temperature(AHT20_data.temperature);
-  ILI9341_Update_Humidity(AHT20_data.humidity);
+  value.aht20 = AHT20_Get_Data(&hi2c1);
+
+  if (value.aht20.validity != SYS_SUCCESS) {
+    return value.aht20.validity;
+  }
+
+  Data_Bus_Publish(DATA_BUS_TOPIC_AHT20, &value);
 
   return SYS_SUCCESS;
 }
@@ -1436,13 +1248,16 @@ SYS_RESULT AHT20_Get_Data_TASK() {
  *
 ------------------------------------------------------------------------------*/
 SYS_RESULT SEN0169_Get_Data_TASK() {
-  SEN0169_Measure(&pH_Data);
+  Data_Bus_Value_t value;
+  SYS_RESULT ret_val;
 
-  // Send Data to Raspberry Pi
-  RPI_UART_Send_SEN0169_Pkt(pH_Data, 4);
+  ret_val = SEN0169_Measure(&value.pH);
 
-  // Send Data to Display
-  ILI9341_Update_WaterpH(pH_Data);
+  if (ret_val != SYS_SUCCESS) {
+    return ret_val;
+  }
+
+  Data_Bus_Publish(DATA_BUS_TOPIC_SEN0169, &value);
 
   return SYS_SUCCESS;
 }
@@ -1452,36 +1267,120 @@ SYS_RESULT SEN0169_Get_Data_TASK() {
  *
  * 	SEN0244_Get_Data_TASK
  *
- * 		Scheduler task to get TDS data from the SEN0244 sensor.
+ * 		Scheduler task to get TDS data from the SEN0244 sensor. Uses the latest
+ *    AHT20 temperature for compensation, or 25C if there is no recent one.
  *    Tasks should do very little computation beyond calling functions.
  *    All task functions should return a SYS_RESULT value.
  *
 ------------------------------------------------------------------------------*/
 SYS_RESULT SEN0244_Get_Data_TASK() {
-  SEN0244_Measure(&tdsData, AHT20_data.temperature);
+  Data_Bus_Sample_t aht20;
+  Data_Bus_Value_t value;
+  float temperature = SEN0244_DEFAULT_TEMPERATURE_C;
+  SYS_RESULT ret_val;
+
+  if ( Data_Bus_Read_Latest(DATA_BUS_TOPIC_AHT20, &aht20)
+    && getTimestamp() - aht20.timestamp <= SEN0244_TEMPERATURE_MAX_AGE_MS ) {
+    temperature = aht20.value.aht20.temperature;
+  }
+
+  ret_val = SEN0244_Measure(&value.tds, temperature);
 
-  // Send Data to Raspberry Pi
-  RPI_UART_Send_SEN0244_Pkt(tdsData, 4);
+  if (ret_val != SYS_SUCCESS) {
+    return ret_val;
+  }
 
-  // Send Data to Display
-  ILI9341_Update_WaterTDS(tdsData);
+  Data_Bus_Publish(DATA_BUS_TOPIC_SEN0244, &value);
 
   return SYS_SUCCESS;
 }
 
 
+/*------------------------------------------------------------------------------
+ *
+ * 	VL53L1X_Get_Data_TASK
+ *
+ * 		Scheduler task publishing the range to the reservoir water surface from
+ *    the VL53L1X, when it has a new one.
+ *
+------------------------------------------------------------------------------*/
+SYS_RESULT VL53L1X_Get_Data_TASK() {
+  Data_Bus_Value_t value;
+  bool newRange;
+  SYS_RESULT ret_val;
+
+  ret_val = VL53L1X_prj_Get_Range_mm(Dev, &value.vl53l1x_range_mm, &newRange);
+
+  if (ret_val != SYS_SUCCESS) {
+    return ret_val;
+  }
+
+  if (newRange) {
+    Data_Bus_Publish(DATA_BUS_TOPIC_VL53L1X, &value);
+  }
+
+  return SYS_SUCCESS;
+}
+
+
+/*------------------------------------------------------------------------------
+ *
+ * 	Reservoir_Check_Fill_TASK
+ *
+ * 		Scheduler task closing the fill valve once the reservoir is full, see
+ *    Reservoir_Check_Fill(). Enabled by Reservoir_Start_Fill().
+ *
+------------------------------------------------------------------------------*/
+SYS_RESULT Reservoir_Check_Fill_TASK() {
+  return Reservoir_Check_Fill();
+}
+
+
+/*------------------------------------------------------------------------------
+ *
+ * 	Checkpoint_Save_TASK
+ *
+ * 		Scheduler task saving the checkpoint, so the DLI and the state times
+ *    lost to a reset are at most CHECKPOINT_INTERVAL_MS old. Transitions and
+ *    dispensed holes save it on their own.
+ *
+------------------------------------------------------------------------------*/
+SYS_RESULT Checkpoint_Save_TASK() {
+  Checkpoint_Save();
+
+  return SYS_SUCCESS;
+}
+
+
+/*------------------------------------------------------------------------------
+ *
+ * 	FSM_Check_EStop_Reset_TASK
+ *
+ * 		Scheduler task asking the Raspberry Pi whether the E-stop has been
+ *    reset, see FSM_Check_EStop_Reset(). Enabled by FSM_STATE_ESTOP_PRESSED.
+ *
+------------------------------------------------------------------------------*/
+SYS_RESULT FSM_Check_EStop_Reset_TASK() {
+  return FSM_Check_EStop_Reset();
+}
+
+
 /*------------------------------------------------------------------------------
  *
  * 	AS7341_Get_Data_TASK
  *
- * 		Scheduler task to get spectral data from the AS7341 sensor and update the
- *    daily light integral (DLI) calculation.
+ * 		Scheduler task to get spectral data from the AS7341 sensor. The DLI
+ *    integrator picks the reading up from the data bus.
  *    Tasks should do very little computation beyond calling functions.
  *    All task functions should return a SYS_RESULT value.
  *
 ------------------------------------------------------------------------------*/
 SYS_RESULT AS7341_Get_Data_TASK() {
-  Adafruit_AS7341_ReadAllChannels();
+  Data_Bus_Value_t value;
+
+  if (!Adafruit_AS7341_ReadAllChannels()) {
+    return SYS_MEASUREMENT_GET_FAIL;
+  }
 
   /*----------------------------------------------------------------------------
   Use GCC Pragmas to suppress the following warning:
@@ -1490,14 +1389,27 @@ SYS_RESULT AS7341_Get_Data_TASK() {
   ----------------------------------------------------------------------------*/
   #pragma GCC diagnostic push
   #pragma GCC diagnostic ignored "-Wincompatible-pointer-types"
-  Adafruit_AS7341_getAllChannels(&AS7341_Values);
+  Adafruit_AS7341_getAllChannels(&value.as7341);
   #pragma GCC diagnostic pop
 
-  // Update DLI calculation
+  Data_Bus_Publish(DATA_BUS_TOPIC_AS7341, &value);
+
+  return SYS_SUCCESS;
+}
 
-  // Send Data to Raspberry Pi
-  RPI_UART_Send_AS7341_Pkt(AS7341_Values, 5);
-  // Send Data to Display
+
+/*------------------------------------------------------------------------------
+ *
+ * 	AS7341_Integrate_DLI_TASK
+ *
+ * 		Scheduler task adding the AS7341 readings published since its last run
+ *    to the daily light integral (DLI), and showing it on the display.
+ *    Tasks should do very little computation beyond calling functions.
+ *    All task functions should return a SYS_RESULT value.
+ *
+------------------------------------------------------------------------------*/
+SYS_RESULT AS7341_Integrate_DLI_TASK() {
+  ILI9341_Update_DLI(Adafruit_AS7341_updateDLI());
 
   return SYS_SUCCESS;
 }
@@ -1505,44 +1417,92 @@ SYS_RESULT AS7341_Get_Data_TASK() {
 
 /*------------------------------------------------------------------------------
  *
- * 	AS7341_Is_Midnight_TASK
+ * 	RPI_UART_Send_Sensor_Data_TASK
  *
- * 		Scheduler task to check if it is midnight has been reached
- *    Logic/functionality for if midnight has passed will be added later
- * 
+ * 		Scheduler task sending the sensor readings published since its last run
+ *    to the Raspberry Pi, see RPI_UART_Send_Sensor_Data().
  *    Tasks should do very little computation beyond calling functions.
  *    All task functions should return a SYS_RESULT value.
  *
 ------------------------------------------------------------------------------*/
-SYS_RESULT AS7341_Is_Midnight_TASK() {
+SYS_RESULT RPI_UART_Send_Sensor_Data_TASK() {
+  return RPI_UART_Send_Sensor_Data();
+}
 
-  /*
-    Check if it's midnight using the current elapsed UnixTime
-    Returns IS_MIDNIGHT (1) if true, NOT_MIDNIGHT (0) if false
-    Remove this comment after full implementation
-  */
-  if (isMidnight()) {
-    // Logic to be applied if it is midnight goes here
-    // Reset DLI calculation
-    // Probably have to send a packet to raspberry pi to reset its DLI data
+
+/*------------------------------------------------------------------------------
+ *
+ * 	ILI9341_Update_Sensor_Readings_TASK
+ *
+ * 		Scheduler task showing the latest sensor readings on the display. Only
+ *    readings published since the last run are redrawn.
+ *    Tasks should do very little computation beyond calling functions.
+ *    All task functions should return a SYS_RESULT value.
+ *
+------------------------------------------------------------------------------*/
+SYS_RESULT ILI9341_Update_Sensor_Readings_TASK() {
+  static uint32_t lastSequence[DATA_BUS_NUM_TOPICS];
+  Data_Bus_Sample_t sample;
+
+  if ( Data_Bus_Read_Latest(DATA_BUS_TOPIC_AHT20, &sample)
+    && sample.sequence != lastSequence[DATA_BUS_TOPIC_AHT20] ) {
+    ILI9341_Update_Temperature(sample.value.aht20.temperature);
+    ILI9341_Update_Humidity(sample.value.aht20.humidity);
+    lastSequence[DATA_BUS_TOPIC_AHT20] = sample.sequence;
+  }
+
+  if ( Data_Bus_Read_Latest(DATA_BUS_TOPIC_SEN0169, &sample)
+    && sample.sequence != lastSequence[DATA_BUS_TOPIC_SEN0169] ) {
+    ILI9341_Update_WaterpH(sample.value.pH);
+    lastSequence[DATA_BUS_TOPIC_SEN0169] = sample.sequence;
+  }
+
+  if ( Data_Bus_Read_Latest(DATA_BUS_TOPIC_SEN0244, &sample)
+    && sample.sequence != lastSequence[DATA_BUS_TOPIC_SEN0244] ) {
+    ILI9341_Update_WaterTDS(sample.value.tds);
+    lastSequence[DATA_BUS_TOPIC_SEN0244] = sample.sequence;
   }
 
   return SYS_SUCCESS;
 }
 
 
+/*------------------------------------------------------------------------------
+ *
+ * 	Wall_Clock_Sync_TASK
+ *
+ * 		Scheduler task setting the RTC from the Raspberry Pi time, see
+ *    Wall_Clock_Sync(). Midnight is an RTC alarm, it is not polled for.
+ *
+------------------------------------------------------------------------------*/
+SYS_RESULT Wall_Clock_Sync_TASK() {
+  return Wall_Clock_Sync();
+}
+
+
 /*------------------------------------------------------------------------------
  *
  * 	CNC_Dispense_Seeds_TASK
  *
- * 		Scheduler task to invoke the mini state machine that controls the dispersal
- *    of seeds.
+ * 		Scheduler task running the seed dispensing sequence, see
+ *    CNC_Dispense_Seeds(). Enabled by CNC_Start_Dispensing_Seeds().
  *
 ------------------------------------------------------------------------------*/
 SYS_RESULT CNC_Dispense_Seeds_TASK() {
-  CNC_Dispense_Seeds();
+  return CNC_Dispense_Seeds();
+}
 
-  return SYS_SUCCESS;
+
+/*------------------------------------------------------------------------------
+ *
+ * 	CNC_Check_Homing_TASK
+ *
+ * 		Scheduler task polling the Raspberry Pi until the CNC is homed, see
+ *    CNC_Check_Homing(). Enabled by CNC_Start_Homing().
+ *
+------------------------------------------------------------------------------*/
+SYS_RESULT CNC_Check_Homing_TASK() {
+  return CNC_Check_Homing();
 }
 
 
@@ -1575,17 +1535,116 @@ SYS_RESULT ILI9341_Change_Dashboard_Screen_TASK() {
  *
  * 	ILI9341_Update_Uptime_TASK
  *
- * 		Updates the uptime value for the ILI9341 display
+ * 		Updates the uptime value, and the time spent in each FSM state, for
+ *    the ILI9341 display
  *
 ------------------------------------------------------------------------------*/
 
 SYS_RESULT ILI9341_Update_Uptime_TASK() {
   ILI9341_Update_Uptime(FSM_GetSystemUptime());
 
+  for (FSM_State s = 0; s < NUM_FSM_STATES && s < DASHBOARD_MAX_STATE_LINES; s++) {
+    ILI9341_Update_State_Time(s, FSM_Get_State_Name(s), FSM_Get_State_Residency_ms(s));
+  }
+
+  return SYS_SUCCESS;
+}
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 	Scheduler_Send_Task_Stats_TASK
+ *
+ * 		Sends the execution time statistics of every scheduler task to the
+ * 		Raspberry Pi, the cause of the last watchdog reset until it has
+ * 		been received, and the FSM trace whenever the FSM has moved since the
+ * 		last one was sent
+ *
+------------------------------------------------------------------------------*/
+
+SYS_RESULT Scheduler_Send_Task_Stats_TASK() {
+  static uint32_t sentTransitions = 0;
+  Watchdog_Reset_Info_t resetInfo;
+  uint32_t numTransitions;
+
+  if (Watchdog_Get_Reset_Info(&resetInfo)
+   && RPI_UART_Send_Watchdog_Reset_Pkt(&resetInfo, 4) == SYS_SUCCESS) {
+    Watchdog_Clear_Reset_Info();
+  }
+
+  numTransitions = FSM_Get_Num_Transitions();
+  if (numTransitions != sentTransitions
+   && RPI_UART_Send_FSM_Trace_Pkt(30) == SYS_SUCCESS) {
+    sentTransitions = numTransitions;
+  }
+
+  return RPI_UART_Send_Task_Stats_Pkt(60);
+}
+
+
+/*------------------------------------------------------------------------------
+ *
+ * 	Device_Failure_Handler
+ *
+ * 		Failure handler for the sensor tasks. Called by the scheduler when a
+ *    task's device stops responding and is parked, and again when a probe
+ *    finds it working. Only notes the change, as the scheduler calls it in
+ *    the middle of its pass; Report_Device_Status() tells the display and the
+ *    Raspberry Pi from the work queue.
+ *
+------------------------------------------------------------------------------*/
+
+SYS_RESULT Device_Failure_Handler(struct Scheduler_Task *task) {
+  Scheduler_Task_ID_t taskID = Scheduler_Get_Task_ID(task);
+
+  if (taskID < 32) {
+    changedDeviceMask |= (1UL << taskID);
+  }
+
+  if (!deviceReportPosted) {
+    deviceReportPosted = Work_Queue_Post(WORK_QUEUE_PRIORITY_NORMAL, Report_Device_Status, 0);
+  }
+
   return SYS_SUCCESS;
 }
 
 
+/*------------------------------------------------------------------------------
+ *
+ * 	Report_Device_Status
+ *
+ * 		Work queue item posted by Device_Failure_Handler(). Sends a device
+ *    status packet for every task whose breaker changed, with its state now,
+ *    and redraws the degraded device count once for all of them.
+ *
+------------------------------------------------------------------------------*/
+
+static void Report_Device_Status(uint32_t argument) {
+  uint32_t degradedTaskMask;
+  uint32_t changedMask;
+  uint8_t numDegradedTasks;
+
+  changedMask = changedDeviceMask;
+  changedDeviceMask = 0;
+  deviceReportPosted = false;
+
+  degradedTaskMask = Scheduler_Get_Degraded_Task_Mask();
+  numDegradedTasks = 0;
+
+  for (uint32_t mask = degradedTaskMask; mask != 0; mask &= mask - 1) {
+    numDegradedTasks++;
+  }
+
+  for (Scheduler_Task_ID_t taskID = 0; changedMask != 0; taskID++, changedMask >>= 1) {
+    if (changedMask & 1) {
+      RPI_UART_Send_Device_Status_Pkt(taskID, Scheduler_Get_Task_Breaker_State(taskID), degradedTaskMask, 4);
+    }
+  }
+
+  ILI9341_Update_Degraded_Status(numDegradedTasks);
+}
+
+
 /* USER CODE END 4 */
 
 /**
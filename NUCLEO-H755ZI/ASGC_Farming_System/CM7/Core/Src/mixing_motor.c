@@ -12,19 +12,20 @@
 -----------------------------------------------------------------------------*/
 
 #include "mixing_motor.h"
-#include "timer.h"
+#include "Timer_Wheel.h"
 
 /*-----------------------------------------------------------------------------
 Static Variable Declaration
  ----------------------------------------------------------------------------*/
 static uint16_t s_duty_cycle;
 static Motor_State motor_state;
-static uint64_t mix_end_timestamp;
+static Timer_Wheel_ID_t mix_timer = TIMER_WHEEL_NO_TIMER;
 
 /*-----------------------------------------------------------------------------
 Static Function Declaration
  ----------------------------------------------------------------------------*/
 static void clamp_speed(uint16_t *speed);
+static void mix_timer_callback(uint32_t argument);
 
 
 /*-----------------------------------------------------------------------------
@@ -54,7 +55,10 @@ bool mixing_motor_Init(TIM_HandleTypeDef htim) {
 	HAL_GPIO_WritePin(L298_IN2_PORT, L298_IN2_PIN, GPIO_PIN_RESET);
 
 	motor_state = MOTOR_STATE_NONE;
-	mix_end_timestamp = 0;
+
+	if (mix_timer == TIMER_WHEEL_NO_TIMER) {
+		mix_timer = Timer_Wheel_Create(mix_timer_callback, 0);
+	}
 
 	if (pwm_ret_val == HAL_OK) {
 		ret_val = MIXING_MOTOR_INIT_SUCCEED;
@@ -175,15 +179,15 @@ static void clamp_speed(uint16_t *speed) {
  *
  * 		mixing_motor_mix_for_time()
  *
- * 		Uses the state machine handled in mixing_motor_handle_state() to 
- * 		drive the mixing motor for a given amount of time. NOTE: 
- * 		mixing_motor_handle_state() must be in the main loop of the program.
+ * 		Drives the mixing motor for a given amount of time. The mix timer
+ * 		stops the motor and applies the brake from Timer_Wheel_Update().
  *
  ----------------------------------------------------------------------------*/
 
 SYS_RESULT mixing_motor_mix_for_time(uint16_t timeout_ms) {
 
-	if (motor_state != MOTOR_STATE_NONE || MIXING_MOTOR_ENABLED == SYS_FEATURE_DISABLED) {
+	if (motor_state != MOTOR_STATE_NONE || MIXING_MOTOR_ENABLED == SYS_FEATURE_DISABLED
+	 || mix_timer == TIMER_WHEEL_NO_TIMER) {
 		return SYS_DEVICE_DISABLED;
 	}
 
@@ -191,8 +195,8 @@ SYS_RESULT mixing_motor_mix_for_time(uint16_t timeout_ms) {
 	SYS_RESULT ret_val = mixing_motor_drive(MOTOR_SPEED_100_PCT);
 
 	// Set motor state machine variables
-	mix_end_timestamp = ((uint64_t)(getTimestamp() + timeout_ms));
 	motor_state = MOTOR_STATE_RUNNING;
+	Timer_Wheel_Start(mix_timer, timeout_ms, 0);
 
 	return ret_val;
 
@@ -200,15 +204,17 @@ SYS_RESULT mixing_motor_mix_for_time(uint16_t timeout_ms) {
 
 /*-----------------------------------------------------------------------------
  *
- * 		mixing_motor_handle_state()
+ * 		mix_timer_callback()
  *
- * 		Handles state of mixing motor. Note that the purpose of the 'spindown'
- * 		state is to allow the motor to slow down to a stop before applying the
- * 		motor brake, to prevent a current spike.
+ * 		Handles state of mixing motor when the mix timer runs out. Note that
+ * 		the purpose of the 'spindown' state is to allow the motor to slow down
+ * 		to a stop before applying the motor brake, to prevent a current spike.
  *
  ----------------------------------------------------------------------------*/
 
-void mixing_motor_handle_state() {
+static void mix_timer_callback(uint32_t argument) {
+
+	(void)argument;
 
 	switch (motor_state) {
 
@@ -216,17 +222,14 @@ void mixing_motor_handle_state() {
 		return;
 
 	case MOTOR_STATE_RUNNING:
-		if ( getTimestamp() > mix_end_timestamp ) {
-			mixing_motor_stop();
-			motor_state = MOTOR_STATE_SPINDOWN;
-		}
+		mixing_motor_stop();
+		motor_state = MOTOR_STATE_SPINDOWN;
+		Timer_Wheel_Start(mix_timer, MOTOR_SPINDOWN_TIME_MS, 0);
 		break;
 
 	case MOTOR_STATE_SPINDOWN:
-		if ( getTimestamp() > ( mix_end_timestamp + MOTOR_SPINDOWN_TIME_MS ) ) {
-			mixing_motor_apply_brake();
-			motor_state = MOTOR_STATE_NONE;
-		}
+		mixing_motor_apply_brake();
+		motor_state = MOTOR_STATE_NONE;
 		break;
 
 	}
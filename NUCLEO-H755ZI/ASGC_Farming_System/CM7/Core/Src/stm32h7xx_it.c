@@ -22,6 +22,8 @@
 #include "stm32h7xx_it.h"
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
+#include "timer.h"
+#include "Wall_Clock.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -216,4 +218,31 @@ void EXTI9_5_IRQHandler(void)
 
 /* USER CODE BEGIN 1 */
 
+/**
+  * @brief This function handles LPTIM1 global interrupt.
+  *        LPTIM1 wakes the core from tickless idle, see ASGC_Timer_Idle().
+  */
+void LPTIM1_IRQHandler(void)
+{
+  LPTIM1->ICR = LPTIM_ICR_CMPMCF;
+}
+
+/**
+  * @brief This function handles TIM2 global interrupt.
+  *        TIM2 wraps once every 71.6 minutes, see getTimestampUs().
+  */
+void TIM2_IRQHandler(void)
+{
+  ASGC_Timer_Wrap_IRQHandler();
+}
+
+/**
+  * @brief This function handles RTC alarms through EXTI line 17.
+  *        Alarm A goes off at local midnight, see Wall_Clock.h.
+  */
+void RTC_Alarm_IRQHandler(void)
+{
+  Wall_Clock_Alarm_IRQHandler();
+}
+
 /* USER CODE END 1 */
@@ -9,116 +9,348 @@
  *  in this project should use getTimestamp() to fetch the milliseconds since
  *  system on, rather than the HAL_GetTick() function.
  *
+ *  The timebase is TIM2, a 32 bit timer counting microseconds, extended to 64
+ *  bits by counting its wraps (every 71.6 minutes) in its update interrupt.
+ *  It is read without masking interrupts, see getTimestampUs().
+ *
 -----------------------------------------------------------------------------*/
 
 #include "timer.h"
+#include "Work_Queue.h"
+
+static volatile uint32_t s_usWraps;		// TIM2 wraps counted so far
 
-static uint32_t unixTimeRefSec;
-static uint64_t timestampAtUnixTimeRefMs;
-static uint32_t nextMidnightTimeSec; 
+static bool s_idleTimerReady;			// LSE running and LPTIM1 counting
+static uint32_t s_idleRemainderTicks;	// Slept time not yet added to the tick
+static uint64_t s_idleTimeMs;			// Total time spent in tickless idle
 
-static uint64_t s_overflowTimeMs;
-static uint32_t prev_32_bit_timestampMs;
+extern __IO uint32_t uwTick;			// HAL millisecond tick, stm32h7xx_hal.c
+
+static void timebase_init();
+static void idle_timer_init();
+static uint16_t idle_timer_read_count();
 
 void ASGC_Timer_Init() {
-	s_overflowTimeMs = 0;
-	prev_32_bit_timestampMs = 0;
-	nextMidnightTimeSec = 0;
+	timebase_init();
+
+	s_idleTimerReady = false;
+	s_idleRemainderTicks = 0;
+	s_idleTimeMs = 0;
+
+	if (TICKLESS_IDLE_ENABLED == SYS_FEATURE_ENABLED) {
+		idle_timer_init();
+	}
 }
 
-// Define constants for Midnight Checker/Calculation functions
-#define SEC_IN_DAY 86400
-#define SEC_IN_HOUR 3600
-#define SEC_IN_MIN 60
-
-/*---------------------------------------------------------------------------------------------------
-	setUnixTimeMidnightRef(const uint32_t currentTimeSec, const int8_t TimeZoneOffsetUTCHours)
-	Takes in a unix timestamp in seconds
-	Takes in a timezone offset in hours from UTC (i.e. UTC-5 should pass '-5', UTC+5 should pass '5')
-
-	This function calculates the next midnight time in seconds, then updates the static variable
-	nextMidnightTimeSec with the new value.
----------------------------------------------------------------------------------------------------*/
-void setUnixTimeMidnightRef(const uint32_t currentTimeSec, const int8_t TimeZoneOffsetUTCHours) {
-	// Set time reference
-	unixTimeRefSec = currentTimeSec;
-	timestampAtUnixTimeRefMs = getTimestamp();
-
-    // Determine what hour, minute, and second we're at in the day
-    const uint8_t currentHour = (((currentTimeSec % SEC_IN_DAY) / SEC_IN_HOUR) + TimeZoneOffsetUTCHours) % 24;
-    const uint8_t currentMinute = ((currentTimeSec % SEC_IN_HOUR) / SEC_IN_MIN);
-    const uint8_t currentSecond = (currentTimeSec % SEC_IN_MIN);
-
-    // Determine the remaining time to midnight for H:M:S, uses ternary operators to avoid overlap (i.e. if seconds>0, then minutes must be decremented by 1)
-    const uint8_t remainingSeconds = (SEC_IN_MIN - currentSecond) % SEC_IN_MIN;
-    const uint8_t remainingMinutes = (remainingSeconds>0) ? (SEC_IN_MIN - currentMinute) % SEC_IN_MIN - 1 : (SEC_IN_MIN - currentMinute) % SEC_IN_MIN;
-    const uint8_t remainingHours = (remainingMinutes>0) ? (24 - currentHour) % 24 - 1 : (24 - currentHour) % 24;
-    
-    // Calculate remaining seconds to midnight, and update the static variable
-    const uint32_t secondsToMidnight = remainingSeconds + (remainingMinutes * SEC_IN_MIN) + (remainingHours * SEC_IN_HOUR);
-    nextMidnightTimeSec = currentTimeSec + secondsToMidnight;
+/*-----------------------------------------------------------------------------
+ *
+ * 		getTimestamp
+ *
+ * 		Returns the number of milliseconds elapsed since ASGC_Timer_Init()
+ * 		started the timebase (power on).
+ *
+ ----------------------------------------------------------------------------*/
+
+uint64_t getTimestamp() {
+	return getTimestampUs() / 1000;
 }
 
-/*-------------------------------------------------------------------------------------
-	isMidnight()
 
-	Returns uint8_t integer code, 1 = IS_MIDNIGHT, 0 = NOT_MIDNIGHT
+/*-----------------------------------------------------------------------------
+ *
+ * 		getTimestampUs
+ *
+ * 		Returns the number of microseconds elapsed since ASGC_Timer_Init()
+ * 		started the timebase. Returns 0 before that.
+ *
+ * 		The wrap count and the counter are read without masking interrupts.
+ * 		If the wrap interrupt runs between the two reads, the wrap count
+ * 		changes and they are read again. A wrap the interrupt has not counted
+ * 		yet (interrupts masked by the caller) is seen on the update flag, and
+ * 		the counter is then read again, as the first read may be from before
+ * 		the wrap. The wrap interrupt is at the highest priority, so no caller
+ * 		can see it half done.
+ *
+ ----------------------------------------------------------------------------*/
 
-	This function checks if the current time is at or past midnight, based on the 
-	unix time reference and the next midnight time calculated by setUnixTimeMidnightRef().
-	If it is, it calculates the next midnight time, sets it and returns IS_MIDNIGHT
--------------------------------------------------------------------------------------*/
-uint8_t isMidnight() {
+uint64_t getTimestampUs() {
 
-	// Get the current time in seconds, calculate using the UnixTime and system offset
-	const uint32_t currentTimeSec = unixTimeRefSec + ((getTimestamp() - timestampAtUnixTimeRefMs) / 1000);
+	uint32_t wraps;
+	uint32_t count;
+	uint32_t pending;
 
-	// Check if we're at or past Midnight -- if we are, recalculate and return IS_MIDNIGHT
-	if (nextMidnightTimeSec != 0 && currentTimeSec >= nextMidnightTimeSec) {
-        nextMidnightTimeSec += SEC_IN_DAY;
-		return IS_MIDNIGHT;
-	} 
-	// Check if we've initialized nextMidnightTimeSec
-	else if (nextMidnightTimeSec == 0) {
-        return -1;
-	}
+	do {
+		wraps = s_usWraps;
+		count = TIMER_US_TIM->CNT;
+		pending = 0;
+
+		if (TIMER_US_TIM->SR & TIM_SR_UIF) {
+			count = TIMER_US_TIM->CNT;
+			pending = 1;
+		}
+	} while (wraps != s_usWraps);
 
-	// If nextMidnightTimeSec is initialized and we haven't reached it, return NOT_MIDNIGHT
-	return NOT_MIDNIGHT;
+	return (((uint64_t)wraps + pending) << 32) | count;
 }
 
+
 /*-----------------------------------------------------------------------------
  *
- * 		getTimestamp
+ * 		ASGC_Timer_Wrap_IRQHandler
  *
- * 		Returns the number of milliseconds elapsed since the system clocks
- * 		were initialized (power on).
+ * 		Called by TIM2_IRQHandler() when the microsecond counter wraps.
  *
- * 		NOTE: This function needs to be tested. I think the STM32CubeIDE
- * 		debugger allows for variable manipulation to test this function.
+ ----------------------------------------------------------------------------*/
+
+void ASGC_Timer_Wrap_IRQHandler() {
+	TIMER_US_TIM->SR = (uint32_t)~TIM_SR_UIF;
+	s_usWraps++;
+}
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		ASGC_Timer_Idle
+ *
+ * 		Sleeps the CM7 for up to idle_ms, or until an interrupt (e.g. a button
+ * 		press) wakes it. For idles of TIMER_IDLE_MIN_MS or more, SysTick is
+ * 		suspended and LPTIM1 wakes the core instead, so the core is not woken
+ * 		every millisecond. The HAL tick is then stepped forward by the time
+ * 		measured on LPTIM1, which keeps HAL_GetTick() correct across the
+ * 		sleep. TIM2 keeps counting while the core sleeps, so getTimestamp()
+ * 		needs no correction.
+ *
+ * 		Returns at once if an interrupt posted work (Work_Queue.h) that the
+ * 		main loop has not run yet.
+ *
+ * 		The core sleeps rather than entering Stop mode, so the PLL, the PWM
+ * 		timers and the peripheral clocks keep running and waking up costs no
+ * 		clock reconfiguration.
  *
  ----------------------------------------------------------------------------*/
 
-uint64_t getTimestamp() {
+void ASGC_Timer_Idle(uint32_t idle_ms) {
+
+	uint16_t startCount;
+	uint16_t elapsedTicks;
+	uint32_t sleepTicks;
+	uint32_t steppedMs;
 
-	uint32_t timestampMs_32_bit;
-	uint64_t timestampMs_ret_val;
+	if (!s_idleTimerReady || idle_ms < TIMER_IDLE_MIN_MS) {
+		__disable_irq();
+		if (Work_Queue_Is_Empty()) {
+			__WFI();
+		}
+		__enable_irq();
+		return;
+	}
+
+	if (idle_ms > TIMER_IDLE_MAX_MS) {
+		idle_ms = TIMER_IDLE_MAX_MS;
+	}
 
-	__disable_irq();	// Lock: prevent interrupts while fetching time.
+	// Round down, so the core wakes at or just before the deadline
+	sleepTicks = (idle_ms * TIMER_IDLE_LPTIM_HZ) / 1000;
 
-	timestampMs_32_bit = HAL_GetTick();	// Get 32 bit time elapsed
-	// (Time elapsed since last overflow)
+	__disable_irq();
 
-	// If an integer overflow has occurred (49.7 days have elapsed)
-	if ( timestampMs_32_bit < prev_32_bit_timestampMs ) {
-		s_overflowTimeMs += 0xFFFFFFFF;	// Add 32 bits worth of milliseconds to the time elapsed
+	// Work posted since the main loop last ran the queue would otherwise wait
+	// for the whole sleep
+	if (!Work_Queue_Is_Empty()) {
+		__enable_irq();
+		return;
 	}
 
-	prev_32_bit_timestampMs = timestampMs_32_bit; // update overflow comparison value
-	timestampMs_ret_val = s_overflowTimeMs + timestampMs_32_bit;
+	/*-------------------------------------------------------------------------
+	Set the compare match to wake the core. CMPOK is set once the new value
+	has reached the LPTIM clock domain (a few LSE cycles).
+	-------------------------------------------------------------------------*/
+	startCount = idle_timer_read_count();
+	LPTIM1->ICR = LPTIM_ICR_CMPOKCF | LPTIM_ICR_CMPMCF;
+	LPTIM1->CMP = (uint16_t)(startCount + sleepTicks);
+	while ((LPTIM1->ISR & LPTIM_ISR_CMPOK) == 0) {
+	}
+
+	HAL_SuspendTick();
+	NVIC_ClearPendingIRQ(LPTIM1_IRQn);
+	NVIC_EnableIRQ(LPTIM1_IRQn);
+
+	// With interrupts masked, WFI still returns on a pending interrupt. The
+	// interrupt is serviced once the tick has been stepped.
+	__DSB();
+	__WFI();
+
+	NVIC_DisableIRQ(LPTIM1_IRQn);
+	elapsedTicks = (uint16_t)(idle_timer_read_count() - startCount);
 
+	/*-------------------------------------------------------------------------
+	Step the HAL tick by the time slept, carrying the part of a millisecond
+	that is left over to the next idle
+	-------------------------------------------------------------------------*/
+	s_idleRemainderTicks += (uint32_t)elapsedTicks * 1000;
+	steppedMs = s_idleRemainderTicks / TIMER_IDLE_LPTIM_HZ;
+	s_idleRemainderTicks %= TIMER_IDLE_LPTIM_HZ;
+
+	uwTick += steppedMs;
+	s_idleTimeMs += steppedMs;
+
+	HAL_ResumeTick();
 	__enable_irq();
+}
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		ASGC_Timer_Get_Idle_Time_ms
+ *
+ * 		Returns the total number of milliseconds spent in tickless idle since
+ * 		power on.
+ *
+ ----------------------------------------------------------------------------*/
+
+uint64_t ASGC_Timer_Get_Idle_Time_ms() {
+	return s_idleTimeMs;
+}
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		timebase_init
+ *
+ * 		Sets TIM2 counting microseconds over its full 32 bit range, with the
+ * 		update interrupt counting the wraps. TIM2 is on APB1, whose timers
+ * 		are clocked at twice PCLK1 when APB1 is divided down.
+ *
+ ----------------------------------------------------------------------------*/
+
+static void timebase_init() {
+
+	uint32_t timerClock;
+
+	s_usWraps = 0;
+
+	__HAL_RCC_TIM2_CLK_ENABLE();
+	__HAL_RCC_TIM2_CLK_SLEEP_ENABLE();
+
+	timerClock = HAL_RCC_GetPCLK1Freq();
+	if ((RCC->D2CFGR & RCC_D2CFGR_D2PPRE1) != RCC_APB1_DIV1) {
+		timerClock *= 2;
+	}
+
+	/*-------------------------------------------------------------------------
+	Load the prescaler with an update event, then clear the update flag it
+	sets, so it is not taken for a wrap
+	-------------------------------------------------------------------------*/
+	TIMER_US_TIM->CR1 = 0;
+	TIMER_US_TIM->PSC = (timerClock / TIMER_US_HZ) - 1;
+	TIMER_US_TIM->ARR = 0xFFFFFFFF;
+	TIMER_US_TIM->CNT = 0;
+	TIMER_US_TIM->EGR = TIM_EGR_UG;
+	TIMER_US_TIM->SR = 0;
+	TIMER_US_TIM->DIER = TIM_DIER_UIE;
+
+	NVIC_SetPriority(TIM2_IRQn, 0);
+	NVIC_ClearPendingIRQ(TIM2_IRQn);
+	NVIC_EnableIRQ(TIM2_IRQn);
+
+	TIMER_US_TIM->CR1 = TIM_CR1_URS | TIM_CR1_CEN;
+}
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		ASGC_Timer_Start_LSE
+ *
+ * 		Starts the 32.768kHz LSE, which clocks LPTIM1 and the RTC, and
+ * 		returns true once it runs. Returns false if it does not start within
+ * 		LSE_STARTUP_TIMEOUT. Leaves the backup domain writable.
+ *
+ ----------------------------------------------------------------------------*/
+
+bool ASGC_Timer_Start_LSE() {
+
+	uint32_t startTick;
+
+	// The backup domain is write protected after reset
+	PWR->CR1 |= PWR_CR1_DBP;
+	while ((PWR->CR1 & PWR_CR1_DBP) == 0) {
+	}
+
+	RCC->BDCR |= RCC_BDCR_LSEON;
+	startTick = HAL_GetTick();
+
+	while ((RCC->BDCR & RCC_BDCR_LSERDY) == 0) {
+		if ((HAL_GetTick() - startTick) > LSE_STARTUP_TIMEOUT) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		idle_timer_init
+ *
+ * 		Starts the LSE and sets LPTIM1 free running from it at
+ * 		TIMER_IDLE_LPTIM_HZ. Tickless idle stays off if the LSE does not
+ * 		start. The compare match interrupt is left enabled in LPTIM1 (IER can
+ * 		only be written while LPTIM1 is disabled), it is gated in the NVIC.
+ *
+ ----------------------------------------------------------------------------*/
+
+static void idle_timer_init() {
+
+	if (!ASGC_Timer_Start_LSE()) {
+		return;
+	}
+
+	/*-------------------------------------------------------------------------
+	Clock LPTIM1 from the LSE, keep it clocked while the core sleeps
+	-------------------------------------------------------------------------*/
+	MODIFY_REG(RCC->D2CCIP2R, RCC_D2CCIP2R_LPTIM1SEL, RCC_D2CCIP2R_LPTIM1SEL_0 | RCC_D2CCIP2R_LPTIM1SEL_1);
+	RCC->APB1LENR |= RCC_APB1LENR_LPTIM1EN;
+	RCC->APB1LLPENR |= RCC_APB1LLPENR_LPTIM1LPEN;
+	(void)RCC->APB1LENR;
+
+	/*-------------------------------------------------------------------------
+	Prescaler /32, compare match interrupt, then enable and count
+	continuously over the full 16 bit range
+	-------------------------------------------------------------------------*/
+	LPTIM1->CR = 0;
+	LPTIM1->CFGR = LPTIM_CFGR_PRESC_2 | LPTIM_CFGR_PRESC_0;
+	LPTIM1->IER = LPTIM_IER_CMPMIE;
+	LPTIM1->CR = LPTIM_CR_ENABLE;
+
+	LPTIM1->ARR = 0xFFFF;
+	while ((LPTIM1->ISR & LPTIM_ISR_ARROK) == 0) {
+	}
+	LPTIM1->ICR = LPTIM_ICR_ARROKCF;
+
+	LPTIM1->CR |= LPTIM_CR_CNTSTRT;
+
+	NVIC_SetPriority(LPTIM1_IRQn, 0);
+	s_idleTimerReady = true;
+}
+
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		idle_timer_read_count
+ *
+ * 		LPTIM1 counts asynchronously to the bus clock, so the counter is read
+ * 		until two consecutive reads agree.
+ *
+ ----------------------------------------------------------------------------*/
+
+static uint16_t idle_timer_read_count() {
+
+	uint16_t count;
 
-	return timestampMs_ret_val;
+	do {
+		count = (uint16_t)LPTIM1->CNT;
+	} while (count != (uint16_t)LPTIM1->CNT);
 
+	return count;
 }
@@ -0,0 +1,702 @@
+/*-----------------------------------------------------------------------------
+ *
+ * 	fsm_test.c
+ *
+ * 		Host tests of the FSM transition tables. FSM.c runs on the real
+ * 		timer wheel for its state timeouts, and the modules it drives are
+ * 		stand-ins that record what they were asked to do. Each case starts
+ * 		from FSM_Init() and posts a sequence of events. The time only moves
+ * 		on, across the cases too, as it does for the timer wheel on the
+ * 		board:
+ *
+ * 		- table:     FSM_Check_Transition_Table() passes, and fails on
+ * 		             broken tables
+ * 		- cycle:     start to growth, with homing done during the fill
+ * 		- deferred:  FSM_EVENT_CNC_HOMED is kept by the fill only
+ * 		- timeouts:  the fill and homing timeouts, and a timeout that must
+ * 		             not reach the state after the one that armed it
+ * 		- faults:    homing and dispensing failures
+ * 		- e-stop:    from every state, with the reset taken or refused,
+ * 		             and the queued and deferred events dropped
+ * 		- uptime:    not restarted by the fill after an E-stop reset
+ * 		- resume:    checkpoints of each state
+ * 		- queue:     a full queue, and the events that are not queued
+ *
+ * 		Build and run with 'make fsm_test' in this directory.
+ *
+-----------------------------------------------------------------------------*/
+
+#include "FSM.h"
+#include "Scheduler.h"
+#include "Timer_Wheel.h"
+#include "Checkpoint.h"
+#include "Reservoir.h"
+#include "Wall_Clock.h"
+#include "RPI_UART.h"
+#include "CNC.h"
+#include "ILI9341/ILI9341_GFX.h"
+#include "host_stubs.h"
+#include <stdio.h>
+#include <string.h>
+
+/*-----------------------------------------------------------------------------
+DEFINES
+-----------------------------------------------------------------------------*/
+#define TEST_START_MS						1000
+#define TEST_BOOT_GAP_MS					1000
+						/* Between the cases, so no two E-stops		 */
+						/* share a token							 */
+#define TEST_HOLES_DISPENSED				7
+
+/*-----------------------------------------------------------------------------
+STATIC VARIABLES
+-----------------------------------------------------------------------------*/
+extern struct FSM_State_Struct FSM_STATES[NUM_FSM_STATES];
+
+// What the stand-ins were asked to do
+static uint32_t fillsStarted;
+static uint32_t fillsStopped;
+static uint32_t homingsStarted;
+static uint32_t emergencyStops;
+static uint32_t checkpointsSaved;
+static uint32_t monitoringStarts;
+static bool pumpOn;
+static const char *faultReason;
+static uint8_t holesRestored;
+static float dliRestored;
+static uint16_t fullRangeRestored;
+
+// How the stand-ins answer
+static SYS_RESULT homingResult;
+static bool dispensing;
+static bool haveCheckpoint;
+static Checkpoint_Data_t checkpointData;
+static bool estopReleased;
+static bool piAnswers;
+static bool piResets;
+static uint32_t piTokenOffset;			/* Added to the token it echoes		 */
+
+static const char *caseName;
+static uint32_t caseFailures;
+static uint32_t testFailures;
+
+/*-----------------------------------------------------------------------------
+FIRMWARE STAND-INS
+-----------------------------------------------------------------------------*/
+bool SYSTEM_START_STATE;
+bool SYSTEM_ESTOP_STATE;
+
+Scheduler_Task_ID_t AHT20_Request_Measurement_Task_ID = SCHEDULER_NO_TASK;
+Scheduler_Task_ID_t AHT20_Get_Data_Task_ID = SCHEDULER_NO_TASK;
+Scheduler_Task_ID_t SEN0169_Get_Data_Task_ID = SCHEDULER_NO_TASK;
+Scheduler_Task_ID_t SEN0244_Get_Data_Task_ID = SCHEDULER_NO_TASK;
+Scheduler_Task_ID_t AS7341_Get_Data_Task_ID = SCHEDULER_NO_TASK;
+Scheduler_Task_ID_t AS7341_Integrate_DLI_Task_ID = SCHEDULER_NO_TASK;
+Scheduler_Task_ID_t ILI9341_Change_Dashboard_Screen_Task_ID = SCHEDULER_NO_TASK;
+Scheduler_Task_ID_t ILI9341_Update_Uptime_Task_ID = SCHEDULER_NO_TASK;
+Scheduler_Task_ID_t ILI9341_Update_Sensor_Readings_Task_ID = SCHEDULER_NO_TASK;
+Scheduler_Task_ID_t RPI_UART_Send_Sensor_Data_Task_ID = SCHEDULER_NO_TASK;
+Scheduler_Task_ID_t Scheduler_Send_Task_Stats_Task_ID = SCHEDULER_NO_TASK;
+Scheduler_Task_ID_t Checkpoint_Save_Task_ID = SCHEDULER_NO_TASK;
+Scheduler_Task_ID_t Wall_Clock_Sync_Task_ID = SCHEDULER_NO_TASK;
+
+SYS_RESULT FSM_Check_EStop_Reset_TASK() {
+	return FSM_Check_EStop_Reset();
+}
+
+void Scheduler_Enable_Task(Scheduler_Task_ID_t task_id, uint32_t ms_delay) {
+	(void)task_id;
+	(void)ms_delay;
+}
+
+void Scheduler_Disable_Task(Scheduler_Task_ID_t task_id) {
+	(void)task_id;
+}
+
+SYS_RESULT Scheduler_Enable_Tasks_Planned(Scheduler_Plan_Entry_t *entries, uint8_t num_entries) {
+	(void)entries;
+	(void)num_entries;
+	monitoringStarts++;
+	return SYS_SUCCESS;
+}
+
+SYS_RESULT Reservoir_Start_Fill() {
+	fillsStarted++;
+	return SYS_SUCCESS;
+}
+
+void Reservoir_Stop_Fill() {
+	fillsStopped++;
+}
+
+void Reservoir_Restore_Calibration(float fill_rate, uint16_t full_range_mm) {
+	(void)fill_rate;
+	fullRangeRestored = full_range_mm;
+}
+
+SYS_RESULT CNC_Start_Homing(void) {
+	homingsStarted++;
+	return homingResult;
+}
+
+void CNC_Stop_Homing(void) {
+}
+
+SYS_RESULT CNC_Emergency_Stop(void) {
+	emergencyStops++;
+	return SYS_SUCCESS;
+}
+
+void CNC_Start_Dispensing_Seeds() {
+}
+
+bool CNC_Is_Dispensing_Seeds() {
+	return dispensing;
+}
+
+void CNC_Set_Holes_Dispensed(uint8_t holes) {
+	holesRestored = holes;
+}
+
+void Checkpoint_Save() {
+	checkpointsSaved++;
+}
+
+bool Checkpoint_Load(Checkpoint_Data_t *data) {
+	if (haveCheckpoint) {
+		*data = checkpointData;
+	}
+
+	return haveCheckpoint;
+}
+
+uint32_t Wall_Clock_Get_Local_Day() {
+	return WALL_CLOCK_DAY_UNKNOWN;
+}
+
+void Adafruit_AS7341_restoreDLI(float dli_mol_m2) {
+	dliRestored = dli_mol_m2;
+}
+
+SYS_RESULT RPI_UART_Request_EStop_Reset_Pkt(uint32_t token, uint8_t state_before, bool released, struct RPI_UART_EStop_Reset_Packet *reset, uint32_t timeout) {
+	(void)state_before;
+	(void)released;
+	(void)timeout;
+
+	if (!piAnswers) {
+		return SYS_FAIL;
+	}
+
+	reset->reset = piResets;
+	reset->token = token + piTokenOffset;
+	reset->token_check = ~token;
+
+	return SYS_SUCCESS;
+}
+
+bool Buttons_estop_is_released() {
+	return estopReleased;
+}
+
+SYS_RESULT GPIO_set_circulating_pump(bool state) {
+	pumpOn = state;
+	return SYS_SUCCESS;
+}
+
+SYS_RESULT mixing_motor_stop() {
+	return SYS_SUCCESS;
+}
+
+SYS_RESULT FAN_pwm_intf_set_duty(uint16_t duty) {
+	(void)duty;
+	return SYS_SUCCESS;
+}
+
+void Display_StartupScreen() {
+}
+
+void Display_EStopScreen() {
+}
+
+void Display_FaultScreen(const char *reason) {
+	faultReason = reason;
+}
+
+void Display_Dashboard() {
+}
+
+void Write_Logo() {
+}
+
+void ILI9341_Update_Uptime(uint64_t msSinceStart) {
+	(void)msSinceStart;
+}
+
+void ILI9341_Update_PumpStatus(_Bool isPumpOnlineNew) {
+	(void)isPumpOnlineNew;
+}
+
+void ILI9431_Set_Current_Dashboard_Page(Dashboard_page_t page) {
+	(void)page;
+}
+
+void ILI9341_Fill_Screen(uint16_t Colour) {
+	(void)Colour;
+}
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		check()
+ *
+ * 		Counts a failed check, and prints the first one of the case.
+ *
+ ----------------------------------------------------------------------------*/
+static void check(bool ok, const char *what) {
+	if (ok) {
+		return;
+	}
+
+	if (caseFailures == 0) {
+		printf("  %s: %s, in %s\n", caseName, what, FSM_Get_State_Name(FSM_Get_State()));
+	}
+
+	caseFailures++;
+}
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		start_fsm()
+ *
+ * 		Puts the stand-ins back to a powered up board, with the start button
+ * 		pressed or not, and runs FSM_Init() and the first FSM_Update(). The
+ * 		checkpoint set up by the case is only seen by this FSM_Init().
+ *
+ ----------------------------------------------------------------------------*/
+static void start_fsm(bool start_pressed) {
+	fillsStarted = 0;
+	fillsStopped = 0;
+	homingsStarted = 0;
+	emergencyStops = 0;
+	checkpointsSaved = 0;
+	monitoringStarts = 0;
+	pumpOn = false;
+	faultReason = NULL;
+	holesRestored = 0;
+	dliRestored = 0.0f;
+	fullRangeRestored = 0;
+
+	homingResult = SYS_SUCCESS;
+	dispensing = true;
+	estopReleased = true;
+	piAnswers = true;
+	piResets = true;
+	piTokenOffset = 0;
+
+	SYSTEM_START_STATE = start_pressed ? SYSTEM_ON : SYSTEM_OFF;
+	SYSTEM_ESTOP_STATE = SYSTEM_OFF;
+
+	host_timestamp_ms += TEST_BOOT_GAP_MS;
+	Timer_Wheel_Update();
+
+	check(FSM_Init() == SYS_SUCCESS, "FSM_Init() failed");
+	FSM_Update();
+
+	haveCheckpoint = false;
+}
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		post(), advance()
+ *
+ * 		Posts an event, or moves the time on, and runs the main loop once.
+ *
+ ----------------------------------------------------------------------------*/
+static void post(FSM_Event_t event) {
+	check(FSM_Post_Event(event), "event not queued");
+	FSM_Update();
+}
+
+static void advance(uint32_t ms) {
+	host_timestamp_ms += ms;
+	Timer_Wheel_Update();
+	FSM_Update();
+}
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		run_to()
+ *
+ * 		Takes a fresh FSM to 'state' the normal way, with homing still
+ * 		running and seeds still being dispensed.
+ *
+ ----------------------------------------------------------------------------*/
+static void run_to(FSM_State state) {
+	start_fsm(state != FSM_STATE_WAITING_ON_START);
+
+	if (state == FSM_STATE_WAITING_ON_START || state == FSM_STATE_FILL_RESERVOIR) {
+		return;
+	}
+
+	post(FSM_EVENT_RESERVOIR_FILLED);
+	if (state == FSM_STATE_CNC_HOMING) {
+		return;
+	}
+
+	if (state == FSM_STATE_FAULT) {
+		post(FSM_EVENT_CNC_HOMING_FAILED);
+		return;
+	}
+
+	post(FSM_EVENT_CNC_HOMED);
+	if (state == FSM_STATE_SEED_DISPENSE) {
+		return;
+	}
+
+	post(FSM_EVENT_SEEDS_DISPENSED);
+}
+
+/*-----------------------------------------------------------------------------
+TEST CASES
+-----------------------------------------------------------------------------*/
+static void test_table() {
+	FSM_State_Struct_t saved = FSM_STATES[FSM_STATE_FILL_RESERVOIR];
+
+	check(FSM_Check_Transition_Table() == SYS_SUCCESS, "table rejected");
+
+	FSM_STATES[FSM_STATE_FILL_RESERVOIR].timeout_ms = 0;
+	check(FSM_Check_Transition_Table() == SYS_FAIL, "timeout without timeout_ms accepted");
+	check(FSM_Init() == SYS_FAIL, "FSM_Init() took a broken table");
+	FSM_STATES[FSM_STATE_FILL_RESERVOIR] = saved;
+
+	FSM_STATES[FSM_STATE_FILL_RESERVOIR].deferredEvents |= FSM_EVENT_MASK(FSM_EVENT_TIMEOUT);
+	check(FSM_Check_Transition_Table() == SYS_FAIL, "deferred timeout accepted");
+	FSM_STATES[FSM_STATE_FILL_RESERVOIR] = saved;
+
+	FSM_STATES[FSM_STATE_FILL_RESERVOIR].deferredEvents |= FSM_EVENT_MASK(FSM_EVENT_RESERVOIR_FILLED);
+	check(FSM_Check_Transition_Table() == SYS_FAIL, "deferred handled event accepted");
+	FSM_STATES[FSM_STATE_FILL_RESERVOIR] = saved;
+
+	// Homing, dispensing and growth are only reached through the fill
+	FSM_STATES[FSM_STATE_FILL_RESERVOIR].numTransitions = 0;
+	check(FSM_Check_Transition_Table() == SYS_FAIL, "unreachable states accepted");
+	FSM_STATES[FSM_STATE_FILL_RESERVOIR] = saved;
+
+	check(FSM_Check_Transition_Table() == SYS_SUCCESS, "table not restored");
+}
+
+static void test_cycle() {
+	static const FSM_State path[] = {
+		FSM_STATE_INIT, FSM_STATE_WAITING_ON_START, FSM_STATE_FILL_RESERVOIR,
+		FSM_STATE_CNC_HOMING, FSM_STATE_SEED_DISPENSE, FSM_STATE_GROWTH_MONITORING,
+	};
+	FSM_Trace_Entry_t trace[FSM_TRACE_LENGTH];
+	uint8_t count;
+
+	start_fsm(false);
+	check(FSM_Get_State() == FSM_STATE_WAITING_ON_START, "not waiting on start");
+
+	post(FSM_EVENT_START_PRESSED);
+	check(FSM_Get_State() == FSM_STATE_FILL_RESERVOIR, "start did not fill");
+	check(fillsStarted == 1 && homingsStarted == 1, "fill and homing not started together");
+	check(monitoringStarts == 1, "monitoring not started");
+
+	// Homing finishes first, and is kept until the fill is done
+	advance(20000);
+	post(FSM_EVENT_CNC_HOMED);
+	check(FSM_Get_State() == FSM_STATE_FILL_RESERVOIR, "homed left the fill");
+
+	advance(10000);
+	post(FSM_EVENT_RESERVOIR_FILLED);
+	check(FSM_Get_State() == FSM_STATE_SEED_DISPENSE, "deferred homed not handled by homing");
+	check(fillsStopped == 1 && pumpOn, "homing did not stop the fill and start the pump");
+
+	post(FSM_EVENT_SEEDS_DISPENSED);
+	check(FSM_Get_State() == FSM_STATE_GROWTH_MONITORING, "not growing");
+	check(monitoringStarts == 1, "monitoring started twice");
+
+	count = FSM_Get_Trace(trace, FSM_TRACE_LENGTH);
+	check(count == sizeof(path) / sizeof(path[0]) - 1, "trace length");
+	check(count == FSM_Get_Num_Transitions(), "transitions not counted");
+	check(checkpointsSaved == count, "checkpoint not saved on every transition");
+	for (uint8_t i = 0; i < count; i++) {
+		check(trace[i].fromState == path[i] && trace[i].toState == path[i + 1], "trace differs from the path");
+	}
+
+	check(FSM_Get_State_Residency_ms(FSM_STATE_FILL_RESERVOIR) == 30000, "fill residency");
+	check(FSM_GetSystemUptime() == 30000, "uptime");
+
+	// Growth has no way out but the E-stop
+	post(FSM_EVENT_START_PRESSED);
+	advance(FSM_STATE_FILL_RESERVOIR_TIMEOUT);
+	check(FSM_Get_State() == FSM_STATE_GROWTH_MONITORING, "growth left on an event");
+}
+
+static void test_deferred() {
+	// Homed before the fill is dropped, only the fill keeps it
+	start_fsm(false);
+	post(FSM_EVENT_CNC_HOMED);
+	post(FSM_EVENT_RESERVOIR_FILLED);
+	check(FSM_Get_State() == FSM_STATE_WAITING_ON_START, "waiting took a fill event");
+
+	post(FSM_EVENT_START_PRESSED);
+	post(FSM_EVENT_RESERVOIR_FILLED);
+	check(FSM_Get_State() == FSM_STATE_CNC_HOMING, "homed kept by the waiting state");
+
+	post(FSM_EVENT_CNC_HOMED);
+	check(FSM_Get_State() == FSM_STATE_SEED_DISPENSE, "homing did not take homed");
+
+	// Homing disabled: homed is posted by the fill, and dispensing with
+	// nothing to wait for is left right away
+	start_fsm(false);
+	homingResult = SYS_DEVICE_DISABLED;
+	dispensing = false;
+	post(FSM_EVENT_START_PRESSED);
+	check(FSM_Get_State() == FSM_STATE_FILL_RESERVOIR, "not filling");
+
+	post(FSM_EVENT_RESERVOIR_FILLED);
+	check(FSM_Get_State() == FSM_STATE_GROWTH_MONITORING, "no homing and dispensing did not go to growth");
+}
+
+static void test_timeouts() {
+	start_fsm(true);
+
+	advance(FSM_STATE_FILL_RESERVOIR_TIMEOUT - 1);
+	check(FSM_Get_State() == FSM_STATE_FILL_RESERVOIR, "fill timed out early");
+	advance(1);
+	check(FSM_Get_State() == FSM_STATE_CNC_HOMING, "fill did not time out");
+
+	advance(FSM_STATE_CNC_HOMING_TIMEOUT - 1);
+	check(FSM_Get_State() == FSM_STATE_CNC_HOMING, "homing timed out early");
+	advance(1);
+	check(FSM_Get_State() == FSM_STATE_FAULT, "homing did not time out");
+	check(faultReason != NULL && strcmp(faultReason, "CNC Homing") == 0, "fault reason");
+
+	// The fill times out and fills in the same pass: the fill is handled,
+	// and the timeout must not fault the homing entered by it
+	start_fsm(true);
+	host_timestamp_ms += FSM_STATE_FILL_RESERVOIR_TIMEOUT;
+	Timer_Wheel_Update();
+	post(FSM_EVENT_RESERVOIR_FILLED);
+	check(FSM_Get_State() == FSM_STATE_CNC_HOMING, "fill timeout reached homing");
+	check(FSM_Get_Ms_Until_Next_Update() == FSM_NO_PENDING_UPDATE_MS, "update pending after the timeout");
+
+	advance(FSM_STATE_CNC_HOMING_TIMEOUT - 1);
+	check(FSM_Get_State() == FSM_STATE_CNC_HOMING, "homing timer not started over");
+}
+
+static void test_faults() {
+	start_fsm(true);
+	post(FSM_EVENT_CNC_HOMING_FAILED);
+	check(FSM_Get_State() == FSM_STATE_FAULT, "homing failure during the fill");
+	check(fillsStopped == 1, "fault did not stop the fill");
+	check(faultReason != NULL && strcmp(faultReason, "CNC Homing") == 0, "homing fault reason");
+
+	// Nothing leaves a fault, not even a timeout still running
+	post(FSM_EVENT_CNC_HOMED);
+	advance(FSM_STATE_FILL_RESERVOIR_TIMEOUT);
+	check(FSM_Get_State() == FSM_STATE_FAULT, "fault left");
+
+	run_to(FSM_STATE_CNC_HOMING);
+	post(FSM_EVENT_CNC_HOMING_FAILED);
+	check(FSM_Get_State() == FSM_STATE_FAULT, "homing failure during homing");
+
+	run_to(FSM_STATE_SEED_DISPENSE);
+	post(FSM_EVENT_SEED_DISPENSE_FAILED);
+	check(FSM_Get_State() == FSM_STATE_FAULT, "dispense failure");
+	check(faultReason != NULL && strcmp(faultReason, "Seed Dispense") == 0, "dispense fault reason");
+}
+
+static void test_estop() {
+	static const FSM_State states[] = {
+		FSM_STATE_WAITING_ON_START, FSM_STATE_FILL_RESERVOIR, FSM_STATE_CNC_HOMING,
+		FSM_STATE_SEED_DISPENSE, FSM_STATE_GROWTH_MONITORING, FSM_STATE_FAULT,
+	};
+	FSM_State from;
+	FSM_State expected;
+	uint32_t transitions;
+
+	for (uint8_t i = 0; i < sizeof(states) / sizeof(states[0]); i++) {
+		from = states[i];
+		run_to(from);
+		check(FSM_Get_State() == from, "state not reached");
+
+		// Queued before the E-stop, must not move the FSM after it
+		FSM_Post_Event(FSM_EVENT_SEEDS_DISPENSED);
+		FSM_EStop();
+		check(FSM_Get_State() == FSM_STATE_ESTOP_PRESSED, "E-stop not entered");
+		check(emergencyStops == 1, "gantry not stopped");
+		check(!pumpOn, "pump not stopped");
+
+		transitions = FSM_Get_Num_Transitions();
+		FSM_EStop();
+		check(FSM_Get_Num_Transitions() == transitions && emergencyStops == 1, "E-stop entered twice");
+
+		FSM_Update();
+		advance(FSM_STATE_FILL_RESERVOIR_TIMEOUT);
+		check(FSM_Get_State() == FSM_STATE_ESTOP_PRESSED, "E-stop left without a reset");
+
+		// Refused: Pi silent, not reset, button held, wrong token
+		piAnswers = false;
+		check(FSM_Check_EStop_Reset() == SYS_FAIL, "silent Pi not reported");
+		piAnswers = true;
+		piResets = false;
+		FSM_Check_EStop_Reset();
+		piResets = true;
+		estopReleased = false;
+		FSM_Check_EStop_Reset();
+		estopReleased = true;
+		piTokenOffset = 1;
+		FSM_Check_EStop_Reset();
+		piTokenOffset = 0;
+		FSM_Update();
+		check(FSM_Get_State() == FSM_STATE_ESTOP_PRESSED, "bad reset taken");
+
+		// Taken, except for a fault
+		SYSTEM_ESTOP_STATE = SYSTEM_ON;
+		check(FSM_Check_EStop_Reset() == SYS_SUCCESS, "reset check failed");
+		FSM_Update();
+
+		if (from == FSM_STATE_FAULT) {
+			expected = FSM_STATE_ESTOP_PRESSED;
+		}
+		else if (from == FSM_STATE_GROWTH_MONITORING) {
+			expected = FSM_STATE_GROWTH_MONITORING;
+		}
+		else {
+			expected = FSM_STATE_FILL_RESERVOIR;
+		}
+
+		check(FSM_Get_State() == expected, "wrong state after the reset");
+		check((SYSTEM_ESTOP_STATE == SYSTEM_OFF) == (from != FSM_STATE_FAULT), "E-stop button not armed again");
+
+		if (from == FSM_STATE_GROWTH_MONITORING) {
+			check(pumpOn && monitoringStarts == 2, "growth not resumed");
+		}
+	}
+
+	// Homing done before the E-stop is redone, not taken from before it
+	run_to(FSM_STATE_FILL_RESERVOIR);
+	post(FSM_EVENT_CNC_HOMED);
+	FSM_EStop();
+	FSM_Check_EStop_Reset();
+	FSM_Update();
+	check(homingsStarted == 2, "homing not started again");
+	post(FSM_EVENT_RESERVOIR_FILLED);
+	check(FSM_Get_State() == FSM_STATE_CNC_HOMING, "homed kept across the E-stop");
+}
+
+static void test_uptime() {
+	start_fsm(true);
+	advance(5000);
+	FSM_EStop();
+	advance(3000);
+	FSM_Check_EStop_Reset();
+	FSM_Update();
+	check(FSM_Get_State() == FSM_STATE_FILL_RESERVOIR, "not back to the fill");
+
+	advance(2000);
+	check(FSM_GetSystemUptime() == 10000, "uptime restarted by the fill");
+}
+
+static void test_resume() {
+	static const FSM_State states[] = {
+		FSM_STATE_WAITING_ON_START, FSM_STATE_FILL_RESERVOIR, FSM_STATE_CNC_HOMING,
+		FSM_STATE_SEED_DISPENSE, FSM_STATE_GROWTH_MONITORING, FSM_STATE_FAULT,
+		FSM_STATE_ESTOP_PRESSED,
+	};
+	FSM_State from;
+	bool resumed;
+
+	for (uint8_t i = 0; i < sizeof(states) / sizeof(states[0]); i++) {
+		from = states[i];
+		resumed = (from != FSM_STATE_WAITING_ON_START && from != FSM_STATE_FAULT && from != FSM_STATE_ESTOP_PRESSED);
+
+		memset(&checkpointData, 0, sizeof(checkpointData));
+		checkpointData.state = from;
+		checkpointData.uptime_ms = 3600000;
+		checkpointData.state_residency_ms[FSM_STATE_GROWTH_MONITORING] = 1800000;
+		checkpointData.dli_mol_m2 = 4.5f;
+		checkpointData.dli_day = WALL_CLOCK_DAY_UNKNOWN;
+		checkpointData.holes_dispensed = TEST_HOLES_DISPENSED;
+		checkpointData.fill_rate_mm_s = 2.0f;
+		checkpointData.full_range_mm = 80;
+
+		haveCheckpoint = true;
+		start_fsm(false);
+
+		check(fullRangeRestored == 80, "calibration not restored");
+
+		if (!resumed) {
+			check(FSM_Get_State() == FSM_STATE_WAITING_ON_START, "resumed a state not worth it");
+			check(holesRestored == 0 && FSM_GetSystemUptime() == 0, "progress restored");
+			continue;
+		}
+
+		check(holesRestored == TEST_HOLES_DISPENSED && dliRestored == 4.5f, "progress not restored");
+		check(FSM_Get_State_Residency_ms(FSM_STATE_GROWTH_MONITORING) >= 1800000, "residency not restored");
+
+		if (from == FSM_STATE_GROWTH_MONITORING) {
+			check(FSM_Get_State() == FSM_STATE_GROWTH_MONITORING, "growth not resumed");
+			check(pumpOn && monitoringStarts == 1 && fillsStarted == 0, "growth resumed through the fill");
+		}
+		else {
+			check(FSM_Get_State() == FSM_STATE_FILL_RESERVOIR, "not filling again");
+		}
+
+		advance(1000);
+		check(FSM_GetSystemUptime() == 3601000, "uptime not carried on");
+	}
+}
+
+static void test_queue() {
+	start_fsm(false);
+
+	check(!FSM_Post_Event(FSM_EVENT_TIMEOUT), "timeout queued");
+	check(!FSM_Post_Event(FSM_EVENT_ESTOP_PRESSED), "E-stop queued");
+	check(!FSM_Post_Event(NUM_FSM_EVENTS), "unknown event queued");
+
+	for (uint8_t i = 0; i < FSM_EVENT_QUEUE_LENGTH; i++) {
+		check(FSM_Post_Event(FSM_EVENT_CNC_HOMED), "queue full early");
+	}
+
+	check(!FSM_Post_Event(FSM_EVENT_START_PRESSED), "full queue took an event");
+	check(FSM_Get_Ms_Until_Next_Update() == 0, "queued events not pending");
+
+	FSM_Update();
+	check(FSM_Get_State() == FSM_STATE_WAITING_ON_START, "dropped event handled");
+	check(FSM_Get_Ms_Until_Next_Update() == FSM_NO_PENDING_UPDATE_MS, "update pending with nothing queued");
+}
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		run_case()
+ *
+ * 		Runs one case and prints the result.
+ *
+ ----------------------------------------------------------------------------*/
+static void run_case(const char *name, void (*test)()) {
+	caseName = name;
+	caseFailures = 0;
+
+	test();
+
+	printf("%-12s %s\n", name, (caseFailures == 0) ? "pass" : "FAIL");
+	testFailures += caseFailures;
+}
+
+int main() {
+	host_timestamp_ms = TEST_START_MS;
+	Timer_Wheel_Init();
+
+	run_case("table", test_table);
+	run_case("cycle", test_cycle);
+	run_case("deferred", test_deferred);
+	run_case("timeouts", test_timeouts);
+	run_case("faults", test_faults);
+	run_case("e-stop", test_estop);
+	run_case("uptime", test_uptime);
+	run_case("resume", test_resume);
+	run_case("queue", test_queue);
+
+	return (testFailures == 0) ? 0 : 1;
+}
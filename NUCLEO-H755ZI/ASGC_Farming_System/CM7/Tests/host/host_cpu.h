@@ -0,0 +1,44 @@
+/*-----------------------------------------------------------------------------
+ *
+ * 	host_cpu.h
+ *
+ * 		Forced into every file of the host builds (-include). Points the
+ * 		Cortex-M core registers the firmware touches at plain variables,
+ * 		and makes the interrupt masking, NVIC and sleep calls do nothing,
+ * 		so the modules under test build and run on the PC.
+ *
+-----------------------------------------------------------------------------*/
+
+#ifndef HOST_CPU_H_
+#define HOST_CPU_H_
+
+#include "stm32h7xx.h"
+
+extern DWT_Type host_dwt;
+extern CoreDebug_Type host_core_debug;
+
+#undef DWT
+#undef CoreDebug
+#define DWT								(&host_dwt)
+#define CoreDebug						(&host_core_debug)
+
+#define __get_PRIMASK()					(0u)
+#define __disable_irq()					do {} while (0)
+#define __enable_irq()					do {} while (0)
+#define __set_PRIMASK(primask)			((void)(primask))
+#define __DMB()							do {} while (0)
+#define __DSB()							do {} while (0)
+
+#undef __WFI
+#define __WFI()							do {} while (0)
+
+#undef NVIC_EnableIRQ
+#undef NVIC_DisableIRQ
+#undef NVIC_ClearPendingIRQ
+#undef NVIC_SetPriority
+#define NVIC_EnableIRQ(irqn)			((void)(irqn))
+#define NVIC_DisableIRQ(irqn)			((void)(irqn))
+#define NVIC_ClearPendingIRQ(irqn)		((void)(irqn))
+#define NVIC_SetPriority(irqn, prio)	((void)(irqn), (void)(prio))
+
+#endif /* HOST_CPU_H_ */
@@ -0,0 +1,40 @@
+/*-----------------------------------------------------------------------------
+ *
+ * 	host_stubs.c
+ *
+ * 		What Scheduler.c needs from the rest of the firmware, for the host
+ * 		builds. The millisecond timebase is a variable the test moves on
+ * 		by hand, and the watchdog and the statistics report do nothing.
+ *
+-----------------------------------------------------------------------------*/
+
+#include "Scheduler.h"
+#include "Watchdog.h"
+#include "host_stubs.h"
+
+DWT_Type host_dwt;
+CoreDebug_Type host_core_debug;
+uint32_t SystemCoreClock = 480000000;
+
+uint64_t host_timestamp_ms;
+
+uint64_t getTimestamp() {
+	return host_timestamp_ms;
+}
+
+void Watchdog_Feed() {
+}
+
+void Watchdog_Set_Breadcrumb(Watchdog_Cause_t cause, Scheduler_Task_ID_t task_id, uint64_t since_timestamp, uint32_t budget_ms) {
+	(void)cause;
+	(void)task_id;
+	(void)since_timestamp;
+	(void)budget_ms;
+}
+
+void Watchdog_Clear_Breadcrumb() {
+}
+
+SYS_RESULT Scheduler_Send_Task_Stats_TASK() {
+	return SYS_SUCCESS;
+}
@@ -0,0 +1,16 @@
+/*-----------------------------------------------------------------------------
+ *
+ * 	host_stubs.h
+ *
+ * 		Controls of the firmware stand-ins in host_stubs.c.
+ *
+-----------------------------------------------------------------------------*/
+
+#ifndef HOST_STUBS_H_
+#define HOST_STUBS_H_
+
+#include <stdint.h>
+
+extern uint64_t host_timestamp_ms;		/* Returned by getTimestamp()		 */
+
+#endif /* HOST_STUBS_H_ */
@@ -0,0 +1,3 @@
+/* Scheduler.h includes Buttons.h, the file is buttons.h. Lets the case
+   sensitive host build find it. */
+#include "buttons.h"
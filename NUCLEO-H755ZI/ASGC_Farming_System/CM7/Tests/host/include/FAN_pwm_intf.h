@@ -0,0 +1,3 @@
+/* Scheduler.h includes FAN_pwm_intf.h, the file is fan_pwm_intf.h. Lets the case
+   sensitive host build find it. */
+#include "fan_pwm_intf.h"
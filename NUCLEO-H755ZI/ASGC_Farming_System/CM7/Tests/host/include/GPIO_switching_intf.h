@@ -0,0 +1,3 @@
+/* Scheduler.h includes GPIO_switching_intf.h, the file is gpio_switching_intf.h. Lets the case
+   sensitive host build find it. */
+#include "gpio_switching_intf.h"
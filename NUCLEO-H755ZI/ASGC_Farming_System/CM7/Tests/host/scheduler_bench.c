@@ -0,0 +1,207 @@
+/*-----------------------------------------------------------------------------
+ *
+ * 	scheduler_bench.c
+ *
+ * 		Host benchmark of the scheduler's ready list. Registers
+ * 		BENCH_NUM_TASKS synthetic tasks with Scheduler.c and runs ten
+ * 		simulated minutes of main loop passes, one per millisecond, twice:
+ *
+ * 		- scan:   every pass checks every enabled task for being due, the
+ * 		          way Scheduler_Update() worked before the ready list
+ * 		- sorted: Scheduler_Update(), which only looks at the head of the
+ * 		          ready list
+ *
+ * 		Both runs must run the tasks the same number of times. Each pass is
+ * 		timed, and the passes with nothing due (the search for a due task,
+ * 		which the ready list is for) are reported apart from the cost of a
+ * 		task run. A run under Scheduler_Update() also pays for its
+ * 		statistics, the watchdog breadcrumb and putting the task back in
+ * 		the list, which the scan here does not do.
+ *
+ * 		Build and run with 'make bench' in this directory.
+ *
+-----------------------------------------------------------------------------*/
+
+#include "Scheduler.h"
+#include "host_stubs.h"
+#include <stdio.h>
+#include <time.h>
+
+/*-----------------------------------------------------------------------------
+DEFINES
+-----------------------------------------------------------------------------*/
+#define BENCH_NUM_TASKS						SCHEDULER_MAX_TASKS - 1
+						/* The scheduler registers its own stats task */
+#define BENCH_DURATION_MS					600000
+#define BENCH_MIN_INTERVAL_MS				50
+#define BENCH_MAX_INTERVAL_MS				5000
+
+/*-----------------------------------------------------------------------------
+STATIC VARIABLES
+-----------------------------------------------------------------------------*/
+extern struct Scheduler_Task Task_List[SCHEDULER_MAX_TASKS];
+
+static uint64_t taskRuns;
+static uint32_t randomState;
+
+typedef struct Bench_Result {
+	double idle_pass_ns;				/* Average of the passes that ran	 */
+										/* nothing							 */
+	double run_ns;						/* Average extra time per task run	 */
+	uint64_t runs;
+}Bench_Result_t;
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		synthetic_TASK()
+ *
+ * 		Task function of every synthetic task. Only counts the run.
+ *
+ ----------------------------------------------------------------------------*/
+static SYS_RESULT synthetic_TASK() {
+	taskRuns++;
+
+	return SYS_SUCCESS;
+}
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		next_random()
+ *
+ * 		Fixed seed LCG, so both runs and every build get the same tasks.
+ *
+ ----------------------------------------------------------------------------*/
+static uint32_t next_random() {
+	randomState = randomState * 1664525u + 1013904223u;
+
+	return randomState >> 8;
+}
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		register_tasks()
+ *
+ * 		Empties the scheduler and registers the synthetic tasks, each with
+ * 		its own interval and a random first run within it.
+ *
+ ----------------------------------------------------------------------------*/
+static void register_tasks() {
+	Scheduler_Task_ID_t task_id;
+	uint32_t interval_ms;
+
+	host_timestamp_ms = 0;
+	randomState = 1;
+	Scheduler_Init();
+
+	for (uint32_t i = 0; i < BENCH_NUM_TASKS; i++) {
+		interval_ms = BENCH_MIN_INTERVAL_MS + next_random() % (BENCH_MAX_INTERVAL_MS - BENCH_MIN_INTERVAL_MS);
+
+		Scheduler_Task_Config_t config = {
+			.task_function = synthetic_TASK,
+			.failure_handler = NULL,
+			.interval_ms = interval_ms,
+			.budget_ms = SCHEDULER_DEFAULT_TASK_BUDGET_MS,
+			.run_mode = SCHEDULER_RUN_FIXED_RATE,
+			.catch_up_policy = SCHEDULER_CATCH_UP_SKIP,
+		};
+
+		task_id = Scheduler_Register_Task(&config);
+		Scheduler_Enable_Task(task_id, next_random() % interval_ms);
+	}
+
+	taskRuns = 0;
+}
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		scan_update()
+ *
+ * 		One pass of the scheduler without the ready list: walks the whole
+ * 		task pool and runs every enabled task that is due.
+ *
+ ----------------------------------------------------------------------------*/
+static void scan_update() {
+	uint8_t numTasks = Scheduler_Get_Num_Tasks();
+
+	for (uint8_t i = 0; i < numTasks; i++) {
+		if (Task_List[i].enabled && Task_List[i].next_run_timestamp <= host_timestamp_ms) {
+			Task_List[i].task_function();
+			Task_List[i].next_run_timestamp = host_timestamp_ms + Task_List[i].interval_ms;
+		}
+	}
+}
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		empty_update()
+ *
+ * 		Pass that does nothing, to time the timing itself.
+ *
+ ----------------------------------------------------------------------------*/
+static void empty_update() {
+}
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		run_passes()
+ *
+ * 		Registers the tasks and runs one pass per simulated millisecond,
+ * 		timing each pass. clock_ns is taken off every pass.
+ *
+ ----------------------------------------------------------------------------*/
+static Bench_Result_t run_passes(void (*update)(), double clock_ns) {
+	struct timespec start, end;
+	Bench_Result_t result;
+	uint64_t runsBefore;
+	double passNs;
+	double idleNs = 0, busyNs = 0;
+	uint64_t idlePasses = 0, busyPasses = 0;
+
+	register_tasks();
+
+	for (host_timestamp_ms = 0; host_timestamp_ms < BENCH_DURATION_MS; host_timestamp_ms++) {
+		runsBefore = taskRuns;
+
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		update();
+		clock_gettime(CLOCK_MONOTONIC, &end);
+
+		passNs = (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec) - clock_ns;
+
+		if (taskRuns == runsBefore) {
+			idleNs += passNs;
+			idlePasses++;
+		}
+		else {
+			busyNs += passNs;
+			busyPasses++;
+		}
+	}
+
+	result.idle_pass_ns = (idlePasses != 0) ? idleNs / idlePasses : 0;
+	result.run_ns = (taskRuns != 0) ? (busyNs - busyPasses * result.idle_pass_ns) / taskRuns : 0;
+	result.runs = taskRuns;
+
+	return result;
+}
+
+int main() {
+	Bench_Result_t scan, sorted;
+	double clockNs;
+
+	clockNs = run_passes(empty_update, 0).idle_pass_ns;
+	scan = run_passes(scan_update, clockNs);
+	sorted = run_passes(Scheduler_Update, clockNs);
+
+	printf("%d tasks, %d passes\n", BENCH_NUM_TASKS, BENCH_DURATION_MS);
+	printf("        idle pass   per task run   task runs\n");
+	printf("scan:   %6.1f ns   %9.1f ns   %9llu\n", scan.idle_pass_ns, scan.run_ns, (unsigned long long)scan.runs);
+	printf("sorted: %6.1f ns   %9.1f ns   %9llu\n", sorted.idle_pass_ns, sorted.run_ns, (unsigned long long)sorted.runs);
+
+	if (scan.runs != sorted.runs) {
+		printf("FAIL: the two schedulers ran the tasks a different number of times\n");
+		return 1;
+	}
+
+	return 0;
+}
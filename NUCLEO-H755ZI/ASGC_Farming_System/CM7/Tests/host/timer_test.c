@@ -0,0 +1,251 @@
+/*-----------------------------------------------------------------------------
+ *
+ * 	timer_test.c
+ *
+ * 		Host tests of getTimestampUs() across a wrap of the 32 bit
+ * 		microsecond counter. timer.c is built into this file with TIM2
+ * 		replaced by a simulated timer, which moves on by one microsecond
+ * 		every time the firmware touches one of its registers, and runs
+ * 		ASGC_Timer_Wrap_IRQHandler() between two of those accesses the way
+ * 		the NVIC would:
+ *
+ * 		- uif pending: the wrap interrupt is taken within a few register
+ * 		               accesses, so it lands inside a read
+ * 		- late:        the wrap interrupt is taken several reads after the
+ * 		               wrap, so reads see the update flag set
+ * 		- masked:      interrupts are masked over the wrap and for the
+ * 		               first half of the reads, then unmasked
+ *
+ * 		Each case starts from every offset around each of the first wraps.
+ * 		Every read must fall between the time the call started and the
+ * 		time it returned, must not go back, and the wrap must be counted
+ * 		exactly once.
+ *
+ * 		Build and run with 'make test' in this directory.
+ *
+-----------------------------------------------------------------------------*/
+
+#include "timer.h"
+#include <stdio.h>
+
+static TIM_TypeDef *host_tim2();
+
+#undef TIMER_US_TIM
+#define TIMER_US_TIM						(host_tim2())
+
+#include "timer.c"
+
+/*-----------------------------------------------------------------------------
+DEFINES
+-----------------------------------------------------------------------------*/
+#define TEST_WRAPS							3
+#define TEST_MAX_OFFSET_US					12
+						/* Start up to this far either side of a wrap		 */
+#define TEST_READS							40
+#define TEST_MAX_IRQ_DELAY					5
+						/* uif pending: accesses before the interrupt runs	 */
+#define TEST_LATE_IRQ_DELAYS				{ 8, 16, 32, 64 }
+						/* late: a read is three to four accesses			 */
+
+/*-----------------------------------------------------------------------------
+STATIC VARIABLES
+-----------------------------------------------------------------------------*/
+static TIM_TypeDef hostTim;
+static uint64_t hostTimeUs;				/* Time on the simulated TIM2		 */
+static uint32_t hostWrapsCleared;		/* Wraps whose update flag the		 */
+										/* interrupt has cleared			 */
+static bool hostFlagShown;				/* UIF set in hostTim.SR			 */
+static uint32_t hostFlagAccesses;		/* Accesses since UIF was set		 */
+static uint32_t hostIrqDelay;
+static bool hostIrqMasked;
+static bool hostInIrq;
+
+static uint32_t testFailures;
+
+/* Firmware the rest of timer.c links against, never called here */
+__IO uint32_t uwTick;
+
+bool Work_Queue_Is_Empty() {
+	return true;
+}
+
+uint32_t HAL_RCC_GetPCLK1Freq() {
+	return 0;
+}
+
+uint32_t HAL_GetTick() {
+	return 0;
+}
+
+void HAL_SuspendTick() {
+}
+
+void HAL_ResumeTick() {
+}
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		take_flag_clear()
+ *
+ * 		The only write to SR is the interrupt clearing UIF. Once it has,
+ * 		every wrap so far is counted as cleared.
+ *
+ ----------------------------------------------------------------------------*/
+static void take_flag_clear() {
+	if (hostFlagShown && (hostTim.SR & TIM_SR_UIF) == 0) {
+		hostWrapsCleared = (uint32_t)(hostTimeUs >> 32);
+		hostFlagShown = false;
+	}
+}
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		host_tim2()
+ *
+ * 		Stands in for TIM2 on every register access. Moves the counter on,
+ * 		sets UIF while a wrap has not been cleared, then runs the wrap
+ * 		interrupt if it is unmasked and has been pending for hostIrqDelay
+ * 		accesses. The interrupt reaches TIM2 through here as well.
+ *
+ ----------------------------------------------------------------------------*/
+static TIM_TypeDef *host_tim2() {
+	take_flag_clear();
+
+	hostTimeUs++;
+
+	if ((uint32_t)(hostTimeUs >> 32) != hostWrapsCleared) {
+		hostFlagAccesses = hostFlagShown ? hostFlagAccesses + 1 : 0;
+		hostFlagShown = true;
+	}
+
+	hostTim.CNT = (uint32_t)hostTimeUs;
+	hostTim.SR = hostFlagShown ? TIM_SR_UIF : 0;
+
+	if (hostFlagShown && !hostIrqMasked && !hostInIrq && hostFlagAccesses >= hostIrqDelay) {
+		hostInIrq = true;
+		ASGC_Timer_Wrap_IRQHandler();
+		hostInIrq = false;
+
+		take_flag_clear();
+	}
+
+	return &hostTim;
+}
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		start_at()
+ *
+ * 		Puts the simulated TIM2 at start_us, with every wrap so far counted.
+ * 		If already_pending is not 0, the last wrap came that many
+ * 		microseconds ago and is left for the interrupt.
+ *
+ ----------------------------------------------------------------------------*/
+static void start_at(uint64_t start_us, uint32_t already_pending) {
+	uint32_t wraps = (uint32_t)(start_us >> 32);
+
+	hostTimeUs = start_us;
+	hostFlagShown = false;
+	hostFlagAccesses = 0;
+
+	if (already_pending != 0) {
+		wraps--;
+		hostFlagShown = true;
+		hostFlagAccesses = already_pending;
+	}
+
+	hostWrapsCleared = wraps;
+	hostTim.CNT = (uint32_t)start_us;
+	hostTim.SR = hostFlagShown ? TIM_SR_UIF : 0;
+	s_usWraps = wraps;
+}
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		run_reads()
+ *
+ * 		TEST_READS calls of getTimestampUs() from where start_at() left the
+ * 		timer. Interrupts are masked for the first mask_reads of them.
+ * 		Returns the number of checks that failed.
+ *
+ ----------------------------------------------------------------------------*/
+static uint32_t run_reads(uint32_t irq_delay, uint32_t mask_reads) {
+	uint64_t before, after, read, lastRead = 0;
+	uint32_t failures = 0;
+
+	hostIrqDelay = irq_delay;
+
+	for (uint32_t i = 0; i < TEST_READS; i++) {
+		hostIrqMasked = (i < mask_reads);
+
+		before = hostTimeUs;
+		read = getTimestampUs();
+		after = hostTimeUs;
+
+		if (read < before || read > after) {
+			failures++;
+		}
+		if (read < lastRead) {
+			failures++;
+		}
+		lastRead = read;
+	}
+
+	// Touch TIM2 once more unmasked, so a wrap still pending is serviced
+	hostIrqMasked = false;
+	hostIrqDelay = 0;
+	(void)host_tim2();
+
+	if (s_usWraps != (uint32_t)(hostTimeUs >> 32)) {
+		failures++;
+	}
+
+	return failures;
+}
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		run_case()
+ *
+ * 		Runs the reads from every offset around each of the first
+ * 		TEST_WRAPS wraps, with each of the num_delays interrupt delays, and
+ * 		prints the result.
+ *
+ ----------------------------------------------------------------------------*/
+static void run_case(const char *name, const uint32_t *irq_delays, uint32_t num_delays, uint32_t mask_reads) {
+	uint64_t wrapUs;
+	uint32_t failures = 0;
+	uint32_t runs = 0;
+
+	for (uint32_t d = 0; d < num_delays; d++) {
+		for (uint32_t wrap = 1; wrap <= TEST_WRAPS; wrap++) {
+			wrapUs = (uint64_t)wrap << 32;
+
+			for (int32_t offset = -TEST_MAX_OFFSET_US; offset <= TEST_MAX_OFFSET_US; offset++) {
+				// A start after the wrap has the wrap pending, not yet counted
+				start_at(wrapUs + offset, (offset > 0) ? (uint32_t)offset : 0);
+				failures += run_reads(irq_delays[d], mask_reads);
+				runs++;
+			}
+		}
+	}
+
+	printf("%-12s %5lu runs   %s\n", name, (unsigned long)runs, (failures == 0) ? "pass" : "FAIL");
+	testFailures += failures;
+}
+
+int main() {
+	uint32_t pendingDelays[TEST_MAX_IRQ_DELAY + 1];
+	const uint32_t lateDelays[] = TEST_LATE_IRQ_DELAYS;
+	const uint32_t maskedDelays[] = { 0 };
+
+	for (uint32_t d = 0; d <= TEST_MAX_IRQ_DELAY; d++) {
+		pendingDelays[d] = d;
+	}
+
+	run_case("uif pending", pendingDelays, TEST_MAX_IRQ_DELAY + 1, 0);
+	run_case("late", lateDelays, sizeof(lateDelays) / sizeof(lateDelays[0]), 0);
+	run_case("masked", maskedDelays, 1, TEST_READS / 2);
+
+	return (testFailures == 0) ? 0 : 1;
+}
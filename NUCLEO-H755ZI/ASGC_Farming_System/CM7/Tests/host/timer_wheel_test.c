@@ -0,0 +1,362 @@
+/*-----------------------------------------------------------------------------
+ *
+ * 	timer_wheel_test.c
+ *
+ * 		Host model check of Timer_Wheel.c. Every timer is also kept in a
+ * 		naive model, a running flag and a deadline per timer, and a long
+ * 		run of random steps is made against both:
+ *
+ * 		- start:   one-shot or periodic, delays from 0 ms to past the top
+ * 		           level of the wheel, from the main loop or from a callback
+ * 		- restart, cancel, also from a callback, of timers waiting to run
+ * 		- update:  the time moves on by 1 ms to 5000 s, or to the time
+ * 		           Timer_Wheel_Get_Ms_Until_Next() gave, then
+ * 		           Timer_Wheel_Update() runs
+ *
+ * 		A callback must be of a running timer that is due, and the
+ * 		callbacks of an update must come in the order of their deadlines.
+ * 		No timer may be left due after an update. Timer_Wheel_Is_Running()
+ * 		must agree with the model, and the time Timer_Wheel_Get_Ms_Until_Next()
+ * 		gives must not be past the earliest deadline.
+ *
+ * 		Each run starts the wheel at a different time, some just before a
+ * 		level rolls over.
+ *
+ * 		Build and run with 'make timer_wheel_test' in this directory.
+ *
+-----------------------------------------------------------------------------*/
+
+#include "Timer_Wheel.h"
+#include "host_stubs.h"
+#include <stdio.h>
+
+/*-----------------------------------------------------------------------------
+DEFINES
+-----------------------------------------------------------------------------*/
+#define TEST_STEPS							200000
+						/* Per run									 */
+#define TEST_MAX_DELAY_MS					19800000
+						/* 5.5 hours, past the top level			 */
+#define TEST_MAX_PERIOD_MS					600000
+#define TEST_MAX_ADVANCE_MS					5000000
+#define TEST_START_TIMES					{ 0, 4000, 262100, 16777000, 1073741800 }
+#define TEST_CALLBACK_OP_PERCENT			20
+						/* Callbacks that start or cancel a timer	 */
+
+/*-----------------------------------------------------------------------------
+TYPEDEFS
+-----------------------------------------------------------------------------*/
+typedef struct Model_Timer {
+	bool running;
+	uint64_t deadline;
+	uint32_t delay_ms;					/* Of the last start, for restarts	 */
+	uint32_t period_ms;
+}Model_Timer_t;
+
+/*-----------------------------------------------------------------------------
+STATIC VARIABLES
+-----------------------------------------------------------------------------*/
+static Model_Timer_t modelTimers[TIMER_WHEEL_MAX_TIMERS];
+static Timer_Wheel_ID_t timerIds[TIMER_WHEEL_MAX_TIMERS];
+static uint64_t nextTick;				/* The wheel's first tick not run	 */
+static uint64_t lastFiredDeadline;		/* In the update being run			 */
+static bool inUpdate;
+
+static uint32_t randomState;
+static uint64_t stepCount;
+static uint32_t runFailures;
+static uint32_t testFailures;
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		next_random()
+ *
+ * 		Linear congruential generator, so every run is the same.
+ *
+ ----------------------------------------------------------------------------*/
+static uint32_t next_random() {
+	randomState = randomState * 1664525u + 1013904223u;
+
+	return randomState >> 8;
+}
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		fail()
+ *
+ * 		Counts a failed check, and prints the first one of the run.
+ *
+ ----------------------------------------------------------------------------*/
+static void fail(const char *what, uint32_t timer) {
+	if (runFailures == 0) {
+		printf("  step %llu, %llu ms, timer %lu: %s\n", (unsigned long long)stepCount,
+		       (unsigned long long)host_timestamp_ms, (unsigned long)timer, what);
+	}
+
+	runFailures++;
+}
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		random_delay()
+ *
+ * 		A delay of 0 ms, within a level of the wheel, or past the top one.
+ *
+ ----------------------------------------------------------------------------*/
+static uint32_t random_delay() {
+	switch (next_random() % 6) {
+	case 0:
+		return 0;
+	case 1:
+		return next_random() % 64;
+	case 2:
+		return next_random() % 4096;
+	case 3:
+		return next_random() % 262144;
+	case 4:
+		return next_random() % 16777216;
+	default:
+		return next_random() % TEST_MAX_DELAY_MS;
+	}
+}
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		model_start()
+ *
+ * 		What Timer_Wheel_Start() does to the model. A deadline already
+ * 		passed is run on the next tick.
+ *
+ ----------------------------------------------------------------------------*/
+static void model_start(uint32_t timer, uint32_t delay_ms, uint32_t period_ms) {
+	Model_Timer_t *model = &modelTimers[timer];
+
+	model->running = true;
+	model->delay_ms = delay_ms;
+	model->period_ms = period_ms;
+	model->deadline = host_timestamp_ms + delay_ms;
+
+	if (model->deadline < nextTick) {
+		model->deadline = nextTick;
+	}
+}
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		random_op()
+ *
+ * 		Starts, restarts or cancels a random timer, on the wheel and in the
+ * 		model.
+ *
+ ----------------------------------------------------------------------------*/
+static void random_op() {
+	uint32_t timer = next_random() % TIMER_WHEEL_MAX_TIMERS;
+	uint32_t delay, period;
+
+	switch (next_random() % 4) {
+	case 0:
+		delay = random_delay();
+		Timer_Wheel_Start(timerIds[timer], delay, 0);
+		model_start(timer, delay, 0);
+		break;
+
+	case 1:
+		delay = random_delay();
+		period = 1 + next_random() % ((next_random() % 2) ? 100 : TEST_MAX_PERIOD_MS);
+		Timer_Wheel_Start(timerIds[timer], delay, period);
+		model_start(timer, delay, period);
+		break;
+
+	case 2:
+		Timer_Wheel_Restart(timerIds[timer]);
+		model_start(timer, modelTimers[timer].delay_ms, modelTimers[timer].period_ms);
+		break;
+
+	default:
+		Timer_Wheel_Cancel(timerIds[timer]);
+		modelTimers[timer].running = false;
+		break;
+	}
+}
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		test_callback()
+ *
+ * 		Callback of every timer, 'argument' is its index. Checks the timer
+ * 		is due and in deadline order, moves the model on the way the wheel
+ * 		does, and now and then starts or cancels a timer itself.
+ *
+ ----------------------------------------------------------------------------*/
+static void test_callback(uint32_t argument) {
+	Model_Timer_t *model = &modelTimers[argument];
+	uint64_t curTime = host_timestamp_ms;
+
+	if (!inUpdate) {
+		fail("callback outside Timer_Wheel_Update()", argument);
+		return;
+	}
+
+	if (!model->running) {
+		fail("callback of a timer not running", argument);
+		return;
+	}
+
+	if (model->deadline > curTime) {
+		fail("callback early", argument);
+	}
+
+	if (model->deadline < lastFiredDeadline) {
+		fail("callback out of deadline order", argument);
+	}
+
+	lastFiredDeadline = model->deadline;
+	nextTick = model->deadline + 1;
+
+	if (model->period_ms == 0) {
+		model->running = false;
+	}
+	else {
+		model->deadline += model->period_ms;
+
+		if (model->deadline <= curTime) {
+			model->deadline += ((curTime - model->deadline) / model->period_ms + 1) * model->period_ms;
+		}
+	}
+
+	if (next_random() % 100 < TEST_CALLBACK_OP_PERCENT) {
+		random_op();
+	}
+}
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		check_wheel()
+ *
+ * 		After an update: no timer left due, every timer running as in the
+ * 		model, and the time until the next one not past the earliest
+ * 		deadline. Returns that time.
+ *
+ ----------------------------------------------------------------------------*/
+static uint32_t check_wheel() {
+	uint64_t earliest = UINT64_MAX;
+	uint32_t untilNext;
+
+	for (uint32_t timer = 0; timer < TIMER_WHEEL_MAX_TIMERS; timer++) {
+		if (Timer_Wheel_Is_Running(timerIds[timer]) != modelTimers[timer].running) {
+			fail("running differs from the model", timer);
+		}
+
+		if (!modelTimers[timer].running) {
+			continue;
+		}
+
+		if (modelTimers[timer].deadline <= host_timestamp_ms) {
+			fail("callback missed", timer);
+		}
+
+		if (modelTimers[timer].deadline < earliest) {
+			earliest = modelTimers[timer].deadline;
+		}
+	}
+
+	untilNext = Timer_Wheel_Get_Ms_Until_Next();
+
+	if (earliest == UINT64_MAX) {
+		if (untilNext != TIMER_WHEEL_NO_PENDING_TIMER_MS) {
+			fail("time until next with no timer running", 0);
+		}
+	}
+	else if (untilNext == TIMER_WHEEL_NO_PENDING_TIMER_MS || host_timestamp_ms + untilNext > earliest) {
+		fail("time until next past the earliest deadline", 0);
+	}
+
+	return untilNext;
+}
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		random_advance()
+ *
+ * 		How far the time moves on before the next update: mostly a few
+ * 		milliseconds, now and then minutes or hours, or to the next timer.
+ *
+ ----------------------------------------------------------------------------*/
+static uint64_t random_advance(uint32_t until_next) {
+	switch (next_random() % 10) {
+	case 0:
+	case 1:
+		if (until_next != TIMER_WHEEL_NO_PENDING_TIMER_MS) {
+			return (until_next == 0) ? 1 : until_next;
+		}
+		return 1;
+	case 2:
+		return 1 + next_random() % 5000;
+	case 3:
+		return 1 + next_random() % ((next_random() % 8 == 0) ? TEST_MAX_ADVANCE_MS : 300000);
+	default:
+		return 1 + next_random() % 64;
+	}
+}
+
+/*-----------------------------------------------------------------------------
+ *
+ * 		run()
+ *
+ * 		TEST_STEPS random steps from start_ms, and prints the result.
+ *
+ ----------------------------------------------------------------------------*/
+static void run(uint64_t start_ms) {
+	uint32_t untilNext = TIMER_WHEEL_NO_PENDING_TIMER_MS;
+	uint64_t updates = 0;
+	uint32_t ops;
+
+	host_timestamp_ms = start_ms;
+	randomState = (uint32_t)start_ms + 1;
+	runFailures = 0;
+
+	Timer_Wheel_Init();
+	nextTick = start_ms + 1;
+
+	for (uint32_t timer = 0; timer < TIMER_WHEEL_MAX_TIMERS; timer++) {
+		timerIds[timer] = Timer_Wheel_Create(test_callback, timer);
+		modelTimers[timer] = (Model_Timer_t){ 0 };
+	}
+
+	if (Timer_Wheel_Create(test_callback, 0) != TIMER_WHEEL_NO_TIMER) {
+		fail("more than TIMER_WHEEL_MAX_TIMERS created", 0);
+	}
+
+	for (stepCount = 0; stepCount < TEST_STEPS; stepCount++) {
+		ops = next_random() % 4;
+
+		for (uint32_t i = 0; i < ops; i++) {
+			random_op();
+		}
+
+		host_timestamp_ms += random_advance(untilNext);
+
+		lastFiredDeadline = 0;
+		inUpdate = true;
+		Timer_Wheel_Update();
+		inUpdate = false;
+		nextTick = host_timestamp_ms + 1;
+		updates++;
+
+		untilNext = check_wheel();
+	}
+
+	printf("start %10llu ms   %7llu updates   %s\n", (unsigned long long)start_ms,
+	       (unsigned long long)updates, (runFailures == 0) ? "pass" : "FAIL");
+	testFailures += runFailures;
+}
+
+int main() {
+	const uint64_t startTimes[] = TEST_START_TIMES;
+
+	for (uint32_t i = 0; i < sizeof(startTimes) / sizeof(startTimes[0]); i++) {
+		run(startTimes[i]);
+	}
+
+	return (testFailures == 0) ? 0 : 1;
+}